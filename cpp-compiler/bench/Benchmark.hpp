@@ -0,0 +1,103 @@
+// Benchmark.hpp
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Timing context handed to a benchmark body. The clock runs from the start
+// of the body; setup that should not count goes between pause() and
+// resume().
+class BenchmarkState
+{
+public:
+    void pause() noexcept { elapsed += Clock::now() - started; }
+    void resume() noexcept { started = Clock::now(); }
+
+    void setItems(size_t count) noexcept { items = count; }
+    void setBytes(size_t count) noexcept { bytes = count; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    Clock::time_point started = Clock::now();
+    Clock::duration elapsed{};
+    size_t items = 0;
+    size_t bytes = 0;
+
+    friend class BenchmarkRunner;
+};
+
+// Runs each registered body several times and reports the fastest run,
+// which is the least noisy estimate on a shared machine
+class BenchmarkRunner
+{
+public:
+    using Body = std::function<void(BenchmarkState&)>;
+
+    explicit BenchmarkRunner(int repetitions = 5) noexcept
+      : repetitions(repetitions)
+    {
+    }
+
+    void add(std::string name, Body body)
+    {
+        benchmarks.push_back({ std::move(name), std::move(body) });
+    }
+
+    int run(const std::string& filter) const
+    {
+        std::printf("%-28s %12s %14s %12s\n",
+                    "benchmark",
+                    "time (ms)",
+                    "items/s",
+                    "MB/s");
+
+        int ran = 0;
+        for (const auto& benchmark : benchmarks) {
+            if (!filter.empty() &&
+                benchmark.name.find(filter) == std::string::npos) {
+                continue;
+            }
+
+            double best = 0;
+            size_t items = 0;
+            size_t bytes = 0;
+            for (int i = 0; i < repetitions; ++i) {
+                BenchmarkState state;
+                benchmark.body(state);
+                state.pause();
+                double seconds =
+                  std::chrono::duration<double>(state.elapsed).count();
+                if (i == 0 || seconds < best) {
+                    best = seconds;
+                }
+                items = state.items;
+                bytes = state.bytes;
+            }
+
+            std::printf("%-28s %12.3f %14.0f %12.1f\n",
+                        benchmark.name.c_str(),
+                        best * 1e3,
+                        best > 0 ? items / best : 0.0,
+                        best > 0 ? bytes / best / 1e6 : 0.0);
+            ++ran;
+        }
+        return ran;
+    }
+
+private:
+    struct Entry
+    {
+        std::string name;
+        Body body;
+    };
+
+    int repetitions;
+    std::vector<Entry> benchmarks;
+};
+
+#endif // BENCHMARK_HPP
@@ -0,0 +1,144 @@
+#include "InputGenerators.hpp"
+
+std::string generateWideBlock(size_t statements)
+{
+    std::string source = "int main()\n{\n    int v0 = 1;\n";
+    for (size_t i = 1; i < statements; ++i) {
+        std::string name = "v" + std::to_string(i);
+        std::string previous = "v" + std::to_string(i - 1);
+        source += "    int " + name + " = " + previous + " + " +
+                  std::to_string(i) + " * " + previous + ";\n";
+    }
+    source += "    return 0;\n}\n";
+    return source;
+}
+
+std::string generateDeepChain(size_t terms)
+{
+    static const char* const operators[] = { " + ", " * ", " - ", " / " };
+    static const char* const operands[] = { "a", "b", "c", "3", "d" };
+
+    std::string source = "int main()\n{\n    int a = 1;\n    int b = 2;\n"
+                         "    int c = 3;\n    int d = 4;\n    int x = a";
+    for (size_t i = 1; i < terms; ++i) {
+        source += operators[i % 4];
+        source += operands[i % 5];
+        if (i % 8 == 0) {
+            source += "\n        ";
+        }
+    }
+    source += ";\n    return x;\n}\n";
+    return source;
+}
+
+std::string generateIfElseLadder(size_t rungs)
+{
+    std::string source = "int main()\n{\n    int x = 7;\n    int y = 0;\n    ";
+    for (size_t i = 0; i < rungs; ++i) {
+        source += "if (x == " + std::to_string(i) + ") {\n        y = y + " +
+                  std::to_string(i) + ";\n    } else ";
+    }
+    source += "{\n        y = 1;\n    }\n    return y;\n}\n";
+    return source;
+}
+
+std::string generateHugeStrings(size_t count, size_t length)
+{
+    std::string source = "int main()\n{\n";
+    for (size_t i = 0; i < count; ++i) {
+        source += "    std::string s" + std::to_string(i) + " = \"";
+        for (size_t j = 0; j < length; ++j) {
+            source += static_cast<char>('a' + (i + j) % 26);
+        }
+        source += "\";\n";
+    }
+    source += "    return 0;\n}\n";
+    return source;
+}
+
+std::string generateLoops(size_t loops)
+{
+    std::string source = "int main()\n{\n    int n = 100;\n    int sum = 0;\n";
+    for (size_t l = 0; l < loops; ++l) {
+        std::string i = "i" + std::to_string(l);
+        std::string j = "j" + std::to_string(l);
+        std::string k = std::to_string(l % 7 + 1);
+        source += "    for (int " + i + " = 0; " + i + " < n; " + i + " = " +
+                  i + " + 1) {\n        int k = n * " + k + " + " + k +
+                  ";\n        sum = sum + " + i + " * k;\n        int " +
+                  j + " = 0;\n        while (" + j +
+                  " < 3) {\n            sum = sum - " + j + " * " + k +
+                  ";\n            " + j + " = " + j +
+                  " + 1;\n        }\n    }\n";
+    }
+    source += "    return sum % 256;\n}\n";
+    return source;
+}
+
+std::string generateManyFunctions(size_t functions, size_t statements)
+{
+    std::string source;
+    for (size_t f = 0; f < functions; ++f) {
+        source += "int f" + std::to_string(f) + "()\n{\n    int a = " +
+                  std::to_string(f) + ";\n";
+        for (size_t i = 1; i < statements; ++i) {
+            std::string k = std::to_string(i);
+            if (i % 4 == 0) {
+                source += "    if (a > " + k + ") {\n        a = a - " + k +
+                          ";\n    } else {\n        a = a + 1;\n    }\n";
+            } else {
+                source += "    a = a * 3 + " + k + ";\n";
+            }
+        }
+        source += "    return a;\n}\n";
+    }
+    source += "int main()\n{\n    return 0;\n}\n";
+    return source;
+}
+
+std::string generateAccessorCalls(size_t helpers)
+{
+    std::string source;
+    for (size_t h = 0; h < helpers; ++h) {
+        std::string c = std::to_string(h % 7 + 1);
+        source += "int h" + std::to_string(h) + "(int v, int k)\n{\n" +
+                  (h % 2 == 0 ? "    return v * k + " + c + ";\n"
+                              : "    return v + k * " + c + ";\n") +
+                  "}\n";
+    }
+    source += "int main()\n{\n    int sum = 0;\n    for (int i = 0; i < "
+              "100; i = i + 1) {\n";
+    for (size_t h = 0; h < helpers; ++h) {
+        source += "        sum = h" + std::to_string(h) +
+                  "(sum, i % 5) % 10007;\n";
+    }
+    source += "    }\n    return sum % 256;\n}\n";
+    return source;
+}
+
+std::string generateBrokenBlock(size_t statements, size_t interval)
+{
+    std::string source = "int main()\n{\n    int v0 = 1;\n";
+    for (size_t i = 1; i < statements; ++i) {
+        std::string name = "v" + std::to_string(i);
+        std::string previous = "v" + std::to_string(i - 1);
+        std::string value = previous + " + " + std::to_string(i);
+        std::string end = ";";
+        if (i % interval == 0) {
+            switch (i / interval % 3) {
+                case 0:
+                    value = previous + " +";
+                    break;
+                case 1:
+                    end.clear();
+                    break;
+                default:
+                    value = "u" + std::to_string(i);
+                    break;
+            }
+        }
+        source += "    int " + name + " = " + value + end + "\n";
+    }
+    source += "    return 0;\n}\n";
+    return source;
+}
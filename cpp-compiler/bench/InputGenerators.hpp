@@ -0,0 +1,46 @@
+// InputGenerators.hpp
+#ifndef INPUT_GENERATORS_HPP
+#define INPUT_GENERATORS_HPP
+
+#include <cstddef>
+#include <string>
+
+// Synthetic translation units that scale with one knob. Each is a single
+// `int main()`, or a run of functions ending in one, that the pipeline
+// accepts end to end, shaped to stress a different part of it.
+
+// A long run of declarations and arithmetic, the shape our code
+// generators produce
+std::string generateWideBlock(size_t statements);
+
+// One declaration whose initializer is a left-leaning chain of `terms`
+// binary operations over a handful of variables
+std::string generateDeepChain(size_t terms);
+
+// An if / else if / ... / else ladder `rungs` long; each else branch nests
+// the next rung, so the tree is as deep as the ladder is long
+std::string generateIfElseLadder(size_t rungs);
+
+// `count` string declarations whose literals are `length` bytes each
+std::string generateHugeStrings(size_t count, size_t length);
+
+// `loops` for loops in turn, each recomputing an invariant and
+// multiplying its counter by it, around a while loop of its own; the work
+// the loop passes of -O2 take out of the body
+std::string generateLoops(size_t loops);
+
+// `functions` functions of `statements` statements each, mixing
+// arithmetic with if / else, followed by a main; the shape the per-function
+// parallel front end splits up
+std::string generateManyFunctions(size_t functions, size_t statements);
+
+// `helpers` one-line accessor-style functions and a main whose loop calls
+// each of them on every iteration; the call overhead -O2 inlines away
+std::string generateAccessorCalls(size_t helpers);
+
+// The wide block with every `interval`-th statement broken in turn by a
+// missing operand, a missing ';' or an undeclared variable; the one input
+// here the pipeline rejects, for measuring error recovery
+std::string generateBrokenBlock(size_t statements, size_t interval);
+
+#endif // INPUT_GENERATORS_HPP
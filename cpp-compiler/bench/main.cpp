@@ -0,0 +1,404 @@
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "AssemblyWriter.hpp"
+#include "Benchmark.hpp"
+#include "BytecodeProgram.hpp"
+#include "Compiler.hpp"
+#include "ControlFlowGraph.hpp"
+#include "IRGenerator.hpp"
+#include "InputGenerators.hpp"
+#include "JITProgram.hpp"
+#include "Lexer.hpp"
+#include "Optimizer.hpp"
+#include "RegisterAllocator.hpp"
+#include "TACImage.hpp"
+#include "ThreadPool.hpp"
+#include "X86Writer.hpp"
+
+namespace {
+
+class StringSink : public OutputSink
+{
+public:
+    std::string bytes;
+
+    void write(const char* data, size_t size) override
+    {
+        bytes.append(data, size);
+    }
+};
+
+// One generated input, tokenized once up front for the stages that start
+// from tokens. The source is also written to a temporary file for the
+// end-to-end benchmark.
+struct Workload
+{
+    std::string name;
+    std::string source;
+    std::shared_ptr<Lexer> lexer = std::make_shared<Lexer>();
+    std::vector<Token> tokens;
+    std::string path;
+
+    Workload(std::string name, std::string text)
+      : name(std::move(name))
+      , source(std::move(text))
+    {
+        lexer->setSource(source);
+        tokens = lexer->tokenize();
+
+        char pattern[] = "/tmp/tinycpp_bench_XXXXXX";
+        int fd = mkstemp(pattern);
+        if (fd < 0) {
+            throw std::runtime_error("Could not create a temporary file");
+        }
+        ::close(fd);
+        path = pattern;
+        std::ofstream(path, std::ios::binary) << source;
+    }
+    Workload(const Workload&) = delete;
+    Workload& operator=(const Workload&) = delete;
+
+    ~Workload() { std::remove(path.c_str()); }
+};
+
+void addPipelineBenchmarks(BenchmarkRunner& runner, const Workload& input)
+{
+    runner.add("tokenize/" + input.name, [&input](BenchmarkState& state) {
+        input.lexer->setSource(input.source);
+        auto result = input.lexer->tokenize();
+        state.setItems(result.size());
+        state.setBytes(input.source.size());
+    });
+
+    runner.add("parse/" + input.name, [&input](BenchmarkState& state) {
+        state.pause();
+        auto parser = std::make_shared<Parser>(input.lexer);
+        parser->setTokens(input.tokens);
+        state.resume();
+
+        [[maybe_unused]] StatementPtr ast = parser->parse();
+        state.setItems(input.tokens.size());
+
+        // Releasing the tree is measured separately by teardown/
+        state.pause();
+        parser.reset();
+        state.resume();
+    });
+
+    runner.add("generate/" + input.name, [&input](BenchmarkState& state) {
+        state.pause();
+        auto parser = std::make_shared<Parser>(input.lexer);
+        parser->setTokens(input.tokens);
+        StatementPtr ast = parser->parse();
+        IRGenerator generator(parser);
+        state.resume();
+
+        const TACProgram& program = generator.generateCode(ast);
+        state.setItems(program.code.size());
+    });
+
+    runner.add("optimize/" + input.name, [&input](BenchmarkState& state) {
+        state.pause();
+        auto parser = std::make_shared<Parser>(input.lexer);
+        parser->setTokens(input.tokens);
+        StatementPtr ast = parser->parse();
+        IRGenerator generator(parser);
+        TACProgram& program = generator.generateCode(ast);
+        size_t before = program.code.size();
+        state.resume();
+
+        Optimizer(Optimizer::MaxLevel).run(program);
+        state.setItems(before);
+    });
+
+    runner.add("allocate/" + input.name, [&input](BenchmarkState& state) {
+        state.pause();
+        auto parser = std::make_shared<Parser>(input.lexer);
+        parser->setTokens(input.tokens);
+        StatementPtr ast = parser->parse();
+        IRGenerator generator(parser);
+        TACProgram& program = generator.generateCode(ast);
+        state.resume();
+
+        AllocationSummary summary =
+          RegisterAllocator(RegisterSet::parse("16")).allocate(program);
+        state.setItems(summary.temps);
+    });
+
+    runner.add("cfg/" + input.name, [&input](BenchmarkState& state) {
+        state.pause();
+        auto parser = std::make_shared<Parser>(input.lexer);
+        parser->setTokens(input.tokens);
+        StatementPtr ast = parser->parse();
+        IRGenerator generator(parser);
+        const TACProgram& program = generator.generateCode(ast);
+        state.resume();
+
+        ControlFlowGraph graph(program);
+        state.setItems(graph.size());
+    });
+
+    runner.add("compile/" + input.name, [&input](BenchmarkState& state) {
+        Compiler compiler;
+        compiler.compile(input.path, "/dev/null");
+        state.setBytes(input.source.size());
+    });
+}
+
+} // namespace
+
+int main(int argc, const char* argv[])
+{
+    size_t size = 100000;
+    int repetitions = 5;
+    std::string filter;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--size" && i + 1 < argc) {
+            size = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--repetitions" && i + 1 < argc) {
+            repetitions = std::atoi(argv[++i]);
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--size N] [--repetitions N] [filter]\n";
+            return 1;
+        } else {
+            filter = arg;
+        }
+    }
+
+    // Every shape scales with --size. The chain and the ladder are kept to
+    // a tenth of it because the recursive passes nest one level per term or
+    // rung.
+    std::vector<std::unique_ptr<Workload>> workloads;
+    workloads.push_back(
+      std::make_unique<Workload>("wide-block", generateWideBlock(size)));
+    workloads.push_back(
+      std::make_unique<Workload>("deep-chain", generateDeepChain(size / 10)));
+    workloads.push_back(std::make_unique<Workload>(
+      "if-else-ladder", generateIfElseLadder(size / 10)));
+    workloads.push_back(std::make_unique<Workload>(
+      "huge-strings", generateHugeStrings(16, size * 4)));
+    workloads.push_back(
+      std::make_unique<Workload>("loops", generateLoops(size / 20)));
+    workloads.push_back(std::make_unique<Workload>(
+      "functions", generateManyFunctions(size / 20, 20)));
+
+    BenchmarkRunner runner(repetitions);
+    for (const auto& workload : workloads) {
+        addPipelineBenchmarks(runner, *workload);
+    }
+
+    const Workload& wide = *workloads.front();
+
+    runner.add("teardown/wide-block", [&](BenchmarkState& state) {
+        state.pause();
+        auto parser = std::make_shared<Parser>(wide.lexer);
+        parser->setTokens(wide.tokens);
+        [[maybe_unused]] StatementPtr ast = parser->parse();
+        state.resume();
+
+        parser.reset();
+        state.setItems(size);
+    });
+
+    // The emitter writes to /dev/null so only formatting and the write
+    // calls are measured, not the disk
+    auto emitParser = std::make_shared<Parser>(wide.lexer);
+    emitParser->setTokens(wide.tokens);
+    IRGenerator emitGenerator(emitParser);
+    const TACProgram& program = emitGenerator.generateCode(emitParser->parse());
+
+    runner.add("emit/wide-block", [&](BenchmarkState& state) {
+        FileSink sink("/dev/null");
+        AssemblyWriter writer(sink);
+        writer.write(program);
+        writer.flush();
+        state.setItems(program.code.size());
+        state.setBytes(writer.bytesWritten());
+    });
+
+    runner.add("emit-x86/wide-block", [&](BenchmarkState& state) {
+        FileSink sink("/dev/null");
+        X86Writer writer(sink);
+        writer.write(program);
+        writer.flush();
+        state.setItems(program.code.size());
+        state.setBytes(writer.bytesWritten());
+    });
+
+    runner.add("jit/wide-block", [&](BenchmarkState& state) {
+        JITProgram jit = JITProgram::compile(program);
+        state.setItems(program.code.size());
+        state.setBytes(jit.codeSize());
+    });
+
+    runner.add("bytecode/wide-block", [&](BenchmarkState& state) {
+        BytecodeProgram translated = BytecodeProgram::compile(program);
+        state.setItems(program.code.size());
+        state.setBytes(translated.size() *
+                       sizeof(BytecodeProgram::Instruction));
+    });
+
+    BytecodeProgram bytecode = BytecodeProgram::compile(program);
+    runner.add("interpret/wide-block", [&](BenchmarkState& state) {
+        bytecode.run();
+        state.setItems(bytecode.size());
+    });
+
+    // What --run costs for a unit the size of inputs/input.cpp, from
+    // reading the file to main's return
+    Workload tiny("tiny", generateWideBlock(8));
+    runner.add("run/tiny", [&tiny](BenchmarkState& state) {
+        Compiler compiler;
+        compiler.run(tiny.path);
+        state.setBytes(tiny.source.size());
+    });
+
+    // One Compiler for every iteration, as an embedder compiling a stream
+    // of buffers would use it; the front end allocates nothing after the
+    // first round
+    Compiler reused;
+    StringSink assembly;
+    runner.add("compile-buffer/tiny", [&](BenchmarkState& state) {
+        assembly.bytes.clear();
+        reused.compileSource(tiny.source, assembly);
+        state.setBytes(tiny.source.size());
+    });
+
+    runner.add("interpret/tiny", [&tiny](BenchmarkState& state) {
+        Compiler compiler;
+        compiler.setEngine(Compiler::Engine::Interpreter);
+        compiler.run(tiny.path);
+        state.setBytes(tiny.source.size());
+    });
+
+    runner.add("serialize/wide-block", [&](BenchmarkState& state) {
+        FileSink sink("/dev/null");
+        state.setItems(program.code.size());
+        state.setBytes(writeTACImage(program, sink));
+    });
+
+    // Mapping alone is constant time; verifying and copying back into a
+    // TACProgram is what a consumer that wants to mutate the IR pays
+    StringSink image;
+    writeTACImage(program, image);
+    runner.add("load/wide-block", [&](BenchmarkState& state) {
+        TACProgram loaded = TACImage::fromBytes(image.bytes).toProgram();
+        state.setItems(loaded.code.size());
+        state.setBytes(image.bytes.size());
+    });
+
+    // Every error is recorded and parsing goes on, so a badly broken unit
+    // costs one pass and one exception rather than one per error
+    Workload broken("broken-block", generateBrokenBlock(size, 10));
+    runner.add("diagnose/broken-block", [&](BenchmarkState& state) {
+        state.pause();
+        auto parser = std::make_shared<Parser>(broken.lexer);
+        parser->setTokens(broken.tokens);
+        state.resume();
+
+        try {
+            parser->parse();
+        } catch (const std::runtime_error&) {
+        }
+        state.setItems(parser->getDiagnostics().errorCount());
+
+        state.pause();
+        parser.reset();
+        state.resume();
+    });
+
+    // The functions of one unit checked and lowered on every core; the
+    // parse/ and generate/ entries above are the same stages on one thread
+    const Workload& functions = *workloads.back();
+    ThreadPool pool;
+    runner.add("parse-parallel/functions", [&](BenchmarkState& state) {
+        state.pause();
+        auto parser = std::make_shared<Parser>(functions.lexer);
+        parser->setTokens(functions.tokens);
+        parser->setThreadPool(&pool);
+        state.resume();
+
+        [[maybe_unused]] StatementPtr ast = parser->parse();
+        state.setItems(functions.tokens.size());
+
+        state.pause();
+        parser.reset();
+        state.resume();
+    });
+
+    runner.add("generate-parallel/functions", [&](BenchmarkState& state) {
+        state.pause();
+        auto parser = std::make_shared<Parser>(functions.lexer);
+        parser->setTokens(functions.tokens);
+        StatementPtr ast = parser->parse();
+        IRGenerator generator(parser);
+        generator.setThreadPool(&pool);
+        state.resume();
+
+        const TACProgram& program = generator.generateCode(ast);
+        state.setItems(program.code.size());
+    });
+
+    // Running the loops as lowered and after -O2, which hoists the
+    // invariants and turns the multiplies into additions
+    const Workload& loops = **(workloads.end() - 2);
+    auto loopParser = std::make_shared<Parser>(loops.lexer);
+    loopParser->setTokens(loops.tokens);
+    IRGenerator loopGenerator(loopParser);
+    TACProgram& loopProgram = loopGenerator.generateCode(loopParser->parse());
+    BytecodeProgram plainLoops = BytecodeProgram::compile(loopProgram);
+    Optimizer(Optimizer::MaxLevel).run(loopProgram);
+    BytecodeProgram optimizedLoops = BytecodeProgram::compile(loopProgram);
+
+    runner.add("interpret-O0/loops", [&](BenchmarkState& state) {
+        plainLoops.run();
+        state.setItems(plainLoops.size());
+    });
+
+    runner.add("interpret-O2/loops", [&](BenchmarkState& state) {
+        optimizedLoops.run();
+        state.setItems(optimizedLoops.size());
+    });
+
+    // A loop of calls to one-line helpers, each a frame push as lowered and
+    // a few instructions in place after -O2 inlines them
+    Workload calls("calls", generateAccessorCalls(size / 200));
+    auto callParser = std::make_shared<Parser>(calls.lexer);
+    callParser->setTokens(calls.tokens);
+    IRGenerator callGenerator(callParser);
+    TACProgram& callProgram = callGenerator.generateCode(callParser->parse());
+    BytecodeProgram plainCalls = BytecodeProgram::compile(callProgram);
+    Optimizer(Optimizer::MaxLevel).run(callProgram);
+    BytecodeProgram inlinedCalls = BytecodeProgram::compile(callProgram);
+
+    runner.add("interpret-O0/calls", [&](BenchmarkState& state) {
+        plainCalls.run();
+        state.setItems(plainCalls.size());
+    });
+
+    runner.add("interpret-O2/calls", [&](BenchmarkState& state) {
+        inlinedCalls.run();
+        state.setItems(inlinedCalls.size());
+    });
+
+    for (const auto& workload : workloads) {
+        std::cout << "input " << workload->name << ": "
+                  << workload->source.size() << " bytes, "
+                  << workload->tokens.size() << " tokens\n";
+    }
+    if (runner.run(filter) == 0) {
+        std::cerr << "No benchmark matches '" << filter << "'\n";
+        return 1;
+    }
+    return 0;
+}
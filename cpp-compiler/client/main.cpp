@@ -0,0 +1,68 @@
+// tinycpp_client: forwards one cpp_compiler command line to a daemon
+// started with `cpp_compiler --serve SOCKET` and relays its output and exit
+// status. It links only the socket protocol, so it starts in a fraction of
+// the time the compiler itself takes.
+#include <climits>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+#include "CompileServer.hpp"
+
+namespace {
+
+void writeAll(int fd, std::string_view text)
+{
+    while (!text.empty()) {
+        ssize_t count = ::write(fd, text.data(), text.size());
+        if (count <= 0) {
+            return;
+        }
+        text.remove_prefix(static_cast<size_t>(count));
+    }
+}
+
+std::string readAll(int fd)
+{
+    std::string bytes;
+    char chunk[64 * 1024];
+    ssize_t count;
+    while ((count = ::read(fd, chunk, sizeof(chunk))) > 0) {
+        bytes.append(chunk, static_cast<size_t>(count));
+    }
+    return bytes;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        writeAll(2,
+                 "Usage: tinycpp_client SOCKET [cpp_compiler arguments]\n");
+        return 1;
+    }
+
+    ServerRequest request;
+    char directory[PATH_MAX];
+    if (::getcwd(directory, sizeof(directory))) {
+        request.directory = directory;
+    }
+    bool readsStdin = false;
+    for (int i = 2; i < argc; ++i) {
+        request.args.emplace_back(argv[i]);
+        readsStdin = readsStdin || request.args.back() == "-";
+    }
+    if (readsStdin) {
+        request.input = readAll(0);
+    }
+
+    try {
+        ServerResponse response = CompileServer::send(argv[1], request);
+        writeAll(1, response.out);
+        writeAll(2, response.err);
+        return response.status;
+    } catch (const std::exception& e) {
+        writeAll(2, std::string("tinycpp_client: ") + e.what() + "\n");
+        return 1;
+    }
+}
@@ -1,24 +1,85 @@
 #ifndef AST_HPP
 #define AST_HPP
 
+#include <cstdint>
 #include <string>
-#include <vector>
-#include <memory>
-#include <stdexcept>
-#include <sstream>
-#include <unordered_map>
-#include <numeric>
-#include "SymbolTable.hpp"
+#include <string_view>
+#include "Arena.hpp"
+#include "SourceMap.hpp"
+#include "StringInterner.hpp"
+#include "Types.hpp"
+
+// Expression kinds come first so isExpression() is a single compare
+enum class NodeKind : std::uint8_t
+{
+    BinaryExpression,
+    LiteralExpression,
+    VariableExpression,
+    CallExpression,
+    BlockStatement,
+    VariableDeclaration,
+    AssignmentStatement,
+    ExpressionStatement,
+    ReturnStatement,
+    FunctionDeclaration,
+    IfStatement,
+    WhileStatement,
+    DoWhileStatement,
+    ForStatement,
+    TranslationUnit
+};
 
+// Nodes are allocated in the parser's Arena and released all at once, so
+// the hierarchy deliberately has no virtual destructor and node members
+// are views and arena lists rather than owning containers. Passes dispatch
+// on the kind tag through ASTVisitor rather than through virtual calls.
 class ASTNode
 {
 public:
-    virtual ~ASTNode() = default;
-    virtual std::string toString() const = 0;
-    virtual void checkSemantics(SymbolTable& symTable) const = 0;
+    NodeKind getKind() const noexcept { return kind; }
+
+    bool isExpression() const noexcept
+    {
+        return kind <= NodeKind::CallExpression;
+    }
+
+    // Implemented by ASTPrinter
+    std::string toString() const;
+
+    // Source offset of the token the node was parsed at, for diagnostics;
+    // NoOffset for nodes built by later passes
+    std::uint32_t getOffset() const noexcept { return offset; }
+    void setOffset(std::uint32_t at) noexcept { offset = at; }
+
+protected:
+    explicit ASTNode(NodeKind kind) noexcept
+      : kind(kind)
+    {
+    }
+
+private:
+    // Ahead of the kind, so that derived classes still pack their first
+    // small members into the padding after it and nodes do not grow
+    std::uint32_t offset = NoOffset;
+    NodeKind kind;
 };
 
-using ASTNodePtr = std::shared_ptr<ASTNode>;
+using ASTNodePtr = ASTNode*;
+
+// Checked downcast on the kind tag; returns nullptr for other kinds
+template <typename T>
+T* nodeCast(ASTNode* node) noexcept
+{
+    return node && node->getKind() == T::Kind ? static_cast<T*>(node)
+                                              : nullptr;
+}
+
+template <typename T>
+const T* nodeCast(const ASTNode* node) noexcept
+{
+    return node && node->getKind() == T::Kind ? static_cast<const T*>(node)
+                                              : nullptr;
+}
 
 enum class BinaryOp
 {
@@ -38,68 +99,41 @@ enum class BinaryOp
 class Expression : public ASTNode
 {
 public:
-    virtual std::string getType(const SymbolTable& symTable) const = 0;
-    virtual void checkSemantics(SymbolTable& symTable) const override = 0;
+    // Filled in once by SemanticAnalyzer; Unknown until then
+    TypeId getType() const noexcept { return type; }
+    void setType(TypeId resolved) noexcept { type = resolved; }
+
+protected:
+    using ASTNode::ASTNode;
+
+private:
+    TypeId type = TypeId::Unknown;
 };
 
-using ExpressionPtr = std::shared_ptr<Expression>;
+using ExpressionPtr = Expression*;
 
 class BinaryExpression : public Expression
 {
 public:
+    static constexpr NodeKind Kind = NodeKind::BinaryExpression;
+
     BinaryExpression(ExpressionPtr left,
                      BinaryOp op,
                      ExpressionPtr right) noexcept
-      : left(std::move(left))
+      : Expression(Kind)
+      , left(left)
       , op(op)
-      , right(std::move(right))
+      , right(right)
     {
     }
 
-    std::string getType(const SymbolTable& symTable) const override
-    {
-        std::string leftType = left->getType(symTable);
-        std::string rightType = right->getType(symTable);
-
-        if (op == BinaryOp::And || op == BinaryOp::Or) {
-            return "bool";
-        }
-
-        if ((leftType == "int" && rightType == "float") ||
-            (leftType == "float" && rightType == "int")) {
-            return "float";
-        }
-
-        if (leftType != rightType) {
-            throw std::runtime_error(
-              "Type mismatch in binary expression: " + leftType + " " +
-              opToString(op) + " " + rightType);
-        }
-
-        return leftType;
-    }
-
-    void checkSemantics(SymbolTable& symTable) const override
-    {
-        left->checkSemantics(symTable);
-        right->checkSemantics(symTable);
-    }
-
-    std::string toString() const override
-    {
-        return "(" + left->toString() + " " + opToString(op) + " " +
-               right->toString() + ")";
-    }
-
-    ExpressionPtr getLeft() const { return left; }
-    ExpressionPtr getRight() const { return right; }
+    ExpressionPtr getLeft() const noexcept { return left; }
+    ExpressionPtr getRight() const noexcept { return right; }
+    void setLeft(ExpressionPtr expr) noexcept { left = expr; }
+    void setRight(ExpressionPtr expr) noexcept { right = expr; }
+    BinaryOp getOperator() const noexcept { return op; }
     std::string getOp() const { return opToString(op); }
 
-private:
-    ExpressionPtr left;
-    BinaryOp op;
-    ExpressionPtr right;
-
     static constexpr const char* opToString(BinaryOp op) noexcept
     {
         switch (op) {
@@ -129,35 +163,25 @@ private:
                 return "?";
         }
     }
+
+private:
+    ExpressionPtr left;
+    BinaryOp op;
+    ExpressionPtr right;
 };
 
 class LiteralExpression : public Expression
 {
 public:
-    explicit LiteralExpression(const std::string& value) noexcept
-      : value(value)
-    {
-    }
+    static constexpr NodeKind Kind = NodeKind::LiteralExpression;
 
-    std::string getType(const SymbolTable&) const override
+    explicit LiteralExpression(std::string_view value) noexcept
+      : Expression(Kind)
+      , value(value)
     {
-        if (isCharacterLiteral())
-            return "char";
-        if (isStringLiteral())
-            return "std::string";
-        if (isFloatingPointLiteral())
-            return "float";
-        return "int";
     }
 
-    void checkSemantics(SymbolTable&) const override {}
-
-    std::string toString() const override { return value; }
-
-    const std::string& getValue() const noexcept { return value; }
-
-private:
-    std::string value;
+    std::string_view getValue() const noexcept { return value; }
 
     bool isCharacterLiteral() const noexcept
     {
@@ -172,304 +196,403 @@ private:
 
     bool isFloatingPointLiteral() const noexcept
     {
-        return value.find('.') != std::string::npos;
+        return value.find('.') != std::string_view::npos;
     }
+
+private:
+    std::string_view value;
 };
 
 class VariableExpression : public Expression
 {
 public:
-    explicit VariableExpression(const std::string& name) noexcept
-      : name(name)
+    static constexpr NodeKind Kind = NodeKind::VariableExpression;
+
+    VariableExpression(std::string_view name, Symbol symbol) noexcept
+      : Expression(Kind)
+      , name(name)
+      , symbol(symbol)
     {
     }
 
-    std::string getType(const SymbolTable& symTable) const override
+    std::string_view getName() const noexcept { return name; }
+
+    Symbol getSymbol() const noexcept { return symbol; }
+
+    // Which declaration of the name in its function the node binds, 0 for
+    // the first; set by SemanticAnalyzer
+    std::uint32_t getOrdinal() const noexcept { return ordinal; }
+    void setOrdinal(std::uint32_t value) noexcept { ordinal = value; }
+
+private:
+    std::string_view name;
+    Symbol symbol;
+    std::uint32_t ordinal = 0;
+};
+
+class FunctionDeclaration;
+
+// name(arguments...). The callee is resolved by SemanticAnalyzer, which
+// records its declaration here for the passes after it.
+class CallExpression : public Expression
+{
+public:
+    static constexpr NodeKind Kind = NodeKind::CallExpression;
+
+    CallExpression(std::string_view name,
+                   Symbol symbol,
+                   NodeList<ExpressionPtr> arguments) noexcept
+      : Expression(Kind)
+      , name(name)
+      , symbol(symbol)
+      , arguments(arguments)
     {
-        return symTable.lookupVariable(name);
     }
 
-    void checkSemantics(SymbolTable& symTable) const override
+    std::string_view getName() const noexcept { return name; }
+
+    Symbol getSymbol() const noexcept { return symbol; }
+
+    // Replaced in place by ConstantFolder
+    NodeList<ExpressionPtr> getArguments() const noexcept
     {
-        symTable.lookupVariable(name);
+        return arguments;
     }
 
-    std::string toString() const override { return name; }
-
-    const std::string& getName() const noexcept { return name; }
+    // Null until resolved, and for a call to an undeclared function
+    const FunctionDeclaration* getFunction() const noexcept
+    {
+        return function;
+    }
+    void setFunction(const FunctionDeclaration* callee) noexcept
+    {
+        function = callee;
+    }
 
 private:
-    std::string name;
+    std::string_view name;
+    Symbol symbol;
+    NodeList<ExpressionPtr> arguments;
+    const FunctionDeclaration* function = nullptr;
 };
 
 class Statement : public ASTNode
 {
-public:
-    virtual ~Statement() = default;
-    virtual void checkSemantics(SymbolTable& symTable) const override = 0;
+protected:
+    using ASTNode::ASTNode;
 };
 
-using StatementPtr = std::shared_ptr<Statement>;
+using StatementPtr = Statement*;
 
 class BlockStatement : public Statement
 {
 public:
-    explicit BlockStatement(const std::vector<StatementPtr>& statements)
-      : statements(statements)
-    {
-    }
-
-    void checkSemantics(SymbolTable& symTable) const override
-    {
-        for (const auto& stmt : statements) {
-            stmt->checkSemantics(symTable);
-        }
-    }
+    static constexpr NodeKind Kind = NodeKind::BlockStatement;
 
-    std::string toString() const override
+    explicit BlockStatement(NodeList<StatementPtr> statements) noexcept
+      : Statement(Kind)
+      , statements(statements)
     {
-        return std::accumulate(
-          statements.begin(),
-          statements.end(),
-          std::string(),
-          [](const std::string& acc, const StatementPtr& stmt) {
-              return acc + "  " + stmt->toString() + "\n";
-          });
     }
 
-    const std::vector<StatementPtr>& getStatements() const noexcept
+    NodeList<StatementPtr> getStatements() const noexcept
     {
         return statements;
     }
 
 private:
-    std::vector<StatementPtr> statements;
+    NodeList<StatementPtr> statements;
 };
 
 class VariableDeclaration : public Statement
 {
 public:
-    VariableDeclaration(std::string type,
-                        std::string name,
-                        ExpressionPtr initializer = nullptr)
-      : type(std::move(type))
-      , name(std::move(name))
-      , initializer(std::move(initializer))
+    static constexpr NodeKind Kind = NodeKind::VariableDeclaration;
+
+    VariableDeclaration(TypeId type,
+                        std::string_view name,
+                        Symbol symbol,
+                        ExpressionPtr initializer = nullptr) noexcept
+      : Statement(Kind)
+      , type(type)
+      , name(name)
+      , symbol(symbol)
+      , initializer(initializer)
     {
     }
 
-    void checkSemantics(SymbolTable& symTable) const override
-    {
-        symTable.declareVariable(name, type);
-
-        if (initializer) {
-            initializer->checkSemantics(symTable);
-            std::string initType = initializer->getType(symTable);
-
-            // Allow type promotion in assignments
-            if (initType == "int" && type == "float") {
-                // Promote int to float
-                initType = "float";
-            } else if (initType == "float" && type == "int") {
-                throw std::runtime_error(
-                  "Cannot assign float to int without explicit cast");
-            }
-
-            if (initType != type) {
-                throw std::runtime_error(
-                  "Type mismatch: Cannot initialize variable of type '" + type +
-                  "' with value of type '" + initType + "'");
-            }
-        }
-    }
+    TypeId getType() const noexcept { return type; }
 
-    std::string toString() const override
-    {
-        return type + " " + name + " = " +
-               (initializer ? initializer->toString() : "null") + ";";
-    }
+    std::string_view getName() const noexcept { return name; }
+
+    Symbol getSymbol() const noexcept { return symbol; }
 
-    const std::string& getName() const noexcept { return name; }
+    ExpressionPtr getInitializer() const noexcept { return initializer; }
+    void setInitializer(ExpressionPtr expr) noexcept { initializer = expr; }
 
-    const ExpressionPtr& getInitializer() const noexcept { return initializer; }
+    // Which declaration of the name in its function the node binds, 0 for
+    // the first; set by SemanticAnalyzer
+    std::uint32_t getOrdinal() const noexcept { return ordinal; }
+    void setOrdinal(std::uint32_t value) noexcept { ordinal = value; }
 
 private:
-    std::string type;
-    std::string name;
+    TypeId type;
+    std::string_view name;
+    Symbol symbol;
+    std::uint32_t ordinal = 0;
     ExpressionPtr initializer;
 };
 
 class AssignmentStatement : public Statement
 {
 public:
-    AssignmentStatement(std::string name, ExpressionPtr value)
-      : name(std::move(name))
-      , value(std::move(value))
+    static constexpr NodeKind Kind = NodeKind::AssignmentStatement;
+
+    AssignmentStatement(std::string_view name,
+                        Symbol symbol,
+                        ExpressionPtr value) noexcept
+      : Statement(Kind)
+      , name(name)
+      , symbol(symbol)
+      , value(value)
     {
     }
 
-    void checkSemantics(SymbolTable& symTable) const override
-    {
-        value->checkSemantics(symTable);
-        std::string varType = symTable.lookupVariable(name);
-        std::string valueType = value->getType(symTable);
-
-        // Allow type promotion in assignments
-        if (valueType == "int" && varType == "float") {
-            // Promote int to float
-            valueType = "float";
-        } else if (valueType == "float" && varType == "int") {
-            throw std::runtime_error(
-              "Cannot assign float to int without explicit cast");
-        }
+    std::string_view getName() const noexcept { return name; }
 
-        if (varType != valueType) {
-            throw std::runtime_error(
-              "Type mismatch in assignment: Cannot assign " + valueType +
-              " to " + varType);
-        }
-    }
+    Symbol getSymbol() const noexcept { return symbol; }
 
-    std::string toString() const override
-    {
-        return name + " = " + value->toString() + ";";
-    }
+    ExpressionPtr getValue() const noexcept { return value; }
+    void setValue(ExpressionPtr expr) noexcept { value = expr; }
 
-    const std::string& getName() const noexcept { return name; }
+    // Declared type of the assigned variable, resolved by SemanticAnalyzer
+    TypeId getTargetType() const noexcept { return targetType; }
+    void setTargetType(TypeId type) noexcept { targetType = type; }
 
-    const ExpressionPtr& getValue() const noexcept { return value; }
+    // Which declaration of the name in its function the node binds, 0 for
+    // the first; set by SemanticAnalyzer
+    std::uint32_t getOrdinal() const noexcept { return ordinal; }
+    void setOrdinal(std::uint32_t value) noexcept { ordinal = value; }
 
 private:
-    std::string name;
+    std::string_view name;
+    Symbol symbol;
+    std::uint32_t ordinal = 0;
     ExpressionPtr value;
+    TypeId targetType = TypeId::Unknown;
 };
 
-class ReturnStatement : public Statement
+// An expression evaluated for its effects; the parser only makes these
+// for calls
+class ExpressionStatement : public Statement
 {
 public:
-    explicit ReturnStatement(ExpressionPtr value = nullptr)
-      : value(std::move(value))
-    {
-    }
+    static constexpr NodeKind Kind = NodeKind::ExpressionStatement;
 
-    void checkSemantics(SymbolTable& symTable) const override
+    explicit ExpressionStatement(ExpressionPtr expression) noexcept
+      : Statement(Kind)
+      , expression(expression)
     {
-        if (value) {
-            value->checkSemantics(symTable);
-        }
     }
 
-    std::string toString() const override
+    ExpressionPtr getExpression() const noexcept { return expression; }
+    void setExpression(ExpressionPtr expr) noexcept { expression = expr; }
+
+private:
+    ExpressionPtr expression;
+};
+
+class ReturnStatement : public Statement
+{
+public:
+    static constexpr NodeKind Kind = NodeKind::ReturnStatement;
+
+    explicit ReturnStatement(ExpressionPtr value = nullptr) noexcept
+      : Statement(Kind)
+      , value(value)
     {
-        return "return " + value->toString() + ";";
     }
 
-    const ExpressionPtr& getReturnValue() const noexcept { return value; }
+    ExpressionPtr getReturnValue() const noexcept { return value; }
+    void setReturnValue(ExpressionPtr expr) noexcept { value = expr; }
 
 private:
     ExpressionPtr value;
 };
 
+struct Parameter
+{
+    TypeId type;
+    std::string_view name;
+    Symbol symbol;
+};
+
 class FunctionDeclaration : public Statement
 {
 public:
-    FunctionDeclaration(const std::string& returnType,
-                        const std::string& name,
-                        const std::vector<std::string>& parameters,
-                        const std::vector<StatementPtr>& body) noexcept
-      : returnType(returnType)
+    static constexpr NodeKind Kind = NodeKind::FunctionDeclaration;
+
+    FunctionDeclaration(TypeId returnType,
+                        std::string_view name,
+                        Symbol symbol,
+                        NodeList<Parameter> parameters,
+                        NodeList<StatementPtr> body) noexcept
+      : Statement(Kind)
+      , returnType(returnType)
       , name(name)
+      , symbol(symbol)
       , parameters(parameters)
       , body(body)
     {
     }
 
-    // checkSemantics marked noexcept because it doesn't throw exceptions
-    void checkSemantics(SymbolTable& symTable) const noexcept override
-    {
-        for (const auto& stmt : body) {
-            stmt->checkSemantics(symTable);
-        }
-    }
+    TypeId getReturnType() const noexcept { return returnType; }
 
-    // toString method rewritten using std::stringstream for efficiency
-    std::string toString() const noexcept override
-    {
-        std::stringstream result;
-        result << returnType << " " << name << "(";
-        for (size_t i = 0; i < parameters.size(); ++i) {
-            if (i > 0)
-                result << ", ";
-            result << parameters[i];
-        }
-        result << ")";
-        return result.str();
-    }
+    std::string_view getName() const noexcept { return name; }
 
-    std::string getName() const { return name; }
+    Symbol getSymbol() const noexcept { return symbol; }
 
-    const std::vector<StatementPtr>& getBody() const { return body; }
+    NodeList<Parameter> getParameters() const noexcept { return parameters; }
+
+    NodeList<StatementPtr> getBody() const noexcept { return body; }
 
 private:
-    std::string returnType;
-    std::string name;
-    std::vector<std::string> parameters;
-    std::vector<StatementPtr> body;
+    TypeId returnType;
+    std::string_view name;
+    Symbol symbol;
+    NodeList<Parameter> parameters;
+    NodeList<StatementPtr> body;
 };
 
 class IfStatement : public Statement
 {
 public:
+    static constexpr NodeKind Kind = NodeKind::IfStatement;
+
     IfStatement(ExpressionPtr condition,
                 StatementPtr thenBranch,
                 StatementPtr elseBranch = nullptr) noexcept
-      : condition(std::move(condition))
-      , thenBranch(std::move(thenBranch))
-      , elseBranch(std::move(elseBranch))
+      : Statement(Kind)
+      , condition(condition)
+      , thenBranch(thenBranch)
+      , elseBranch(elseBranch)
     {
     }
 
-    void checkSemantics(SymbolTable& symTable) const override
+    ExpressionPtr getCondition() const noexcept { return condition; }
+    void setCondition(ExpressionPtr expr) noexcept { condition = expr; }
+
+    StatementPtr getThenBranch() const noexcept { return thenBranch; }
+
+    StatementPtr getElseBranch() const noexcept { return elseBranch; }
+
+private:
+    ExpressionPtr condition;
+    StatementPtr thenBranch;
+    StatementPtr elseBranch;
+};
+
+class WhileStatement : public Statement
+{
+public:
+    static constexpr NodeKind Kind = NodeKind::WhileStatement;
+
+    WhileStatement(ExpressionPtr condition, StatementPtr body) noexcept
+      : Statement(Kind)
+      , condition(condition)
+      , body(body)
     {
-        // Check the semantics of the condition
-        condition->checkSemantics(symTable);
-
-        // Ensure the condition is a boolean expression
-        auto conditionType = condition->getType(symTable);
-        if (conditionType != "int" && conditionType != "bool") {
-            throw std::runtime_error(
-              "Condition in 'if' statement must be of type int or bool");
-        }
+    }
 
-        // Check the semantics of the then branch
-        thenBranch->checkSemantics(symTable);
+    ExpressionPtr getCondition() const noexcept { return condition; }
+    void setCondition(ExpressionPtr expr) noexcept { condition = expr; }
 
-        // Check the semantics of the else branch (if it exists)
-        if (elseBranch) {
-            elseBranch->checkSemantics(symTable);
-        }
+    StatementPtr getBody() const noexcept { return body; }
+
+private:
+    ExpressionPtr condition;
+    StatementPtr body;
+};
+
+class DoWhileStatement : public Statement
+{
+public:
+    static constexpr NodeKind Kind = NodeKind::DoWhileStatement;
+
+    DoWhileStatement(StatementPtr body, ExpressionPtr condition) noexcept
+      : Statement(Kind)
+      , body(body)
+      , condition(condition)
+    {
     }
 
-    std::string toString() const override
+    StatementPtr getBody() const noexcept { return body; }
+
+    ExpressionPtr getCondition() const noexcept { return condition; }
+    void setCondition(ExpressionPtr expr) noexcept { condition = expr; }
+
+private:
+    StatementPtr body;
+    ExpressionPtr condition;
+};
+
+// for (initializer; condition; update) body. Any of the first three may
+// be null; a missing condition loops until a return. The initializer is a
+// declaration or assignment scoped to the loop, the update an assignment.
+class ForStatement : public Statement
+{
+public:
+    static constexpr NodeKind Kind = NodeKind::ForStatement;
+
+    ForStatement(StatementPtr initializer,
+                 ExpressionPtr condition,
+                 StatementPtr update,
+                 StatementPtr body) noexcept
+      : Statement(Kind)
+      , initializer(initializer)
+      , condition(condition)
+      , update(update)
+      , body(body)
     {
-        std::string result =
-          "if (" + condition->toString() + ") " + thenBranch->toString();
-        if (elseBranch) {
-            result += " else " + elseBranch->toString();
-        }
-        return result;
     }
 
-    const ExpressionPtr& getCondition() const noexcept { return condition; }
+    StatementPtr getInitializer() const noexcept { return initializer; }
+
+    ExpressionPtr getCondition() const noexcept { return condition; }
+    void setCondition(ExpressionPtr expr) noexcept { condition = expr; }
 
-    const StatementPtr& getThenBranch() const noexcept { return thenBranch; }
+    StatementPtr getUpdate() const noexcept { return update; }
 
-    const StatementPtr& getElseBranch() const noexcept { return elseBranch; }
+    StatementPtr getBody() const noexcept { return body; }
 
 private:
+    StatementPtr initializer;
     ExpressionPtr condition;
-    StatementPtr thenBranch;
-    StatementPtr elseBranch;
+    StatementPtr update;
+    StatementPtr body;
+};
+
+// Root of a parsed unit: its top-level statements in source order. A unit
+// of more than one statement holds only function declarations, which share
+// no scope, so each can be checked and lowered independently of the rest.
+class TranslationUnit : public Statement
+{
+public:
+    static constexpr NodeKind Kind = NodeKind::TranslationUnit;
+
+    explicit TranslationUnit(NodeList<StatementPtr> statements) noexcept
+      : Statement(Kind)
+      , statements(statements)
+    {
+    }
+
+    NodeList<StatementPtr> getStatements() const noexcept
+    {
+        return statements;
+    }
+
+private:
+    NodeList<StatementPtr> statements;
 };
 
 #endif // AST_HPP
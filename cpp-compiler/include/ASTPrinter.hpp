@@ -0,0 +1,36 @@
+// ASTPrinter.hpp
+#ifndef AST_PRINTER_HPP
+#define AST_PRINTER_HPP
+
+#include <string>
+#include "ASTVisitor.hpp"
+
+// Renders a tree back to source-like text into a single growing buffer
+class ASTPrinter : public ASTVisitor<ASTPrinter>
+{
+public:
+    std::string print(const ASTNode& node);
+
+    void visit(const BinaryExpression& expr);
+    void visit(const LiteralExpression& expr);
+    void visit(const VariableExpression& expr);
+    void visit(const CallExpression& expr);
+    void visit(const BlockStatement& stmt);
+    void visit(const VariableDeclaration& stmt);
+    void visit(const AssignmentStatement& stmt);
+    void visit(const ExpressionStatement& stmt);
+    void visit(const ReturnStatement& stmt);
+    void visit(const FunctionDeclaration& stmt);
+    void visit(const IfStatement& stmt);
+    void visit(const WhileStatement& stmt);
+    void visit(const DoWhileStatement& stmt);
+    void visit(const ForStatement& stmt);
+    void visit(const TranslationUnit& unit);
+
+private:
+    std::string out;
+
+    void printNode(const ASTNode& node);
+};
+
+#endif // AST_PRINTER_HPP
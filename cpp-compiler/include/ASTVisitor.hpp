@@ -0,0 +1,95 @@
+// ASTVisitor.hpp
+#ifndef AST_VISITOR_HPP
+#define AST_VISITOR_HPP
+
+#include <type_traits>
+#include "AST.hpp"
+
+// CRTP dispatcher over the node kind tag. Derived classes provide a
+// visit() overload for every concrete node type; the switch compiles to a
+// jump table and each call is resolved statically, so dispatch cost does not
+// grow as node types are added. Passes that annotate or rewrite the tree set
+// Mutable and receive non-const nodes.
+template <typename Derived,
+          typename ExprResult = void,
+          typename StmtResult = void,
+          bool Mutable = false>
+class ASTVisitor
+{
+    template <typename Node>
+    using Ref = std::conditional_t<Mutable, Node&, const Node&>;
+
+public:
+    ExprResult visitExpression(Ref<Expression> expr)
+    {
+        switch (expr.getKind()) {
+            case NodeKind::BinaryExpression:
+                return derived().visit(
+                  static_cast<Ref<BinaryExpression>>(expr));
+            case NodeKind::LiteralExpression:
+                return derived().visit(
+                  static_cast<Ref<LiteralExpression>>(expr));
+            case NodeKind::VariableExpression:
+                return derived().visit(
+                  static_cast<Ref<VariableExpression>>(expr));
+            case NodeKind::CallExpression:
+                return derived().visit(
+                  static_cast<Ref<CallExpression>>(expr));
+            default:
+                break;
+        }
+        return unreachable<ExprResult>();
+    }
+
+    StmtResult visitStatement(Ref<Statement> stmt)
+    {
+        switch (stmt.getKind()) {
+            case NodeKind::BlockStatement:
+                return derived().visit(
+                  static_cast<Ref<BlockStatement>>(stmt));
+            case NodeKind::VariableDeclaration:
+                return derived().visit(
+                  static_cast<Ref<VariableDeclaration>>(stmt));
+            case NodeKind::AssignmentStatement:
+                return derived().visit(
+                  static_cast<Ref<AssignmentStatement>>(stmt));
+            case NodeKind::ExpressionStatement:
+                return derived().visit(
+                  static_cast<Ref<ExpressionStatement>>(stmt));
+            case NodeKind::ReturnStatement:
+                return derived().visit(
+                  static_cast<Ref<ReturnStatement>>(stmt));
+            case NodeKind::FunctionDeclaration:
+                return derived().visit(
+                  static_cast<Ref<FunctionDeclaration>>(stmt));
+            case NodeKind::IfStatement:
+                return derived().visit(static_cast<Ref<IfStatement>>(stmt));
+            case NodeKind::WhileStatement:
+                return derived().visit(
+                  static_cast<Ref<WhileStatement>>(stmt));
+            case NodeKind::DoWhileStatement:
+                return derived().visit(
+                  static_cast<Ref<DoWhileStatement>>(stmt));
+            case NodeKind::ForStatement:
+                return derived().visit(static_cast<Ref<ForStatement>>(stmt));
+            case NodeKind::TranslationUnit:
+                return derived().visit(
+                  static_cast<Ref<TranslationUnit>>(stmt));
+            default:
+                break;
+        }
+        return unreachable<StmtResult>();
+    }
+
+private:
+    Derived& derived() noexcept { return static_cast<Derived&>(*this); }
+
+    template <typename Result>
+    static Result unreachable()
+    {
+        // Only reached for a node whose kind tag does not match its class
+        __builtin_unreachable();
+    }
+};
+
+#endif // AST_VISITOR_HPP
@@ -0,0 +1,148 @@
+// Arena.hpp
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Fixed-size view of objects stored in an Arena
+template <typename T>
+class NodeList
+{
+public:
+    NodeList() noexcept = default;
+    NodeList(T* items, size_t count) noexcept
+      : items(items)
+      , count(count)
+    {
+    }
+
+    T* begin() const noexcept { return items; }
+    T* end() const noexcept { return items + count; }
+    T& operator[](size_t i) const noexcept { return items[i]; }
+    size_t size() const noexcept { return count; }
+    bool empty() const noexcept { return count == 0; }
+
+private:
+    T* items = nullptr;
+    size_t count = 0;
+};
+
+// Bump allocator for objects that die together. Nothing allocated here is
+// ever destroyed individually, so only trivially destructible types are
+// accepted. reset() rewinds to the first block but keeps every block for
+// reuse.
+class Arena
+{
+public:
+    explicit Arena(size_t blockSize = 64 * 1024) noexcept
+      : blockSize(blockSize)
+    {
+    }
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(size_t size, size_t alignment)
+    {
+        size_t aligned = (offset + alignment - 1) & ~(alignment - 1);
+        if (current < blocks.size() && aligned + size <= blocks[current].size) {
+            offset = aligned + size;
+            return blocks[current].data.get() + aligned;
+        }
+        return allocateSlow(size, alignment);
+    }
+
+    template <typename T, typename... Args>
+    T* make(Args&&... args)
+    {
+        static_assert(std::is_trivially_destructible_v<T>,
+                      "Arena objects are never destroyed");
+        void* memory = allocate(sizeof(T), alignof(T));
+        ++objects;
+        return new (memory) T(std::forward<Args>(args)...);
+    }
+
+    template <typename T>
+    NodeList<T> copyList(const T* items, size_t count)
+    {
+        static_assert(std::is_trivially_copyable_v<T>,
+                      "Arena lists are copied bytewise");
+        if (count == 0) {
+            return NodeList<T>();
+        }
+        auto* memory =
+          static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+        std::memcpy(memory, items, sizeof(T) * count);
+        return NodeList<T>(memory, count);
+    }
+
+    std::string_view copyString(std::string_view text)
+    {
+        if (text.empty()) {
+            return std::string_view();
+        }
+        auto* memory = static_cast<char*>(allocate(text.size(), 1));
+        std::memcpy(memory, text.data(), text.size());
+        return std::string_view(memory, text.size());
+    }
+
+    void reset() noexcept
+    {
+        current = 0;
+        offset = 0;
+        used = 0;
+        objects = 0;
+    }
+
+    size_t bytesAllocated() const noexcept { return used + offset; }
+    // Objects created through make() since the last reset
+    size_t objectCount() const noexcept { return objects; }
+
+private:
+    struct Block
+    {
+        std::unique_ptr<std::byte[]> data;
+        size_t size;
+    };
+
+    size_t blockSize;
+    std::vector<Block> blocks;
+    size_t current = 0;
+    size_t offset = 0;
+    size_t used = 0; // Bytes in blocks before `current`
+    size_t objects = 0;
+
+    void* allocateSlow(size_t size, size_t alignment)
+    {
+        // Move on to the next retained block that fits, or add a new one
+        while (true) {
+            if (current < blocks.size()) {
+                used += offset;
+                ++current;
+            }
+            offset = 0;
+            if (current == blocks.size()) {
+                size_t needed = size + alignment;
+                size_t length = needed > blockSize ? needed : blockSize;
+                blocks.push_back(
+                  Block{ std::unique_ptr<std::byte[]>(new std::byte[length]),
+                         length });
+            }
+            if (size + alignment <= blocks[current].size) {
+                break;
+            }
+        }
+
+        // Block storage from new[] is aligned for any fundamental type
+        offset = size;
+        return blocks[current].data.get();
+    }
+};
+
+#endif // ARENA_HPP
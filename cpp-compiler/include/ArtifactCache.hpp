@@ -0,0 +1,95 @@
+// ArtifactCache.hpp
+#ifndef ARTIFACT_CACHE_HPP
+#define ARTIFACT_CACHE_HPP
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include "ContentHash.hpp"
+
+// Counters persisted in the cache directory, shared by every process that
+// uses it
+struct CacheStats
+{
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t stores = 0;
+    std::uint64_t evictions = 0;
+    std::uint64_t entries = 0;
+    std::uint64_t bytes = 0;
+};
+
+enum class ArtifactKind
+{
+    Assembly, // .asm text
+    IR        // .tir binary TAC image
+};
+
+// Content-addressed store of compiled assembly and, when asked for, the
+// serialized TAC. An entry is keyed on the source bytes, the identity of the
+// compiler that produced it and the options that affect its output, so a hit
+// can be copied to the output path without lexing, parsing or generating
+// anything.
+//
+// Entries live in <dir>/<xx>/<hash>.asm (or .tir) and are published with
+// rename, so readers never see a partial file. Their modification time records the
+// last use; once the total size passes the limit the least recently used
+// entries are removed. The counters in <dir>/stats are updated under an
+// flock, which makes one cache safe to share between the threads of a batch
+// and between concurrent compiler processes.
+class ArtifactCache
+{
+public:
+    static constexpr std::uint64_t DefaultMaxBytes = 1ull << 30;
+
+    // Creates the directory if it does not exist yet
+    explicit ArtifactCache(std::string directory,
+                           std::uint64_t maxBytes = DefaultMaxBytes,
+                           std::string compilerIdentity =
+                             defaultCompilerIdentity());
+
+    ContentHash keyFor(std::string_view source,
+                       std::string_view configuration) const;
+
+    // Copies the artifact stored under `key` to outputPath and refreshes its
+    // last-use time; returns false on a miss
+    bool fetch(const ContentHash& key,
+               const std::string& outputPath,
+               ArtifactKind kind = ArtifactKind::Assembly) const;
+
+    // Adds the artifact just written to artifactPath under `key`, then
+    // evicts least recently used entries if the cache is over its limit.
+    // Anything but a regular file (say /dev/null) is not stored.
+    void store(const ContentHash& key,
+               const std::string& artifactPath,
+               ArtifactKind kind = ArtifactKind::Assembly) const;
+
+    CacheStats getStats() const;
+    void writeStats(std::ostream& out) const;
+
+    const std::string& getDirectory() const noexcept { return directory; }
+    std::uint64_t getMaxBytes() const noexcept { return maxBytes; }
+
+    // Version plus the size and mtime of the running executable, so any
+    // rebuilt compiler starts from a cold cache
+    static std::string defaultCompilerIdentity();
+
+    // Byte count with an optional K, M or G suffix; throws
+    // std::runtime_error on anything else
+    static std::uint64_t parseSize(const std::string& text);
+
+private:
+    std::string directory;
+    std::uint64_t maxBytes;
+    ContentHash identity;
+
+    std::string entryPath(const ContentHash& key, ArtifactKind kind) const;
+
+    template <typename Update>
+    CacheStats updateStats(Update&& update) const;
+    // Called with the stats lock held
+    void evict(CacheStats& stats) const;
+};
+
+#endif // ARTIFACT_CACHE_HPP
@@ -0,0 +1,83 @@
+// AssemblyWriter.hpp
+#ifndef ASSEMBLY_WRITER_HPP
+#define ASSEMBLY_WRITER_HPP
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include "TAC.hpp"
+
+// Destination for emitted bytes; receives large blocks only
+class OutputSink
+{
+public:
+    virtual ~OutputSink() = default;
+    virtual void write(const char* data, size_t size) = 0;
+};
+
+// Writes blocks straight to a file descriptor with write(2), bypassing
+// iostreams and the locale machinery
+class FileSink : public OutputSink
+{
+public:
+    explicit FileSink(const std::string& filePath);
+    FileSink(const FileSink&) = delete;
+    FileSink& operator=(const FileSink&) = delete;
+    ~FileSink() override;
+
+    void write(const char* data, size_t size) override;
+
+private:
+    int fd;
+    std::string filePath;
+};
+
+// Formats TAC text into one reusable buffer and hands it to the sink in
+// blocks of BufferSize bytes
+class AssemblyWriter
+{
+public:
+    static constexpr size_t BufferSize = 1 << 20;
+
+    explicit AssemblyWriter(OutputSink& sink);
+    // Formats into `buffer` instead, BufferSize bytes the caller keeps, so
+    // writers created one after another share one allocation
+    AssemblyWriter(OutputSink& sink, char* buffer) noexcept;
+    AssemblyWriter(const AssemblyWriter&) = delete;
+    AssemblyWriter& operator=(const AssemblyWriter&) = delete;
+
+    void write(const TACProgram& program);
+    void flush();
+
+    // Bytes handed to the sink so far
+    size_t bytesWritten() const noexcept { return written; }
+
+private:
+    OutputSink& sink;
+    std::unique_ptr<char[]> ownedBuffer;
+    char* buffer;
+    size_t used = 0;
+    size_t written = 0;
+
+    static size_t operandLength(const TACProgram& program,
+                                Operand operand) noexcept;
+    static char* copy(char* out, std::string_view text) noexcept;
+    static char* copyOperand(char* out,
+                             const TACProgram& program,
+                             Operand operand) noexcept;
+
+    void writeLongLine(const TACProgram& program,
+                       std::string_view op,
+                       const Operand (&operands)[3]);
+    void append(std::string_view text);
+
+    void reserve(size_t size)
+    {
+        if (BufferSize - used < size) {
+            flush();
+        }
+    }
+};
+
+#endif // ASSEMBLY_WRITER_HPP
@@ -0,0 +1,67 @@
+// BatchDriver.hpp
+#ifndef BATCH_DRIVER_HPP
+#define BATCH_DRIVER_HPP
+
+#include <string>
+#include <vector>
+#include "Compiler.hpp"
+
+struct BatchJob
+{
+    std::string inputPath;
+    std::string outputPath;
+};
+
+struct BatchResult
+{
+    bool succeeded = false;
+    std::string error;
+};
+
+// Compiles many units concurrently on a work-stealing ThreadPool. Every
+// unit gets its own Compiler, so no lexer, parser or IR state is shared
+// between threads.
+class BatchDriver
+{
+public:
+    // Zero picks one thread per hardware thread
+    explicit BatchDriver(unsigned threadCount = 0) noexcept
+      : threadCount(threadCount)
+    {
+    }
+
+    // Shared by every unit of the batch; null (the default) disables it
+    void setCache(const ArtifactCache* artifactCache) noexcept
+    {
+        cache = artifactCache;
+    }
+
+    void setOptimizationLevel(int level) noexcept
+    {
+        optimizationLevel = level;
+    }
+
+    void setTarget(Compiler::Target outputTarget) noexcept
+    {
+        target = outputTarget;
+    }
+
+    // Results are in job order
+    std::vector<BatchResult> run(const std::vector<BatchJob>& jobs) const;
+
+    // Whitespace-separated input paths
+    static std::vector<std::string> readResponseFile(const std::string& path);
+
+    // <outputDir>/<stem>.asm, or the input path with its extension replaced
+    // when outputDir is empty
+    static std::string outputPathFor(const std::string& inputPath,
+                                     const std::string& outputDir);
+
+private:
+    unsigned threadCount;
+    const ArtifactCache* cache = nullptr;
+    int optimizationLevel = 0;
+    Compiler::Target target = Compiler::Target::Tac;
+};
+
+#endif // BATCH_DRIVER_HPP
@@ -0,0 +1,90 @@
+// BytecodeProgram.hpp
+#ifndef BYTECODE_PROGRAM_HPP
+#define BYTECODE_PROGRAM_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "TAC.hpp"
+
+// A TACProgram translated into register-based bytecode, the portable
+// counterpart of JITProgram for hosts that may not map executable pages.
+// Every variable, temp, spill slot and constant of a function becomes a
+// register of its frame, labels become instruction indices, and the type
+// rules of the native backends (NativeTypes.hpp) pick typed opcodes and
+// explicit conversions up front, so execution never looks at a name or a
+// type. A comparison read only by the IF_FALSE after it fuses into one
+// compare-and-branch. A call's arguments go in the registers just past the
+// caller's frame, where the callee's frame begins, so passing them copies
+// nothing. run() dispatches with computed goto where the compiler supports
+// it and with a switch otherwise.
+//
+// compile() throws std::runtime_error for what the native backends have
+// no lowering for either. Unlike native code, an integer division by zero,
+// INT_MIN / -1 or recursion past a million frames throws
+// std::runtime_error from run() instead of raising a signal.
+class BytecodeProgram
+{
+public:
+    static BytecodeProgram compile(const TACProgram& program);
+
+    BytecodeProgram(BytecodeProgram&&) noexcept = default;
+    BytecodeProgram& operator=(BytecodeProgram&&) noexcept = default;
+    // Registers point into `literals`, which a copy would not share
+    BytecodeProgram(const BytecodeProgram&) = delete;
+    BytecodeProgram& operator=(const BytecodeProgram&) = delete;
+
+    // Runs main, or the first function when there is none, on a fresh
+    // register stack and returns its value
+    int run() const;
+
+    size_t size() const noexcept { return code.size(); }
+    // Registers of every function's frame together
+    size_t registerCount() const noexcept { return initial.size(); }
+
+    // Holds whichever member the opcodes reading it expect
+    union Value
+    {
+        std::int32_t i;
+        double f;
+        const char* s;
+    };
+
+    // Register operands a and b, result or jump target c. Call takes the
+    // function in a, the callee's frame offset in b and the result in c.
+    struct Instruction
+    {
+        std::uint32_t op;
+        std::uint32_t a;
+        std::uint32_t b;
+        std::uint32_t c;
+    };
+
+    struct Function
+    {
+        std::uint32_t entry;
+        // Registers 0 to parameters - 1 hold the arguments
+        std::uint32_t parameters;
+        // Registers the function names, which its template initializes
+        std::uint32_t frameSize;
+        // frameSize plus the arguments of its widest call
+        std::uint32_t extent;
+        // Where its template starts in `initial`
+        std::uint32_t initial;
+    };
+
+private:
+    BytecodeProgram() = default;
+
+    std::vector<Instruction> code;
+    std::vector<Function> functions;
+    // Every function's frame template: constants hold their values,
+    // everything else starts at zero
+    std::vector<Value> initial;
+    // NUL-terminated string literals
+    std::vector<char> literals;
+    // Index in `functions` of the one run() calls
+    std::uint32_t entry = 0;
+};
+
+#endif // BYTECODE_PROGRAM_HPP
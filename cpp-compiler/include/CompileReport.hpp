@@ -0,0 +1,57 @@
+// CompileReport.hpp
+#ifndef COMPILE_REPORT_HPP
+#define COMPILE_REPORT_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Per-phase measurements of one compile, filled in by a Compiler that has
+// the report attached (Compiler::setReport). Heap figures come from
+// HeapStats and are only present when heapTracked() is true.
+class CompileReport
+{
+public:
+    struct Phase
+    {
+        const char* name;
+        double milliseconds;
+        std::size_t items;
+        const char* unit;
+        // Growth of the live heap above its size at the start of the phase
+        std::size_t peakHeapBytes;
+        std::size_t allocations;
+    };
+
+    // Clears the phases of any previous compile
+    void start(const std::string& inputPath);
+    void begin(const char* name);
+    void end(std::size_t items, const char* unit);
+
+    const std::vector<Phase>& getPhases() const noexcept { return phases; }
+    const std::string& getInputPath() const noexcept { return inputPath; }
+    double totalMilliseconds() const noexcept;
+    bool heapTracked() const noexcept { return heapTracking; }
+    // Peak resident set size of the whole process, in KiB
+    long maxResidentKilobytes() const noexcept { return maxResident; }
+
+    void writeText(std::ostream& out) const;
+    void writeJson(std::ostream& out) const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    std::string inputPath;
+    std::vector<Phase> phases;
+    bool heapTracking = false;
+    long maxResident = 0;
+
+    const char* currentName = nullptr;
+    Clock::time_point started;
+    std::ptrdiff_t heapBaseline = 0;
+    std::size_t allocationBaseline = 0;
+};
+
+#endif // COMPILE_REPORT_HPP
@@ -0,0 +1,73 @@
+// CompileServer.hpp
+#ifndef COMPILE_SERVER_HPP
+#define COMPILE_SERVER_HPP
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
+
+// What a client asks of the daemon: the command line it would have run
+// cpp_compiler with, the directory its relative paths are relative to, and
+// its stdin when one of the arguments is "-"
+struct ServerRequest
+{
+    std::string directory;
+    std::vector<std::string> args;
+    std::string input;
+};
+
+// What cpp_compiler would have exited with and printed
+struct ServerResponse
+{
+    int status = 0;
+    std::string out;
+    std::string err;
+};
+
+// Serves one request per connection on a Unix domain socket. Connections
+// are answered concurrently on a ThreadPool, each by `handler`, so state
+// the handler keeps per worker thread stays warm across requests. Frames
+// are the magic "TCPD", then for a request the directory, the argument
+// count, the arguments and the input, and for a response the status, out
+// and err; every string is a 32-bit length followed by its bytes, all in
+// host byte order since both ends share one machine.
+//
+// Socket errors throw std::runtime_error; a handler that throws answers
+// its client with status 1 and the exception's message.
+class CompileServer
+{
+public:
+    using Handler = std::function<ServerResponse(const ServerRequest&)>;
+
+    // Binds `socketPath`, replacing a stale socket file but refusing one a
+    // live server still answers on. Zero threads picks one per core.
+    CompileServer(std::string socketPath, Handler handler, unsigned threads);
+    CompileServer(const CompileServer&) = delete;
+    CompileServer& operator=(const CompileServer&) = delete;
+    // Closes and removes the socket
+    ~CompileServer();
+
+    // Accepts connections until stop(), then waits for the requests in
+    // flight
+    void serve();
+
+    // Safe to call from a signal handler
+    void stop() noexcept;
+
+    // Client side: sends `request` to the server on `socketPath` and waits
+    // for its response
+    static ServerResponse send(const std::string& socketPath,
+                               const ServerRequest& request);
+
+private:
+    std::string socketPath;
+    Handler handler;
+    unsigned threads;
+    int listener = -1;
+    std::atomic<bool> stopping{ false };
+
+    void answer(int connection) const;
+};
+
+#endif // COMPILE_SERVER_HPP
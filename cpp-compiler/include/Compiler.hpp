@@ -2,13 +2,44 @@
 #ifndef COMPILER_HPP
 #define COMPILER_HPP
 
+#include "ArtifactCache.hpp"
+#include "AssemblyWriter.hpp"
+#include "CompileReport.hpp"
 #include "Lexer.hpp"
 #include "Parser.hpp"
 #include "IRGenerator.hpp"
+#include "Optimizer.hpp"
+#include "RegisterAllocator.hpp"
+#include "SourceBuffer.hpp"
+#include "ThreadPool.hpp"
 
+// Drives one unit at a time through its pipeline. The lexer, parser and IR
+// generator keep per-unit state, so a Compiler must not be shared between
+// threads; concurrent compiles each use their own instance (see
+// BatchDriver). Each unit resets them rather than rebuilding them, so a
+// Compiler reused for a stream of units keeps its buffers and arenas
+// instead of reallocating them every time.
 class Compiler
 {
 public:
+    // What the output file holds: TAC listing or x86-64 assembly for GNU as
+    enum class Target
+    {
+        Tac,
+        X86_64
+    };
+
+    // How run() executes main: machine code from JITProgram, or the
+    // bytecode interpreter (BytecodeProgram), which needs no executable
+    // memory
+    enum class Engine
+    {
+        Jit,
+        Interpreter
+    };
+
+    // Builds a private lexer/parser/IR generator pipeline
+    Compiler();
     Compiler(std::shared_ptr<Lexer> lexer,
              std::shared_ptr<Parser> parser,
              std::shared_ptr<IRGenerator> irGenerator);
@@ -16,14 +47,123 @@ public:
     void compile(const std::string& inputFilePath,
                  const std::string& outputFilePath);
 
+    // Compiles the unit at `inputFilePath`, a source file or TAC image, into
+    // memory with the engine and runs its main in this process, returning
+    // what main returns. The -O level applies; registers, the target, the
+    // cache and the IR output do not.
+    int run(const std::string& inputFilePath);
+
+    // In-memory counterparts of compile() and run() for embedders. `source`
+    // is source text or a TAC image and only needs to live for the call;
+    // reports name the unit "<buffer>", and the cache and the IR output,
+    // which are files, do not apply. compileSource writes the target's
+    // output to `out` and returns the bytes written.
+    size_t compileSource(std::string_view source, OutputSink& out);
+    int runSource(std::string_view source);
+
+    // Stops compileSource after the -O passes and register allocation and
+    // returns the program, which stays valid until the next unit
+    const TACProgram& generateIR(std::string_view source);
+
+    // Attaches a report that each compile() fills in phase by phase; null
+    // detaches it. Without a report the phase hooks are a single test.
+    void setReport(CompileReport* report) noexcept { report_ = report; }
+
+    // Looks every unit up in `cache` before compiling it and stores the
+    // result after a miss; null turns caching off. The cache may be shared
+    // with other Compilers.
+    void setCache(const ArtifactCache* cache) noexcept { cache_ = cache; }
+
+    // Also writes the generated TAC as a binary image (see TACImage.hpp) to
+    // `path`; empty turns it off
+    void setIROutput(std::string path) { irOutputPath_ = std::move(path); }
+
+    // -O level for the TAC passes (see Optimizer); 0, the default, runs none
+    void setOptimizationLevel(int level) noexcept
+    {
+        optimizationLevel_ = level;
+    }
+
+    // Maps temps onto `registers` after IR generation; an empty set (the
+    // default) keeps the virtual temps
+    void setRegisters(RegisterSet registers)
+    {
+        registers_ = std::move(registers);
+    }
+
+    // Tac, the default, writes the TAC listing; X86_64 lowers the same
+    // program with X86Writer
+    void setTarget(Target target) noexcept { target_ = target; }
+
+    // "tac" or "x86-64"; throws std::runtime_error for anything else
+    static Target parseTarget(const std::string& name);
+
+    // Jit, the default on x86-64 hosts, or Interpreter, the default on
+    // every other host
+    void setEngine(Engine engine) noexcept { engine_ = engine; }
+
+    // Checks and lowers the functions of a unit on `threads` workers; 0
+    // picks one per hardware thread, and 1, the default, keeps the whole
+    // compile on the calling thread. The output does not depend on it. The
+    // workers belong to this Compiler and are kept for the units after.
+    void setThreads(unsigned threads);
+
+    // Puts every setting above back to its default, keeping the pipeline
+    // and its buffers, for a Compiler that serves one request after another
+    void resetOptions() noexcept;
+
 private:
     std::shared_ptr<Lexer> lexer_;
     std::shared_ptr<Parser> parser_;
     std::shared_ptr<IRGenerator> irGenerator_;
+    CompileReport* report_ = nullptr;
+    const ArtifactCache* cache_ = nullptr;
+    std::string irOutputPath_;
+    RegisterSet registers_;
+    int optimizationLevel_ = 0;
+    Target target_ = Target::Tac;
+#if defined(__x86_64__)
+    static constexpr Engine DefaultEngine = Engine::Jit;
+#else
+    static constexpr Engine DefaultEngine = Engine::Interpreter;
+#endif
+    Engine engine_ = DefaultEngine;
+    std::unique_ptr<ThreadPool> pool_;
+    // Handed back and forth with the parser, so neither list is freed
+    std::vector<Token> tokens_;
+    // The last unit given as a TAC image
+    TACProgram loaded_;
+    // AssemblyWriter's buffer, allocated by the first TAC write
+    std::unique_ptr<char[]> writeBuffer_;
+
+    // Options that change the generated code, folded into the cache key
+    std::string outputConfiguration() const;
+
+    // Loads `source` if it is a TAC image; otherwise tokenizes, parses and
+    // generates it, then runs the -O passes
+    TACProgram& generate(std::string_view source);
+    // Maps temps onto the registers, if any were set
+    void allocate(TACProgram& ir);
+    // Runs main with the engine
+    int execute(const TACProgram& ir);
+
+    static SourceBuffer readFile(const std::string& filePath);
+    size_t writeAssembly(const TACProgram& ir, OutputSink& out);
+    static size_t writeIRToFile(const TACProgram& ir,
+                                const std::string& filePath);
 
-    static std::string readFile(const std::string& filePath);
-    static void writeAssemblyToFile(const std::vector<TACInstruction>& ir,
-                                    const std::string& filePath);
+    void beginPhase(const char* name)
+    {
+        if (report_) {
+            report_->begin(name);
+        }
+    }
+    void endPhase(size_t items, const char* unit)
+    {
+        if (report_) {
+            report_->end(items, unit);
+        }
+    }
 };
 
 #endif // COMPILER_HPP
\ No newline at end of file
@@ -0,0 +1,54 @@
+// ConstantFolder.hpp
+#ifndef CONSTANT_FOLDER_HPP
+#define CONSTANT_FOLDER_HPP
+
+#include "ASTVisitor.hpp"
+#include "Arena.hpp"
+
+// Evaluates literal-only arithmetic and applies exact algebraic identities
+// (x*1, x+0, x*0, ...) on an annotated tree, so it runs after
+// SemanticAnalyzer. Each expression visit returns the node that replaces the
+// visited one. Folded literals live in the tree's arena and keep the type of
+// the node they replace, so the annotations downstream passes read are
+// unchanged.
+class ConstantFolder
+  : public ASTVisitor<ConstantFolder, ExpressionPtr, void, true>
+{
+public:
+    explicit ConstantFolder(Arena& arena) noexcept
+      : arena(arena)
+    {
+    }
+
+    void fold(Statement& root) { visitStatement(root); }
+
+    // Binary expressions removed so far
+    size_t getFoldCount() const noexcept { return folded; }
+
+    ExpressionPtr visit(BinaryExpression& expr);
+    ExpressionPtr visit(LiteralExpression& expr);
+    ExpressionPtr visit(VariableExpression& expr);
+    ExpressionPtr visit(CallExpression& expr);
+    void visit(BlockStatement& stmt);
+    void visit(VariableDeclaration& stmt);
+    void visit(AssignmentStatement& stmt);
+    void visit(ExpressionStatement& stmt);
+    void visit(ReturnStatement& stmt);
+    void visit(FunctionDeclaration& stmt);
+    void visit(IfStatement& stmt);
+    void visit(WhileStatement& stmt);
+    void visit(DoWhileStatement& stmt);
+    void visit(ForStatement& stmt);
+    void visit(TranslationUnit& unit);
+
+private:
+    Arena& arena;
+    size_t folded = 0;
+
+    ExpressionPtr simplify(ExpressionPtr expr);
+    ExpressionPtr evaluate(BinaryExpression& expr);
+    ExpressionPtr applyIdentity(BinaryExpression& expr);
+    ExpressionPtr makeLiteral(std::string_view text, TypeId type);
+};
+
+#endif // CONSTANT_FOLDER_HPP
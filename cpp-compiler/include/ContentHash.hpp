@@ -0,0 +1,32 @@
+// ContentHash.hpp
+#ifndef CONTENT_HASH_HPP
+#define CONTENT_HASH_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// 128-bit non-cryptographic digest (MurmurHash3 x64_128). Wide enough that
+// accidental collisions between cached units are not a practical concern;
+// it is not meant to resist deliberately crafted inputs.
+struct ContentHash
+{
+    std::uint64_t low = 0;
+    std::uint64_t high = 0;
+
+    static ContentHash of(std::string_view data, std::uint64_t seed = 0);
+
+    // Combines two digests so that the order of the parts matters
+    static ContentHash combine(const ContentHash& first,
+                               const ContentHash& second);
+
+    // 32 lowercase hex digits, high word first
+    std::string toHex() const;
+
+    bool operator==(const ContentHash& other) const noexcept
+    {
+        return low == other.low && high == other.high;
+    }
+};
+
+#endif // CONTENT_HASH_HPP
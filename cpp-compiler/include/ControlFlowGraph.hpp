@@ -0,0 +1,147 @@
+// ControlFlowGraph.hpp
+#ifndef CONTROL_FLOW_GRAPH_HPP
+#define CONTROL_FLOW_GRAPH_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Arena.hpp"
+#include "TAC.hpp"
+
+using BlockId = std::uint32_t;
+
+constexpr BlockId NoBlock = UINT32_MAX;
+
+// Maximal straight-line run of instructions [begin, end). Only the last
+// instruction may jump or return, and only the first may be a LABEL or
+// FUNCTION.
+struct BasicBlock
+{
+    std::uint32_t begin;
+    std::uint32_t end;
+    // Jump target first, then the fall-through block; a conditional jump to
+    // the next block has a single edge
+    BlockId successors[2] = { NoBlock, NoBlock };
+    std::uint32_t successorCount = 0;
+    // Slice of the graph's predecessor array
+    std::uint32_t firstPredecessor = 0;
+    std::uint32_t predecessorCount = 0;
+};
+
+// Natural loop of the back edges into `header` (jumps from blocks it
+// dominates): the header and every block that reaches one of them without
+// passing through it
+struct NaturalLoop
+{
+    BlockId header;
+    // Slice of the nest's block array
+    std::uint32_t firstBlock = 0;
+    std::uint32_t blockCount = 0;
+};
+
+struct LoopNest
+{
+    std::vector<NaturalLoop> loops;
+    std::vector<BlockId> blockList;
+
+    // In reverse postorder, so the header comes first
+    NodeList<const BlockId> blocks(const NaturalLoop& loop) const noexcept
+    {
+        return { blockList.data() + loop.firstBlock, loop.blockCount };
+    }
+};
+
+// Basic blocks of a TACProgram with their edges and dominator tree, built
+// once from the flat instruction array. The graph indexes the program, so
+// rebuild it after any pass that moves or removes instructions.
+//
+// Entries are block 0 and every block that starts with a FUNCTION, which
+// gets no fall-through edge from the block before it. Dominators are
+// computed over all entries at once with semi-NCA, and each entry roots
+// its own tree; a block reached from more than one entry roots a tree of
+// its own.
+class ControlFlowGraph
+{
+public:
+    explicit ControlFlowGraph(const TACProgram& program);
+
+    size_t size() const noexcept { return blocks.size(); }
+    const BasicBlock& block(BlockId id) const noexcept { return blocks[id]; }
+    const std::vector<BasicBlock>& getBlocks() const noexcept
+    {
+        return blocks;
+    }
+
+    NodeList<const BlockId> successors(BlockId id) const noexcept
+    {
+        return { blocks[id].successors, blocks[id].successorCount };
+    }
+    NodeList<const BlockId> predecessors(BlockId id) const noexcept
+    {
+        const BasicBlock& b = blocks[id];
+        return { predecessorList.data() + b.firstPredecessor,
+                 b.predecessorCount };
+    }
+
+    // Block starting at the LABEL instruction for `label`, or NoBlock
+    BlockId blockOfLabel(Operand label) const noexcept;
+
+    // Block holding the instruction at `position`
+    BlockId blockOf(std::uint32_t position) const noexcept;
+
+    const std::vector<BlockId>& getEntries() const noexcept
+    {
+        return entries;
+    }
+
+    // Reachable blocks, each one before all of its successors except
+    // along back edges
+    const std::vector<BlockId>& reversePostorder() const noexcept
+    {
+        return order;
+    }
+
+    bool isReachable(BlockId id) const noexcept
+    {
+        return rpoIndex[id] != NoBlock;
+    }
+
+    // NoBlock for entries and unreachable blocks
+    BlockId immediateDominator(BlockId id) const noexcept
+    {
+        return idom[id] == id ? NoBlock : idom[id];
+    }
+
+    // Every path from an entry to `b` passes through `a`; a block
+    // dominates itself. Constant time, from dominator tree numbering.
+    bool dominates(BlockId a, BlockId b) const noexcept;
+
+    // One loop per header, each after the loops it is nested in. Loops
+    // that can be entered other than through their header are left out.
+    LoopNest naturalLoops() const;
+
+    // One line per block, for debugging
+    std::string toString() const;
+
+private:
+    std::vector<BasicBlock> blocks;
+    std::vector<BlockId> predecessorList;
+    // Indexed by the label's string index
+    std::vector<BlockId> labelBlocks;
+    std::vector<BlockId> entries;
+    std::vector<BlockId> order;
+    std::vector<BlockId> rpoIndex;
+    std::vector<BlockId> idom;
+    // Preorder interval of each block in its dominator tree
+    std::vector<std::uint32_t> treeEnter;
+    std::vector<std::uint32_t> treeExit;
+
+    void buildBlocks(const TACProgram& program);
+    void linkPredecessors();
+    void findEntries(const TACProgram& program);
+    void computeOrder();
+    void computeDominators();
+    void numberDominatorTree();
+};
+
+#endif // CONTROL_FLOW_GRAPH_HPP
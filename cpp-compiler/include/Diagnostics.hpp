@@ -0,0 +1,43 @@
+// Diagnostics.hpp
+#ifndef DIAGNOSTICS_HPP
+#define DIAGNOSTICS_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "SourceMap.hpp"
+
+struct Diagnostic
+{
+    std::uint32_t offset = NoOffset;
+    std::string message;
+};
+
+// Errors found in one unit, each at a byte offset into its source. The
+// parser and SemanticAnalyzer record an error and carry on, so a single
+// pass finds every problem and none of them unwinds the stack; lines and
+// columns are only worked out when the errors are formatted.
+class Diagnostics
+{
+public:
+    void error(std::uint32_t offset, std::string message);
+
+    bool hasErrors() const noexcept { return !entries.empty(); }
+    size_t errorCount() const noexcept { return entries.size(); }
+    const std::vector<Diagnostic>& all() const noexcept { return entries; }
+
+    // Adds the errors of `other` after these
+    void append(const Diagnostics& other);
+
+    // Forgets the errors, keeping the storage for the next unit
+    void clear() noexcept { entries.clear(); }
+
+    // One "line:column: error: message" line per error, in source order;
+    // errors without an offset come last, without a position
+    std::string format(const SourceMap& lines) const;
+
+private:
+    std::vector<Diagnostic> entries;
+};
+
+#endif // DIAGNOSTICS_HPP
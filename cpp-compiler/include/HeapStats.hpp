@@ -0,0 +1,59 @@
+// HeapStats.hpp
+#ifndef HEAP_STATS_HPP
+#define HEAP_STATS_HPP
+
+#include <atomic>
+#include <cstddef>
+
+// Process-wide heap counters, fed by the operator new/delete replacements in
+// HeapHooks.cpp. Only executables that link those hooks have them
+// (available()), and they only count once enable() has been called, so a
+// build or run without instrumentation pays one relaxed load per allocation
+// at most.
+class HeapStats
+{
+public:
+    static bool available() noexcept { return hooked.load(Relaxed); }
+    static bool enabled() noexcept { return tracking.load(Relaxed); }
+
+    // Meant to be called once at startup, before the allocations of
+    // interest; blocks allocated earlier are still subtracted when freed
+    static void enable() noexcept { tracking.store(true, Relaxed); }
+
+    static std::ptrdiff_t current() noexcept { return live.load(Relaxed); }
+    static std::ptrdiff_t peak() noexcept { return highWater.load(Relaxed); }
+    static std::size_t allocations() noexcept { return count.load(Relaxed); }
+
+    // Restarts peak tracking from the current live size
+    static void resetPeak() noexcept { highWater.store(current(), Relaxed); }
+
+    // Hook interface
+    static void markAvailable() noexcept { hooked.store(true, Relaxed); }
+
+    static void recordAllocation(std::size_t size) noexcept
+    {
+        auto bytes = static_cast<std::ptrdiff_t>(size);
+        std::ptrdiff_t now = live.fetch_add(bytes, Relaxed) + bytes;
+        std::ptrdiff_t high = highWater.load(Relaxed);
+        while (now > high &&
+               !highWater.compare_exchange_weak(high, now, Relaxed)) {
+        }
+        count.fetch_add(1, Relaxed);
+    }
+
+    static void recordRelease(std::size_t size) noexcept
+    {
+        live.fetch_sub(static_cast<std::ptrdiff_t>(size), Relaxed);
+    }
+
+private:
+    static constexpr auto Relaxed = std::memory_order_relaxed;
+
+    static inline std::atomic<bool> hooked{ false };
+    static inline std::atomic<bool> tracking{ false };
+    static inline std::atomic<std::ptrdiff_t> live{ 0 };
+    static inline std::atomic<std::ptrdiff_t> highWater{ 0 };
+    static inline std::atomic<std::size_t> count{ 0 };
+};
+
+#endif // HEAP_STATS_HPP
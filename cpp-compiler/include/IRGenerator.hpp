@@ -1,46 +1,109 @@
 #ifndef IR_GENERATOR_HPP
 #define IR_GENERATOR_HPP
 
+#include <memory>
 #include <string>
-#include <vector>
 #include "AST.hpp"
+#include "ASTVisitor.hpp"
 #include "Parser.hpp"
+#include "TAC.hpp"
 
-struct TACInstruction
-{
-    std::string op;
-    std::string arg1;
-    std::string arg2;
-    std::string result;
-
-    TACInstruction(std::string op,
-                   std::string arg1,
-                   std::string arg2,
-                   std::string result)
-      : op(std::move(op))
-      , arg1(std::move(arg1))
-      , arg2(std::move(arg2))
-      , result(std::move(result))
-    {
-    }
-};
+class ThreadPool;
 
-class IRGenerator
+// Lowers annotated statements to three-address code; expressions yield the
+// operand holding their value. Instruction types come straight from the
+// types SemanticAnalyzer stored on the tree. A variable is named by its
+// spelling, and a later declaration of the same name in the function (an
+// inner `int x` shadowing an outer one, say) by `x`.<ordinal>, which no
+// identifier can alias, so each binding is a TAC variable of its own. A
+// function is its FUNCTION, one PARAM per parameter and its body; a call
+// evaluates every argument before the run of ARGs and the CALL, so nothing
+// comes between them.
+//
+// With a thread pool, the functions of a unit of several are lowered in
+// contiguous runs, each into a program of its own whose temps and labels
+// are numbered from zero. The runs are then appended in source order,
+// renumbering temps and replaying each run's strings in the order it
+// interned them, so the merged program is exactly the one lowering the
+// whole unit on one thread produces.
+class IRGenerator : public ASTVisitor<IRGenerator, Operand>
 {
 public:
     explicit IRGenerator(std::shared_ptr<Parser> parser);
 
-    std::vector<TACInstruction> generateCode(const ASTNodePtr& ast);
+    // Replaces the program with the code for `ast`. Later passes such as
+    // register allocation rewrite it in place; it stays valid until the
+    // next call.
+    TACProgram& generateCode(ASTNodePtr ast);
+
+    // Empties the program, keeping its storage
+    void reset() noexcept
+    {
+        program.clear();
+        localLabelCount = 0;
+    }
+
+    // Lowers the functions of a unit of several on `pool`; null (the
+    // default) keeps lowering on the calling thread. The pool must outlive
+    // the generator's use of it and have no other work in flight.
+    void setThreadPool(ThreadPool* pool) noexcept { this->pool = pool; }
 
 private:
+    friend class ASTVisitor<IRGenerator, Operand>;
+
+    // Marks the spelling of a label numbered within one run; nothing in
+    // the source can start with it
+    static constexpr char LocalLabelMark = '@';
+
     std::shared_ptr<Parser> parser;
-    std::vector<TACInstruction> code;
-    int tempVarCount = 0;
+    TACProgram program;
+    ThreadPool* pool = nullptr;
+    // Set on the generators of the runs, which number their own labels
+    bool localLabels = false;
+    std::uint32_t localLabelCount = 0;
+    // One per run, kept with their programs' storage from unit to unit
+    std::vector<std::unique_ptr<IRGenerator>> runs;
+    // Index in `program`'s strings of each string of the run being appended
+    std::vector<std::uint32_t> remap;
+    // Values of the arguments of the calls being lowered, innermost last
+    std::vector<Operand> arguments;
+    // Scratch for the spellings of shadowing variables
+    std::string spelling;
+    // Return type of the function being lowered; Unknown outside one
+    TypeId returnType = TypeId::Unknown;
+
+    Operand visit(const BinaryExpression& expr);
+    Operand visit(const LiteralExpression& expr);
+    Operand visit(const VariableExpression& expr);
+    Operand visit(const CallExpression& expr);
+    void visit(const BlockStatement& stmt);
+    void visit(const VariableDeclaration& stmt);
+    void visit(const AssignmentStatement& stmt);
+    void visit(const ExpressionStatement& stmt);
+    void visit(const ReturnStatement& stmt);
+    void visit(const FunctionDeclaration& stmt);
+    void visit(const IfStatement& stmt);
+    void visit(const WhileStatement& stmt);
+    void visit(const DoWhileStatement& stmt);
+    void visit(const ForStatement& stmt);
+    void visit(const TranslationUnit& unit);
 
-    void generateStatement(const StatementPtr& stmt);
-    void generateExpression(const ExpressionPtr& expr, std::string& resultVar);
+    void emit(Opcode op,
+              Operand arg1 = Operand(),
+              Operand arg2 = Operand(),
+              Operand result = Operand(),
+              TypeId type = TypeId::Unknown);
+    Operand getNewTempVar() noexcept;
+    Operand newLabel();
+    Operand number(size_t value);
+    // The TAC variable of a binding, given its ordinal from the analyzer
+    Operand variable(std::string_view name, std::uint32_t ordinal);
+    // Lowers a call whose value goes to `result`, or nowhere if None
+    void call(const CallExpression& expr, Operand result);
 
-    std::string getNewTempVar() noexcept;
+    void generateConcurrently(const TranslationUnit& unit);
+    // Appends the code of a run lowered with local labels
+    void append(const TACProgram& run);
 };
 
 #endif // IR_GENERATOR_HPP
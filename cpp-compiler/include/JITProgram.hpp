@@ -0,0 +1,57 @@
+// JITProgram.hpp
+#ifndef JIT_PROGRAM_HPP
+#define JIT_PROGRAM_HPP
+
+#include <cstddef>
+#include "TAC.hpp"
+
+// A TACProgram encoded as x86-64 machine code into executable memory of
+// this process, so its main runs without writing, assembling or linking a
+// file. Every variable and temp gets a stack slot, values pass through
+// rax, rcx, rdx and xmm0-1, and the type rules are X86Writer's (see
+// NativeTypes.hpp), so a program behaves the same under --run as built
+// from --target x86-64. Calls between the program's functions pass every
+// argument on the stack, since no value lives in a register across them.
+// The pages are writable while the code is copied in and only readable and
+// executable after that.
+//
+// compile() throws std::runtime_error on hosts other than x86-64, for
+// register-allocated TAC, and for what X86Writer has no lowering for.
+// run() throws std::runtime_error for an integer division by zero or
+// INT_MIN / -1, with the interpreter's message, where the native
+// executable would take SIGFPE: each idiv is checked first, and a failed
+// check unwinds straight back to the stub that called main.
+class JITProgram
+{
+public:
+    static JITProgram compile(const TACProgram& program);
+
+    JITProgram(JITProgram&& other) noexcept;
+    JITProgram& operator=(JITProgram&& other) noexcept;
+    JITProgram(const JITProgram&) = delete;
+    JITProgram& operator=(const JITProgram&) = delete;
+    ~JITProgram();
+
+    // Calls main, or the first function when there is none, and returns
+    // its value
+    int run() const;
+
+    // Bytes of code and string data
+    size_t codeSize() const noexcept { return size; }
+
+private:
+    JITProgram(void* memory, size_t mapped, size_t size, size_t entry) noexcept
+      : memory(memory)
+      , mapped(mapped)
+      , size(size)
+      , entry(entry)
+    {
+    }
+
+    void* memory = nullptr;
+    size_t mapped = 0;
+    size_t size = 0;
+    size_t entry = 0;
+};
+
+#endif // JIT_PROGRAM_HPP
@@ -2,8 +2,12 @@
 #ifndef LEXER_H
 #define LEXER_H
 
-#include <string>
+#include <cstdint>
+#include <functional>
+#include <string_view>
 #include <vector>
+#include "SourceMap.hpp"
+#include "StringInterner.hpp"
 #include "Token.hpp"
 
 class Lexer
@@ -11,28 +15,62 @@ class Lexer
 public:
     Lexer();
 
-    void setSource(const std::string& source);
+    // The lexer reads the buffer in place; it must outlive the tokens
+    void setSource(std::string_view source) noexcept;
 
+    // Tokens view into the buffer passed to setSource
     std::vector<Token> tokenize();
+    // Replaces the contents of `tokens`, reusing its capacity
+    void tokenize(std::vector<Token>& tokens);
+
+    // Forgets the source and every interned spelling but the keywords, so
+    // symbols of earlier tokens become invalid; the interner keeps its
+    // storage
+    void reset();
+
+    const StringInterner& getInterner() const noexcept { return interner; }
+
+    // Line and column of a token lexed from the current source. Positions
+    // are not tracked while scanning; the first call maps the buffer's
+    // lines in one pass. Tokens from elsewhere locate to {0, 0}.
+    SourceLocation locate(const Token& token) const;
+
+    // Where a token lexed from the current source starts in it; NoOffset
+    // for tokens from elsewhere
+    std::uint32_t offsetOf(const Token& token) const noexcept
+    {
+        // Called for every node the parser builds, so kept inline
+        const char* at = token.getValue().data();
+        std::less_equal<const char*> notAfter;
+        if (!at || !notAfter(source.data(), at) ||
+            !notAfter(at, source.data() + source.size())) {
+            return NoOffset;
+        }
+        return static_cast<std::uint32_t>(at - source.data());
+    }
+
+    // Line starts of the current source, mapped on first use
+    const SourceMap& getSourceMap() const;
 
 private:
-    std::string source;
+    std::string_view source;
+    StringInterner interner;
     size_t index = 0;
-    int line = 1;
-    int column = 1;
+    mutable SourceMap sourceMap;
+    mutable bool sourceMapped = false;
 
+    void internKeywords();
     char currentChar() const noexcept;
     char peekChar(int offset = 1) const noexcept;
     void advance() noexcept;
-    void skipWhitespace() noexcept;
-    void skipComment();
+    void skipTrivia() noexcept;
     Token number();
     Token identifierOrKeyword();
     Token stringLiteral();
     Token characterLiteral();
     Token nextToken();
-    static constexpr bool isOperator(char c) noexcept;
     Token operatorToken();
+    std::string_view lexemeFrom(size_t start) const noexcept;
 };
 
 #endif // LEXER_H
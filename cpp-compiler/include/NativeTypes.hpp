@@ -0,0 +1,55 @@
+// NativeTypes.hpp
+#ifndef NATIVE_TYPES_HPP
+#define NATIVE_TYPES_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "TAC.hpp"
+
+// Type rules the native backends (X86Writer and JITProgram) share. TAC
+// records the type a MOV stores and the type an expression was checked at,
+// but not the width a value has in a machine register, so both derive it
+// here the same way.
+
+// What running a program reports where its native executable would take
+// SIGFPE; the JIT and the interpreter throw these as std::runtime_error
+constexpr const char* DivisionByZeroMessage = "Division by zero";
+constexpr const char* DivisionOverflowMessage = "Integer division overflow";
+
+// Type of a constant from its spelling: "..." string, 'c' char, true and
+// false bool, a '.' float, anything else int
+TypeId literalType(std::string_view text) noexcept;
+
+// Value of a non-string constant; chars give their code, floats truncate
+long long literalInteger(std::string_view text);
+double literalFloat(std::string_view text);
+
+// Declares the variables of the function spanning code [begin, end):
+// types[offset + v] becomes the type of the first typed instruction that
+// writes variable v there, or Unknown, for each variable the function
+// names. Not only MOV and PARAM: the optimizer folds `OP a b t; MOV t v`
+// into `OP a b v` and deletes dead stores, so the typing MOV may be gone.
+// Variables are local to their function, so two functions may give one
+// name different types.
+void declareVariables(const TACProgram& program,
+                      std::uint32_t begin,
+                      std::uint32_t end,
+                      std::vector<TypeId>& types,
+                      size_t offset);
+
+// Type of the value `instruction` produces from operands of type `left`
+// and `right`: comparisons and logic give bool, arithmetic is float when
+// either side is and int otherwise (char promotes, as in C++), and MOV
+// and CALL keep their own type.
+TypeId producedType(const TACInstruction& instruction,
+                    TypeId left,
+                    TypeId right) noexcept;
+
+inline bool isComparison(Opcode op) noexcept
+{
+    return op >= Opcode::LessThan && op <= Opcode::NotEqual;
+}
+
+#endif // NATIVE_TYPES_HPP
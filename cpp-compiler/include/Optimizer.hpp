@@ -0,0 +1,120 @@
+// Optimizer.hpp
+#ifndef OPTIMIZER_HPP
+#define OPTIMIZER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "TAC.hpp"
+
+struct OptimizationSummary
+{
+    size_t removed = 0;
+    size_t threaded = 0;
+    // Expressions replaced by an earlier result, operands replaced by the
+    // value they copy
+    size_t rewritten = 0;
+    // Calls replaced by a copy of the function they call
+    size_t inlined = 0;
+    size_t rounds = 0;
+};
+
+// Runs the TAC passes selected by an -O level:
+//   0  nothing; the output mirrors the source one statement at a time
+//   1  inlining of small leaf functions, jump threading, unreachable
+//      block removal, folding of the MOV after each computed value, local
+//      common subexpression elimination, copy propagation and unused temp
+//      elimination
+//   2  level 1 plus removal of stores whose values never reach a branch or
+//      a return, or that are overwritten within the block, loop-invariant
+//      code motion and strength reduction of induction variables
+// Each pass can expose work for the others (a folded branch leaves a block
+// unreachable, a reused expression leaves a copy to propagate, a removed
+// store leaves its temp unused, an inlined call leaves its caller a leaf
+// small enough to inline), so the passes are repeated until a round
+// changes nothing.
+// Passes see virtual temps, so they run before register allocation.
+class Optimizer
+{
+public:
+    static constexpr int MaxLevel = 2;
+
+    explicit Optimizer(int level) noexcept
+      : level(level)
+    {
+    }
+
+    // "0" to "2"; throws std::runtime_error otherwise
+    static int parseLevel(const std::string& text);
+
+    OptimizationSummary run(TACProgram& program) const;
+
+private:
+    int level;
+};
+
+// The individual passes. Each builds the ControlFlowGraph it needs, or
+// finds block boundaries on its own walk, and returns how many
+// instructions or operands it rewrote or removed.
+
+// Replaces each call to a function without calls of its own whose body is
+// a dozen instructions or fewer by a copy of that body, with fresh temps,
+// variables and labels, MOVs from the arguments into the parameters and
+// from each returned value into the call's result. The functions stay, so
+// other units can still call them.
+size_t inlineCalls(TACProgram& program);
+
+// Retargets jumps through blocks that only hold labels and a GOTO, folds
+// IF_FALSE on a constant, drops jumps to the next instruction and deletes
+// labels nothing jumps to
+size_t threadJumps(TACProgram& program);
+
+// Deletes blocks no entry reaches, such as code after a RET
+size_t removeUnreachableBlocks(TACProgram& program);
+
+// Rewrites OP a b tN followed by MOV tN v into OP a b v when the MOV is the
+// only read of tN, both sit in one block and nothing in between touches v.
+// The generator emits that pair for every declaration and assignment.
+size_t foldCopies(TACProgram& program);
+
+// Local value numbering: an expression whose operands hold the same values
+// as an earlier one in the block becomes a MOV from the operand still
+// holding that result. Commutative operators match either operand order.
+size_t eliminateCommonSubexpressions(TACProgram& program);
+
+// Replaces reads of a temp set by MOV with the MOV's source, within the
+// block and while the source is unchanged. The MOV itself is then left to
+// removeUnusedTemps.
+size_t propagateCopies(TACProgram& program);
+
+// Deletes instructions whose temp result is never read, cascading to the
+// temps they read; divisions that may trap stay
+size_t removeUnusedTemps(TACProgram& program);
+
+// Deletes every write whose value cannot reach a jump condition or a
+// return through any chain of temps and variables, and writes the same
+// block overwrites before reading. Divisions that may trap stay, with the
+// writes they read. Linear in the program size.
+size_t removeDeadStores(TACProgram& program);
+
+// Loop-invariant code motion and strength reduction over the natural
+// loops. Expressions whose operands a loop never changes move to a
+// preheader that runs once before it, leaving a MOV of the result in the
+// loop; divisions only move when their divisor is a constant that cannot
+// trap. In innermost loops, i * k, where every write of the int variable
+// i adds or subtracts a constant and k is invariant, becomes a sum that
+// starts at i * k and changes by constant * k next to each step of i.
+size_t optimizeLoops(TACProgram& program);
+
+// Whether `instruction` may fault at run time: an int / or % whose divisor
+// is not a constant other than 0 and -1. Passes must not delete it, or
+// move it where it would not have run, even when its value is unused.
+bool mayTrap(const TACProgram& program, const TACInstruction& instruction);
+
+// Compacts `code`, dropping every instruction whose flag is set; returns
+// how many were dropped
+size_t eraseInstructions(std::vector<TACInstruction>& code,
+                         const std::vector<std::uint8_t>& dead);
+
+#endif // OPTIMIZER_HPP
@@ -2,10 +2,16 @@
 #ifndef PARSER_HPP
 #define PARSER_HPP
 
+#include <string_view>
 #include <vector>
+#include "Arena.hpp"
+#include "Diagnostics.hpp"
 #include "Token.hpp"
 #include "AST.hpp"
 #include "Lexer.hpp"
+#include "SymbolTable.hpp"
+
+class ThreadPool;
 
 class Parser
 {
@@ -14,35 +20,119 @@ public:
 
     void setTokens(std::vector<Token> tokens);
 
+    // Like setTokens, but hands the previous token list back through
+    // `tokens`, emptied and with its capacity, for the lexer to refill
+    void swapTokens(std::vector<Token>& tokens);
+
+    // Releases the tree and the tokens; the arena and the token list keep
+    // their storage for the next unit
+    void reset();
+
+    // The tree lives in the parser's arena and is released wholesale by the
+    // next setTokens call or when the parser is destroyed. A syntax error
+    // is recorded and parsing resumes after the ';' or '}' that ends the
+    // broken statement, or at the next declaration, 'if' or 'return'; the
+    // tree that remains is still checked, and if anything was wrong a
+    // single std::runtime_error lists every error.
     StatementPtr parse();
 
+    // Checks the functions of a unit of several on `pool` rather than on
+    // the calling thread; null (the default) turns that off. The pool must
+    // outlive the parser's use of it and have no other work in flight.
+    void setThreadPool(ThreadPool* pool) noexcept { this->pool = pool; }
+
+    // Errors found by the last parse
+    const Diagnostics& getDiagnostics() const noexcept { return diagnostics; }
+
+    // Nodes in the tree built by the last parse
+    size_t getNodeCount() const noexcept { return arena.objectCount(); }
+
 private:
     std::shared_ptr<Lexer> lexer;
+    // Always ends with an EndOfFile token, which advance() never moves past
     std::vector<Token> tokens;
     size_t index;
+    Arena arena;
+    // Children of the blocks currently being parsed; each block copies its
+    // own tail into the arena once it is closed
+    std::vector<StatementPtr> statementStack;
+    // Scratch list for the function declaration being parsed
+    std::vector<Parameter> parameters;
+    // Arguments of the calls being parsed, innermost last, like the
+    // statements of the open blocks
+    std::vector<ExpressionPtr> argumentStack;
+    // Scopes and functions for the semantic checks of the tree being parsed
+    SymbolTable symbols;
+    FunctionTable functions;
+    Diagnostics diagnostics;
+    // Set by the first error in a statement, so what follows from it is not
+    // reported too; cleared once parseStatement has resynchronized
+    bool panicking = false;
+    ThreadPool* pool = nullptr;
+
+    // Scopes and errors of one run of functions checked on the pool, kept
+    // from unit to unit like the parser's own
+    struct CheckChunk
+    {
+        SymbolTable symbols;
+        Diagnostics diagnostics;
+    };
+    std::vector<std::unique_ptr<CheckChunk>> checkChunks;
 
-    Token currentToken() const noexcept;
+    const Token& currentToken() const noexcept;
     void advance() noexcept;
     bool match(TokenType type) const noexcept;
+    bool matchSeparator(SeparatorKind kind) const noexcept;
+    // Consumes the separator, or reports `message` and returns false
+    bool expectSeparator(SeparatorKind kind, const char* message);
+    void error(const Token& at, std::string message);
+    // Skips the rest of a broken statement
+    void synchronize() noexcept;
+    // Skips past the ')' closing a broken loop header, so the ';'s inside
+    // a for header do not end the statement early
+    void skipHeader() noexcept;
+    static bool startsStatement(const Token& token) noexcept;
+
+    // Arena node positioned at `at`
+    template <typename T, typename... Args>
+    T* make(const Token& at, Args&&... args);
 
+    // Each parse method returns null if it reported an error and has
+    // nothing usable; a statement missing only its ';' is kept
+    StatementPtr parseTranslationUnit();
     StatementPtr parseStatement();
+    StatementPtr dispatchStatement();
     StatementPtr parseVariableDeclaration();
-    StatementPtr parseFunctionDeclaration(std::string returnType,
-                                          std::string name);
+    StatementPtr parseFunctionDeclaration(TypeId returnType,
+                                          std::string_view name,
+                                          Symbol symbol);
     StatementPtr parseIfStatement();
     StatementPtr parseWhileStatement();
     StatementPtr parseForStatement();
     StatementPtr parseDoWhileStatement();
     StatementPtr parseBlockStatement();
-    StatementPtr parseAssignmentOrFunctionCall();
+    // A for update has no ';' of its own, so it is not `terminated`
+    StatementPtr parseAssignmentOrFunctionCall(bool terminated = true);
     StatementPtr parseReturn();
 
+    // Semantic checks over the whole unit, concurrent with a pool
+    void check(TranslationUnit& unit);
+
     ExpressionPtr parseExpression();
     ExpressionPtr parsePrimaryExpression();
+    // The arguments of a call to the identifier `start`, from the '(' on
+    ExpressionPtr parseCall(const Token& start);
     ExpressionPtr parseBinaryExpression(int precedence = 0);
 
+    std::string_view symbolText(const Token& token) const noexcept;
+    // Token spelling for messages, which already carry its position
+    static std::string describe(const Token& token);
+    NodeList<StatementPtr> popStatements(size_t first);
+    static TypeId typeFromKeyword(const Token& token) noexcept;
+
     static int getPrecedence(const Token& token) noexcept;
-    static BinaryOp tokenToBinaryOp(const Token& token);
+    // False for operators that bind but have no BinaryOp
+    static bool tokenToBinaryOp(const Token& token, BinaryOp& op) noexcept;
 };
 
 #endif // PARSER_HPP
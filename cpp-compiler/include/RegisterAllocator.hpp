@@ -0,0 +1,75 @@
+// RegisterAllocator.hpp
+#ifndef REGISTER_ALLOCATOR_HPP
+#define REGISTER_ALLOCATOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "TAC.hpp"
+
+// Physical registers the allocator may hand out, in preference order
+class RegisterSet
+{
+public:
+    RegisterSet() = default;
+    // Throws std::runtime_error on an empty, duplicate or malformed name
+    explicit RegisterSet(std::vector<std::string> names);
+
+    // "N" names r0 .. rN-1; anything else is a comma-separated list
+    static RegisterSet parse(const std::string& spec);
+
+    const std::vector<std::string>& getNames() const noexcept { return names; }
+    size_t size() const noexcept { return names.size(); }
+    bool empty() const noexcept { return names.empty(); }
+
+    // Comma-separated names; also part of the artifact cache key
+    std::string toString() const;
+
+private:
+    std::vector<std::string> names;
+};
+
+// Instruction positions over which a temp must keep its value: from its
+// definition to its last use, stretched to the end of every loop whose
+// header it is live into
+struct LiveInterval
+{
+    std::uint32_t temp;
+    std::uint32_t start;
+    std::uint32_t end;
+};
+
+// One interval per temp that is defined or used, ordered by start
+std::vector<LiveInterval> computeLiveIntervals(const TACProgram& program);
+
+struct AllocationSummary
+{
+    size_t temps = 0;
+    size_t spilled = 0;
+    // Most registers in use at once
+    size_t registersUsed = 0;
+    size_t slots = 0;
+};
+
+// Linear-scan allocation over the live intervals (Poletto and Sarkar).
+// Temps are rewritten in place to Register operands; when more intervals
+// overlap than there are registers, the one that ends last lives in a
+// spill slot instead. TAC operands may name memory, so a spill needs no
+// extra load or store instructions. Slots are reused once their interval
+// has ended.
+class RegisterAllocator
+{
+public:
+    explicit RegisterAllocator(RegisterSet registers)
+      : registers(std::move(registers))
+    {
+    }
+
+    AllocationSummary allocate(TACProgram& program) const;
+
+private:
+    RegisterSet registers;
+};
+
+#endif // REGISTER_ALLOCATOR_HPP
@@ -0,0 +1,71 @@
+// SemanticAnalyzer.hpp
+#ifndef SEMANTIC_ANALYZER_HPP
+#define SEMANTIC_ANALYZER_HPP
+
+#include "ASTVisitor.hpp"
+#include "Diagnostics.hpp"
+#include "SymbolTable.hpp"
+
+// Declaration, lookup and type rules over a parsed tree. Function bodies and
+// blocks open scopes. Functions come from a FunctionTable filled in before
+// the check; as in C++, a call may only name a function defined above it,
+// arguments convert like initializers and a returned number converts to
+// any numeric return type. This is also the type-annotation pass: each
+// expression's type is computed once, bottom-up, and stored on the node for
+// the rest of the pipeline. Violations are recorded in `diagnostics` at the
+// offending node and checking goes on; an expression whose type could not
+// be resolved is Unknown, and checks involving it are skipped so that one
+// mistake is reported once.
+class SemanticAnalyzer
+  : public ASTVisitor<SemanticAnalyzer, TypeId, void, true>
+{
+public:
+    SemanticAnalyzer(SymbolTable& symTable,
+                     const FunctionTable& functions,
+                     Diagnostics& diagnostics) noexcept
+      : symTable(symTable)
+      , functions(functions)
+      , diagnostics(diagnostics)
+    {
+    }
+
+    void check(Statement& root) { visitStatement(root); }
+
+    TypeId visit(BinaryExpression& expr);
+    TypeId visit(LiteralExpression& expr);
+    TypeId visit(VariableExpression& expr);
+    TypeId visit(CallExpression& expr);
+    void visit(BlockStatement& stmt);
+    void visit(VariableDeclaration& stmt);
+    void visit(AssignmentStatement& stmt);
+    void visit(ExpressionStatement& stmt);
+    void visit(ReturnStatement& stmt);
+    void visit(FunctionDeclaration& stmt);
+    void visit(IfStatement& stmt);
+    void visit(WhileStatement& stmt);
+    void visit(DoWhileStatement& stmt);
+    void visit(ForStatement& stmt);
+    void visit(TranslationUnit& unit);
+
+private:
+    SymbolTable& symTable;
+    const FunctionTable& functions;
+    Diagnostics& diagnostics;
+    // The function whose body is being checked, if any
+    const FunctionDeclaration* function = nullptr;
+
+    // Resolves and records the type of an expression tree
+    TypeId annotate(Expression& expr);
+    SymbolTable::Variable lookup(const ASTNode& at,
+                                 Symbol symbol,
+                                 std::string_view name);
+    // Annotates a branch or loop condition, which must be int or bool
+    void checkCondition(Expression& condition, const char* statement);
+    void checkAssignable(const ASTNode& at,
+                         TypeId target,
+                         TypeId value,
+                         bool initializing);
+    void error(const ASTNode& at, std::string message);
+};
+
+#endif // SEMANTIC_ANALYZER_HPP
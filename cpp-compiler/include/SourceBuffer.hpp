@@ -0,0 +1,40 @@
+// SourceBuffer.hpp
+#ifndef SOURCE_BUFFER_HPP
+#define SOURCE_BUFFER_HPP
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// Read-only contents of an input file. Regular files are memory-mapped so
+// the lexer reads straight from the page cache; pipes, terminals and stdin
+// (path "-") are pulled in fixed-size chunks into a single owned buffer.
+class SourceBuffer
+{
+public:
+    static SourceBuffer open(const std::string& filePath);
+
+    SourceBuffer() = default;
+    SourceBuffer(SourceBuffer&& other) noexcept;
+    SourceBuffer& operator=(SourceBuffer&& other) noexcept;
+    SourceBuffer(const SourceBuffer&) = delete;
+    SourceBuffer& operator=(const SourceBuffer&) = delete;
+    ~SourceBuffer();
+
+    std::string_view view() const noexcept { return { data, size }; }
+    bool isMapped() const noexcept { return mapped; }
+
+private:
+    static constexpr size_t ChunkSize = 64 * 1024;
+
+    const char* data = nullptr;
+    size_t size = 0;
+    bool mapped = false;
+    std::unique_ptr<char[]> owned;
+
+    void release() noexcept;
+    void readChunks(int fd, const std::string& filePath);
+};
+
+#endif // SOURCE_BUFFER_HPP
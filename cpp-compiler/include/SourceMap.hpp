@@ -0,0 +1,36 @@
+// SourceMap.hpp
+#ifndef SOURCE_MAP_HPP
+#define SOURCE_MAP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Byte offset into a source buffer that stands for "nowhere"
+constexpr std::uint32_t NoOffset = UINT32_MAX;
+
+// 1-based position in a source buffer; {0, 0} when unknown
+struct SourceLocation
+{
+    int line = 0;
+    int column = 0;
+};
+
+// Line starts of a source buffer, found in one bulk scan for newlines, so
+// tokens only need to remember where they are in the buffer. Columns count
+// bytes from the start of the line.
+class SourceMap
+{
+public:
+    SourceMap() = default;
+    explicit SourceMap(std::string_view source);
+
+    SourceLocation locate(size_t offset) const noexcept;
+    size_t lineCount() const noexcept { return lineStarts.size(); }
+
+private:
+    std::vector<std::uint32_t> lineStarts;
+};
+
+#endif // SOURCE_MAP_HPP
@@ -0,0 +1,68 @@
+// StringInterner.hpp
+#ifndef STRING_INTERNER_HPP
+#define STRING_INTERNER_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+using Symbol = std::uint32_t;
+
+constexpr Symbol InvalidSymbol = UINT32_MAX;
+
+// Maps identifier spellings to dense integer ids. Interned text is copied
+// into large chunks owned by the interner, so the returned views stay valid
+// for the interner's lifetime, independently of the source buffer. Lookup is
+// an open-addressing table of (hash, symbol) pairs, so probing touches one
+// contiguous array instead of chasing hash-map nodes.
+class StringInterner
+{
+public:
+    StringInterner() = default;
+    StringInterner(const StringInterner&) = delete;
+    StringInterner& operator=(const StringInterner&) = delete;
+    StringInterner(StringInterner&&) noexcept = default;
+    StringInterner& operator=(StringInterner&&) noexcept = default;
+
+    Symbol intern(std::string_view text);
+    Symbol find(std::string_view text) const noexcept;
+
+    std::string_view lookup(Symbol symbol) const noexcept
+    {
+        return strings[symbol];
+    }
+
+    size_t size() const noexcept { return strings.size(); }
+
+    // Forgets every string, invalidating their symbols and views, but keeps
+    // the table and the chunks for the strings interned next
+    void clear() noexcept;
+
+private:
+    static constexpr size_t ChunkSize = 64 * 1024;
+
+    struct Slot
+    {
+        std::uint32_t hash;
+        Symbol symbol = InvalidSymbol;
+    };
+
+    std::vector<Slot> slots = std::vector<Slot>(256);
+    std::vector<std::string_view> strings;
+    // ChunkSize blocks, the first `chunksInUse` of them holding strings
+    std::vector<std::unique_ptr<char[]>> chunks;
+    size_t chunksInUse = 0;
+    // Spellings too long to share a chunk, one block each
+    std::vector<std::unique_ptr<char[]>> oversized;
+    char* current = nullptr;
+    size_t chunkUsed = ChunkSize;
+
+    static std::uint32_t hash(std::string_view text) noexcept;
+    size_t findSlot(std::string_view text, std::uint32_t textHash) const
+      noexcept;
+    void grow();
+    std::string_view store(std::string_view text);
+};
+
+#endif // STRING_INTERNER_HPP
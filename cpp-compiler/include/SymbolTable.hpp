@@ -2,33 +2,118 @@
 #ifndef SYMBOL_TABLE_HPP
 #define SYMBOL_TABLE_HPP
 
-#include <unordered_map>
-#include <string>
-#include <stdexcept>
+#include <cstdint>
+#include <vector>
+#include "StringInterner.hpp"
+#include "Types.hpp"
 
+// Block-scoped variable bindings keyed by interned symbol. Lookup is one
+// open-addressing probe sequence over a flat slot array; each slot points at
+// the innermost live binding for its symbol, and bindings chain to the ones
+// they shadow, so leaving a scope just unwinds the bindings it added.
+// Nothing here allocates once the arrays have grown to the program's size.
+//
+// Each binding also gets an ordinal: how many bindings of its name came
+// before it since the outermost scope was last entered, that is within the
+// function. A shadowing or sibling-scope redeclaration thus differs from
+// the first by its ordinal, which is what later passes name it by.
 class SymbolTable
 {
 public:
-    void declareVariable(const std::string& name, const std::string& type)
+    struct Variable
     {
-        if (symbols.find(name) != symbols.end()) {
-            throw std::runtime_error("Variable '" + name +
-                                     "' is already declared");
+        TypeId type = TypeId::Unknown;
+        std::uint32_t ordinal = 0;
+    };
+
+    SymbolTable();
+
+    // Drops every binding and scope but the global one, keeping the arrays
+    void reset() noexcept;
+
+    // Entering a scope of the global one restarts the ordinals
+    void enterScope();
+    void exitScope() noexcept;
+
+    // Returns false if the name is already declared in the current scope
+    bool declareVariable(Symbol name, TypeId type);
+
+    // The innermost visible binding; type Unknown if there is none
+    Variable lookupVariable(Symbol name) const noexcept
+    {
+        std::uint32_t binding = slots[findSlot(name)].binding;
+        if (binding == NoBinding) {
+            return {};
         }
-        symbols[name] = type;
+        return { bindings[binding].type, bindings[binding].ordinal };
     }
 
-    std::string lookupVariable(const std::string& name) const
+private:
+    static constexpr std::uint32_t NoBinding = UINT32_MAX;
+
+    struct Slot
+    {
+        Symbol name = InvalidSymbol;
+        std::uint32_t binding = NoBinding;
+    };
+
+    struct Binding
     {
-        auto it = symbols.find(name);
-        if (it == symbols.end()) {
-            throw std::runtime_error("Variable '" + name + "' is not declared");
+        Symbol name;
+        TypeId type;
+        std::uint32_t depth;
+        std::uint32_t shadowed;
+        std::uint32_t ordinal;
+    };
+
+    std::vector<Slot> slots;
+    std::vector<Binding> bindings;
+    std::vector<std::uint32_t> scopeStarts;
+    // Bindings made of each symbol since the ordinals last restarted, and
+    // the symbols counted, to clear them
+    std::vector<std::uint32_t> ordinals;
+    std::vector<Symbol> counted;
+    size_t usedSlots = 0;
+
+    size_t findSlot(Symbol name) const noexcept
+    {
+        size_t mask = slots.size() - 1;
+        // Multiplying by an odd constant permutes the low bits, so dense
+        // symbol ids land in distinct slots
+        size_t slot = (name * 2654435769u) & mask;
+        while (slots[slot].name != name && slots[slot].name != InvalidSymbol) {
+            slot = (slot + 1) & mask;
         }
-        return it->second;
+        return slot;
+    }
+
+    void grow();
+    void restartOrdinals() noexcept;
+};
+
+class FunctionDeclaration;
+
+// The functions of a unit by interned name. Parser declares every one
+// before any body is checked, so the concurrent checks only read it.
+class FunctionTable
+{
+public:
+    // Forgets every function, keeping the array
+    void reset() noexcept;
+
+    // Returns false if a function of that name is already declared
+    bool declare(Symbol name, const FunctionDeclaration& function);
+
+    // Null if no function has the name
+    const FunctionDeclaration* lookup(Symbol name) const noexcept
+    {
+        return name < functions.size() ? functions[name] : nullptr;
     }
 
 private:
-    std::unordered_map<std::string, std::string> symbols;
+    // Indexed by symbol, which the interner hands out densely
+    std::vector<const FunctionDeclaration*> functions;
+    std::vector<Symbol> declared;
 };
 
 #endif // SYMBOL_TABLE_H
@@ -0,0 +1,264 @@
+// TAC.hpp
+#ifndef TAC_HPP
+#define TAC_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "StringInterner.hpp"
+#include "Types.hpp"
+
+// A function starts at FUNCTION f, which names it and is the only way
+// into it: control never falls into a FUNCTION, and LABELs are only jump
+// targets. Calls pass values as ARG v, one per argument in order, right
+// before CALL f n r, which runs function f on the n ARGs and leaves its
+// value in r (None when it is dropped). The callee receives argument k as
+// PARAM k x after its FUNCTION. A call changes nothing of the caller's but
+// r, whose temps, variables, registers and slots are its own.
+enum class Opcode : std::uint8_t
+{
+    Mov,
+    Add,
+    Subtract,
+    Multiply,
+    Divide,
+    Modulo,
+    LessThan,
+    GreaterThan,
+    Equal,
+    NotEqual,
+    And,
+    Or,
+    IfFalse,
+    Goto,
+    Label,
+    Ret,
+    Param,
+    Arg,
+    Call,
+    Function
+};
+
+constexpr const char* opcodeName(Opcode op) noexcept
+{
+    switch (op) {
+        case Opcode::Mov:
+            return "MOV";
+        case Opcode::Add:
+            return "+";
+        case Opcode::Subtract:
+            return "-";
+        case Opcode::Multiply:
+            return "*";
+        case Opcode::Divide:
+            return "/";
+        case Opcode::Modulo:
+            return "%";
+        case Opcode::LessThan:
+            return "<";
+        case Opcode::GreaterThan:
+            return ">";
+        case Opcode::Equal:
+            return "==";
+        case Opcode::NotEqual:
+            return "!=";
+        case Opcode::And:
+            return "&&";
+        case Opcode::Or:
+            return "||";
+        case Opcode::IfFalse:
+            return "IF_FALSE";
+        case Opcode::Goto:
+            return "GOTO";
+        case Opcode::Label:
+            return "LABEL";
+        case Opcode::Ret:
+            return "RET";
+        case Opcode::Param:
+            return "PARAM";
+        case Opcode::Arg:
+            return "ARG";
+        case Opcode::Call:
+            return "CALL";
+        case Opcode::Function:
+            return "FUNCTION";
+        default:
+            return "?";
+    }
+}
+
+// 32-bit handle naming an instruction operand: a kind tag in the top bits
+// and an index below it. Temps and spill slots are numbered per program;
+// variables, constants, labels, functions and registers index the owning
+// TACProgram's string table. Labels are jump targets only, and functions,
+// named by FUNCTION and CALL, are a kind of their own, so a call can never
+// resolve to a label of the same spelling. Registers and slots only appear
+// after register allocation.
+class Operand
+{
+public:
+    enum class Kind : std::uint8_t
+    {
+        None,
+        Temp,
+        Variable,
+        Constant,
+        Label,
+        Register,
+        Slot,
+        Function
+    };
+
+    static constexpr unsigned IndexBits = 29;
+    static constexpr std::uint32_t MaxIndex = (1u << IndexBits) - 1;
+
+    constexpr Operand() noexcept = default;
+
+    static constexpr Operand make(Kind kind, std::uint32_t index) noexcept
+    {
+        return Operand((static_cast<std::uint32_t>(kind) << IndexBits) |
+                       (index & MaxIndex));
+    }
+
+    constexpr Kind kind() const noexcept
+    {
+        return static_cast<Kind>(bits >> IndexBits);
+    }
+    constexpr std::uint32_t index() const noexcept { return bits & MaxIndex; }
+    constexpr std::uint32_t raw() const noexcept { return bits; }
+    constexpr bool isNone() const noexcept { return bits == 0; }
+    constexpr bool is(Kind k) const noexcept { return kind() == k; }
+
+    constexpr bool operator==(Operand other) const noexcept
+    {
+        return bits == other.bits;
+    }
+    constexpr bool operator!=(Operand other) const noexcept
+    {
+        return bits != other.bits;
+    }
+
+private:
+    constexpr explicit Operand(std::uint32_t bits) noexcept
+      : bits(bits)
+    {
+    }
+
+    std::uint32_t bits = 0;
+};
+
+// `type` is the type of the value the instruction produces or moves: the
+// destination's type for MOV, the operand type for arithmetic and
+// comparisons, the function's return type for RET and CALL and the
+// parameter's type for PARAM and ARG. Unknown for other control flow.
+struct TACInstruction
+{
+    Opcode op;
+    TypeId type;
+    std::uint8_t reserved[2] = {};
+    Operand arg1;
+    Operand arg2;
+    Operand result;
+
+    constexpr TACInstruction(Opcode op,
+                             Operand arg1 = Operand(),
+                             Operand arg2 = Operand(),
+                             Operand result = Operand(),
+                             TypeId type = TypeId::Unknown) noexcept
+      : op(op)
+      , type(type)
+      , arg1(arg1)
+      , arg2(arg2)
+      , result(result)
+    {
+    }
+};
+
+static_assert(sizeof(TACInstruction) == 16,
+              "TACInstruction is meant to pack into 16 bytes");
+
+// A lowered program: a flat instruction array plus the table that names
+// its variables, constants and labels. Spellings are interned once, so an
+// operand referring to "x" is the same 32-bit value everywhere.
+class TACProgram
+{
+public:
+    std::vector<TACInstruction> code;
+
+    Operand variable(std::string_view name)
+    {
+        return Operand::make(Operand::Kind::Variable, strings.intern(name));
+    }
+    Operand constant(std::string_view literal)
+    {
+        return Operand::make(Operand::Kind::Constant, strings.intern(literal));
+    }
+    Operand label(std::string_view name)
+    {
+        return Operand::make(Operand::Kind::Label, strings.intern(name));
+    }
+    Operand function(std::string_view name)
+    {
+        return Operand::make(Operand::Kind::Function, strings.intern(name));
+    }
+    Operand reg(std::string_view name)
+    {
+        return Operand::make(Operand::Kind::Register, strings.intern(name));
+    }
+    // Fresh L<n> label; spellings already in the table are skipped. The
+    // generator interns every function name before it lowers any body, so
+    // the label never aliases a function or another label.
+    Operand newLabel();
+    // Fresh variable spelled `name`.<n>, which no identifier can alias; for
+    // the copies of a function's variables the inliner makes
+    Operand newVariable(std::string_view name);
+    Operand newTemp() noexcept
+    {
+        return Operand::make(Operand::Kind::Temp, tempCount++);
+    }
+    Operand slot(std::uint32_t index) noexcept
+    {
+        if (index >= slotCount) {
+            slotCount = index + 1;
+        }
+        return Operand::make(Operand::Kind::Slot, index);
+    }
+
+    // Spelling of a variable, constant, label, function or register operand
+    std::string_view text(Operand operand) const noexcept
+    {
+        return strings.lookup(operand.index());
+    }
+
+    // Appends the printed form of an operand; None prints as nothing and
+    // slot k as [sk]
+    void appendOperand(std::string& out, Operand operand) const;
+
+    std::uint32_t getTempCount() const noexcept { return tempCount; }
+    // For programs loaded from an image; newTemp continues after `count`
+    void setTempCount(std::uint32_t count) noexcept { tempCount = count; }
+    std::uint32_t getSlotCount() const noexcept { return slotCount; }
+    void setSlotCount(std::uint32_t count) noexcept { slotCount = count; }
+    const StringInterner& getStrings() const noexcept { return strings; }
+
+    // Empties the program for the next one, keeping its storage
+    void clear() noexcept
+    {
+        code.clear();
+        strings.clear();
+        tempCount = 0;
+        slotCount = 0;
+        labelCount = 0;
+        variableCount = 0;
+    }
+
+private:
+    StringInterner strings;
+    std::uint32_t tempCount = 0;
+    std::uint32_t slotCount = 0;
+    std::uint32_t labelCount = 0;
+    std::uint32_t variableCount = 0;
+};
+
+#endif // TAC_HPP
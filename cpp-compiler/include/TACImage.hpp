@@ -0,0 +1,104 @@
+// TACImage.hpp
+#ifndef TAC_IMAGE_HPP
+#define TAC_IMAGE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "AssemblyWriter.hpp"
+#include "SourceBuffer.hpp"
+#include "TAC.hpp"
+
+// Binary form of a TACProgram, laid out so a mapped file can be used in
+// place:
+//
+//   TACImageHeader                      32 bytes
+//   TACInstruction[instructionCount]    16 bytes each, as held in memory
+//   uint32_t[stringCount + 1]           start of each string, then the end
+//   char[stringBytes]                   string data, not terminated
+//
+// Operands keep their in-memory encoding, so variable, constant, label,
+// function and register indices refer to the string table. Integers are in the writer's byte
+// order; a reader on a machine with the other order rejects the file.
+struct TACImageHeader
+{
+    static constexpr char Magic[4] = { 'T', 'C', 'I', 'R' };
+    // 2 added register and spill slot operands and slotCount, 3 the
+    // PARAM, ARG and CALL opcodes, 4 the FUNCTION opcode, 5 function
+    // operands. Older images start functions with a LABEL, which no longer
+    // marks an entry, and name them and their calls with label operands.
+    static constexpr std::uint16_t CurrentVersion = 5;
+    static constexpr std::uint16_t OldestReadableVersion = 5;
+    static constexpr std::uint16_t ByteOrderMark = 0x0102;
+
+    char magic[4];
+    std::uint16_t version;
+    std::uint16_t byteOrder;
+    std::uint32_t instructionCount;
+    std::uint32_t tempCount;
+    std::uint32_t stringCount;
+    std::uint32_t stringBytes;
+    std::uint32_t slotCount;
+    std::uint32_t reserved;
+};
+
+static_assert(sizeof(TACImageHeader) == 32,
+              "TACImageHeader keeps the instruction records 16-byte aligned");
+
+// Serializes `program`; returns the number of bytes handed to the sink
+size_t writeTACImage(const TACProgram& program, OutputSink& sink);
+
+// Read-only view of a serialized program. open() maps the file and checks
+// only the header and section sizes, so loading costs the same for any
+// program size; verify() walks every instruction for inputs that are not
+// trusted.
+class TACImage
+{
+public:
+    static TACImage open(const std::string& filePath);
+    // Does not copy; `bytes` must outlive the image and be 4-byte aligned
+    static TACImage fromBytes(std::string_view bytes);
+
+    // True when `bytes` begins with the image magic
+    static bool isImage(std::string_view bytes) noexcept;
+
+    const TACInstruction* begin() const noexcept { return code; }
+    const TACInstruction* end() const noexcept
+    {
+        return code + header->instructionCount;
+    }
+    size_t size() const noexcept { return header->instructionCount; }
+
+    std::uint32_t getTempCount() const noexcept { return header->tempCount; }
+    std::uint32_t getSlotCount() const noexcept { return header->slotCount; }
+    std::uint32_t getStringCount() const noexcept
+    {
+        return header->stringCount;
+    }
+
+    // String table entry, or an empty view for an out-of-range index
+    std::string_view string(std::uint32_t index) const noexcept;
+    std::string_view text(Operand operand) const noexcept
+    {
+        return string(operand.index());
+    }
+
+    // Throws std::runtime_error on an unknown opcode or type, or an operand
+    // that points outside the temp or slot range or the string table
+    void verify() const;
+
+    // Verifies the image and copies it into an owned, mutable program
+    TACProgram toProgram() const;
+
+private:
+    SourceBuffer storage;
+    const TACImageHeader* header = nullptr;
+    const TACInstruction* code = nullptr;
+    const std::uint32_t* offsets = nullptr;
+    const char* strings = nullptr;
+
+    void bind(std::string_view bytes);
+};
+
+#endif // TAC_IMAGE_HPP
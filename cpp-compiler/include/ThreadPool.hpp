@@ -0,0 +1,71 @@
+// ThreadPool.hpp
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of workers with one task deque each. A worker pops from the
+// back of its own deque and, when that runs dry, steals from the front of
+// the others, so uneven task costs even out without a central queue.
+class ThreadPool
+{
+public:
+    using Task = std::function<void()>;
+
+    static constexpr unsigned NotAWorker = ~0u;
+
+    // Zero picks one worker per hardware thread
+    explicit ThreadPool(unsigned threadCount = 0);
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ~ThreadPool();
+
+    // Tasks submitted from a worker go onto that worker's own deque
+    void submit(Task task);
+
+    // Blocks until every submitted task has finished
+    void wait();
+
+    // Runs body(0) ... body(count - 1) on the workers and waits for them,
+    // rethrowing the first exception one of them threw. It waits for the
+    // whole pool, so it must not be called from one of its workers.
+    void forEach(size_t count, const std::function<void(size_t)>& body);
+
+    unsigned size() const noexcept
+    {
+        return static_cast<unsigned>(workers.size());
+    }
+
+    // Index of the calling worker in its pool, or NotAWorker
+    static unsigned currentWorker() noexcept;
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex stateMutex;
+    std::condition_variable wakeup;
+    std::condition_variable idle;
+    size_t queued = 0;  // Tasks sitting in a deque
+    size_t pending = 0; // Tasks submitted but not yet finished
+    bool stopping = false;
+    std::atomic<unsigned> nextQueue{ 0 };
+
+    void workerLoop(unsigned index);
+    bool tryPop(unsigned index, Task& task);
+};
+
+#endif // THREAD_POOL_HPP
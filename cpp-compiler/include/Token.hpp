@@ -1,9 +1,37 @@
 #ifndef TOKEN_H
 #define TOKEN_H
 
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include "SourceMap.hpp"
+#include "StringInterner.hpp"
 
-enum class TokenType
+// Keywords are interned first, in this order, so their symbols are fixed
+enum class Keyword : Symbol
+{
+    True,
+    False,
+    Nullptr,
+    Int,
+    Return,
+    If,
+    Else,
+    For,
+    While,
+    Do,
+    Float,
+    Char,
+    StdString,
+    Count
+};
+
+constexpr Symbol keywordSymbol(Keyword keyword) noexcept
+{
+    return static_cast<Symbol>(keyword);
+}
+
+enum class TokenType : std::uint8_t
 {
     Identifier,
     Keyword,
@@ -20,37 +48,100 @@ enum class TokenType
     FloatingPointLiteral
 };
 
+// Operator spellings the lexer classifies, so the parser dispatches on a
+// kind instead of comparing text. A run of operator characters with no
+// meaning of its own (such as "+-") is Other; non-operators are None.
+enum class OperatorKind : std::uint8_t
+{
+    None,
+    Plus,
+    Minus,
+    Star,
+    Slash,
+    Percent,
+    Assign,
+    Less,
+    Greater,
+    LessEqual,
+    GreaterEqual,
+    EqualEqual,
+    NotEqual,
+    AndAnd,
+    OrOr,
+    Not,
+    Ampersand,
+    Pipe,
+    Caret,
+    Tilde,
+    Other,
+    Count
+};
+
+enum class SeparatorKind : std::uint8_t
+{
+    None,
+    Semicolon,
+    Comma,
+    LeftParen,
+    RightParen,
+    LeftBrace,
+    RightBrace
+};
+
 class Token
 {
 public:
+    // The token only views its lexeme; the buffer handed to
+    // Lexer::setSource must outlive it. Its position is where that view
+    // starts (Lexer::locate).
     Token(TokenType type,
-          const std::string& value,
-          int line,
-          int column) noexcept
+          std::string_view value,
+          Symbol symbol = InvalidSymbol) noexcept
       : type(type)
+      , symbol(symbol)
+      , value(value)
+    {
+    }
+
+    Token(OperatorKind op, std::string_view value) noexcept
+      : type(TokenType::Operator)
+      , op(op)
+      , value(value)
+    {
+    }
+
+    Token(SeparatorKind separator, std::string_view value) noexcept
+      : type(TokenType::Separator)
+      , separator(separator)
       , value(value)
-      , line(line)
-      , column(column)
     {
     }
 
     TokenType getType() const noexcept { return type; }
-    const std::string& getValue() const noexcept { return value; }
-    int getLine() const noexcept { return line; }
-    int getColumn() const noexcept { return column; }
+    std::string_view getValue() const noexcept { return value; }
+    // Interned id for identifiers and keywords, InvalidSymbol otherwise
+    Symbol getSymbol() const noexcept { return symbol; }
+    bool isKeyword(Keyword keyword) const noexcept
+    {
+        return symbol == keywordSymbol(keyword);
+    }
+    OperatorKind getOperator() const noexcept { return op; }
+    SeparatorKind getSeparator() const noexcept { return separator; }
 
-    std::string toString() const noexcept
+    std::string toString(SourceLocation location) const
     {
         return std::string("Token(") + tokenTypeToString(type) + ", \"" +
-               value + "\", Line: " + std::to_string(line) +
-               ", Column: " + std::to_string(column) + ")";
+               std::string(value) + "\", Line: " +
+               std::to_string(location.line) +
+               ", Column: " + std::to_string(location.column) + ")";
     }
 
 private:
     TokenType type;
-    std::string value;
-    int line;
-    int column;
+    OperatorKind op = OperatorKind::None;
+    SeparatorKind separator = SeparatorKind::None;
+    Symbol symbol = InvalidSymbol;
+    std::string_view value;
 
     static constexpr const char* tokenTypeToString(TokenType type) noexcept
     {
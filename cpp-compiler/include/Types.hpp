@@ -0,0 +1,37 @@
+// Types.hpp
+#ifndef TYPES_HPP
+#define TYPES_HPP
+
+#include <cstdint>
+
+// Small integer ids for the language's types. Unknown marks "not computed"
+// or "not found", never a real type.
+enum class TypeId : std::uint8_t
+{
+    Unknown,
+    Int,
+    Float,
+    Char,
+    String,
+    Bool
+};
+
+constexpr const char* typeName(TypeId type) noexcept
+{
+    switch (type) {
+        case TypeId::Int:
+            return "int";
+        case TypeId::Float:
+            return "float";
+        case TypeId::Char:
+            return "char";
+        case TypeId::String:
+            return "std::string";
+        case TypeId::Bool:
+            return "bool";
+        default:
+            return "unknown";
+    }
+}
+
+#endif // TYPES_HPP
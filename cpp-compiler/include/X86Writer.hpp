@@ -0,0 +1,56 @@
+// X86Writer.hpp
+#ifndef X86_WRITER_HPP
+#define X86_WRITER_HPP
+
+#include <cstddef>
+#include <string>
+#include "AssemblyWriter.hpp"
+#include "RegisterAllocator.hpp"
+#include "TAC.hpp"
+
+// Lowers a TACProgram to x86-64 assembly for the GNU assembler in Intel
+// syntax, following the System V ABI, so `gcc out.s` links it into a
+// native executable.
+//
+// Every function gets an rbp frame with one 8-byte slot per variable, temp
+// and spill slot it touches. Temps the RegisterAllocator placed stay in
+// their registers; callee-saved ones are pushed by the prologue. int, char
+// and bool are 32-bit, float is an SSE double and std::string is a pointer
+// to a literal in .rodata. Arithmetic works on memory and immediate
+// operands directly, adds and small constant multiplies go through lea,
+// comparisons set their result with setcc, && and || select with cmov, and
+// a comparison followed by the IF_FALSE that tests it becomes one jcc.
+// Calls pass ints, chars, bools and strings in rdi, rsi, rdx, rcx, r8 and
+// r9, floats in xmm0-xmm7 and the rest on the stack, with the caller-saved
+// registers the caller allocated pushed around the call.
+//
+// Throws std::runtime_error for what has no native lowering: arithmetic
+// and comparison on strings, float %, and registers that are not in
+// allocatableRegisters.
+class X86Writer
+{
+public:
+    explicit X86Writer(OutputSink& sink);
+    X86Writer(const X86Writer&) = delete;
+    X86Writer& operator=(const X86Writer&) = delete;
+
+    void write(const TACProgram& program);
+    void flush();
+
+    // Bytes handed to the sink so far
+    size_t bytesWritten() const noexcept { return written; }
+
+    // The first `count` of rbx, r12-r15, rsi, rdi and r8-r11; throws past
+    // eleven. rax, rcx, rdx and the SSE registers are the writer's scratch.
+    static RegisterSet allocatableRegisters(size_t count);
+
+private:
+    // Lowers one program; defined in X86Writer.cpp
+    class Lowering;
+
+    OutputSink& sink;
+    std::string buffer;
+    size_t written = 0;
+};
+
+#endif // X86_WRITER_HPP
@@ -0,0 +1,180 @@
+#include "ASTPrinter.hpp"
+
+std::string ASTNode::toString() const
+{
+    return ASTPrinter().print(*this);
+}
+
+std::string ASTPrinter::print(const ASTNode& node)
+{
+    out.clear();
+    printNode(node);
+    return std::move(out);
+}
+
+void ASTPrinter::printNode(const ASTNode& node)
+{
+    if (node.isExpression()) {
+        visitExpression(static_cast<const Expression&>(node));
+    } else {
+        visitStatement(static_cast<const Statement&>(node));
+    }
+}
+
+void ASTPrinter::visit(const BinaryExpression& expr)
+{
+    out += '(';
+    visitExpression(*expr.getLeft());
+    out += ' ';
+    out += BinaryExpression::opToString(expr.getOperator());
+    out += ' ';
+    visitExpression(*expr.getRight());
+    out += ')';
+}
+
+void ASTPrinter::visit(const LiteralExpression& expr)
+{
+    out += expr.getValue();
+}
+
+void ASTPrinter::visit(const VariableExpression& expr)
+{
+    out += expr.getName();
+}
+
+void ASTPrinter::visit(const CallExpression& expr)
+{
+    out += expr.getName();
+    out += '(';
+    const auto arguments = expr.getArguments();
+    for (size_t i = 0; i < arguments.size(); ++i) {
+        if (i > 0)
+            out += ", ";
+        visitExpression(*arguments[i]);
+    }
+    out += ')';
+}
+
+void ASTPrinter::visit(const BlockStatement& stmt)
+{
+    for (const auto& inner : stmt.getStatements()) {
+        out += "  ";
+        visitStatement(*inner);
+        out += '\n';
+    }
+}
+
+void ASTPrinter::visit(const VariableDeclaration& stmt)
+{
+    out += typeName(stmt.getType());
+    out += ' ';
+    out += stmt.getName();
+    out += " = ";
+    if (stmt.getInitializer()) {
+        visitExpression(*stmt.getInitializer());
+    } else {
+        out += "null";
+    }
+    out += ';';
+}
+
+void ASTPrinter::visit(const AssignmentStatement& stmt)
+{
+    out += stmt.getName();
+    out += " = ";
+    visitExpression(*stmt.getValue());
+    out += ';';
+}
+
+void ASTPrinter::visit(const ExpressionStatement& stmt)
+{
+    visitExpression(*stmt.getExpression());
+    out += ';';
+}
+
+void ASTPrinter::visit(const ReturnStatement& stmt)
+{
+    out += "return";
+    if (stmt.getReturnValue()) {
+        out += ' ';
+        visitExpression(*stmt.getReturnValue());
+    }
+    out += ';';
+}
+
+void ASTPrinter::visit(const FunctionDeclaration& stmt)
+{
+    out += typeName(stmt.getReturnType());
+    out += ' ';
+    out += stmt.getName();
+    out += '(';
+    const auto parameters = stmt.getParameters();
+    for (size_t i = 0; i < parameters.size(); ++i) {
+        if (i > 0)
+            out += ", ";
+        out += typeName(parameters[i].type);
+        out += ' ';
+        out += parameters[i].name;
+    }
+    out += ')';
+}
+
+void ASTPrinter::visit(const IfStatement& stmt)
+{
+    out += "if (";
+    visitExpression(*stmt.getCondition());
+    out += ") ";
+    visitStatement(*stmt.getThenBranch());
+    if (stmt.getElseBranch()) {
+        out += " else ";
+        visitStatement(*stmt.getElseBranch());
+    }
+}
+
+void ASTPrinter::visit(const WhileStatement& stmt)
+{
+    out += "while (";
+    visitExpression(*stmt.getCondition());
+    out += ") ";
+    visitStatement(*stmt.getBody());
+}
+
+void ASTPrinter::visit(const DoWhileStatement& stmt)
+{
+    out += "do ";
+    visitStatement(*stmt.getBody());
+    out += " while (";
+    visitExpression(*stmt.getCondition());
+    out += ");";
+}
+
+void ASTPrinter::visit(const ForStatement& stmt)
+{
+    out += "for (";
+    if (stmt.getInitializer()) {
+        visitStatement(*stmt.getInitializer());
+    } else {
+        out += ';';
+    }
+    if (stmt.getCondition()) {
+        out += ' ';
+        visitExpression(*stmt.getCondition());
+    }
+    out += ';';
+    if (stmt.getUpdate()) {
+        out += ' ';
+        visitStatement(*stmt.getUpdate());
+        // Printed as a statement; the update has no ';' of its own
+        out.pop_back();
+    }
+    out += ") ";
+    visitStatement(*stmt.getBody());
+}
+
+void ASTPrinter::visit(const TranslationUnit& unit)
+{
+    for (const auto& inner : unit.getStatements()) {
+        visitStatement(*inner);
+        out += '\n';
+    }
+}
@@ -0,0 +1,414 @@
+#include "ArtifactCache.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "AssemblyWriter.hpp"
+#include "SourceBuffer.hpp"
+
+#ifndef TINYCPP_VERSION
+#define TINYCPP_VERSION "unknown"
+#endif
+
+namespace {
+
+const char* suffixFor(ArtifactKind kind) noexcept
+{
+    return kind == ArtifactKind::IR ? ".tir" : ".asm";
+}
+
+class StatsFile
+{
+public:
+    StatsFile(const std::string& path, int lockType)
+      : fd(::open(path.c_str(), O_RDWR | O_CREAT, 0644))
+    {
+        if (fd < 0) {
+            throw std::runtime_error("Could not open cache stats: " + path);
+        }
+        while (::flock(fd, lockType) != 0 && errno == EINTR) {
+        }
+    }
+    StatsFile(const StatsFile&) = delete;
+    StatsFile& operator=(const StatsFile&) = delete;
+    // Closing the descriptor drops the lock
+    ~StatsFile() { ::close(fd); }
+
+    CacheStats read() const
+    {
+        char text[512];
+        ssize_t count = ::pread(fd, text, sizeof(text) - 1, 0);
+        text[count > 0 ? count : 0] = '\0';
+
+        CacheStats stats;
+        struct Field
+        {
+            const char* name;
+            std::uint64_t* value;
+        } fields[] = { { "hits", &stats.hits },
+                       { "misses", &stats.misses },
+                       { "stores", &stats.stores },
+                       { "evictions", &stats.evictions },
+                       { "entries", &stats.entries },
+                       { "bytes", &stats.bytes } };
+
+        char name[32];
+        unsigned long long value;
+        int consumed;
+        const char* cursor = text;
+        while (std::sscanf(cursor, "%31s %llu%n", name, &value, &consumed) ==
+               2) {
+            for (auto& field : fields) {
+                if (std::strcmp(field.name, name) == 0) {
+                    *field.value = value;
+                }
+            }
+            cursor += consumed;
+        }
+        return stats;
+    }
+
+    void write(const CacheStats& stats) const
+    {
+        char text[512];
+        int length = std::snprintf(text,
+                                   sizeof(text),
+                                   "hits %llu\nmisses %llu\nstores %llu\n"
+                                   "evictions %llu\nentries %llu\n"
+                                   "bytes %llu\n",
+                                   static_cast<unsigned long long>(stats.hits),
+                                   static_cast<unsigned long long>(
+                                     stats.misses),
+                                   static_cast<unsigned long long>(
+                                     stats.stores),
+                                   static_cast<unsigned long long>(
+                                     stats.evictions),
+                                   static_cast<unsigned long long>(
+                                     stats.entries),
+                                   static_cast<unsigned long long>(
+                                     stats.bytes));
+        if (::ftruncate(fd, 0) == 0) {
+            ssize_t ignored = ::pwrite(fd, text, length, 0);
+            (void)ignored;
+        }
+    }
+
+private:
+    int fd;
+};
+
+struct Entry
+{
+    std::string path;
+    timespec lastUse;
+    std::uint64_t size;
+};
+
+bool olderThan(const Entry& a, const Entry& b) noexcept
+{
+    if (a.lastUse.tv_sec != b.lastUse.tv_sec) {
+        return a.lastUse.tv_sec < b.lastUse.tv_sec;
+    }
+    return a.lastUse.tv_nsec < b.lastUse.tv_nsec;
+}
+
+bool hasSuffix(const char* name, const char* suffix) noexcept
+{
+    size_t length = std::strlen(name);
+    size_t suffixLength = std::strlen(suffix);
+    return length > suffixLength &&
+           std::strcmp(name + length - suffixLength, suffix) == 0;
+}
+
+std::vector<Entry> listEntries(const std::string& directory)
+{
+    std::vector<Entry> entries;
+    DIR* top = ::opendir(directory.c_str());
+    if (!top) {
+        return entries;
+    }
+    while (dirent* bucket = ::readdir(top)) {
+        if (bucket->d_name[0] == '.' || std::strlen(bucket->d_name) != 2) {
+            continue;
+        }
+        std::string bucketPath = directory + "/" + bucket->d_name;
+        DIR* files = ::opendir(bucketPath.c_str());
+        if (!files) {
+            continue;
+        }
+        while (dirent* file = ::readdir(files)) {
+            // Skips "." and "..", and unpublished temporaries
+            if (file->d_name[0] == '.' ||
+                !(hasSuffix(file->d_name, suffixFor(ArtifactKind::Assembly)) ||
+                  hasSuffix(file->d_name, suffixFor(ArtifactKind::IR)))) {
+                continue;
+            }
+            std::string path = bucketPath + "/" + file->d_name;
+            struct stat info;
+            if (::stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode)) {
+                entries.push_back({ std::move(path),
+                                    info.st_mtim,
+                                    static_cast<std::uint64_t>(
+                                      info.st_size) });
+            }
+        }
+        ::closedir(files);
+    }
+    ::closedir(top);
+    return entries;
+}
+
+void makeDirectory(const std::string& path)
+{
+    for (size_t slash = path.find('/', 1); ;
+         slash = path.find('/', slash + 1)) {
+        std::string prefix = path.substr(0, slash);
+        if (::mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST) {
+            throw std::runtime_error("Could not create cache directory: " +
+                                     prefix);
+        }
+        if (slash == std::string::npos) {
+            break;
+        }
+    }
+}
+
+void copyFile(const std::string& from, const std::string& to)
+{
+    SourceBuffer contents = SourceBuffer::open(from);
+    FileSink sink(to);
+    sink.write(contents.view().data(), contents.view().size());
+}
+
+std::string formatBytes(std::uint64_t bytes)
+{
+    static constexpr const char* units[] = { "B", "KiB", "MiB", "GiB", "TiB" };
+    double value = static_cast<double>(bytes);
+    size_t unit = 0;
+    while (value >= 1024 && unit + 1 < std::size(units)) {
+        value /= 1024;
+        ++unit;
+    }
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.1f %s", value, units[unit]);
+    return text;
+}
+
+} // namespace
+
+ArtifactCache::ArtifactCache(std::string directory,
+                             std::uint64_t maxBytes,
+                             std::string compilerIdentity)
+  : directory(std::move(directory))
+  , maxBytes(maxBytes)
+  , identity(ContentHash::of(compilerIdentity))
+{
+    while (this->directory.size() > 1 && this->directory.back() == '/') {
+        this->directory.pop_back();
+    }
+    if (this->directory.empty()) {
+        throw std::runtime_error("Cache directory must not be empty");
+    }
+    makeDirectory(this->directory);
+}
+
+ContentHash ArtifactCache::keyFor(std::string_view source,
+                                  std::string_view configuration) const
+{
+    ContentHash setup = ContentHash::combine(identity,
+                                             ContentHash::of(configuration));
+    return ContentHash::combine(setup, ContentHash::of(source));
+}
+
+std::string ArtifactCache::entryPath(const ContentHash& key,
+                                     ArtifactKind kind) const
+{
+    std::string hex = key.toHex();
+    return directory + "/" + hex.substr(0, 2) + "/" + hex.substr(2) +
+           suffixFor(kind);
+}
+
+bool ArtifactCache::fetch(const ContentHash& key,
+                          const std::string& outputPath,
+                          ArtifactKind kind) const
+{
+    std::string path = entryPath(key, kind);
+    SourceBuffer contents;
+    bool hit = false;
+    if (::access(path.c_str(), R_OK) == 0) {
+        try {
+            contents = SourceBuffer::open(path);
+            hit = true;
+        } catch (const std::runtime_error&) {
+            // Evicted between the check and the open
+        }
+    }
+
+    if (hit) {
+        FileSink sink(outputPath);
+        sink.write(contents.view().data(), contents.view().size());
+        ::utimensat(AT_FDCWD, path.c_str(), nullptr, 0);
+    }
+
+    updateStats([hit](CacheStats& stats) {
+        ++(hit ? stats.hits : stats.misses);
+    });
+    return hit;
+}
+
+void ArtifactCache::store(const ContentHash& key,
+                          const std::string& artifactPath,
+                          ArtifactKind kind) const
+{
+    struct stat info;
+    if (::stat(artifactPath.c_str(), &info) != 0 || !S_ISREG(info.st_mode)) {
+        return;
+    }
+
+    std::string path = entryPath(key, kind);
+    if (::access(path.c_str(), F_OK) == 0) {
+        // Another compile of the same unit got there first
+        return;
+    }
+
+    static std::atomic<unsigned> sequence{ 0 };
+    std::string bucket = path.substr(0, path.find_last_of('/'));
+    std::string temporary = bucket + "/.tmp-" + std::to_string(::getpid()) +
+                            "-" + std::to_string(sequence++);
+
+    // The output is already written, so a cache that cannot take the entry
+    // (full disk, read-only directory) costs a future miss and nothing else
+    try {
+        if (::mkdir(bucket.c_str(), 0755) != 0 && errno != EEXIST) {
+            return;
+        }
+        copyFile(artifactPath, temporary);
+        if (::rename(temporary.c_str(), path.c_str()) != 0) {
+            ::unlink(temporary.c_str());
+            return;
+        }
+        auto size = static_cast<std::uint64_t>(info.st_size);
+        updateStats([this, size](CacheStats& stats) {
+            ++stats.stores;
+            ++stats.entries;
+            stats.bytes += size;
+            if (stats.bytes > maxBytes) {
+                evict(stats);
+            }
+        });
+    } catch (const std::runtime_error&) {
+        ::unlink(temporary.c_str());
+    }
+}
+
+template <typename Update>
+CacheStats ArtifactCache::updateStats(Update&& update) const
+{
+    StatsFile file(directory + "/stats", LOCK_EX);
+    CacheStats stats = file.read();
+    update(stats);
+    file.write(stats);
+    return stats;
+}
+
+void ArtifactCache::evict(CacheStats& stats) const
+{
+    std::vector<Entry> entries = listEntries(directory);
+    std::sort(entries.begin(), entries.end(), olderThan);
+
+    std::uint64_t total = 0;
+    for (const auto& entry : entries) {
+        total += entry.size;
+    }
+
+    // Trim to a low-water mark so the next few stores do not rescan
+    std::uint64_t target = maxBytes - maxBytes / 10;
+    size_t removed = 0;
+    while (removed < entries.size() && total > target) {
+        if (::unlink(entries[removed].path.c_str()) == 0) {
+            ++stats.evictions;
+        }
+        total -= entries[removed].size;
+        ++removed;
+    }
+
+    stats.entries = entries.size() - removed;
+    stats.bytes = total;
+}
+
+CacheStats ArtifactCache::getStats() const
+{
+    return StatsFile(directory + "/stats", LOCK_SH).read();
+}
+
+void ArtifactCache::writeStats(std::ostream& out) const
+{
+    CacheStats stats = getStats();
+    std::uint64_t lookups = stats.hits + stats.misses;
+    double hitRate = lookups > 0 ? stats.hits * 100.0 / lookups : 0;
+
+    char line[160];
+    out << "cache directory  " << directory << "\n";
+    std::snprintf(line,
+                  sizeof(line),
+                  "hits             %llu\nmisses           %llu\n"
+                  "hit rate         %.1f%%\nstores           %llu\n"
+                  "evictions        %llu\nentries          %llu\n",
+                  static_cast<unsigned long long>(stats.hits),
+                  static_cast<unsigned long long>(stats.misses),
+                  hitRate,
+                  static_cast<unsigned long long>(stats.stores),
+                  static_cast<unsigned long long>(stats.evictions),
+                  static_cast<unsigned long long>(stats.entries));
+    out << line << "size             " << formatBytes(stats.bytes) << " of "
+        << formatBytes(maxBytes) << "\n";
+}
+
+std::string ArtifactCache::defaultCompilerIdentity()
+{
+    std::string identity = "tinycpp " TINYCPP_VERSION;
+    struct stat info;
+    if (::stat("/proc/self/exe", &info) == 0) {
+        identity += " " + std::to_string(info.st_size) + " " +
+                    std::to_string(info.st_mtim.tv_sec) + "." +
+                    std::to_string(info.st_mtim.tv_nsec);
+    }
+    return identity;
+}
+
+std::uint64_t ArtifactCache::parseSize(const std::string& text)
+{
+    size_t digits = 0;
+    std::uint64_t value = 0;
+    while (digits < text.size() && text[digits] >= '0' &&
+           text[digits] <= '9') {
+        value = value * 10 + static_cast<std::uint64_t>(text[digits] - '0');
+        ++digits;
+    }
+
+    std::string suffix = text.substr(digits);
+    int shift = -1;
+    if (suffix.empty()) {
+        shift = 0;
+    } else if (suffix == "K" || suffix == "k") {
+        shift = 10;
+    } else if (suffix == "M" || suffix == "m") {
+        shift = 20;
+    } else if (suffix == "G" || suffix == "g") {
+        shift = 30;
+    }
+    if (digits == 0 || shift < 0 || value == 0) {
+        throw std::runtime_error("Invalid cache size: " + text);
+    }
+    return value << shift;
+}
@@ -0,0 +1,168 @@
+#include "AssemblyWriter.hpp"
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+FileSink::FileSink(const std::string& filePath)
+  : fd(::open(filePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644))
+  , filePath(filePath)
+{
+    if (fd < 0) {
+        throw std::runtime_error("Could not open output file: " + filePath);
+    }
+}
+
+FileSink::~FileSink()
+{
+    ::close(fd);
+}
+
+void FileSink::write(const char* data, size_t size)
+{
+    while (size > 0) {
+        ssize_t count = ::write(fd, data, size);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("Could not write output file: " +
+                                     filePath);
+        }
+        data += count;
+        size -= static_cast<size_t>(count);
+    }
+}
+
+AssemblyWriter::AssemblyWriter(OutputSink& sink)
+  : sink(sink)
+  , ownedBuffer(new char[BufferSize])
+  , buffer(ownedBuffer.get())
+{
+}
+
+AssemblyWriter::AssemblyWriter(OutputSink& sink, char* buffer) noexcept
+  : sink(sink)
+  , buffer(buffer)
+{
+}
+
+void AssemblyWriter::write(const TACProgram& program)
+{
+    for (const auto& instruction : program.code) {
+        std::string_view op = opcodeName(instruction.op);
+        Operand operands[] = { instruction.arg1,
+                               instruction.arg2,
+                               instruction.result };
+
+        // Bound the whole line so it is copied without further checks
+        size_t length = op.size() + 4;
+        for (Operand operand : operands) {
+            length += operandLength(program, operand);
+        }
+        if (length > BufferSize) {
+            writeLongLine(program, op, operands);
+            continue;
+        }
+
+        reserve(length);
+        char* out = buffer + used;
+        out = copy(out, op);
+        for (Operand operand : operands) {
+            *out++ = ' ';
+            out = copyOperand(out, program, operand);
+        }
+        *out++ = '\n';
+        used = static_cast<size_t>(out - buffer);
+    }
+}
+
+void AssemblyWriter::flush()
+{
+    if (used > 0) {
+        sink.write(buffer, used);
+        written += used;
+        used = 0;
+    }
+}
+
+size_t AssemblyWriter::operandLength(const TACProgram& program,
+                                     Operand operand) noexcept
+{
+    switch (operand.kind()) {
+        case Operand::Kind::None:
+            return 0;
+        case Operand::Kind::Temp:
+            // 't' plus at most ten digits
+            return 11;
+        case Operand::Kind::Slot:
+            // "[s", at most ten digits, ']'
+            return 13;
+        default:
+            return program.text(operand).size();
+    }
+}
+
+char* AssemblyWriter::copy(char* out, std::string_view text) noexcept
+{
+    std::memcpy(out, text.data(), text.size());
+    return out + text.size();
+}
+
+char* AssemblyWriter::copyOperand(char* out,
+                                  const TACProgram& program,
+                                  Operand operand) noexcept
+{
+    switch (operand.kind()) {
+        case Operand::Kind::None:
+            return out;
+        case Operand::Kind::Temp:
+            *out++ = 't';
+            return std::to_chars(out, out + 10, operand.index()).ptr;
+        case Operand::Kind::Slot:
+            *out++ = '[';
+            *out++ = 's';
+            out = std::to_chars(out, out + 10, operand.index()).ptr;
+            *out++ = ']';
+            return out;
+        default:
+            return copy(out, program.text(operand));
+    }
+}
+
+void AssemblyWriter::writeLongLine(const TACProgram& program,
+                                   std::string_view op,
+                                   const Operand (&operands)[3])
+{
+    // Only a huge string literal gets here; it goes straight to the sink
+    append(op);
+    for (Operand operand : operands) {
+        append(" ");
+        if (operand.is(Operand::Kind::Temp) ||
+            operand.is(Operand::Kind::Slot)) {
+            reserve(13);
+            used = static_cast<size_t>(
+              copyOperand(buffer + used, program, operand) -
+              buffer);
+        } else if (!operand.isNone()) {
+            append(program.text(operand));
+        }
+    }
+    append("\n");
+}
+
+void AssemblyWriter::append(std::string_view text)
+{
+    if (text.size() > BufferSize - used) {
+        flush();
+    }
+    if (text.size() > BufferSize) {
+        sink.write(text.data(), text.size());
+        written += text.size();
+        return;
+    }
+    copy(buffer + used, text);
+    used += text.size();
+}
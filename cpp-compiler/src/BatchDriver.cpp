@@ -0,0 +1,62 @@
+#include "BatchDriver.hpp"
+#include <fstream>
+#include <stdexcept>
+#include "Compiler.hpp"
+#include "ThreadPool.hpp"
+
+std::vector<BatchResult> BatchDriver::run(
+  const std::vector<BatchJob>& jobs) const
+{
+    std::vector<BatchResult> results(jobs.size());
+    ThreadPool pool(threadCount);
+
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        pool.submit([this, &jobs, &results, i] {
+            try {
+                Compiler compiler;
+                compiler.setCache(cache);
+                compiler.setOptimizationLevel(optimizationLevel);
+                compiler.setTarget(target);
+                compiler.compile(jobs[i].inputPath, jobs[i].outputPath);
+                results[i].succeeded = true;
+            } catch (const std::exception& e) {
+                results[i].error = e.what();
+            }
+        });
+    }
+
+    pool.wait();
+    return results;
+}
+
+std::vector<std::string> BatchDriver::readResponseFile(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open response file: " + path);
+    }
+
+    std::vector<std::string> inputs;
+    std::string input;
+    while (file >> input) {
+        inputs.push_back(std::move(input));
+    }
+    return inputs;
+}
+
+std::string BatchDriver::outputPathFor(const std::string& inputPath,
+                                       const std::string& outputDir)
+{
+    size_t nameStart = inputPath.find_last_of('/');
+    nameStart = nameStart == std::string::npos ? 0 : nameStart + 1;
+    size_t extension = inputPath.find_last_of('.');
+    if (extension == std::string::npos || extension < nameStart) {
+        extension = inputPath.size();
+    }
+
+    if (outputDir.empty()) {
+        return inputPath.substr(0, extension) + ".asm";
+    }
+    return outputDir + "/" +
+           inputPath.substr(nameStart, extension - nameStart) + ".asm";
+}
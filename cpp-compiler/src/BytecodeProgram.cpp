@@ -0,0 +1,991 @@
+#include "BytecodeProgram.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ControlFlowGraph.hpp"
+#include "NativeTypes.hpp"
+
+// Labels as values make the dispatch a jump through a table at the end of
+// every handler instead of one shared indirect branch. They are a GNU
+// extension, so -Wpedantic is quiet for run() only.
+#if defined(__GNUC__)
+#define BYTECODE_THREADED 1
+#else
+#define BYTECODE_THREADED 1
+#endif
+
+// Every opcode once, in the order of its number; expanded into the enum and
+// into the threaded dispatch table, which must agree
+#define BYTECODE_OPCODES(X)                                                   \
+    X(Move)                                                                   \
+    X(IntToFloat)                                                             \
+    X(FloatToInt)                                                             \
+    X(NarrowChar)                                                             \
+    X(NarrowBool)                                                             \
+    X(FloatTruth)                                                             \
+    X(AddInt)                                                                 \
+    X(SubtractInt)                                                            \
+    X(MultiplyInt)                                                            \
+    X(DivideInt)                                                              \
+    X(ModuloInt)                                                              \
+    X(AddFloat)                                                               \
+    X(SubtractFloat)                                                          \
+    X(MultiplyFloat)                                                          \
+    X(DivideFloat)                                                            \
+    X(LessInt)                                                                \
+    X(GreaterInt)                                                             \
+    X(EqualInt)                                                               \
+    X(NotEqualInt)                                                            \
+    X(LessFloat)                                                              \
+    X(GreaterFloat)                                                           \
+    X(EqualFloat)                                                             \
+    X(NotEqualFloat)                                                          \
+    X(And)                                                                    \
+    X(Or)                                                                     \
+    X(JumpUnlessLessInt)                                                      \
+    X(JumpUnlessGreaterInt)                                                   \
+    X(JumpUnlessEqualInt)                                                     \
+    X(JumpUnlessNotEqualInt)                                                  \
+    X(JumpUnlessLessFloat)                                                    \
+    X(JumpUnlessGreaterFloat)                                                 \
+    X(JumpUnlessEqualFloat)                                                   \
+    X(JumpUnlessNotEqualFloat)                                                \
+    X(JumpIfZero)                                                             \
+    X(Jump)                                                                   \
+    X(Call)                                                                   \
+    X(Return)
+
+namespace {
+
+using Instruction = BytecodeProgram::Instruction;
+using Value = BytecodeProgram::Value;
+using Function = BytecodeProgram::Function;
+
+constexpr std::uint32_t None = UINT32_MAX;
+
+enum Op : std::uint32_t
+{
+#define BYTECODE_ENUM(name) name,
+    BYTECODE_OPCODES(BYTECODE_ENUM)
+#undef BYTECODE_ENUM
+};
+
+// Scratch registers for converted operands and for results that need a
+// conversion before they reach their variable
+constexpr std::uint32_t ScratchCount = 3;
+constexpr std::uint32_t ResultScratch = 2;
+
+// Stands for the caller's frame size in the operands that name argument
+// registers, until the frame is complete
+constexpr std::uint32_t OutgoingBase = 0x80000000u;
+
+// Frames a run may stack before it fails, in place of a native stack
+// overflow
+constexpr size_t MaxCallDepth = 1 << 20;
+
+// Integer arithmetic wraps at 32 bits as it does in native code
+std::int32_t wrap(std::uint32_t value) noexcept
+{
+    return static_cast<std::int32_t>(value);
+}
+
+// cvttsd2si: NaN and values out of range give INT_MIN
+std::int32_t truncate(double value) noexcept
+{
+    if (!(value > -2147483649.0 && value < 2147483648.0)) {
+        return INT32_MIN;
+    }
+    return static_cast<std::int32_t>(value);
+}
+
+void checkDivision(std::int32_t left, std::int32_t right)
+{
+    if (right == 0) {
+        throw std::runtime_error(DivisionByZeroMessage);
+    }
+    if (left == INT32_MIN && right == -1) {
+        throw std::runtime_error(DivisionOverflowMessage);
+    }
+}
+
+struct Translation
+{
+    std::vector<Instruction> code;
+    std::vector<Function> functions;
+    std::vector<Value> initial;
+    std::vector<char> literals;
+    // (index into initial, offset into literals) for each string constant,
+    // resolved once `literals` stops growing
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> strings;
+    std::uint32_t entry = 0;
+};
+
+// Translates every function of one program. A frame holds the function's
+// parameters, then the scratch and zero registers, then each temp,
+// variable, spill slot, register and constant in order of appearance; the
+// arguments of its calls go just past its end, where the callee's frame
+// starts.
+class Translator
+{
+public:
+    explicit Translator(const TACProgram& program);
+
+    Translation run();
+
+private:
+    const TACProgram& program;
+    std::uint32_t tempCount;
+    std::uint32_t stringCount;
+    std::uint32_t valueCount;
+    Translation out;
+
+    // Types and reads of each temp, variable, spill slot and register, by
+    // indexOf
+    std::vector<TypeId> types;
+    std::vector<std::uint32_t> uses;
+    // Frame register of each value, valid while its stamp is `function`
+    std::vector<std::uint32_t> frameRegisters;
+    std::vector<std::uint32_t> frameStamps;
+    std::uint32_t function = 0;
+    // The frame being laid out: its start in out.initial, its size so far,
+    // and the most arguments any of its calls passes
+    std::uint32_t templateStart = 0;
+    std::uint32_t frameSize = 0;
+    std::uint32_t parameters = 0;
+    std::uint32_t outgoing = 0;
+    std::uint32_t argumentCount = 0;
+    // main returns the process exit status whatever its return type
+    bool returnsInt = false;
+    // Registers of converted constants in the current frame, keyed by
+    // string index and type
+    std::unordered_map<std::uint64_t, std::uint32_t> constants;
+    // Offset into literals of each string constant placed there
+    std::vector<std::uint32_t> literalOffsets;
+    // Index in out.functions of each function by the string index of its
+    // name
+    std::vector<std::uint32_t> functionIndex;
+    // Label positions by string index, and the instructions jumping there
+    std::vector<std::uint32_t> labels;
+    std::vector<std::uint32_t> jumps;
+
+    std::uint32_t indexOf(Operand operand) const noexcept;
+    std::uint32_t registerOf(Operand operand);
+    std::uint32_t allocate(Value value);
+    TypeId typeOf(Operand operand) const;
+    std::uint32_t scratch(std::uint32_t which) const noexcept;
+    std::uint32_t zero() const noexcept;
+
+    void translate(const std::vector<TACInstruction>& instructions,
+                   std::uint32_t begin,
+                   std::uint32_t end,
+                   std::string_view name);
+    void translateArgument(const TACInstruction& instruction);
+    void translateCall(const TACInstruction& instruction, TypeId produced);
+    bool translateComparison(const TACInstruction& instruction,
+                             const TACInstruction* next);
+    void translateBranch(const TACInstruction& instruction);
+    void translateReturn(const TACInstruction& instruction);
+
+    void emit(Op op, std::uint32_t a, std::uint32_t b, std::uint32_t c);
+    void emitJump(Op op, std::uint32_t a, std::uint32_t b, Operand target);
+    void convert(std::uint32_t destination,
+                 TypeId to,
+                 std::uint32_t source,
+                 TypeId from);
+
+    std::uint32_t constant(Operand operand, TypeId as);
+    std::uint32_t asInt(Operand operand, std::uint32_t which);
+    std::uint32_t asFloat(Operand operand, std::uint32_t which);
+    std::uint32_t asTruth(Operand operand, std::uint32_t which);
+    std::uint32_t asIs(Operand operand);
+
+    // Where an instruction producing `produced` writes, and the copy into
+    // its variable when that one is declared with a different type
+    std::uint32_t destination(Operand result, TypeId produced);
+    void finish(Operand result, std::uint32_t written, TypeId produced);
+};
+
+Translator::Translator(const TACProgram& program)
+  : program(program)
+  , tempCount(program.getTempCount())
+  , stringCount(static_cast<std::uint32_t>(program.getStrings().size()))
+{
+    // Temps, variables, spill slots and registers by string index
+    valueCount = tempCount + 2 * stringCount +
+                 static_cast<std::uint32_t>(program.getSlotCount());
+    types.assign(valueCount, TypeId::Unknown);
+    uses.assign(valueCount, 0);
+    frameRegisters.assign(valueCount, 0);
+    frameStamps.assign(valueCount, 0);
+    literalOffsets.assign(stringCount, None);
+    functionIndex.assign(stringCount, None);
+    labels.assign(stringCount, None);
+}
+
+Translation Translator::run()
+{
+    const auto& instructions = program.code;
+    if (!instructions.empty()) {
+        ControlFlowGraph graph(program);
+        std::vector<std::uint32_t> starts;
+        for (BlockId id : graph.getEntries()) {
+            starts.push_back(graph.block(id).begin);
+        }
+        std::sort(starts.begin(), starts.end());
+        starts.push_back(static_cast<std::uint32_t>(instructions.size()));
+
+        // Only a program without functions starts unlabeled
+        std::vector<std::string_view> names;
+        for (size_t i = 0; i + 1 < starts.size(); ++i) {
+            const TACInstruction& first = instructions[starts[i]];
+            names.push_back(first.op == Opcode::Function
+                              ? program.text(first.result)
+                              : std::string_view("main"));
+            if (first.op == Opcode::Function) {
+                functionIndex[first.result.index()] =
+                  static_cast<std::uint32_t>(i);
+            }
+        }
+        auto main = std::find(names.begin(), names.end(), "main");
+        if (main != names.end()) {
+            out.entry = static_cast<std::uint32_t>(main - names.begin());
+        }
+        for (size_t i = 0; i + 1 < starts.size(); ++i) {
+            translate(instructions, starts[i], starts[i + 1], names[i]);
+        }
+    } else {
+        translate(instructions, 0, 0, "main");
+    }
+
+    for (std::uint32_t at : jumps) {
+        std::uint32_t label = out.code[at].c;
+        if (labels[label] == None) {
+            throw std::runtime_error("Jump to undefined label: " +
+                                     std::string(program.text(Operand::make(
+                                       Operand::Kind::Label, label))));
+        }
+        out.code[at].c = labels[label];
+    }
+    return std::move(out);
+}
+
+std::uint32_t Translator::indexOf(Operand operand) const noexcept
+{
+    std::uint32_t slots = program.getSlotCount();
+    switch (operand.kind()) {
+        case Operand::Kind::Temp:
+            return operand.index() < tempCount ? operand.index() : None;
+        case Operand::Kind::Variable:
+            return tempCount + operand.index();
+        case Operand::Kind::Slot:
+            return operand.index() < slots
+                     ? tempCount + stringCount + operand.index()
+                     : None;
+        case Operand::Kind::Register:
+            return tempCount + stringCount + slots + operand.index();
+        default:
+            return None;
+    }
+}
+
+std::uint32_t Translator::registerOf(Operand operand)
+{
+    std::uint32_t index = indexOf(operand);
+    if (index == None) {
+        return None;
+    }
+    if (frameStamps[index] != function) {
+        frameStamps[index] = function;
+        frameRegisters[index] = allocate(Value{});
+    }
+    return frameRegisters[index];
+}
+
+std::uint32_t Translator::allocate(Value value)
+{
+    out.initial.push_back(value);
+    return frameSize++;
+}
+
+TypeId Translator::typeOf(Operand operand) const
+{
+    TypeId type = TypeId::Unknown;
+    if (operand.is(Operand::Kind::Constant)) {
+        type = literalType(program.text(operand));
+    } else if (std::uint32_t index = indexOf(operand); index != None) {
+        type = types[index];
+    }
+    return type == TypeId::Unknown ? TypeId::Int : type;
+}
+
+std::uint32_t Translator::scratch(std::uint32_t which) const noexcept
+{
+    return parameters + which;
+}
+
+std::uint32_t Translator::zero() const noexcept
+{
+    return parameters + ScratchCount;
+}
+
+void Translator::translate(const std::vector<TACInstruction>& instructions,
+                           std::uint32_t begin,
+                           std::uint32_t end,
+                           std::string_view name)
+{
+    ++function;
+    returnsInt = name == "main";
+    // Reads that come before the declaration in the code still see it
+    declareVariables(program, begin, end, types, tempCount);
+    constants.clear();
+    templateStart = static_cast<std::uint32_t>(out.initial.size());
+    frameSize = 0;
+    parameters = 0;
+    outgoing = 0;
+    argumentCount = 0;
+    for (std::uint32_t i = begin; i < end; ++i) {
+        const TACInstruction& instruction = instructions[i];
+        for (Operand operand : { instruction.arg1, instruction.arg2 }) {
+            if (std::uint32_t index = indexOf(operand); index != None) {
+                ++uses[index];
+            }
+        }
+        if (instruction.op == Opcode::Param) {
+            ++parameters;
+        }
+    }
+    for (std::uint32_t i = 0; i < parameters + ScratchCount + 1; ++i) {
+        allocate(Value{});
+    }
+    auto first = static_cast<std::uint32_t>(out.code.size());
+
+    for (std::uint32_t i = begin; i < end; ++i) {
+        const TACInstruction& instruction = instructions[i];
+        Operand left = instruction.arg1;
+        Operand right = instruction.arg2;
+        Operand result = instruction.result;
+        TypeId produced =
+          producedType(instruction, typeOf(left), typeOf(right));
+
+        switch (instruction.op) {
+            case Opcode::Mov: {
+                TypeId from = typeOf(left);
+                TypeId to = result.is(Operand::Kind::Variable)
+                              ? typeOf(result)
+                              : producedType(
+                                  instruction, from, TypeId::Unknown);
+                std::uint32_t source = left.is(Operand::Kind::Constant)
+                                         ? constant(left, from = to)
+                                         : asIs(left);
+                convert(asIs(result), to, source, from);
+                produced = to;
+                break;
+            }
+            case Opcode::Add:
+            case Opcode::Subtract:
+            case Opcode::Multiply:
+            case Opcode::Divide:
+            case Opcode::Modulo: {
+                if (produced == TypeId::String) {
+                    throw std::runtime_error(
+                      "The interpreter has no lowering for string "
+                      "arithmetic");
+                }
+                auto offset = static_cast<std::uint32_t>(instruction.op) -
+                              static_cast<std::uint32_t>(Opcode::Add);
+                std::uint32_t written = destination(result, produced);
+                if (produced == TypeId::Float) {
+                    if (instruction.op == Opcode::Modulo) {
+                        throw std::runtime_error(
+                          "The interpreter has no lowering for float %");
+                    }
+                    emit(static_cast<Op>(AddFloat + offset),
+                         asFloat(left, 0),
+                         asFloat(right, 1),
+                         written);
+                } else {
+                    emit(static_cast<Op>(AddInt + offset),
+                         asInt(left, 0),
+                         asInt(right, 1),
+                         written);
+                }
+                finish(result, written, produced);
+                break;
+            }
+            case Opcode::LessThan:
+            case Opcode::GreaterThan:
+            case Opcode::Equal:
+            case Opcode::NotEqual:
+                if (translateComparison(instruction,
+                                        i + 1 < end ? &instructions[i + 1]
+                                                    : nullptr)) {
+                    ++i;
+                }
+                break;
+            case Opcode::And:
+            case Opcode::Or: {
+                if (typeOf(left) == TypeId::String ||
+                    typeOf(right) == TypeId::String) {
+                    throw std::runtime_error(
+                      "The interpreter has no lowering for strings in && "
+                      "or ||");
+                }
+                std::uint32_t written = destination(result, produced);
+                emit(instruction.op == Opcode::And ? And : Or,
+                     asTruth(left, 0),
+                     asTruth(right, 1),
+                     written);
+                finish(result, written, produced);
+                break;
+            }
+            case Opcode::IfFalse:
+                translateBranch(instruction);
+                break;
+            case Opcode::Goto:
+                emitJump(Jump, 0, 0, result);
+                break;
+            case Opcode::Label:
+                labels[result.index()] =
+                  static_cast<std::uint32_t>(out.code.size());
+                break;
+            case Opcode::Function:
+                // Calls find the function through functionIndex
+                break;
+            case Opcode::Ret:
+                translateReturn(instruction);
+                break;
+            case Opcode::Param: {
+                // Argument k arrives in register k of the frame
+                std::uint32_t index = indexOf(result);
+                frameStamps[index] = function;
+                frameRegisters[index] = static_cast<std::uint32_t>(
+                  literalInteger(program.text(left)));
+                break;
+            }
+            case Opcode::Arg:
+                translateArgument(instruction);
+                break;
+            case Opcode::Call:
+                translateCall(instruction, produced);
+                break;
+        }
+
+        if (instruction.op != Opcode::IfFalse &&
+            instruction.op != Opcode::Goto &&
+            instruction.op != Opcode::Label && instruction.op != Opcode::Ret &&
+            !result.is(Operand::Kind::Variable)) {
+            if (std::uint32_t index = indexOf(result); index != None) {
+                types[index] = produced;
+            }
+        }
+    }
+    if (out.code.size() == first || out.code.back().op != Return) {
+        emit(Return, zero(), 0, 0);
+    }
+
+    // The argument registers start where the frame ends
+    for (size_t i = first; i < out.code.size(); ++i) {
+        for (std::uint32_t* operand :
+             { &out.code[i].a, &out.code[i].b, &out.code[i].c }) {
+            if (*operand >= OutgoingBase) {
+                *operand = frameSize + (*operand - OutgoingBase);
+            }
+        }
+    }
+    out.functions.push_back(
+      { first, parameters, frameSize, frameSize + outgoing, templateStart });
+}
+
+void Translator::translateArgument(const TACInstruction& instruction)
+{
+    Operand value = instruction.arg1;
+    TypeId from = typeOf(value);
+    TypeId to = instruction.type != TypeId::Unknown ? instruction.type : from;
+    std::uint32_t source = value.is(Operand::Kind::Constant)
+                             ? constant(value, from = to)
+                             : asIs(value);
+    convert(OutgoingBase + argumentCount++, to, source, from);
+    outgoing = std::max(outgoing, argumentCount);
+}
+
+void Translator::translateCall(const TACInstruction& instruction,
+                               TypeId produced)
+{
+    std::uint32_t callee = functionIndex[instruction.arg1.index()];
+    if (callee == None) {
+        throw std::runtime_error("Call to undefined function: " +
+                                 std::string(program.text(instruction.arg1)));
+    }
+    argumentCount = 0;
+    Operand result = instruction.result;
+    if (result.isNone()) {
+        emit(Call, callee, OutgoingBase, scratch(ResultScratch));
+        return;
+    }
+    std::uint32_t written = destination(result, produced);
+    emit(Call, callee, OutgoingBase, written);
+    finish(result, written, produced);
+}
+
+bool Translator::translateComparison(const TACInstruction& instruction,
+                                     const TACInstruction* next)
+{
+    Operand left = instruction.arg1;
+    Operand right = instruction.arg2;
+    Operand result = instruction.result;
+    if (typeOf(left) == TypeId::String || typeOf(right) == TypeId::String) {
+        throw std::runtime_error(
+          "The interpreter has no lowering for string comparison");
+    }
+    auto offset = static_cast<std::uint32_t>(instruction.op) -
+                  static_cast<std::uint32_t>(Opcode::LessThan);
+    bool isFloat = instruction.type == TypeId::Float ||
+                   typeOf(left) == TypeId::Float ||
+                   typeOf(right) == TypeId::Float;
+    std::uint32_t a = isFloat ? asFloat(left, 0) : asInt(left, 0);
+    std::uint32_t b = isFloat ? asFloat(right, 1) : asInt(right, 1);
+
+    std::uint32_t index = indexOf(result);
+    if (next && next->op == Opcode::IfFalse && next->arg1 == result &&
+        result.is(Operand::Kind::Temp) && index != None && uses[index] == 1) {
+        Op fused = isFloat ? JumpUnlessLessFloat : JumpUnlessLessInt;
+        emitJump(static_cast<Op>(fused + offset), a, b, next->result);
+        return true;
+    }
+
+    std::uint32_t written = destination(result, TypeId::Bool);
+    emit(static_cast<Op>((isFloat ? LessFloat : LessInt) + offset),
+         a,
+         b,
+         written);
+    finish(result, written, TypeId::Bool);
+    return false;
+}
+
+void Translator::translateBranch(const TACInstruction& instruction)
+{
+    Operand condition = instruction.arg1;
+    if (condition.is(Operand::Kind::Constant)) {
+        std::string_view text = program.text(condition);
+        if (literalType(text) != TypeId::String && literalFloat(text) == 0.0) {
+            emitJump(Jump, 0, 0, instruction.result);
+        }
+        return;
+    }
+    emitJump(JumpIfZero, asTruth(condition, 0), 0, instruction.result);
+}
+
+void Translator::translateReturn(const TACInstruction& instruction)
+{
+    Operand value = instruction.arg1;
+    std::uint32_t source = zero();
+    if (!value.isNone()) {
+        TypeId type = instruction.type != TypeId::Unknown ? instruction.type
+                                                          : typeOf(value);
+        if (type == TypeId::String || typeOf(value) == TypeId::String) {
+            source = asIs(value);
+        } else if (type == TypeId::Float && !returnsInt) {
+            source = asFloat(value, 0);
+        } else {
+            source = asInt(value, 0);
+        }
+    }
+    emit(Return, source, 0, 0);
+}
+
+void Translator::emit(Op op, std::uint32_t a, std::uint32_t b, std::uint32_t c)
+{
+    out.code.push_back({ op, a, b, c });
+}
+
+void Translator::emitJump(Op op,
+                          std::uint32_t a,
+                          std::uint32_t b,
+                          Operand target)
+{
+    jumps.push_back(static_cast<std::uint32_t>(out.code.size()));
+    emit(op, a, b, target.index());
+}
+
+void Translator::convert(std::uint32_t destination,
+                         TypeId to,
+                         std::uint32_t source,
+                         TypeId from)
+{
+    if (to == TypeId::String || from == TypeId::String) {
+        if (destination != source) {
+            emit(Move, source, 0, destination);
+        }
+    } else if (to == TypeId::Float) {
+        if (from != TypeId::Float) {
+            emit(IntToFloat, source, 0, destination);
+        } else if (destination != source) {
+            emit(Move, source, 0, destination);
+        }
+    } else if (from == TypeId::Float) {
+        if (to == TypeId::Bool) {
+            emit(FloatTruth, source, 0, destination);
+        } else {
+            emit(FloatToInt, source, 0, destination);
+            if (to == TypeId::Char) {
+                emit(NarrowChar, destination, 0, destination);
+            }
+        }
+    } else if (to == TypeId::Char && from != TypeId::Char) {
+        emit(NarrowChar, source, 0, destination);
+    } else if (to == TypeId::Bool && from != TypeId::Bool) {
+        emit(NarrowBool, source, 0, destination);
+    } else if (destination != source) {
+        emit(Move, source, 0, destination);
+    }
+}
+
+std::uint32_t Translator::constant(Operand operand, TypeId as)
+{
+    std::uint64_t key =
+      std::uint64_t(operand.index()) << 8 | static_cast<std::uint8_t>(as);
+    auto [it, inserted] = constants.try_emplace(key, frameSize);
+    if (!inserted) {
+        return it->second;
+    }
+
+    std::string_view text = program.text(operand);
+    TypeId type = literalType(text);
+    Value value{};
+    if (as == TypeId::String || type == TypeId::String) {
+        // Registers hold the text without its quotes
+        std::uint32_t& offset = literalOffsets[operand.index()];
+        if (offset == None) {
+            offset = static_cast<std::uint32_t>(out.literals.size());
+            std::string_view body =
+              type == TypeId::String ? text.substr(1, text.size() - 2) : text;
+            out.literals.insert(out.literals.end(), body.begin(), body.end());
+            out.literals.push_back('\0');
+        }
+        out.strings.push_back({ templateStart + it->second, offset });
+    } else if (as == TypeId::Float) {
+        value.f = literalFloat(text);
+    } else if (as == TypeId::Bool) {
+        value.i = literalFloat(text) != 0.0;
+    } else if (type == TypeId::Float) {
+        value.i = truncate(literalFloat(text));
+    } else {
+        value.i = wrap(static_cast<std::uint32_t>(literalInteger(text)));
+    }
+    if (as == TypeId::Char) {
+        value.i = static_cast<signed char>(value.i);
+    }
+    allocate(value);
+    return it->second;
+}
+
+std::uint32_t Translator::asInt(Operand operand, std::uint32_t which)
+{
+    if (operand.is(Operand::Kind::Constant)) {
+        return constant(operand, TypeId::Int);
+    }
+    if (typeOf(operand) == TypeId::Float) {
+        emit(FloatToInt, asIs(operand), 0, scratch(which));
+        return scratch(which);
+    }
+    return asIs(operand);
+}
+
+std::uint32_t Translator::asFloat(Operand operand, std::uint32_t which)
+{
+    if (operand.is(Operand::Kind::Constant)) {
+        return constant(operand, TypeId::Float);
+    }
+    if (typeOf(operand) != TypeId::Float) {
+        emit(IntToFloat, asIs(operand), 0, scratch(which));
+        return scratch(which);
+    }
+    return asIs(operand);
+}
+
+std::uint32_t Translator::asTruth(Operand operand, std::uint32_t which)
+{
+    if (operand.is(Operand::Kind::Constant)) {
+        return constant(operand, TypeId::Bool);
+    }
+    if (typeOf(operand) == TypeId::Float) {
+        emit(FloatTruth, asIs(operand), 0, scratch(which));
+        return scratch(which);
+    }
+    return asIs(operand);
+}
+
+std::uint32_t Translator::asIs(Operand operand)
+{
+    if (operand.is(Operand::Kind::Constant)) {
+        return constant(operand, typeOf(operand));
+    }
+    std::uint32_t index = registerOf(operand);
+    if (index == None) {
+        throw std::runtime_error("The interpreter cannot place operand");
+    }
+    return index;
+}
+
+std::uint32_t Translator::destination(Operand result, TypeId produced)
+{
+    if (!result.is(Operand::Kind::Variable)) {
+        return asIs(result);
+    }
+    TypeId declared = typeOf(result);
+    bool fits = declared == produced ||
+                (declared == TypeId::Int && produced == TypeId::Bool);
+    return fits ? registerOf(result) : scratch(ResultScratch);
+}
+
+void Translator::finish(Operand result, std::uint32_t written, TypeId produced)
+{
+    if (written == scratch(ResultScratch)) {
+        convert(registerOf(result), typeOf(result), written, produced);
+    }
+}
+
+} // namespace
+
+BytecodeProgram BytecodeProgram::compile(const TACProgram& program)
+{
+    Translation translation = Translator(program).run();
+
+    BytecodeProgram bytecode;
+    bytecode.code = std::move(translation.code);
+    bytecode.initial = std::move(translation.initial);
+    bytecode.literals = std::move(translation.literals);
+    bytecode.functions = std::move(translation.functions);
+    bytecode.entry = translation.entry;
+    for (const auto& [index, offset] : translation.strings) {
+        bytecode.initial[index].s = bytecode.literals.data() + offset;
+    }
+    return bytecode;
+}
+
+#if BYTECODE_THREADED
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+
+int BytecodeProgram::run() const
+{
+    // The caller's Call instruction and frame for every call in progress
+    struct Frame
+    {
+        const Instruction* ip;
+        size_t base;
+    };
+    std::vector<Frame> frames;
+    const Function& main = functions[entry];
+    std::vector<Value> registers(std::max<size_t>(main.extent, 256));
+    std::copy(initial.begin() + main.initial,
+              initial.begin() + main.initial + main.frameSize,
+              registers.begin());
+    size_t base = 0;
+    Value* r = registers.data();
+    const Instruction* ip = code.data() + main.entry;
+
+#if BYTECODE_THREADED
+#define BYTECODE_LABEL(name) &&Op##name,
+    static void* const Handlers[] = { BYTECODE_OPCODES(BYTECODE_LABEL) };
+#undef BYTECODE_LABEL
+#define CASE(name) Op##name:
+#define NEXT() goto* Handlers[(++ip)->op]
+#define JUMP() goto* Handlers[(ip = code.data() + ip->c)->op]
+#define DISPATCH() goto* Handlers[ip->op]
+    goto* Handlers[ip->op];
+#else
+#define CASE(name) case name:
+#define NEXT() \
+    ++ip;      \
+    continue
+#define JUMP()                  \
+    ip = code.data() + ip->c; \
+    continue
+#define DISPATCH() continue
+    for (;;) {
+        switch (ip->op) {
+#endif
+
+    CASE(Move)
+    r[ip->c] = r[ip->a];
+    NEXT();
+    CASE(IntToFloat)
+    r[ip->c].f = r[ip->a].i;
+    NEXT();
+    CASE(FloatToInt)
+    r[ip->c].i = truncate(r[ip->a].f);
+    NEXT();
+    CASE(NarrowChar)
+    r[ip->c].i = static_cast<signed char>(r[ip->a].i);
+    NEXT();
+    CASE(NarrowBool)
+    r[ip->c].i = r[ip->a].i != 0;
+    NEXT();
+    CASE(FloatTruth)
+    r[ip->c].i = r[ip->a].f != 0.0;
+    NEXT();
+
+    CASE(AddInt)
+    r[ip->c].i = wrap(static_cast<std::uint32_t>(r[ip->a].i) +
+                      static_cast<std::uint32_t>(r[ip->b].i));
+    NEXT();
+    CASE(SubtractInt)
+    r[ip->c].i = wrap(static_cast<std::uint32_t>(r[ip->a].i) -
+                      static_cast<std::uint32_t>(r[ip->b].i));
+    NEXT();
+    CASE(MultiplyInt)
+    r[ip->c].i = wrap(static_cast<std::uint32_t>(r[ip->a].i) *
+                      static_cast<std::uint32_t>(r[ip->b].i));
+    NEXT();
+    CASE(DivideInt)
+    checkDivision(r[ip->a].i, r[ip->b].i);
+    r[ip->c].i = r[ip->a].i / r[ip->b].i;
+    NEXT();
+    CASE(ModuloInt)
+    checkDivision(r[ip->a].i, r[ip->b].i);
+    r[ip->c].i = r[ip->a].i % r[ip->b].i;
+    NEXT();
+    CASE(AddFloat)
+    r[ip->c].f = r[ip->a].f + r[ip->b].f;
+    NEXT();
+    CASE(SubtractFloat)
+    r[ip->c].f = r[ip->a].f - r[ip->b].f;
+    NEXT();
+    CASE(MultiplyFloat)
+    r[ip->c].f = r[ip->a].f * r[ip->b].f;
+    NEXT();
+    CASE(DivideFloat)
+    r[ip->c].f = r[ip->a].f / r[ip->b].f;
+    NEXT();
+
+    CASE(LessInt)
+    r[ip->c].i = r[ip->a].i < r[ip->b].i;
+    NEXT();
+    CASE(GreaterInt)
+    r[ip->c].i = r[ip->a].i > r[ip->b].i;
+    NEXT();
+    CASE(EqualInt)
+    r[ip->c].i = r[ip->a].i == r[ip->b].i;
+    NEXT();
+    CASE(NotEqualInt)
+    r[ip->c].i = r[ip->a].i != r[ip->b].i;
+    NEXT();
+    CASE(LessFloat)
+    r[ip->c].i = r[ip->a].f < r[ip->b].f;
+    NEXT();
+    CASE(GreaterFloat)
+    r[ip->c].i = r[ip->a].f > r[ip->b].f;
+    NEXT();
+    CASE(EqualFloat)
+    r[ip->c].i = r[ip->a].f == r[ip->b].f;
+    NEXT();
+    CASE(NotEqualFloat)
+    r[ip->c].i = r[ip->a].f != r[ip->b].f;
+    NEXT();
+    CASE(And)
+    r[ip->c].i = (r[ip->a].i != 0) & (r[ip->b].i != 0);
+    NEXT();
+    CASE(Or)
+    r[ip->c].i = (r[ip->a].i != 0) | (r[ip->b].i != 0);
+    NEXT();
+
+    CASE(JumpUnlessLessInt)
+    if (r[ip->a].i < r[ip->b].i) {
+        NEXT();
+    }
+    JUMP();
+    CASE(JumpUnlessGreaterInt)
+    if (r[ip->a].i > r[ip->b].i) {
+        NEXT();
+    }
+    JUMP();
+    CASE(JumpUnlessEqualInt)
+    if (r[ip->a].i == r[ip->b].i) {
+        NEXT();
+    }
+    JUMP();
+    CASE(JumpUnlessNotEqualInt)
+    if (r[ip->a].i != r[ip->b].i) {
+        NEXT();
+    }
+    JUMP();
+    CASE(JumpUnlessLessFloat)
+    if (r[ip->a].f < r[ip->b].f) {
+        NEXT();
+    }
+    JUMP();
+    CASE(JumpUnlessGreaterFloat)
+    if (r[ip->a].f > r[ip->b].f) {
+        NEXT();
+    }
+    JUMP();
+    CASE(JumpUnlessEqualFloat)
+    if (r[ip->a].f == r[ip->b].f) {
+        NEXT();
+    }
+    JUMP();
+    CASE(JumpUnlessNotEqualFloat)
+    if (r[ip->a].f != r[ip->b].f) {
+        NEXT();
+    }
+    JUMP();
+    CASE(JumpIfZero)
+    if (r[ip->a].i != 0) {
+        NEXT();
+    }
+    JUMP();
+    CASE(Jump)
+    JUMP();
+    CASE(Call)
+    {
+        // The callee's frame starts at the caller's argument registers and
+        // takes the rest of its registers from its template
+        const Function& callee = functions[ip->a];
+        if (frames.size() == MaxCallDepth) {
+            throw std::runtime_error("Call stack overflow");
+        }
+        frames.push_back({ ip, base });
+        base += ip->b;
+        if (base + callee.extent > registers.size()) {
+            registers.resize(
+              std::max(2 * registers.size(), base + callee.extent));
+        }
+        r = registers.data() + base;
+        std::copy(initial.begin() + callee.initial + callee.parameters,
+                  initial.begin() + callee.initial + callee.frameSize,
+                  r + callee.parameters);
+        ip = code.data() + callee.entry;
+        DISPATCH();
+    }
+    CASE(Return)
+    {
+        Value value = r[ip->a];
+        if (frames.empty()) {
+            return value.i;
+        }
+        ip = frames.back().ip;
+        base = frames.back().base;
+        frames.pop_back();
+        r = registers.data() + base;
+        r[ip->c] = value;
+        NEXT();
+    }
+
+#if !BYTECODE_THREADED
+        }
+    }
+#endif
+#undef CASE
+#undef NEXT
+#undef JUMP
+#undef DISPATCH
+}
+
+#if BYTECODE_THREADED
+#pragma GCC diagnostic pop
+#endif
@@ -0,0 +1,172 @@
+#include "CompileReport.hpp"
+#include <cstdio>
+#include <sys/resource.h>
+#include "HeapStats.hpp"
+
+namespace {
+
+void appendJsonString(std::string& out, const std::string& text)
+{
+    out += '"';
+    for (char c : text) {
+        switch (c) {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    out += escaped;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+}
+
+} // namespace
+
+void CompileReport::start(const std::string& path)
+{
+    inputPath = path;
+    phases.clear();
+    heapTracking = HeapStats::available() && HeapStats::enabled();
+}
+
+void CompileReport::begin(const char* name)
+{
+    currentName = name;
+    if (heapTracking) {
+        heapBaseline = HeapStats::current();
+        allocationBaseline = HeapStats::allocations();
+        HeapStats::resetPeak();
+    }
+    started = Clock::now();
+}
+
+void CompileReport::end(std::size_t items, const char* unit)
+{
+    auto elapsed = Clock::now() - started;
+
+    Phase phase{ currentName,
+                 std::chrono::duration<double, std::milli>(elapsed).count(),
+                 items,
+                 unit,
+                 0,
+                 0 };
+    if (heapTracking) {
+        std::ptrdiff_t growth = HeapStats::peak() - heapBaseline;
+        phase.peakHeapBytes = growth > 0 ? static_cast<std::size_t>(growth) : 0;
+        phase.allocations = HeapStats::allocations() - allocationBaseline;
+    }
+    phases.push_back(phase);
+
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        maxResident = usage.ru_maxrss;
+    }
+}
+
+double CompileReport::totalMilliseconds() const noexcept
+{
+    double total = 0;
+    for (const auto& phase : phases) {
+        total += phase.milliseconds;
+    }
+    return total;
+}
+
+void CompileReport::writeText(std::ostream& out) const
+{
+    char line[160];
+    std::snprintf(line,
+                  sizeof(line),
+                  "%-10s %12s %8s %14s %-12s %14s %10s\n",
+                  "phase",
+                  "time (ms)",
+                  "%",
+                  "items",
+                  "",
+                  "peak heap",
+                  "allocs");
+    out << "Compile report for " << inputPath << "\n" << line;
+
+    double total = totalMilliseconds();
+    for (const auto& phase : phases) {
+        double share = total > 0 ? phase.milliseconds * 100 / total : 0;
+        if (heapTracking) {
+            std::snprintf(line,
+                          sizeof(line),
+                          "%-10s %12.3f %7.1f%% %14zu %-12s %14zu %10zu\n",
+                          phase.name,
+                          phase.milliseconds,
+                          share,
+                          phase.items,
+                          phase.unit,
+                          phase.peakHeapBytes,
+                          phase.allocations);
+        } else {
+            std::snprintf(line,
+                          sizeof(line),
+                          "%-10s %12.3f %7.1f%% %14zu %-12s %14s %10s\n",
+                          phase.name,
+                          phase.milliseconds,
+                          share,
+                          phase.items,
+                          phase.unit,
+                          "-",
+                          "-");
+        }
+        out << line;
+    }
+
+    std::snprintf(line, sizeof(line), "%-10s %12.3f\n", "total", total);
+    out << line << "max resident set: " << maxResident << " KiB\n";
+}
+
+void CompileReport::writeJson(std::ostream& out) const
+{
+    std::string json = "{\n  \"input\": ";
+    appendJsonString(json, inputPath);
+
+    char number[64];
+    std::snprintf(number, sizeof(number), "%.6f", totalMilliseconds());
+    json += ",\n  \"total_ms\": ";
+    json += number;
+    json += ",\n  \"max_rss_kb\": " + std::to_string(maxResident);
+    json += ",\n  \"heap_tracked\": ";
+    json += heapTracking ? "true" : "false";
+    json += ",\n  \"phases\": [";
+
+    for (size_t i = 0; i < phases.size(); ++i) {
+        const auto& phase = phases[i];
+        std::snprintf(number, sizeof(number), "%.6f", phase.milliseconds);
+        json += i == 0 ? "\n" : ",\n";
+        json += "    { \"name\": \"";
+        json += phase.name;
+        json += "\", \"ms\": ";
+        json += number;
+        json += ", \"items\": " + std::to_string(phase.items);
+        json += ", \"unit\": \"";
+        json += phase.unit;
+        json += "\"";
+        if (heapTracking) {
+            json += ", \"peak_heap_bytes\": " +
+                    std::to_string(phase.peakHeapBytes);
+            json += ", \"allocations\": " + std::to_string(phase.allocations);
+        } else {
+            json += ", \"peak_heap_bytes\": null, \"allocations\": null";
+        }
+        json += " }";
+    }
+    json += "\n  ]\n}\n";
+    out << json;
+}
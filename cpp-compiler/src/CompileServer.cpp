@@ -0,0 +1,300 @@
+#include "CompileServer.hpp"
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "ThreadPool.hpp"
+
+namespace {
+
+constexpr char Magic[4] = { 'T', 'C', 'P', 'D' };
+
+// Caps every length and count, so a corrupt frame cannot make the other
+// end allocate without bound
+constexpr std::uint32_t MaxField = 1u << 30;
+constexpr std::uint32_t MaxArguments = 1u << 16;
+
+// A client that stops sending mid-request gives its worker back after this
+constexpr int ReceiveTimeoutSeconds = 30;
+
+std::string errorText(const std::string& what)
+{
+    return what + ": " + std::strerror(errno);
+}
+
+// Closes the descriptor when it goes out of scope
+class Socket
+{
+public:
+    explicit Socket(int fd) noexcept
+      : fd(fd)
+    {
+    }
+    Socket(const Socket&) = delete;
+    Socket& operator=(const Socket&) = delete;
+    ~Socket()
+    {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    int get() const noexcept { return fd; }
+
+private:
+    int fd;
+};
+
+sockaddr_un addressOf(const std::string& socketPath)
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Unusable socket path: '" + socketPath + "'");
+    }
+    std::memcpy(address.sun_path, socketPath.data(), socketPath.size());
+    return address;
+}
+
+bool connectTo(int fd, const sockaddr_un& address) noexcept
+{
+    int result;
+    do {
+        result = ::connect(fd,
+                           reinterpret_cast<const sockaddr*>(&address),
+                           sizeof(address));
+    } while (result != 0 && errno == EINTR);
+    return result == 0;
+}
+
+void appendNumber(std::string& frame, std::uint32_t value)
+{
+    char raw[sizeof(value)];
+    std::memcpy(raw, &value, sizeof(value));
+    frame.append(raw, sizeof(raw));
+}
+
+void appendString(std::string& frame, std::string_view text)
+{
+    if (text.size() > MaxField) {
+        throw std::runtime_error("Message field too large");
+    }
+    appendNumber(frame, static_cast<std::uint32_t>(text.size()));
+    frame.append(text);
+}
+
+void sendAll(int fd, const std::string& frame)
+{
+    size_t sent = 0;
+    while (sent < frame.size()) {
+        ssize_t count =
+          ::send(fd, frame.data() + sent, frame.size() - sent, MSG_NOSIGNAL);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(errorText("Could not send"));
+        }
+        sent += static_cast<size_t>(count);
+    }
+}
+
+void receiveExactly(int fd, char* data, size_t size)
+{
+    while (size > 0) {
+        ssize_t count = ::recv(fd, data, size, 0);
+        if (count == 0) {
+            throw std::runtime_error("Connection closed mid-message");
+        }
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(errorText("Could not receive"));
+        }
+        data += count;
+        size -= static_cast<size_t>(count);
+    }
+}
+
+void receiveMagic(int fd)
+{
+    char magic[sizeof(Magic)];
+    receiveExactly(fd, magic, sizeof(magic));
+    if (std::memcmp(magic, Magic, sizeof(Magic)) != 0) {
+        throw std::runtime_error("Not a tinycpp daemon message");
+    }
+}
+
+std::uint32_t receiveNumber(int fd)
+{
+    std::uint32_t value;
+    char raw[sizeof(value)];
+    receiveExactly(fd, raw, sizeof(raw));
+    std::memcpy(&value, raw, sizeof(value));
+    return value;
+}
+
+std::string receiveString(int fd)
+{
+    std::uint32_t size = receiveNumber(fd);
+    if (size > MaxField) {
+        throw std::runtime_error("Message field too large");
+    }
+    std::string text(size, '\0');
+    receiveExactly(fd, text.data(), size);
+    return text;
+}
+
+} // namespace
+
+CompileServer::CompileServer(std::string socketPath,
+                             Handler handler,
+                             unsigned threads)
+  : socketPath(std::move(socketPath))
+  , handler(std::move(handler))
+  , threads(threads)
+{
+    sockaddr_un address = addressOf(this->socketPath);
+    listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listener < 0) {
+        throw std::runtime_error(errorText("Could not create socket"));
+    }
+
+    auto bindTo = [&] {
+        return ::bind(listener,
+                      reinterpret_cast<const sockaddr*>(&address),
+                      sizeof(address)) == 0;
+    };
+    bool bound = bindTo();
+    if (!bound && errno == EADDRINUSE) {
+        // The file may be left over from a server that died; only a socket
+        // nobody answers on is replaced
+        Socket probe(::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0));
+        if (probe.get() >= 0 && connectTo(probe.get(), address)) {
+            ::close(listener);
+            throw std::runtime_error("A daemon is already serving on " +
+                                     this->socketPath);
+        }
+        ::unlink(this->socketPath.c_str());
+        bound = bindTo();
+    }
+    if (!bound || ::listen(listener, SOMAXCONN) != 0) {
+        std::string message = errorText("Could not listen on " +
+                                        this->socketPath);
+        ::close(listener);
+        throw std::runtime_error(message);
+    }
+}
+
+CompileServer::~CompileServer()
+{
+    ::close(listener);
+    ::unlink(socketPath.c_str());
+}
+
+void CompileServer::serve()
+{
+    ThreadPool pool(threads);
+    while (!stopping.load(std::memory_order_acquire)) {
+        int connection = ::accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+        if (connection < 0) {
+            if (stopping.load(std::memory_order_acquire)) {
+                break;
+            }
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            throw std::runtime_error(errorText("Could not accept"));
+        }
+
+        timeval timeout{};
+        timeout.tv_sec = ReceiveTimeoutSeconds;
+        ::setsockopt(
+          connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        pool.submit([this, connection] {
+            Socket owned(connection);
+            answer(connection);
+        });
+    }
+    pool.wait();
+}
+
+void CompileServer::stop() noexcept
+{
+    stopping.store(true, std::memory_order_release);
+    // Wakes the accept() in serve()
+    ::shutdown(listener, SHUT_RDWR);
+}
+
+void CompileServer::answer(int connection) const
+{
+    ServerRequest request;
+    try {
+        receiveMagic(connection);
+        request.directory = receiveString(connection);
+        std::uint32_t count = receiveNumber(connection);
+        if (count > MaxArguments) {
+            throw std::runtime_error("Too many arguments");
+        }
+        request.args.reserve(count);
+        for (std::uint32_t i = 0; i < count; ++i) {
+            request.args.push_back(receiveString(connection));
+        }
+        request.input = receiveString(connection);
+    } catch (const std::exception&) {
+        // A client that went away or speaks something else gets no answer
+        return;
+    }
+
+    ServerResponse response;
+    try {
+        response = handler(request);
+    } catch (const std::exception& e) {
+        response = ServerResponse{ 1, "", std::string(e.what()) + "\n" };
+    }
+
+    std::string frame(Magic, sizeof(Magic));
+    appendNumber(frame, static_cast<std::uint32_t>(response.status));
+    appendString(frame, response.out);
+    appendString(frame, response.err);
+    try {
+        sendAll(connection, frame);
+    } catch (const std::exception&) {
+        // Nobody is left to tell
+    }
+}
+
+ServerResponse CompileServer::send(const std::string& socketPath,
+                                   const ServerRequest& request)
+{
+    sockaddr_un address = addressOf(socketPath);
+    Socket connection(::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0));
+    if (connection.get() < 0 || !connectTo(connection.get(), address)) {
+        throw std::runtime_error(errorText("Could not connect to " +
+                                           socketPath));
+    }
+
+    std::string frame(Magic, sizeof(Magic));
+    appendString(frame, request.directory);
+    appendNumber(frame, static_cast<std::uint32_t>(request.args.size()));
+    for (const auto& arg : request.args) {
+        appendString(frame, arg);
+    }
+    appendString(frame, request.input);
+    sendAll(connection.get(), frame);
+
+    ServerResponse response;
+    receiveMagic(connection.get());
+    response.status =
+      static_cast<std::int32_t>(receiveNumber(connection.get()));
+    response.out = receiveString(connection.get());
+    response.err = receiveString(connection.get());
+    return response;
+}
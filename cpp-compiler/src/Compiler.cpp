@@ -1,7 +1,17 @@
 #include "Compiler.hpp"
-#include <fstream>
-#include <iostream>
-#include <sstream>
+#include <algorithm>
+#include "AssemblyWriter.hpp"
+#include "BytecodeProgram.hpp"
+#include "JITProgram.hpp"
+#include "TACImage.hpp"
+#include "X86Writer.hpp"
+
+Compiler::Compiler()
+  : lexer_(std::make_shared<Lexer>())
+  , parser_(std::make_shared<Parser>(lexer_))
+  , irGenerator_(std::make_shared<IRGenerator>(parser_))
+{
+}
 
 Compiler::Compiler(std::shared_ptr<Lexer> lexer,
                    std::shared_ptr<Parser> parser,
@@ -12,42 +22,248 @@ Compiler::Compiler(std::shared_ptr<Lexer> lexer,
 {
 }
 
-std::string Compiler::readFile(const std::string& filePath)
+std::string Compiler::outputConfiguration() const
+{
+    return "O" + std::to_string(optimizationLevel_) +
+           " registers=" + registers_.toString() +
+           (target_ == Target::X86_64 ? " target=x86-64" : "");
+}
+
+void Compiler::resetOptions() noexcept
 {
-    std::ifstream file(filePath);
-    if (!file.is_open()) {
-        throw std::runtime_error("Could not open input file: " + filePath);
+    report_ = nullptr;
+    cache_ = nullptr;
+    irOutputPath_.clear();
+    registers_ = RegisterSet();
+    optimizationLevel_ = 0;
+    target_ = Target::Tac;
+    engine_ = DefaultEngine;
+    parser_->setThreadPool(nullptr);
+    irGenerator_->setThreadPool(nullptr);
+}
+
+void Compiler::setThreads(unsigned threads)
+{
+    if (threads == 1) {
+        parser_->setThreadPool(nullptr);
+        irGenerator_->setThreadPool(nullptr);
+        return;
+    }
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
     }
+    if (!pool_ || pool_->size() != threads) {
+        pool_ = std::make_unique<ThreadPool>(threads);
+    }
+    parser_->setThreadPool(pool_.get());
+    irGenerator_->setThreadPool(pool_.get());
+}
 
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    return buffer.str();
+Compiler::Target Compiler::parseTarget(const std::string& name)
+{
+    if (name == "tac") {
+        return Target::Tac;
+    }
+    if (name == "x86-64") {
+        return Target::X86_64;
+    }
+    throw std::runtime_error("Unknown target '" + name +
+                             "' (expected tac or x86-64)");
 }
 
-void Compiler::writeAssemblyToFile(const std::vector<TACInstruction>& ir,
-                                   const std::string& filePath)
+SourceBuffer Compiler::readFile(const std::string& filePath)
 {
-    std::ofstream outFile(filePath);
-    if (!outFile.is_open()) {
-        throw std::runtime_error("Could not open output file: " + filePath);
+    return SourceBuffer::open(filePath);
+}
+
+size_t Compiler::writeAssembly(const TACProgram& ir, OutputSink& out)
+{
+    if (target_ == Target::X86_64) {
+        X86Writer writer(out);
+        writer.write(ir);
+        writer.flush();
+        return writer.bytesWritten();
+    }
+    if (!writeBuffer_) {
+        writeBuffer_.reset(new char[AssemblyWriter::BufferSize]);
     }
+    AssemblyWriter writer(out, writeBuffer_.get());
+    writer.write(ir);
+    writer.flush();
+    return writer.bytesWritten();
+}
+
+size_t Compiler::writeIRToFile(const TACProgram& ir,
+                               const std::string& filePath)
+{
+    FileSink file(filePath);
+    return writeTACImage(ir, file);
+}
+
+TACProgram& Compiler::generate(std::string_view source)
+{
+    // A serialized program skips the front end altogether
+    if (TACImage::isImage(source)) {
+        beginPhase("load");
+        loaded_ = TACImage::fromBytes(source).toProgram();
+        endPhase(loaded_.code.size(), "instructions");
+        return loaded_;
+    }
+
+    beginPhase("tokenize");
+    lexer_->reset();
+    lexer_->setSource(source);
+    lexer_->tokenize(tokens_);
+    endPhase(tokens_.size(), "tokens");
+
+    // Includes the semantic checks Parser::parse runs on the tree
+    beginPhase("parse");
+    parser_->swapTokens(tokens_);
+    auto ast = parser_->parse();
+    endPhase(parser_->getNodeCount(), "nodes");
+
+    beginPhase("generate");
+    TACProgram& ir = irGenerator_->generateCode(ast);
+    endPhase(ir.code.size(), "instructions");
 
-    for (const auto& instruction : ir) {
-        outFile << instruction.op << " " << instruction.arg1 << " "
-                << instruction.arg2 << " " << instruction.result << "\n";
+    if (optimizationLevel_ > 0) {
+        beginPhase("optimize");
+        Optimizer(optimizationLevel_).run(ir);
+        endPhase(ir.code.size(), "instructions");
+    }
+
+    return ir;
+}
+
+void Compiler::allocate(TACProgram& ir)
+{
+    if (!registers_.empty()) {
+        beginPhase("allocate");
+        RegisterAllocator allocator(registers_);
+        AllocationSummary allocation = allocator.allocate(ir);
+        endPhase(allocation.temps, "temps");
     }
 }
 
 void Compiler::compile(const std::string& inputFilePath,
                        const std::string& outputFilePath)
 {
-    std::string sourceCode = readFile(inputFilePath);
+    if (report_) {
+        report_->start(inputFilePath);
+    }
 
-    lexer_->setSource(sourceCode);
-    auto tokens = lexer_->tokenize();
-    parser_->setTokens(std::move(tokens));
-    auto ast = parser_->parse();
-    auto ir = irGenerator_->generateCode(ast);
+    // Tokens view straight into this buffer, so it lives for the whole
+    // compile
+    beginPhase("read");
+    SourceBuffer sourceCode = readFile(inputFilePath);
+    endPhase(sourceCode.view().size(), "bytes");
 
-    writeAssemblyToFile(ir, outputFilePath);
-}
\ No newline at end of file
+    // An image is written out as it is, without the cache or allocation
+    bool image = TACImage::isImage(sourceCode.view());
+    bool emitIR = !image && !irOutputPath_.empty();
+    bool caching = !image && cache_;
+    ContentHash key;
+    if (caching) {
+        beginPhase("cache");
+        key = cache_->keyFor(sourceCode.view(), outputConfiguration());
+        bool hit = cache_->fetch(key, outputFilePath) &&
+                   (!emitIR ||
+                    cache_->fetch(key, irOutputPath_, ArtifactKind::IR));
+        endPhase(sourceCode.view().size(), hit ? "bytes, hit" : "bytes, miss");
+        if (hit) {
+            return;
+        }
+    }
+
+    TACProgram& ir = generate(sourceCode.view());
+    if (!image) {
+        allocate(ir);
+    }
+
+    if (emitIR) {
+        beginPhase("emit-ir");
+        size_t imageBytes = writeIRToFile(ir, irOutputPath_);
+        endPhase(imageBytes, "bytes");
+    }
+
+    beginPhase("write");
+    FileSink file(outputFilePath);
+    size_t written = writeAssembly(ir, file);
+    endPhase(written, "bytes");
+
+    if (caching) {
+        beginPhase("store");
+        cache_->store(key, outputFilePath);
+        if (emitIR) {
+            cache_->store(key, irOutputPath_, ArtifactKind::IR);
+        }
+        endPhase(written, "bytes");
+    }
+}
+
+size_t Compiler::compileSource(std::string_view source, OutputSink& out)
+{
+    const TACProgram& ir = generateIR(source);
+
+    beginPhase("write");
+    size_t written = writeAssembly(ir, out);
+    endPhase(written, "bytes");
+    return written;
+}
+
+const TACProgram& Compiler::generateIR(std::string_view source)
+{
+    if (report_) {
+        report_->start("<buffer>");
+    }
+
+    TACProgram& ir = generate(source);
+    if (&ir != &loaded_) {
+        allocate(ir);
+    }
+    return ir;
+}
+
+int Compiler::run(const std::string& inputFilePath)
+{
+    if (report_) {
+        report_->start(inputFilePath);
+    }
+
+    beginPhase("read");
+    SourceBuffer sourceCode = readFile(inputFilePath);
+    endPhase(sourceCode.view().size(), "bytes");
+
+    return execute(generate(sourceCode.view()));
+}
+
+int Compiler::runSource(std::string_view source)
+{
+    if (report_) {
+        report_->start("<buffer>");
+    }
+    return execute(generate(source));
+}
+
+int Compiler::execute(const TACProgram& ir)
+{
+    if (engine_ == Engine::Interpreter) {
+        beginPhase("translate");
+        BytecodeProgram bytecode = BytecodeProgram::compile(ir);
+        endPhase(bytecode.size(), "instructions");
+
+        beginPhase("execute");
+        int status = bytecode.run();
+        endPhase(1, "call");
+        return status;
+    }
+
+    beginPhase("jit");
+    JITProgram program = JITProgram::compile(ir);
+    endPhase(program.codeSize(), "bytes");
+
+    beginPhase("execute");
+    int status = program.run();
+    endPhase(1, "call");
+    return status;
+}
@@ -0,0 +1,401 @@
+#include "ConstantFolder.hpp"
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+// Value of an int or float literal, as SemanticAnalyzer typed it
+struct Constant
+{
+    bool isFloat = false;
+    std::int32_t intValue = 0;
+    double floatValue = 0;
+
+    double asDouble() const noexcept
+    {
+        return isFloat ? floatValue : static_cast<double>(intValue);
+    }
+    bool isZero() const noexcept { return asDouble() == 0; }
+    bool isOne() const noexcept { return asDouble() == 1; }
+};
+
+bool readConstant(const Expression& expr, Constant& out)
+{
+    const auto* literal = nodeCast<LiteralExpression>(&expr);
+    if (!literal) {
+        return false;
+    }
+
+    std::string_view text = literal->getValue();
+    const char* end = text.data() + text.size();
+    if (expr.getType() == TypeId::Int) {
+        out.isFloat = false;
+        auto result = std::from_chars(text.data(), end, out.intValue);
+        return result.ec == std::errc() && result.ptr == end;
+    }
+    if (expr.getType() == TypeId::Float) {
+        out.isFloat = true;
+        auto result = std::from_chars(text.data(), end, out.floatValue);
+        return result.ec == std::errc() && result.ptr == end &&
+               std::isfinite(out.floatValue);
+    }
+    return false;
+}
+
+// Whether folding may drop `expr` unevaluated. A call is never pure, since
+// its body runs with whatever effects it has; arithmetic is kept too, since
+// it may fault (10 / z) at run time.
+bool isPure(const Expression& expr) noexcept
+{
+    switch (expr.getKind()) {
+        case NodeKind::LiteralExpression:
+        case NodeKind::VariableExpression:
+            return true;
+        case NodeKind::CallExpression:
+        default:
+            return false;
+    }
+}
+
+// Two's-complement wraparound, the behaviour of the generated code
+std::int32_t wrap(std::int64_t value) noexcept
+{
+    return static_cast<std::int32_t>(static_cast<std::uint32_t>(value));
+}
+
+// Integer result of `left op right`; false when the operation must be left
+// for run time (division by zero, INT_MIN / -1) or has no integer value
+bool evaluateInt(BinaryOp op,
+                 std::int32_t left,
+                 std::int32_t right,
+                 std::int32_t& out) noexcept
+{
+    switch (op) {
+        case BinaryOp::Add:
+            out = wrap(std::int64_t(left) + right);
+            return true;
+        case BinaryOp::Subtract:
+            out = wrap(std::int64_t(left) - right);
+            return true;
+        case BinaryOp::Multiply:
+            out = wrap(std::int64_t(left) * right);
+            return true;
+        case BinaryOp::Divide:
+        case BinaryOp::Modulo:
+            if (right == 0 ||
+                (left == std::numeric_limits<std::int32_t>::min() &&
+                 right == -1)) {
+                return false;
+            }
+            out = op == BinaryOp::Divide ? left / right : left % right;
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool evaluateFloat(BinaryOp op, double left, double right, double& out)
+{
+    switch (op) {
+        case BinaryOp::Add:
+            out = left + right;
+            break;
+        case BinaryOp::Subtract:
+            out = left - right;
+            break;
+        case BinaryOp::Multiply:
+            out = left * right;
+            break;
+        case BinaryOp::Divide:
+            if (right == 0) {
+                return false;
+            }
+            out = left / right;
+            break;
+        default:
+            return false;
+    }
+    return std::isfinite(out);
+}
+
+// Truth value of a comparison or logical operator, else false
+bool evaluateCondition(BinaryOp op, double left, double right, bool& out)
+{
+    switch (op) {
+        case BinaryOp::LessThan:
+            out = left < right;
+            return true;
+        case BinaryOp::GreaterThan:
+            out = left > right;
+            return true;
+        case BinaryOp::Equal:
+            out = left == right;
+            return true;
+        case BinaryOp::NotEqual:
+            out = left != right;
+            return true;
+        case BinaryOp::And:
+            out = left != 0 && right != 0;
+            return true;
+        case BinaryOp::Or:
+            out = left != 0 || right != 0;
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Shortest round-tripping spelling that still reads as a float literal
+std::string_view formatFloat(double value, char (&buffer)[64])
+{
+    char* end = std::to_chars(buffer, buffer + 60, value).ptr;
+    std::string_view text(buffer, static_cast<size_t>(end - buffer));
+    if (text.find('.') != std::string_view::npos) {
+        return text;
+    }
+
+    size_t exponent = text.find('e');
+    if (exponent == std::string_view::npos) {
+        *end++ = '.';
+        *end++ = '0';
+    } else {
+        std::memmove(buffer + exponent + 2,
+                     buffer + exponent,
+                     text.size() - exponent);
+        buffer[exponent] = '.';
+        buffer[exponent + 1] = '0';
+        end += 2;
+    }
+    return std::string_view(buffer, static_cast<size_t>(end - buffer));
+}
+
+} // namespace
+
+ExpressionPtr ConstantFolder::simplify(ExpressionPtr expr)
+{
+    return expr ? visitExpression(*expr) : nullptr;
+}
+
+ExpressionPtr ConstantFolder::makeLiteral(std::string_view text, TypeId type)
+{
+    auto* literal = arena.make<LiteralExpression>(arena.copyString(text));
+    literal->setType(type);
+    return literal;
+}
+
+ExpressionPtr ConstantFolder::evaluate(BinaryExpression& expr)
+{
+    Constant left;
+    Constant right;
+    if (!readConstant(*expr.getLeft(), left) ||
+        !readConstant(*expr.getRight(), right)) {
+        return nullptr;
+    }
+
+    BinaryOp op = expr.getOperator();
+    TypeId type = expr.getType();
+    char buffer[64];
+
+    bool truth;
+    if (evaluateCondition(op, left.asDouble(), right.asDouble(), truth)) {
+        // Comparisons carry their operands' type; a float-typed truth value
+        // is spelled as a float literal
+        if (type == TypeId::Float) {
+            return makeLiteral(truth ? "1.0" : "0.0", type);
+        }
+        return makeLiteral(truth ? "1" : "0", type);
+    }
+
+    if (type == TypeId::Int && !left.isFloat && !right.isFloat) {
+        std::int32_t value;
+        if (!evaluateInt(op, left.intValue, right.intValue, value)) {
+            return nullptr;
+        }
+        char* end = std::to_chars(buffer, buffer + sizeof(buffer), value).ptr;
+        return makeLiteral(
+          std::string_view(buffer, static_cast<size_t>(end - buffer)), type);
+    }
+
+    if (type == TypeId::Float) {
+        double value;
+        if (!evaluateFloat(op, left.asDouble(), right.asDouble(), value)) {
+            return nullptr;
+        }
+        return makeLiteral(formatFloat(value, buffer), type);
+    }
+    return nullptr;
+}
+
+ExpressionPtr ConstantFolder::applyIdentity(BinaryExpression& expr)
+{
+    TypeId type = expr.getType();
+    if (type != TypeId::Int && type != TypeId::Float) {
+        return nullptr;
+    }
+
+    // An operand may stand in for the whole expression only when no
+    // int-to-float promotion is lost with the operator
+    ExpressionPtr left = expr.getLeft();
+    ExpressionPtr right = expr.getRight();
+    bool keepLeft = left->getType() == type;
+    bool keepRight = right->getType() == type;
+
+    Constant constant;
+    bool rightConstant = readConstant(*right, constant);
+    Constant leftValue;
+    bool leftConstant = readConstant(*left, leftValue);
+
+    switch (expr.getOperator()) {
+        case BinaryOp::Add:
+            // x + 0.0 is not x for x == -0.0, so floats keep the add
+            if (type != TypeId::Int) {
+                break;
+            }
+            if (rightConstant && constant.isZero() && keepLeft) {
+                return left;
+            }
+            if (leftConstant && leftValue.isZero() && keepRight) {
+                return right;
+            }
+            break;
+        case BinaryOp::Subtract:
+            if (rightConstant && constant.isZero() && keepLeft) {
+                return left;
+            }
+            break;
+        case BinaryOp::Multiply:
+            if (rightConstant && constant.isOne() && keepLeft) {
+                return left;
+            }
+            if (leftConstant && leftValue.isOne() && keepRight) {
+                return right;
+            }
+            // Float x * 0 depends on x (NaN, infinities, signed zero)
+            if (type == TypeId::Int &&
+                ((rightConstant && constant.isZero() && isPure(*left)) ||
+                 (leftConstant && leftValue.isZero() &&
+                  isPure(*right)))) {
+                return makeLiteral("0", type);
+            }
+            break;
+        case BinaryOp::Divide:
+            if (rightConstant && constant.isOne() && keepLeft) {
+                return left;
+            }
+            break;
+        default:
+            break;
+    }
+    return nullptr;
+}
+
+ExpressionPtr ConstantFolder::visit(BinaryExpression& expr)
+{
+    expr.setLeft(simplify(expr.getLeft()));
+    expr.setRight(simplify(expr.getRight()));
+
+    ExpressionPtr replacement = evaluate(expr);
+    if (!replacement) {
+        replacement = applyIdentity(expr);
+    }
+    if (!replacement) {
+        return &expr;
+    }
+    ++folded;
+    return replacement;
+}
+
+ExpressionPtr ConstantFolder::visit(LiteralExpression& expr)
+{
+    return &expr;
+}
+
+ExpressionPtr ConstantFolder::visit(VariableExpression& expr)
+{
+    return &expr;
+}
+
+ExpressionPtr ConstantFolder::visit(CallExpression& expr)
+{
+    for (ExpressionPtr& argument : expr.getArguments()) {
+        argument = simplify(argument);
+    }
+    return &expr;
+}
+
+void ConstantFolder::visit(BlockStatement& stmt)
+{
+    for (const auto& inner : stmt.getStatements()) {
+        visitStatement(*inner);
+    }
+}
+
+void ConstantFolder::visit(VariableDeclaration& stmt)
+{
+    stmt.setInitializer(simplify(stmt.getInitializer()));
+}
+
+void ConstantFolder::visit(AssignmentStatement& stmt)
+{
+    stmt.setValue(simplify(stmt.getValue()));
+}
+
+void ConstantFolder::visit(ExpressionStatement& stmt)
+{
+    stmt.setExpression(simplify(stmt.getExpression()));
+}
+
+void ConstantFolder::visit(ReturnStatement& stmt)
+{
+    stmt.setReturnValue(simplify(stmt.getReturnValue()));
+}
+
+void ConstantFolder::visit(FunctionDeclaration& stmt)
+{
+    for (const auto& inner : stmt.getBody()) {
+        visitStatement(*inner);
+    }
+}
+
+void ConstantFolder::visit(IfStatement& stmt)
+{
+    stmt.setCondition(simplify(stmt.getCondition()));
+    visitStatement(*stmt.getThenBranch());
+    if (stmt.getElseBranch()) {
+        visitStatement(*stmt.getElseBranch());
+    }
+}
+
+void ConstantFolder::visit(WhileStatement& stmt)
+{
+    stmt.setCondition(simplify(stmt.getCondition()));
+    visitStatement(*stmt.getBody());
+}
+
+void ConstantFolder::visit(DoWhileStatement& stmt)
+{
+    visitStatement(*stmt.getBody());
+    stmt.setCondition(simplify(stmt.getCondition()));
+}
+
+void ConstantFolder::visit(ForStatement& stmt)
+{
+    if (stmt.getInitializer()) {
+        visitStatement(*stmt.getInitializer());
+    }
+    stmt.setCondition(simplify(stmt.getCondition()));
+    if (stmt.getUpdate()) {
+        visitStatement(*stmt.getUpdate());
+    }
+    visitStatement(*stmt.getBody());
+}
+
+void ConstantFolder::visit(TranslationUnit& unit)
+{
+    for (const auto& inner : unit.getStatements()) {
+        visitStatement(*inner);
+    }
+}
@@ -0,0 +1,111 @@
+#include "ContentHash.hpp"
+#include <cstring>
+
+namespace {
+
+constexpr std::uint64_t C1 = 0x87c37b91114253d5ull;
+constexpr std::uint64_t C2 = 0x4cf5ad432745937full;
+
+inline std::uint64_t rotl(std::uint64_t x, int r) noexcept
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+inline std::uint64_t fmix(std::uint64_t k) noexcept
+{
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdull;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ull;
+    k ^= k >> 33;
+    return k;
+}
+
+inline std::uint64_t load(const unsigned char* p) noexcept
+{
+    std::uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline std::uint64_t mixK1(std::uint64_t k1) noexcept
+{
+    return rotl(k1 * C1, 31) * C2;
+}
+
+inline std::uint64_t mixK2(std::uint64_t k2) noexcept
+{
+    return rotl(k2 * C2, 33) * C1;
+}
+
+} // namespace
+
+ContentHash ContentHash::of(std::string_view data, std::uint64_t seed)
+{
+    auto bytes = reinterpret_cast<const unsigned char*>(data.data());
+    size_t length = data.size();
+    size_t blocks = length / 16;
+
+    std::uint64_t h1 = seed;
+    std::uint64_t h2 = seed;
+
+    for (size_t i = 0; i < blocks; ++i) {
+        h1 ^= mixK1(load(bytes + i * 16));
+        h1 = rotl(h1, 27) + h2;
+        h1 = h1 * 5 + 0x52dce729;
+
+        h2 ^= mixK2(load(bytes + i * 16 + 8));
+        h2 = rotl(h2, 31) + h1;
+        h2 = h2 * 5 + 0x38495ab5;
+    }
+
+    const unsigned char* tail = bytes + blocks * 16;
+    size_t rest = length & 15;
+    std::uint64_t k1 = 0;
+    std::uint64_t k2 = 0;
+    for (size_t i = rest; i > 8; --i) {
+        k2 = (k2 << 8) | tail[i - 1];
+    }
+    for (size_t i = rest < 8 ? rest : 8; i > 0; --i) {
+        k1 = (k1 << 8) | tail[i - 1];
+    }
+    if (rest > 8) {
+        h2 ^= mixK2(k2);
+    }
+    if (rest > 0) {
+        h1 ^= mixK1(k1);
+    }
+
+    h1 ^= length;
+    h2 ^= length;
+    h1 += h2;
+    h2 += h1;
+    h1 = fmix(h1);
+    h2 = fmix(h2);
+    h1 += h2;
+    h2 += h1;
+
+    return { h1, h2 };
+}
+
+ContentHash ContentHash::combine(const ContentHash& first,
+                                 const ContentHash& second)
+{
+    unsigned char parts[32];
+    std::memcpy(parts, &first.low, 8);
+    std::memcpy(parts + 8, &first.high, 8);
+    std::memcpy(parts + 16, &second.low, 8);
+    std::memcpy(parts + 24, &second.high, 8);
+    return of({ reinterpret_cast<const char*>(parts), sizeof(parts) });
+}
+
+std::string ContentHash::toHex() const
+{
+    static constexpr char digits[] = "0123456789abcdef";
+    std::string hex(32, '0');
+    for (int i = 0; i < 16; ++i) {
+        hex[15 - i] = digits[(high >> (4 * i)) & 15];
+        hex[31 - i] = digits[(low >> (4 * i)) & 15];
+    }
+    return hex;
+}
@@ -0,0 +1,420 @@
+#include "ControlFlowGraph.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+bool endsBlock(Opcode op) noexcept
+{
+    return op == Opcode::Goto || op == Opcode::IfFalse || op == Opcode::Ret;
+}
+
+bool startsBlock(Opcode op) noexcept
+{
+    return op == Opcode::Label || op == Opcode::Function;
+}
+
+void appendBlockName(std::string& out, BlockId id)
+{
+    if (id == NoBlock) {
+        out += '-';
+    } else {
+        out += 'B';
+        out += std::to_string(id);
+    }
+}
+
+} // namespace
+
+ControlFlowGraph::ControlFlowGraph(const TACProgram& program)
+{
+    buildBlocks(program);
+    linkPredecessors();
+    findEntries(program);
+    computeOrder();
+    computeDominators();
+    numberDominatorTree();
+}
+
+void ControlFlowGraph::buildBlocks(const TACProgram& program)
+{
+    const auto& code = program.code;
+    auto count = static_cast<std::uint32_t>(code.size());
+    labelBlocks.assign(program.getStrings().size(), NoBlock);
+
+    std::uint32_t begin = 0;
+    for (std::uint32_t i = 0; i < count; ++i) {
+        const TACInstruction& instruction = code[i];
+        if (startsBlock(instruction.op) && i > begin) {
+            blocks.push_back({ begin, i });
+            begin = i;
+        }
+        if (instruction.op == Opcode::Label &&
+            instruction.result.is(Operand::Kind::Label)) {
+            labelBlocks[instruction.result.index()] =
+              static_cast<BlockId>(blocks.size());
+        }
+        if (endsBlock(instruction.op)) {
+            blocks.push_back({ begin, i + 1 });
+            begin = i + 1;
+        }
+    }
+    if (begin < count) {
+        blocks.push_back({ begin, count });
+    }
+
+    for (BlockId id = 0; id < blocks.size(); ++id) {
+        BasicBlock& b = blocks[id];
+        const TACInstruction& last = code[b.end - 1];
+        // Nothing falls into a function
+        BlockId next =
+          id + 1 < blocks.size() &&
+              code[blocks[id + 1].begin].op != Opcode::Function
+            ? id + 1
+            : NoBlock;
+
+        auto addEdge = [&b](BlockId to) {
+            if (to != NoBlock &&
+                (b.successorCount == 0 || b.successors[0] != to)) {
+                b.successors[b.successorCount++] = to;
+            }
+        };
+
+        if (last.op == Opcode::Goto || last.op == Opcode::IfFalse) {
+            BlockId target = blockOfLabel(last.result);
+            if (target == NoBlock) {
+                std::string name(program.text(last.result));
+                throw std::runtime_error("Jump to undefined label: " + name);
+            }
+            addEdge(target);
+            if (last.op == Opcode::IfFalse) {
+                addEdge(next);
+            }
+        } else if (last.op != Opcode::Ret) {
+            addEdge(next);
+        }
+    }
+}
+
+void ControlFlowGraph::linkPredecessors()
+{
+    for (const BasicBlock& b : blocks) {
+        for (std::uint32_t i = 0; i < b.successorCount; ++i) {
+            ++blocks[b.successors[i]].predecessorCount;
+        }
+    }
+
+    std::uint32_t offset = 0;
+    for (BasicBlock& b : blocks) {
+        b.firstPredecessor = offset;
+        offset += b.predecessorCount;
+        b.predecessorCount = 0;
+    }
+
+    predecessorList.resize(offset);
+    for (BlockId id = 0; id < blocks.size(); ++id) {
+        const BasicBlock& b = blocks[id];
+        for (std::uint32_t i = 0; i < b.successorCount; ++i) {
+            BasicBlock& to = blocks[b.successors[i]];
+            predecessorList[to.firstPredecessor + to.predecessorCount++] = id;
+        }
+    }
+}
+
+void ControlFlowGraph::findEntries(const TACProgram& program)
+{
+    for (BlockId id = 0; id < blocks.size(); ++id) {
+        const BasicBlock& b = blocks[id];
+        if (id == 0 || program.code[b.begin].op == Opcode::Function) {
+            entries.push_back(id);
+        }
+    }
+}
+
+void ControlFlowGraph::computeOrder()
+{
+    rpoIndex.assign(blocks.size(), NoBlock);
+
+    // Iterative depth-first search; each frame is a block and the index of
+    // the next successor to visit. rpoIndex doubles as the visited mark.
+    std::vector<std::pair<BlockId, std::uint32_t>> stack;
+    std::vector<BlockId> postorder;
+    postorder.reserve(blocks.size());
+    for (BlockId entry : entries) {
+        stack.push_back({ entry, 0 });
+        rpoIndex[entry] = 0;
+        while (!stack.empty()) {
+            auto& [id, next] = stack.back();
+            const BasicBlock& b = blocks[id];
+            if (next < b.successorCount) {
+                BlockId to = b.successors[next++];
+                if (rpoIndex[to] == NoBlock) {
+                    rpoIndex[to] = 0;
+                    stack.push_back({ to, 0 });
+                }
+                continue;
+            }
+            postorder.push_back(id);
+            stack.pop_back();
+        }
+    }
+
+    order.assign(postorder.rbegin(), postorder.rend());
+    for (std::uint32_t i = 0; i < order.size(); ++i) {
+        rpoIndex[order[i]] = i;
+    }
+}
+
+void ControlFlowGraph::computeDominators()
+{
+    // Semi-NCA over a depth-first preorder. Number 0 is a virtual root with
+    // an edge to every entry, so a block reached from two entries ends up
+    // dominated by the virtual root alone and roots its own tree.
+    constexpr std::uint32_t Unvisited = UINT32_MAX;
+    std::vector<std::uint32_t> number(blocks.size(), Unvisited);
+    std::vector<BlockId> vertex(1, NoBlock);
+    std::vector<std::uint32_t> parent(1, 0);
+    vertex.reserve(order.size() + 1);
+    parent.reserve(order.size() + 1);
+
+    std::vector<std::pair<BlockId, std::uint32_t>> stack;
+    for (BlockId entry : entries) {
+        if (number[entry] != Unvisited) {
+            continue;
+        }
+        number[entry] = static_cast<std::uint32_t>(vertex.size());
+        vertex.push_back(entry);
+        parent.push_back(0);
+        stack.push_back({ entry, 0 });
+        while (!stack.empty()) {
+            auto& [id, next] = stack.back();
+            const BasicBlock& b = blocks[id];
+            if (next == b.successorCount) {
+                stack.pop_back();
+                continue;
+            }
+            BlockId to = b.successors[next++];
+            if (number[to] == Unvisited) {
+                number[to] = static_cast<std::uint32_t>(vertex.size());
+                vertex.push_back(to);
+                parent.push_back(number[id]);
+                stack.push_back({ to, 0 });
+            }
+        }
+    }
+
+    auto count = static_cast<std::uint32_t>(vertex.size());
+    std::vector<std::uint32_t> semi(count);
+    std::vector<std::uint32_t> label(count);
+    std::vector<std::uint32_t> ancestor(count, Unvisited);
+    for (std::uint32_t i = 0; i < count; ++i) {
+        semi[i] = label[i] = i;
+    }
+
+    // Vertex with the smallest semidominator on the linked path above v,
+    // compressing the path as it goes
+    std::vector<std::uint32_t> path;
+    auto eval = [&](std::uint32_t v) {
+        if (ancestor[v] == Unvisited) {
+            return v;
+        }
+        for (std::uint32_t x = v; ancestor[ancestor[x]] != Unvisited;
+             x = ancestor[x]) {
+            path.push_back(x);
+        }
+        while (!path.empty()) {
+            std::uint32_t x = path.back();
+            path.pop_back();
+            std::uint32_t up = ancestor[x];
+            if (semi[label[up]] < semi[label[x]]) {
+                label[x] = label[up];
+            }
+            ancestor[x] = ancestor[up];
+        }
+        return label[v];
+    };
+
+    for (std::uint32_t w = count - 1; w > 0; --w) {
+        std::uint32_t best = parent[w];
+        for (BlockId pred : predecessors(vertex[w])) {
+            if (number[pred] != Unvisited) {
+                best = std::min(best, semi[eval(number[pred])]);
+            }
+        }
+        semi[w] = best;
+        ancestor[w] = parent[w];
+    }
+
+    std::vector<std::uint32_t> dominator(count, 0);
+    for (std::uint32_t w = 1; w < count; ++w) {
+        std::uint32_t d = parent[w];
+        while (d > semi[w]) {
+            d = dominator[d];
+        }
+        dominator[w] = d;
+    }
+
+    idom.assign(blocks.size(), NoBlock);
+    for (std::uint32_t w = 1; w < count; ++w) {
+        idom[vertex[w]] = dominator[w] == 0 ? vertex[w]
+                                            : vertex[dominator[w]];
+    }
+}
+
+void ControlFlowGraph::numberDominatorTree()
+{
+    std::vector<std::uint32_t> childCount(blocks.size() + 1, 0);
+    for (BlockId id : order) {
+        if (idom[id] != id) {
+            ++childCount[idom[id]];
+        }
+    }
+    std::vector<std::uint32_t> firstChild(blocks.size() + 1, 0);
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        firstChild[i + 1] = firstChild[i] + childCount[i];
+    }
+    std::vector<BlockId> children(firstChild[blocks.size()]);
+    std::vector<std::uint32_t> filled(firstChild.begin(), firstChild.end() - 1);
+    for (BlockId id : order) {
+        if (idom[id] != id) {
+            children[filled[idom[id]]++] = id;
+        }
+    }
+
+    treeEnter.assign(blocks.size(), 0);
+    treeExit.assign(blocks.size(), 0);
+    std::uint32_t clock = 0;
+    std::vector<std::pair<BlockId, std::uint32_t>> stack;
+    for (BlockId root : order) {
+        if (idom[root] != root) {
+            continue;
+        }
+        stack.push_back({ root, firstChild[root] });
+        treeEnter[root] = clock++;
+        while (!stack.empty()) {
+            auto& [id, next] = stack.back();
+            if (next < firstChild[id + 1]) {
+                BlockId child = children[next++];
+                treeEnter[child] = clock++;
+                stack.push_back({ child, firstChild[child] });
+                continue;
+            }
+            treeExit[id] = clock++;
+            stack.pop_back();
+        }
+    }
+}
+
+bool ControlFlowGraph::dominates(BlockId a, BlockId b) const noexcept
+{
+    if (!isReachable(a) || !isReachable(b)) {
+        return a == b;
+    }
+    return treeEnter[a] <= treeEnter[b] && treeExit[b] <= treeExit[a];
+}
+
+LoopNest ControlFlowGraph::naturalLoops() const
+{
+    LoopNest nest;
+    std::vector<BlockId>& body = nest.blockList;
+    // Header of the loop each block was last added to
+    std::vector<BlockId> member(blocks.size(), NoBlock);
+    std::vector<BlockId> work;
+
+    // A header dominates everything in its loop, so it comes before the
+    // headers of the loops nested in it
+    for (BlockId header : order) {
+        auto first = static_cast<std::uint32_t>(body.size());
+        for (BlockId from : predecessors(header)) {
+            if (!dominates(header, from)) {
+                continue;
+            }
+            if (member[header] != header) {
+                member[header] = header;
+                body.push_back(header);
+            }
+            if (member[from] != header) {
+                member[from] = header;
+                work.push_back(from);
+            }
+        }
+        if (member[header] != header) {
+            continue;
+        }
+
+        bool entered = false;
+        while (!work.empty()) {
+            BlockId id = work.back();
+            work.pop_back();
+            body.push_back(id);
+            entered = entered || (id != header && !dominates(header, id));
+            for (BlockId from : predecessors(id)) {
+                if (member[from] != header && isReachable(from)) {
+                    member[from] = header;
+                    work.push_back(from);
+                }
+            }
+        }
+        if (entered) {
+            body.resize(first);
+            continue;
+        }
+        std::sort(body.begin() + first,
+                  body.end(),
+                  [this](BlockId a, BlockId b) {
+                      return rpoIndex[a] < rpoIndex[b];
+                  });
+        nest.loops.push_back(
+          { header, first, static_cast<std::uint32_t>(body.size() - first) });
+    }
+    return nest;
+}
+
+BlockId ControlFlowGraph::blockOfLabel(Operand label) const noexcept
+{
+    if (!label.is(Operand::Kind::Label) ||
+        label.index() >= labelBlocks.size()) {
+        return NoBlock;
+    }
+    return labelBlocks[label.index()];
+}
+
+BlockId ControlFlowGraph::blockOf(std::uint32_t position) const noexcept
+{
+    auto after = std::upper_bound(
+      blocks.begin(),
+      blocks.end(),
+      position,
+      [](std::uint32_t value, const BasicBlock& b) { return value < b.begin; });
+    if (after == blocks.begin() || position >= (after - 1)->end) {
+        return NoBlock;
+    }
+    return static_cast<BlockId>(after - blocks.begin() - 1);
+}
+
+std::string ControlFlowGraph::toString() const
+{
+    std::string out;
+    for (BlockId id = 0; id < blocks.size(); ++id) {
+        const BasicBlock& b = blocks[id];
+        appendBlockName(out, id);
+        out += " [" + std::to_string(b.begin) + ", " + std::to_string(b.end) +
+               ") succ";
+        for (BlockId to : successors(id)) {
+            out += ' ';
+            appendBlockName(out, to);
+        }
+        out += " pred";
+        for (BlockId from : predecessors(id)) {
+            out += ' ';
+            appendBlockName(out, from);
+        }
+        out += " idom ";
+        appendBlockName(out, immediateDominator(id));
+        if (!isReachable(id)) {
+            out += " unreachable";
+        }
+        out += '\n';
+    }
+    return out;
+}
@@ -0,0 +1,194 @@
+#include "ControlFlowGraph.hpp"
+#include "Optimizer.hpp"
+
+namespace {
+
+// Instructions that compute a value into `result` without other effects.
+// A call is kept with the ARGs before it, and a PARAM with the argument
+// slot it takes, even when nothing reads what they write.
+bool producesValue(Opcode op) noexcept
+{
+    return op != Opcode::IfFalse && op != Opcode::Goto &&
+           op != Opcode::Label && op != Opcode::Ret && op != Opcode::Param &&
+           op != Opcode::Arg && op != Opcode::Call && op != Opcode::Function;
+}
+
+} // namespace
+
+size_t removeUnreachableBlocks(TACProgram& program)
+{
+    auto& code = program.code;
+    if (code.empty()) {
+        return 0;
+    }
+    ControlFlowGraph graph(program);
+
+    std::vector<std::uint8_t> dead(code.size(), 0);
+    bool any = false;
+    for (BlockId id = 0; id < graph.size(); ++id) {
+        if (!graph.isReachable(id)) {
+            const BasicBlock& b = graph.block(id);
+            std::fill(dead.begin() + b.begin, dead.begin() + b.end, 1);
+            any = true;
+        }
+    }
+    return any ? eraseInstructions(code, dead) : 0;
+}
+
+size_t removeUnusedTemps(TACProgram& program)
+{
+    auto& code = program.code;
+    std::uint32_t tempCount = program.getTempCount();
+    std::vector<std::uint32_t> uses(tempCount, 0);
+    for (const TACInstruction& instruction : code) {
+        for (Operand operand : { instruction.arg1, instruction.arg2 }) {
+            if (operand.is(Operand::Kind::Temp) &&
+                operand.index() < tempCount) {
+                ++uses[operand.index()];
+            }
+        }
+    }
+
+    // Temps are defined before they are read, so one backward walk also
+    // catches the temps that only fed a deleted instruction
+    std::vector<std::uint8_t> dead(code.size(), 0);
+    bool any = false;
+    for (size_t i = code.size(); i-- > 0;) {
+        const TACInstruction& instruction = code[i];
+        if (!producesValue(instruction.op) || mayTrap(program, instruction) ||
+            !instruction.result.is(Operand::Kind::Temp) ||
+            instruction.result.index() >= tempCount ||
+            uses[instruction.result.index()] != 0) {
+            continue;
+        }
+        dead[i] = 1;
+        any = true;
+        for (Operand operand : { instruction.arg1, instruction.arg2 }) {
+            if (operand.is(Operand::Kind::Temp) &&
+                operand.index() < tempCount) {
+                --uses[operand.index()];
+            }
+        }
+    }
+    return any ? eraseInstructions(code, dead) : 0;
+}
+
+size_t removeDeadStores(TACProgram& program)
+{
+    auto& code = program.code;
+    if (code.empty()) {
+        return 0;
+    }
+    std::uint32_t tempCount = program.getTempCount();
+    auto valueCount =
+      static_cast<std::uint32_t>(tempCount + program.getStrings().size());
+
+    // Temps and variables share one numbering: temp t is t, variable v is
+    // tempCount + v
+    auto valueOf = [tempCount](Operand operand) -> std::uint32_t {
+        if (operand.is(Operand::Kind::Temp) && operand.index() < tempCount) {
+            return operand.index();
+        }
+        if (operand.is(Operand::Kind::Variable)) {
+            return tempCount + operand.index();
+        }
+        return UINT32_MAX;
+    };
+
+    // A write the same block overwrites before any read never matters.
+    // overwrittenIn[v] == block + 1 while walking that block backwards
+    // means v is written again further down.
+    ControlFlowGraph graph(program);
+    std::vector<std::uint8_t> dead(code.size(), 0);
+    std::vector<BlockId> overwrittenIn(valueCount, 0);
+    for (BlockId id = 0; id < graph.size(); ++id) {
+        const BasicBlock& b = graph.block(id);
+        BlockId stamp = id + 1;
+        for (std::uint32_t i = b.end; i-- > b.begin;) {
+            const TACInstruction& instruction = code[i];
+            if (producesValue(instruction.op) &&
+                instruction.result.is(Operand::Kind::Variable)) {
+                std::uint32_t value = valueOf(instruction.result);
+                if (overwrittenIn[value] == stamp &&
+                    !mayTrap(program, instruction)) {
+                    dead[i] = 1;
+                    continue;
+                }
+                overwrittenIn[value] = stamp;
+            }
+            for (Operand operand : { instruction.arg1, instruction.arg2 }) {
+                if (operand.is(Operand::Kind::Variable)) {
+                    overwrittenIn[valueOf(operand)] = 0;
+                }
+            }
+        }
+    }
+
+    // Writers of each value, packed by value
+    std::vector<std::uint32_t> firstWriter(valueCount + 1, 0);
+    for (std::uint32_t i = 0; i < code.size(); ++i) {
+        if (!dead[i] && producesValue(code[i].op)) {
+            std::uint32_t value = valueOf(code[i].result);
+            if (value != UINT32_MAX) {
+                ++firstWriter[value + 1];
+            }
+        }
+    }
+    for (std::uint32_t v = 0; v < valueCount; ++v) {
+        firstWriter[v + 1] += firstWriter[v];
+    }
+    std::vector<std::uint32_t> writers(firstWriter[valueCount]);
+    std::vector<std::uint32_t> filled(firstWriter.begin(),
+                                      firstWriter.end() - 1);
+    for (std::uint32_t i = 0; i < code.size(); ++i) {
+        if (!dead[i] && producesValue(code[i].op)) {
+            std::uint32_t value = valueOf(code[i].result);
+            if (value != UINT32_MAX) {
+                writers[filled[value]++] = i;
+            }
+        }
+    }
+
+    // Mark from the instructions with effects: jumps, labels, returns,
+    // calls and divisions that may trap, plus writes to anything that is
+    // not a temp or variable. A value they read keeps every write of it,
+    // and so on transitively; one sweep then drops the rest, however long
+    // the chains are.
+    std::vector<std::uint8_t> needed(code.size(), 0);
+    std::vector<std::uint8_t> valueNeeded(valueCount, 0);
+    std::vector<std::uint32_t> worklist;
+    for (std::uint32_t i = 0; i < code.size(); ++i) {
+        if (!producesValue(code[i].op) || mayTrap(program, code[i]) ||
+            (!dead[i] && valueOf(code[i].result) == UINT32_MAX)) {
+            needed[i] = 1;
+            worklist.push_back(i);
+        }
+    }
+    while (!worklist.empty()) {
+        const TACInstruction& instruction = code[worklist.back()];
+        worklist.pop_back();
+        for (Operand operand : { instruction.arg1, instruction.arg2 }) {
+            std::uint32_t value = valueOf(operand);
+            if (value == UINT32_MAX || valueNeeded[value]) {
+                continue;
+            }
+            valueNeeded[value] = 1;
+            for (std::uint32_t w = firstWriter[value];
+                 w < firstWriter[value + 1];
+                 ++w) {
+                std::uint32_t writer = writers[w];
+                if (!needed[writer]) {
+                    needed[writer] = 1;
+                    worklist.push_back(writer);
+                }
+            }
+        }
+    }
+
+    bool any = false;
+    for (std::uint32_t i = 0; i < code.size(); ++i) {
+        dead[i] = !needed[i];
+        any = any || dead[i];
+    }
+    return any ? eraseInstructions(code, dead) : 0;
+}
@@ -0,0 +1,43 @@
+#include "Diagnostics.hpp"
+#include <algorithm>
+#include <utility>
+
+void Diagnostics::error(std::uint32_t offset, std::string message)
+{
+    entries.push_back(Diagnostic{ offset, std::move(message) });
+}
+
+void Diagnostics::append(const Diagnostics& other)
+{
+    entries.insert(entries.end(), other.entries.begin(), other.entries.end());
+}
+
+std::string Diagnostics::format(const SourceMap& lines) const
+{
+    // Parse errors are recorded before the semantic ones of earlier lines
+    std::vector<const Diagnostic*> ordered;
+    ordered.reserve(entries.size());
+    for (const auto& entry : entries) {
+        ordered.push_back(&entry);
+    }
+    std::stable_sort(ordered.begin(),
+                     ordered.end(),
+                     [](const Diagnostic* a, const Diagnostic* b) {
+                         return a->offset < b->offset;
+                     });
+
+    std::string text;
+    for (const Diagnostic* entry : ordered) {
+        if (!text.empty()) {
+            text += '\n';
+        }
+        if (entry->offset != NoOffset) {
+            SourceLocation location = lines.locate(entry->offset);
+            text += std::to_string(location.line) + ':' +
+                    std::to_string(location.column) + ": ";
+        }
+        text += "error: ";
+        text += entry->message;
+    }
+    return text;
+}
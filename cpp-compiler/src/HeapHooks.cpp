@@ -0,0 +1,97 @@
+// Global operator new/delete replacements feeding HeapStats. Linked into
+// the cpp_compiler executable only, never into the tinycpp library, so
+// library users keep their own allocator.
+#include <cstdlib>
+#include <new>
+#include <malloc.h>
+#include "HeapStats.hpp"
+
+namespace {
+
+struct Install
+{
+    Install() noexcept { HeapStats::markAvailable(); }
+} install;
+
+void* allocate(std::size_t size) noexcept
+{
+    void* memory = std::malloc(size ? size : 1);
+    if (memory && HeapStats::enabled()) {
+        HeapStats::recordAllocation(malloc_usable_size(memory));
+    }
+    return memory;
+}
+
+void* allocateOrThrow(std::size_t size)
+{
+    while (true) {
+        if (void* memory = allocate(size)) {
+            return memory;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+void release(void* memory) noexcept
+{
+    if (memory && HeapStats::enabled()) {
+        HeapStats::recordRelease(malloc_usable_size(memory));
+    }
+    std::free(memory);
+}
+
+} // namespace
+
+void* operator new(std::size_t size)
+{
+    return allocateOrThrow(size);
+}
+
+void* operator new[](std::size_t size)
+{
+    return allocateOrThrow(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+    release(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+    release(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    release(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept
+{
+    release(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept
+{
+    release(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept
+{
+    release(memory);
+}
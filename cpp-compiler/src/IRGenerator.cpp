@@ -1,106 +1,414 @@
 // IntermediateCode.cpp
 #include "IRGenerator.hpp"
+#include <algorithm>
+#include <charconv>
+#include "ThreadPool.hpp"
+
+namespace {
+
+constexpr Opcode binaryOpcode(BinaryOp op) noexcept
+{
+    switch (op) {
+        case BinaryOp::Add:
+            return Opcode::Add;
+        case BinaryOp::Subtract:
+            return Opcode::Subtract;
+        case BinaryOp::Multiply:
+            return Opcode::Multiply;
+        case BinaryOp::Divide:
+            return Opcode::Divide;
+        case BinaryOp::Modulo:
+            return Opcode::Modulo;
+        case BinaryOp::LessThan:
+            return Opcode::LessThan;
+        case BinaryOp::GreaterThan:
+            return Opcode::GreaterThan;
+        case BinaryOp::Equal:
+            return Opcode::Equal;
+        case BinaryOp::NotEqual:
+            return Opcode::NotEqual;
+        case BinaryOp::And:
+            return Opcode::And;
+        case BinaryOp::Or:
+            return Opcode::Or;
+    }
+    return Opcode::Add;
+}
+
+} // namespace
 
 IRGenerator::IRGenerator(std::shared_ptr<Parser> parser)
   : parser(std::move(parser))
 {
 }
 
-std::vector<TACInstruction> IRGenerator::generateCode(const ASTNodePtr& ast)
+TACProgram& IRGenerator::generateCode(ASTNodePtr ast)
 {
-    code.reserve(100); // Reserve space to reduce reallocations
+    reset();
+    program.code.reserve(100); // Reserve space to reduce reallocations
 
-    if (auto block = std::dynamic_pointer_cast<BlockStatement>(ast)) {
-        for (const auto& stmt : block->getStatements()) {
-            generateStatement(stmt);
+    // Function names are taken before any label is, on either path, so
+    // no label is spelled like a function declared after it
+    const auto* unit = nodeCast<TranslationUnit>(ast);
+    if (unit) {
+        for (const Statement* stmt : unit->getStatements()) {
+            if (const auto* function = nodeCast<FunctionDeclaration>(stmt)) {
+                program.function(function->getName());
+            }
         }
-    } else {
-        generateStatement(std::dynamic_pointer_cast<Statement>(ast));
+    } else if (const auto* function = nodeCast<FunctionDeclaration>(ast)) {
+        program.function(function->getName());
+    }
+    if (unit && pool && pool->size() > 1 && unit->getStatements().size() > 1) {
+        generateConcurrently(*unit);
+    } else if (!ast->isExpression()) {
+        visitStatement(*static_cast<Statement*>(ast));
     }
-    return code;
+    return program;
 }
 
-void IRGenerator::generateStatement(const StatementPtr& stmt)
+void IRGenerator::generateConcurrently(const TranslationUnit& unit)
 {
-    if (auto varDecl = std::dynamic_pointer_cast<VariableDeclaration>(stmt)) {
-        std::string resultVar = varDecl->getName();
-        if (const auto& initializer = varDecl->getInitializer()) {
-            std::string tempVar;
-            generateExpression(initializer, tempVar);
-            code.emplace_back(
-              "MOV", std::move(tempVar), "", std::move(resultVar));
-        }
-    } else if (auto assignStmt =
-                 std::dynamic_pointer_cast<AssignmentStatement>(stmt)) {
-        std::string tempVar;
-        generateExpression(assignStmt->getValue(), tempVar);
-        code.emplace_back("MOV", std::move(tempVar), "", assignStmt->getName());
-    } else if (auto ifStmt = std::dynamic_pointer_cast<IfStatement>(stmt)) {
-        std::string conditionVar;
-        generateExpression(ifStmt->getCondition(), conditionVar);
-        code.emplace_back("IF_FALSE", std::move(conditionVar), "", "L1");
-
-        generateStatement(ifStmt->getThenBranch());
-        code.emplace_back("GOTO", "", "", "L2");
-
-        code.emplace_back("LABEL", "", "", "L1");
-        if (ifStmt->getElseBranch()) {
-            generateStatement(ifStmt->getElseBranch());
-        }
-        code.emplace_back("LABEL", "", "", "L2");
-    } else if (auto blockStmt =
-                 std::dynamic_pointer_cast<BlockStatement>(stmt)) {
-        for (const auto& innerStmt : blockStmt->getStatements()) {
-            generateStatement(innerStmt);
-        }
-    } else if (auto returnStmt =
-                 std::dynamic_pointer_cast<ReturnStatement>(stmt)) {
-        if (const auto& returnValue = returnStmt->getReturnValue()) {
-            std::string tempVar;
-            generateExpression(returnValue, tempVar);
-            code.emplace_back("RET", std::move(tempVar), "", "");
-        } else {
-            code.emplace_back("RET", "", "", "");
+    NodeList<StatementPtr> statements = unit.getStatements();
+    size_t chunks = std::min(statements.size(), size_t{ pool->size() } * 4);
+    while (runs.size() < chunks) {
+        runs.push_back(std::make_unique<IRGenerator>(parser));
+        runs.back()->localLabels = true;
+    }
+
+    pool->forEach(chunks, [&](size_t chunk) {
+        IRGenerator& run = *runs[chunk];
+        run.reset();
+        size_t end = (chunk + 1) * statements.size() / chunks;
+        for (size_t i = chunk * statements.size() / chunks; i < end; ++i) {
+            run.visitStatement(*statements[i]);
         }
-        return; // Stop processing further statements after a return
-    } else if (auto funcDecl =
-                 std::dynamic_pointer_cast<FunctionDeclaration>(stmt)) {
-        code.emplace_back("LABEL", "", "", funcDecl->getName());
-
-        for (const auto& bodyStmt : funcDecl->getBody()) {
-            generateStatement(bodyStmt);
-            if (!code.empty() && code.back().op == "RET") {
-                return;
-            }
+    });
+
+    size_t total = program.code.size();
+    for (size_t chunk = 0; chunk < chunks; ++chunk) {
+        total += runs[chunk]->program.code.size();
+    }
+    program.code.reserve(total);
+    for (size_t chunk = 0; chunk < chunks; ++chunk) {
+        append(runs[chunk]->program);
+    }
+}
+
+void IRGenerator::append(const TACProgram& run)
+{
+    // Strings are interned here in the order the run interned them, and a
+    // local label becomes a fresh label at the same point, so every label
+    // gets the number and spelling it would have had on one thread
+    const StringInterner& strings = run.getStrings();
+    remap.resize(strings.size());
+    for (Symbol i = 0; i < strings.size(); ++i) {
+        std::string_view text = strings.lookup(i);
+        Operand mapped = !text.empty() && text.front() == LocalLabelMark
+                           ? program.newLabel()
+                           : program.label(text);
+        remap[i] = mapped.index();
+    }
+
+    std::uint32_t tempBase = program.getTempCount();
+    auto map = [&](Operand operand) {
+        switch (operand.kind()) {
+            case Operand::Kind::Temp:
+                return Operand::make(Operand::Kind::Temp,
+                                     tempBase + operand.index());
+            case Operand::Kind::Variable:
+            case Operand::Kind::Constant:
+            case Operand::Kind::Label:
+            case Operand::Kind::Function:
+                return Operand::make(operand.kind(), remap[operand.index()]);
+            default:
+                return operand;
         }
+    };
+    for (TACInstruction instruction : run.code) {
+        instruction.arg1 = map(instruction.arg1);
+        instruction.arg2 = map(instruction.arg2);
+        instruction.result = map(instruction.result);
+        program.code.push_back(instruction);
+    }
+    program.setTempCount(tempBase + run.getTempCount());
+}
+
+Operand IRGenerator::newLabel()
+{
+    if (!localLabels) {
+        return program.newLabel();
+    }
+    char name[16] = { LocalLabelMark };
+    auto end =
+      std::to_chars(name + 1, name + sizeof(name), ++localLabelCount).ptr;
+    return program.label(
+      std::string_view(name, static_cast<size_t>(end - name)));
+}
+
+Operand IRGenerator::number(size_t value)
+{
+    char digits[24];
+    auto end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+    return program.constant(
+      std::string_view(digits, static_cast<size_t>(end - digits)));
+}
+
+Operand IRGenerator::variable(std::string_view name, std::uint32_t ordinal)
+{
+    if (ordinal == 0) {
+        return program.variable(name);
+    }
+    char digits[16];
+    auto end = std::to_chars(digits, digits + sizeof(digits), ordinal).ptr;
+    spelling.assign(name);
+    spelling += '.';
+    spelling.append(digits, end);
+    return program.variable(spelling);
+}
 
-        if (code.empty() || code.back().op != "RET") {
-            code.emplace_back("RET", "", "", "");
+void IRGenerator::emit(Opcode op,
+                       Operand arg1,
+                       Operand arg2,
+                       Operand result,
+                       TypeId type)
+{
+    program.code.emplace_back(op, arg1, arg2, result, type);
+}
+
+void IRGenerator::visit(const VariableDeclaration& stmt)
+{
+    if (const Expression* initializer = stmt.getInitializer()) {
+        Operand value = visitExpression(*initializer);
+        emit(Opcode::Mov,
+             value,
+             Operand(),
+             variable(stmt.getName(), stmt.getOrdinal()),
+             stmt.getType());
+    }
+}
+
+void IRGenerator::visit(const AssignmentStatement& stmt)
+{
+    Operand value = visitExpression(*stmt.getValue());
+    emit(Opcode::Mov,
+         value,
+         Operand(),
+         variable(stmt.getName(), stmt.getOrdinal()),
+         stmt.getTargetType());
+}
+
+void IRGenerator::visit(const IfStatement& stmt)
+{
+    // Both labels are taken up front, so nested ifs number after their
+    // parent
+    Operand elseLabel = newLabel();
+    Operand endLabel = newLabel();
+
+    Operand condition = visitExpression(*stmt.getCondition());
+    emit(Opcode::IfFalse,
+         condition,
+         Operand(),
+         elseLabel,
+         stmt.getCondition()->getType());
+
+    visitStatement(*stmt.getThenBranch());
+    emit(Opcode::Goto, Operand(), Operand(), endLabel);
+
+    emit(Opcode::Label, Operand(), Operand(), elseLabel);
+    if (stmt.getElseBranch()) {
+        visitStatement(*stmt.getElseBranch());
+    }
+    emit(Opcode::Label, Operand(), Operand(), endLabel);
+}
+
+// Loops test at the top and jump back to it: LABEL head, the condition,
+// IF_FALSE to the end, the body, GOTO head, LABEL end. The header is then
+// entered from one place outside the loop, the instruction before it,
+// which is where the loop passes put a preheader.
+void IRGenerator::visit(const WhileStatement& stmt)
+{
+    Operand headLabel = newLabel();
+    Operand endLabel = newLabel();
+
+    emit(Opcode::Label, Operand(), Operand(), headLabel);
+    Operand condition = visitExpression(*stmt.getCondition());
+    emit(Opcode::IfFalse,
+         condition,
+         Operand(),
+         endLabel,
+         stmt.getCondition()->getType());
+    visitStatement(*stmt.getBody());
+    emit(Opcode::Goto, Operand(), Operand(), headLabel);
+    emit(Opcode::Label, Operand(), Operand(), endLabel);
+}
+
+void IRGenerator::visit(const DoWhileStatement& stmt)
+{
+    Operand headLabel = newLabel();
+    Operand endLabel = newLabel();
+
+    emit(Opcode::Label, Operand(), Operand(), headLabel);
+    visitStatement(*stmt.getBody());
+    Operand condition = visitExpression(*stmt.getCondition());
+    emit(Opcode::IfFalse,
+         condition,
+         Operand(),
+         endLabel,
+         stmt.getCondition()->getType());
+    emit(Opcode::Goto, Operand(), Operand(), headLabel);
+    emit(Opcode::Label, Operand(), Operand(), endLabel);
+}
+
+void IRGenerator::visit(const ForStatement& stmt)
+{
+    Operand headLabel = newLabel();
+    Operand endLabel = newLabel();
+
+    if (stmt.getInitializer()) {
+        visitStatement(*stmt.getInitializer());
+    }
+    emit(Opcode::Label, Operand(), Operand(), headLabel);
+    if (const Expression* condition = stmt.getCondition()) {
+        emit(Opcode::IfFalse,
+             visitExpression(*condition),
+             Operand(),
+             endLabel,
+             condition->getType());
+    }
+    visitStatement(*stmt.getBody());
+    if (stmt.getUpdate()) {
+        visitStatement(*stmt.getUpdate());
+    }
+    emit(Opcode::Goto, Operand(), Operand(), headLabel);
+    // Without a condition nothing jumps to the end
+    if (stmt.getCondition()) {
+        emit(Opcode::Label, Operand(), Operand(), endLabel);
+    }
+}
+
+void IRGenerator::visit(const BlockStatement& stmt)
+{
+    for (const auto& innerStmt : stmt.getStatements()) {
+        visitStatement(*innerStmt);
+    }
+}
+
+void IRGenerator::visit(const ExpressionStatement& stmt)
+{
+    const Expression& expr = *stmt.getExpression();
+    if (const auto* callExpr = nodeCast<CallExpression>(&expr)) {
+        call(*callExpr, Operand());
+    } else {
+        visitExpression(expr);
+    }
+}
+
+void IRGenerator::visit(const ReturnStatement& stmt)
+{
+    if (const Expression* returnValue = stmt.getReturnValue()) {
+        Operand value = visitExpression(*returnValue);
+        // The backends convert an int returned from a float function
+        TypeId type = returnType != TypeId::Unknown ? returnType
+                                                    : returnValue->getType();
+        emit(Opcode::Ret, value, Operand(), Operand(), type);
+    } else {
+        emit(Opcode::Ret);
+    }
+}
+
+void IRGenerator::visit(const FunctionDeclaration& stmt)
+{
+    const auto& code = program.code;
+    emit(Opcode::Function,
+         Operand(),
+         Operand(),
+         program.function(stmt.getName()));
+    NodeList<Parameter> parameters = stmt.getParameters();
+    for (size_t i = 0; i < parameters.size(); ++i) {
+        emit(Opcode::Param,
+             number(i),
+             Operand(),
+             program.variable(parameters[i].name),
+             parameters[i].type);
+    }
+    returnType = stmt.getReturnType();
+
+    for (const auto& bodyStmt : stmt.getBody()) {
+        visitStatement(*bodyStmt);
+        if (!code.empty() && code.back().op == Opcode::Ret) {
+            break; // Stop processing further statements after a return
         }
     }
+
+    if (code.empty() || code.back().op != Opcode::Ret) {
+        emit(Opcode::Ret);
+    }
+    returnType = TypeId::Unknown;
+}
+
+Operand IRGenerator::visit(const BinaryExpression& expr)
+{
+    Operand left = visitExpression(*expr.getLeft());
+    Operand right = visitExpression(*expr.getRight());
+    Operand result = getNewTempVar();
+    emit(binaryOpcode(expr.getOperator()), left, right, result, expr.getType());
+    return result;
+}
+
+Operand IRGenerator::visit(const CallExpression& expr)
+{
+    Operand result = getNewTempVar();
+    call(expr, result);
+    return result;
 }
 
-void IRGenerator::generateExpression(const ExpressionPtr& expr,
-                                     std::string& resultVar)
+void IRGenerator::call(const CallExpression& expr, Operand result)
 {
-    if (auto binExpr = std::dynamic_pointer_cast<BinaryExpression>(expr)) {
-        std::string leftVar, rightVar;
-        generateExpression(binExpr->getLeft(), leftVar);
-        generateExpression(binExpr->getRight(), rightVar);
-        resultVar = getNewTempVar();
-        code.emplace_back(
-          binExpr->getOp(), std::move(leftVar), std::move(rightVar), resultVar);
-    } else if (auto litExpr =
-                 std::dynamic_pointer_cast<LiteralExpression>(expr)) {
-        resultVar = litExpr->getValue();
-    } else if (auto varExpr =
-                 std::dynamic_pointer_cast<VariableExpression>(expr)) {
-        resultVar = varExpr->getName();
+    const FunctionDeclaration& callee = *expr.getFunction();
+    NodeList<ExpressionPtr> values = expr.getArguments();
+    size_t first = arguments.size();
+    for (const Expression* value : values) {
+        Operand operand = visitExpression(*value);
+        arguments.push_back(operand);
     }
-    // Handle other expression types similarly
+
+    // ARG carries the parameter's type; the backends convert an int passed
+    // for a float
+    NodeList<Parameter> parameters = callee.getParameters();
+    for (size_t i = 0; i < values.size(); ++i) {
+        emit(Opcode::Arg,
+             arguments[first + i],
+             Operand(),
+             Operand(),
+             parameters[i].type);
+    }
+    arguments.resize(first);
+    emit(Opcode::Call,
+         program.function(callee.getName()),
+         number(values.size()),
+         result,
+         callee.getReturnType());
 }
 
-std::string IRGenerator::getNewTempVar() noexcept
+Operand IRGenerator::visit(const LiteralExpression& expr)
 {
-    return "t" + std::to_string(tempVarCount++);
-}
\ No newline at end of file
+    return program.constant(expr.getValue());
+}
+
+Operand IRGenerator::visit(const VariableExpression& expr)
+{
+    return variable(expr.getName(), expr.getOrdinal());
+}
+
+Operand IRGenerator::getNewTempVar() noexcept
+{
+    return program.newTemp();
+}
+
+void IRGenerator::visit(const TranslationUnit& unit)
+{
+    for (const auto& inner : unit.getStatements()) {
+        visitStatement(*inner);
+    }
+}
@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "ControlFlowGraph.hpp"
+#include "Optimizer.hpp"
+
+namespace {
+
+constexpr std::uint32_t None = UINT32_MAX;
+
+// Most instructions a body may hold, besides its LABEL, PARAMs and final
+// RET, to be copied into its callers. A call costs an ARG per argument,
+// the CALL and a frame set up and torn down, so bodies this small are
+// cheaper copied than called, and accessor-sized ones shrink the caller.
+constexpr size_t InlineLimit = 12;
+
+struct Function
+{
+    // PARAMs in [parameters, body), then the body up to `end`
+    std::uint32_t parameters;
+    std::uint32_t body;
+    std::uint32_t end;
+    bool inlinable;
+};
+
+// Renames the temps, variables and labels of one copy of a body: each
+// stamp says which copy its entry belongs to
+class Renaming
+{
+public:
+    explicit Renaming(TACProgram& program)
+      : program(program)
+      , temps(program.getTempCount())
+      , variables(program.getStrings().size())
+      , labels(program.getStrings().size())
+    {
+    }
+
+    void next() noexcept { ++copy; }
+
+    Operand operator()(Operand operand)
+    {
+        switch (operand.kind()) {
+            case Operand::Kind::Temp:
+                return rename(temps, operand, [this](Operand) {
+                    return program.newTemp();
+                });
+            case Operand::Kind::Variable:
+                return rename(variables, operand, [this](Operand original) {
+                    return program.newVariable(program.text(original));
+                });
+            case Operand::Kind::Label:
+                return rename(labels, operand, [this](Operand) {
+                    return program.newLabel();
+                });
+            default:
+                return operand;
+        }
+    }
+
+private:
+    struct Entry
+    {
+        Operand renamed;
+        std::uint32_t copy = 0;
+    };
+
+    TACProgram& program;
+    std::vector<Entry> temps;
+    std::vector<Entry> variables;
+    std::vector<Entry> labels;
+    std::uint32_t copy = 0;
+
+    template<typename Make>
+    Operand rename(std::vector<Entry>& entries, Operand operand, Make make)
+    {
+        if (operand.index() >= entries.size()) {
+            return operand;
+        }
+        Entry& entry = entries[operand.index()];
+        if (entry.copy != copy) {
+            entry = { make(operand), copy };
+        }
+        return entry.renamed;
+    }
+};
+
+} // namespace
+
+size_t inlineCalls(TACProgram& program)
+{
+    const auto& code = program.code;
+    auto isCall = [](const TACInstruction& instruction) {
+        return instruction.op == Opcode::Call;
+    };
+    if (std::none_of(code.begin(), code.end(), isCall)) {
+        return 0;
+    }
+
+    // Functions by the string index of their name
+    std::vector<Function> functions;
+    std::vector<std::uint32_t> functionOf(program.getStrings().size(), None);
+    {
+        ControlFlowGraph graph(program);
+        std::vector<std::uint32_t> starts;
+        for (BlockId entry : graph.getEntries()) {
+            starts.push_back(graph.block(entry).begin);
+        }
+        std::sort(starts.begin(), starts.end());
+        starts.push_back(static_cast<std::uint32_t>(code.size()));
+
+        for (size_t i = 0; i + 1 < starts.size(); ++i) {
+            std::uint32_t begin = starts[i];
+            std::uint32_t end = starts[i + 1];
+            if (code[begin].op != Opcode::Function) {
+                continue;
+            }
+            std::uint32_t body = begin + 1;
+            while (body < end && code[body].op == Opcode::Param) {
+                ++body;
+            }
+            bool leaf =
+              std::none_of(code.begin() + body, code.begin() + end, isCall);
+            size_t cost = end - body;
+            if (cost > 0 && code[end - 1].op == Opcode::Ret) {
+                --cost;
+            }
+            functionOf[code[begin].result.index()] =
+              static_cast<std::uint32_t>(functions.size());
+            functions.push_back(
+              { begin + 1, body, end, leaf && cost <= InlineLimit });
+        }
+    }
+
+    std::vector<TACInstruction> out;
+    out.reserve(code.size());
+    Renaming rename(program);
+    size_t inlined = 0;
+    for (const TACInstruction& call : code) {
+        std::uint32_t index = call.op == Opcode::Call
+                                ? functionOf[call.arg1.index()]
+                                : None;
+        if (index == None || !functions[index].inlinable) {
+            out.push_back(call);
+            continue;
+        }
+        const Function& callee = functions[index];
+        size_t count = callee.body - callee.parameters;
+        auto first = out.end() - static_cast<std::ptrdiff_t>(
+                                   std::min(count, out.size()));
+        if (out.size() < count ||
+            !std::all_of(first, out.end(), [](const TACInstruction& arg) {
+                return arg.op == Opcode::Arg;
+            })) {
+            out.push_back(call);
+            continue;
+        }
+
+        // The ARGs become MOVs into copies of the parameters, and each RET
+        // a MOV of its value into the call's result and a jump past the
+        // copy
+        rename.next();
+        std::vector<TACInstruction> arguments(first, out.end());
+        out.erase(first, out.end());
+        for (size_t k = 0; k < count; ++k) {
+            const TACInstruction& parameter = code[callee.parameters + k];
+            out.push_back(TACInstruction(Opcode::Mov,
+                                         arguments[k].arg1,
+                                         Operand(),
+                                         rename(parameter.result),
+                                         parameter.type));
+        }
+        Operand end;
+        for (std::uint32_t i = callee.body; i < callee.end; ++i) {
+            const TACInstruction& instruction = code[i];
+            if (instruction.op != Opcode::Ret) {
+                out.push_back(TACInstruction(instruction.op,
+                                             rename(instruction.arg1),
+                                             rename(instruction.arg2),
+                                             rename(instruction.result),
+                                             instruction.type));
+                continue;
+            }
+            Operand value = instruction.arg1;
+            if (value.isNone() && call.type != TypeId::String) {
+                // What the backends return from a RET without a value
+                value = program.constant("0");
+            }
+            if (!call.result.isNone() && !value.isNone()) {
+                out.push_back(TACInstruction(Opcode::Mov,
+                                             rename(value),
+                                             Operand(),
+                                             call.result,
+                                             call.type));
+            }
+            if (i + 1 < callee.end) {
+                if (end.isNone()) {
+                    end = program.newLabel();
+                }
+                out.push_back(
+                  TACInstruction(Opcode::Goto, Operand(), Operand(), end));
+            }
+        }
+        if (!end.isNone()) {
+            out.push_back(
+              TACInstruction(Opcode::Label, Operand(), Operand(), end));
+        }
+        ++inlined;
+    }
+
+    if (inlined > 0) {
+        program.code.swap(out);
+    }
+    return inlined;
+}
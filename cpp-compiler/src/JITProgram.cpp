@@ -0,0 +1,865 @@
+#include "JITProgram.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "ControlFlowGraph.hpp"
+#include "NativeTypes.hpp"
+
+namespace {
+
+constexpr std::uint32_t None = UINT32_MAX;
+
+// Register numbers as the ModRM byte encodes them
+constexpr std::uint8_t Rax = 0;
+constexpr std::uint8_t Rcx = 1;
+constexpr std::uint8_t Rdx = 2;
+constexpr std::uint8_t Xmm0 = 0;
+constexpr std::uint8_t Xmm1 = 1;
+
+// What the entry stub is called with. Running code keeps it in rbx; a
+// division check that fails stores its fault and unwinds to the stub by
+// restoring `stack`, the stub's rsp at its call into main.
+struct Trap
+{
+    void* stack = nullptr;
+    std::int32_t fault = 0;
+};
+
+static_assert(offsetof(Trap, stack) == 0 && offsetof(Trap, fault) == 8,
+              "the trap stubs address Trap's fields directly");
+
+enum Fault : std::int32_t
+{
+    NoFault,
+    DivisionByZero,
+    DivisionOverflow
+};
+
+// Condition codes of setcc and jcc
+enum Condition : std::uint8_t
+{
+    Parity = 0xA,
+    NoParity = 0xB,
+    Equal = 0x4,
+    NotEqual = 0x5,
+    Above = 0x7,
+    Less = 0xC,
+    Greater = 0xF
+};
+
+// Appends instruction bytes. Memory operands are always [rbp+disp32] and
+// register operands are the low eight, so no instruction needs REX.R/B.
+class Encoder
+{
+public:
+    std::vector<std::uint8_t> bytes;
+
+    size_t position() const noexcept { return bytes.size(); }
+
+    void emit(std::initializer_list<std::uint8_t> opcode)
+    {
+        bytes.insert(bytes.end(), opcode.begin(), opcode.end());
+    }
+
+    void imm32(std::int32_t value)
+    {
+        std::uint8_t raw[4];
+        std::memcpy(raw, &value, sizeof(raw));
+        bytes.insert(bytes.end(), raw, raw + sizeof(raw));
+    }
+
+    void imm64(std::uint64_t value)
+    {
+        std::uint8_t raw[8];
+        std::memcpy(raw, &value, sizeof(raw));
+        bytes.insert(bytes.end(), raw, raw + sizeof(raw));
+    }
+
+    void patch32(size_t at, std::int32_t value)
+    {
+        std::memcpy(bytes.data() + at, &value, sizeof(value));
+    }
+
+    // opcode reg, [rbp+disp]
+    void memory(std::initializer_list<std::uint8_t> opcode,
+                std::uint8_t reg,
+                std::int32_t disp)
+    {
+        emit(opcode);
+        bytes.push_back(static_cast<std::uint8_t>(0x85 | reg << 3));
+        imm32(disp);
+    }
+
+    // opcode reg, rm with both registers
+    void direct(std::initializer_list<std::uint8_t> opcode,
+                std::uint8_t reg,
+                std::uint8_t rm)
+    {
+        emit(opcode);
+        bytes.push_back(static_cast<std::uint8_t>(0xC0 | reg << 3 | rm));
+    }
+
+    void setcc(Condition condition, std::uint8_t reg8)
+    {
+        direct({ 0x0F, static_cast<std::uint8_t>(0x90 | condition) }, 0, reg8);
+    }
+};
+
+// Lowers one program onto an Encoder; the same walk as X86Writer without
+// its instruction selection, since here the cost that matters is the time
+// to produce code
+class Lowering
+{
+public:
+    explicit Lowering(const TACProgram& program);
+
+    // Code followed by the string data; `entry` is the offset of the stub
+    // that takes a Trap* and calls main
+    std::vector<std::uint8_t> run(size_t& entry);
+
+private:
+    const TACProgram& program;
+    std::uint32_t tempCount;
+    std::uint32_t stringCount;
+    Encoder code;
+
+    std::vector<TypeId> types;
+    std::vector<std::uint32_t> frameOffsets;
+    std::vector<std::uint32_t> frameStamps;
+    std::uint32_t function = 0;
+    bool returnsInt = false;
+    // ARGs of the call being lowered
+    std::vector<const TACInstruction*> arguments;
+
+    // Label and function positions by string index, and the rel32 fields
+    // that jump to or call them
+    std::vector<std::uint32_t> labels;
+    std::vector<std::uint32_t> functions;
+    std::vector<std::pair<size_t, Operand>> jumps;
+    // lea rax, [rip+disp32] fields for each string literal
+    std::vector<std::pair<size_t, std::uint32_t>> strings;
+    // Stubs that set a Fault and unwind, which idiv checks jump to
+    size_t divisionByZero = 0;
+    size_t divisionOverflow = 0;
+
+    size_t emitEntry();
+
+    std::uint32_t slotIndex(Operand operand) const noexcept;
+    TypeId typeOf(Operand operand) const;
+    std::int32_t disp(Operand operand) const;
+
+    void lowerFunction(std::uint32_t begin, std::uint32_t end);
+    void lower(const TACInstruction& instruction);
+    void lowerMove(const TACInstruction& instruction);
+    void lowerComparison(const TACInstruction& instruction);
+    void lowerBranch(const TACInstruction& instruction);
+    void lowerParameter(const TACInstruction& instruction);
+    void lowerCall(const TACInstruction& instruction);
+    void lowerReturn(const TACInstruction& instruction);
+    void jump(std::initializer_list<std::uint8_t> opcode, Operand target);
+    void jump(std::initializer_list<std::uint8_t> opcode, size_t target);
+
+    void loadInt(std::uint8_t reg, Operand operand);
+    void loadFloat(std::uint8_t xmm, Operand operand);
+    void loadTruth(std::uint8_t reg, Operand operand);
+    void loadPointer(Operand operand);
+    void storeInt(Operand result, std::uint8_t reg, TypeId from);
+    void storeFloat(Operand result);
+    void storeBool(Operand result);
+};
+
+Lowering::Lowering(const TACProgram& program)
+  : program(program)
+  , tempCount(program.getTempCount())
+  , stringCount(static_cast<std::uint32_t>(program.getStrings().size()))
+{
+    size_t values = tempCount + stringCount + program.getSlotCount();
+    types.assign(values, TypeId::Unknown);
+    frameOffsets.assign(values, 0);
+    frameStamps.assign(values, 0);
+    labels.assign(stringCount, None);
+    functions.assign(stringCount, None);
+}
+
+std::vector<std::uint8_t> Lowering::run(size_t& entry)
+{
+    const auto& instructions = program.code;
+    entry = 0;
+    if (!instructions.empty()) {
+        size_t mainCall = emitEntry();
+        std::uint32_t mainPosition = None;
+        ControlFlowGraph graph(program);
+        std::vector<std::uint32_t> starts;
+        for (BlockId id : graph.getEntries()) {
+            starts.push_back(graph.block(id).begin);
+        }
+        std::sort(starts.begin(), starts.end());
+        starts.push_back(static_cast<std::uint32_t>(instructions.size()));
+
+        for (size_t i = 0; i + 1 < starts.size(); ++i) {
+            const TACInstruction& first = instructions[starts[i]];
+            std::string_view name = first.op == Opcode::Function
+                                      ? program.text(first.result)
+                                      : std::string_view("main");
+            returnsInt = name == "main";
+            if (returnsInt || mainPosition == None) {
+                mainPosition = static_cast<std::uint32_t>(code.position());
+            }
+            lowerFunction(starts[i], starts[i + 1]);
+        }
+        code.patch32(mainCall,
+                     static_cast<std::int32_t>(mainPosition - (mainCall + 4)));
+    }
+
+    for (const auto& [at, target] : jumps) {
+        bool call = target.is(Operand::Kind::Function);
+        std::uint32_t position =
+          (call ? functions : labels)[target.index()];
+        if (position == None) {
+            throw std::runtime_error(
+              (call ? "Call to undefined function: "
+                    : "Jump to undefined label: ") +
+              std::string(program.text(target)));
+        }
+        code.patch32(at, static_cast<std::int32_t>(position - (at + 4)));
+    }
+
+    // String literals follow the code, without their quotes
+    std::vector<std::uint32_t> placed(stringCount, None);
+    for (const auto& [at, literal] : strings) {
+        if (placed[literal] == None) {
+            placed[literal] = static_cast<std::uint32_t>(code.position());
+            std::string_view text = program.text(
+              Operand::make(Operand::Kind::Constant, literal));
+            text = text.substr(1, text.size() - 2);
+            auto& bytes = code.bytes;
+            bytes.insert(bytes.end(), text.begin(), text.end());
+            bytes.push_back(0);
+        }
+        code.patch32(
+          at, static_cast<std::int32_t>(placed[literal] - (at + 4)));
+    }
+    return std::move(code.bytes);
+}
+
+// The entry stub calls main with rbx pointing at the Trap, and the fault
+// stubs come right after it, so every division check jumps backwards to a
+// known position. Returns the call's rel32 field.
+size_t Lowering::emitEntry()
+{
+    // push rbp; push rbx; sub rsp, 8; mov rbx, rdi; mov [rbx], rsp
+    code.emit({ 0x55, 0x53, 0x48, 0x83, 0xEC, 0x08 });
+    code.emit({ 0x48, 0x89, 0xFB, 0x48, 0x89, 0x23 });
+    // call main
+    code.emit({ 0xE8 });
+    size_t mainCall = code.position();
+    code.imm32(0);
+    size_t resume = code.position();
+    // add rsp, 8; pop rbx; pop rbp; ret
+    code.emit({ 0x48, 0x83, 0xC4, 0x08, 0x5B, 0x5D, 0xC3 });
+
+    // mov [rbx+8], eax; mov rsp, [rbx]; jmp resume
+    size_t trap = code.position();
+    code.emit({ 0x89, 0x43, 0x08, 0x48, 0x8B, 0x23 });
+    jump({ 0xE9 }, resume);
+
+    // mov eax, fault; jmp trap
+    divisionByZero = code.position();
+    code.emit({ static_cast<std::uint8_t>(0xB8 | Rax) });
+    code.imm32(DivisionByZero);
+    jump({ 0xE9 }, trap);
+    divisionOverflow = code.position();
+    code.emit({ static_cast<std::uint8_t>(0xB8 | Rax) });
+    code.imm32(DivisionOverflow);
+    jump({ 0xE9 }, trap);
+    return mainCall;
+}
+
+std::uint32_t Lowering::slotIndex(Operand operand) const noexcept
+{
+    switch (operand.kind()) {
+        case Operand::Kind::Temp:
+            return operand.index() < tempCount ? operand.index() : None;
+        case Operand::Kind::Variable:
+            return tempCount + operand.index();
+        case Operand::Kind::Slot:
+            return operand.index() < program.getSlotCount()
+                     ? tempCount + stringCount + operand.index()
+                     : None;
+        default:
+            return None;
+    }
+}
+
+TypeId Lowering::typeOf(Operand operand) const
+{
+    TypeId type = TypeId::Unknown;
+    if (operand.is(Operand::Kind::Constant)) {
+        type = literalType(program.text(operand));
+    } else if (std::uint32_t index = slotIndex(operand); index != None) {
+        type = types[index];
+    }
+    return type == TypeId::Unknown ? TypeId::Int : type;
+}
+
+std::int32_t Lowering::disp(Operand operand) const
+{
+    std::uint32_t index = slotIndex(operand);
+    if (index == None) {
+        throw std::runtime_error("The JIT cannot place operand");
+    }
+    return -8 * static_cast<std::int32_t>(frameOffsets[index]);
+}
+
+void Lowering::lowerFunction(std::uint32_t begin, std::uint32_t end)
+{
+    const auto& instructions = program.code;
+    ++function;
+    declareVariables(program, begin, end, types, tempCount);
+
+    std::uint32_t slots = 0;
+    for (std::uint32_t i = begin; i < end; ++i) {
+        const TACInstruction& instruction = instructions[i];
+        for (Operand operand :
+             { instruction.arg1, instruction.arg2, instruction.result }) {
+            if (operand.is(Operand::Kind::Register)) {
+                throw std::runtime_error(
+                  "The JIT runs TAC before register allocation; drop "
+                  "--registers");
+            }
+            std::uint32_t index = slotIndex(operand);
+            if (index != None && frameStamps[index] != function) {
+                frameStamps[index] = function;
+                frameOffsets[index] = ++slots;
+            }
+        }
+    }
+
+    // Calls land on the prologue
+    if (instructions[begin].op == Opcode::Function) {
+        functions[instructions[begin].result.index()] =
+          static_cast<std::uint32_t>(code.position());
+    }
+    // push rbp; mov rbp, rsp; sub rsp, frame
+    code.emit({ 0x55, 0x48, 0x89, 0xE5 });
+    code.emit({ 0x48, 0x81, 0xEC });
+    code.imm32(static_cast<std::int32_t>(8 * (slots + slots % 2)));
+
+    for (std::uint32_t i = begin; i < end; ++i) {
+        if (i == begin && instructions[i].op == Opcode::Function) {
+            continue;
+        }
+        lower(instructions[i]);
+    }
+}
+
+void Lowering::lower(const TACInstruction& instruction)
+{
+    Operand left = instruction.arg1;
+    Operand right = instruction.arg2;
+    Operand result = instruction.result;
+    TypeId produced = producedType(instruction, typeOf(left), typeOf(right));
+
+    switch (instruction.op) {
+        case Opcode::Mov:
+            lowerMove(instruction);
+            break;
+        case Opcode::Add:
+        case Opcode::Subtract:
+        case Opcode::Multiply:
+        case Opcode::Divide:
+        case Opcode::Modulo:
+            if (produced == TypeId::String) {
+                throw std::runtime_error(
+                  "The JIT has no lowering for string arithmetic");
+            }
+            if (produced == TypeId::Float) {
+                if (instruction.op == Opcode::Modulo) {
+                    throw std::runtime_error(
+                      "The JIT has no lowering for float %");
+                }
+                static constexpr std::uint8_t Operations[] = {
+                    0x58, 0x5C, 0x59, 0x5E
+                };
+                std::uint8_t operation = Operations[static_cast<int>(
+                  instruction.op) - static_cast<int>(Opcode::Add)];
+                loadFloat(Xmm0, left);
+                loadFloat(Xmm1, right);
+                code.direct({ 0xF2, 0x0F, operation }, Xmm0, Xmm1);
+                storeFloat(result);
+                break;
+            }
+            loadInt(Rax, left);
+            loadInt(Rcx, right);
+            switch (instruction.op) {
+                case Opcode::Add:
+                    code.direct({ 0x03 }, Rax, Rcx);
+                    break;
+                case Opcode::Subtract:
+                    code.direct({ 0x2B }, Rax, Rcx);
+                    break;
+                case Opcode::Multiply:
+                    code.direct({ 0x0F, 0xAF }, Rax, Rcx);
+                    break;
+                default:
+                    // idiv would raise SIGFPE in the compiler, so fault
+                    // the way the interpreter does:
+                    // test ecx, ecx; jz divisionByZero
+                    code.direct({ 0x85 }, Rcx, Rcx);
+                    jump({ 0x0F, 0x84 }, divisionByZero);
+                    // cmp ecx, -1; jne +11; cmp eax, INT32_MIN;
+                    // je divisionOverflow
+                    code.emit({ 0x83, 0xF9, 0xFF, 0x75, 0x0B, 0x3D });
+                    code.imm32(INT32_MIN);
+                    jump({ 0x0F, 0x84 }, divisionOverflow);
+                    // cdq; idiv ecx
+                    code.emit({ 0x99 });
+                    code.direct({ 0xF7 }, 7, Rcx);
+                    break;
+            }
+            storeInt(result,
+                     instruction.op == Opcode::Modulo ? Rdx : Rax,
+                     TypeId::Int);
+            break;
+        case Opcode::LessThan:
+        case Opcode::GreaterThan:
+        case Opcode::Equal:
+        case Opcode::NotEqual:
+            lowerComparison(instruction);
+            break;
+        case Opcode::And:
+        case Opcode::Or:
+            if (typeOf(left) == TypeId::String ||
+                typeOf(right) == TypeId::String) {
+                throw std::runtime_error(
+                  "The JIT has no lowering for strings in && or ||");
+            }
+            loadTruth(Rax, left);
+            loadTruth(Rcx, right);
+            // and/or al, cl
+            code.direct({ instruction.op == Opcode::And ? std::uint8_t(0x20)
+                                                        : std::uint8_t(0x08) },
+                        Rcx,
+                        Rax);
+            storeBool(result);
+            break;
+        case Opcode::IfFalse:
+            lowerBranch(instruction);
+            break;
+        case Opcode::Goto:
+            jump({ 0xE9 }, result);
+            break;
+        case Opcode::Label:
+            labels[result.index()] =
+              static_cast<std::uint32_t>(code.position());
+            break;
+        case Opcode::Function:
+            // Only ever first, placed ahead of the prologue
+            break;
+        case Opcode::Ret:
+            lowerReturn(instruction);
+            break;
+        case Opcode::Param:
+            lowerParameter(instruction);
+            break;
+        case Opcode::Arg:
+            arguments.push_back(&instruction);
+            break;
+        case Opcode::Call:
+            lowerCall(instruction);
+            break;
+    }
+
+    if (instruction.op != Opcode::IfFalse && instruction.op != Opcode::Goto &&
+        instruction.op != Opcode::Label && instruction.op != Opcode::Ret &&
+        !result.is(Operand::Kind::Variable)) {
+        if (std::uint32_t index = slotIndex(result); index != None) {
+            types[index] = produced;
+        }
+    }
+}
+
+void Lowering::lowerMove(const TACInstruction& instruction)
+{
+    Operand source = instruction.arg1;
+    Operand result = instruction.result;
+    TypeId from = typeOf(source);
+    TypeId target = result.is(Operand::Kind::Variable)
+                      ? typeOf(result)
+                      : producedType(instruction, from, TypeId::Unknown);
+
+    if (target == TypeId::String || from == TypeId::String) {
+        loadPointer(source);
+        storeInt(result, Rax, TypeId::String);
+    } else if (target == TypeId::Float) {
+        loadFloat(Xmm0, source);
+        storeFloat(result);
+    } else if (target == TypeId::Bool && from == TypeId::Float) {
+        loadTruth(Rax, source);
+        storeInt(result, Rax, TypeId::Bool);
+    } else {
+        loadInt(Rax, source);
+        storeInt(result, Rax, from == TypeId::Float ? TypeId::Int : from);
+    }
+}
+
+void Lowering::lowerComparison(const TACInstruction& instruction)
+{
+    Operand left = instruction.arg1;
+    Operand right = instruction.arg2;
+    if (typeOf(left) == TypeId::String || typeOf(right) == TypeId::String) {
+        throw std::runtime_error(
+          "The JIT has no lowering for string comparison");
+    }
+    Opcode op = instruction.op;
+
+    if (instruction.type == TypeId::Float || typeOf(left) == TypeId::Float ||
+        typeOf(right) == TypeId::Float) {
+        // a < b is tested as b > a so that unordered compares false
+        if (op == Opcode::LessThan) {
+            std::swap(left, right);
+        }
+        loadFloat(Xmm0, left);
+        loadFloat(Xmm1, right);
+        // ucomisd xmm0, xmm1
+        code.direct({ 0x66, 0x0F, 0x2E }, Xmm0, Xmm1);
+        if (op == Opcode::Equal) {
+            code.setcc(Equal, Rax);
+            code.setcc(NoParity, Rcx);
+            code.direct({ 0x20 }, Rcx, Rax);
+        } else if (op == Opcode::NotEqual) {
+            code.setcc(NotEqual, Rax);
+            code.setcc(Parity, Rcx);
+            code.direct({ 0x08 }, Rcx, Rax);
+        } else {
+            code.setcc(Above, Rax);
+        }
+    } else {
+        loadInt(Rax, left);
+        loadInt(Rcx, right);
+        // cmp eax, ecx
+        code.direct({ 0x3B }, Rax, Rcx);
+        code.setcc(op == Opcode::LessThan      ? Less
+                   : op == Opcode::GreaterThan ? Greater
+                   : op == Opcode::Equal       ? Equal
+                                               : NotEqual,
+                   Rax);
+    }
+    // movzx eax, al
+    code.direct({ 0x0F, 0xB6 }, Rax, Rax);
+    storeInt(instruction.result, Rax, TypeId::Bool);
+}
+
+void Lowering::lowerBranch(const TACInstruction& instruction)
+{
+    Operand condition = instruction.arg1;
+    if (condition.is(Operand::Kind::Constant)) {
+        std::string_view text = program.text(condition);
+        if (literalType(text) != TypeId::String && literalFloat(text) == 0.0) {
+            jump({ 0xE9 }, instruction.result);
+        }
+        return;
+    }
+    if (typeOf(condition) == TypeId::Float) {
+        loadTruth(Rax, condition);
+    } else {
+        loadInt(Rax, condition);
+    }
+    // test eax, eax; je
+    code.direct({ 0x85 }, Rax, Rax);
+    jump({ 0x0F, 0x84 }, instruction.result);
+}
+
+void Lowering::lowerParameter(const TACInstruction& instruction)
+{
+    // Argument k is at [rbp+16+8k], above the return address and rbp
+    std::int32_t at =
+      16 + 8 * static_cast<std::int32_t>(
+                 literalInteger(program.text(instruction.arg1)));
+    if (instruction.type == TypeId::Float) {
+        code.memory({ 0xF2, 0x0F, 0x10 }, Xmm0, at);
+        storeFloat(instruction.result);
+    } else if (instruction.type == TypeId::String) {
+        code.memory({ 0x48, 0x8B }, Rax, at);
+        storeInt(instruction.result, Rax, TypeId::String);
+    } else {
+        code.memory({ 0x8B }, Rax, at);
+        storeInt(instruction.result, Rax, instruction.type);
+    }
+}
+
+void Lowering::lowerCall(const TACInstruction& instruction)
+{
+    // Every argument goes on the stack, the first lowest, with rsp kept
+    // 16-byte aligned at the call
+    size_t count = arguments.size();
+    if (count % 2 != 0) {
+        // sub rsp, 8
+        code.emit({ 0x48, 0x83, 0xEC, 0x08 });
+    }
+    for (size_t i = count; i-- > 0;) {
+        const TACInstruction& argument = *arguments[i];
+        if (argument.type == TypeId::Float) {
+            // movq rax, xmm0
+            loadFloat(Xmm0, argument.arg1);
+            code.direct({ 0x66, 0x48, 0x0F, 0x7E }, Xmm0, Rax);
+        } else if (argument.type == TypeId::String) {
+            loadPointer(argument.arg1);
+        } else {
+            loadInt(Rax, argument.arg1);
+        }
+        // push rax
+        code.emit({ 0x50 });
+    }
+    arguments.clear();
+
+    jump({ 0xE8 }, instruction.arg1);
+    if (count > 0) {
+        // add rsp, imm32
+        code.emit({ 0x48, 0x81, 0xC4 });
+        code.imm32(static_cast<std::int32_t>(8 * (count + count % 2)));
+    }
+
+    Operand result = instruction.result;
+    if (result.isNone()) {
+        return;
+    }
+    TypeId type = producedType(instruction, TypeId::Unknown, TypeId::Unknown);
+    if (type == TypeId::Float) {
+        storeFloat(result);
+    } else {
+        storeInt(result, Rax, type);
+    }
+}
+
+void Lowering::lowerReturn(const TACInstruction& instruction)
+{
+    Operand value = instruction.arg1;
+    TypeId type =
+      instruction.type != TypeId::Unknown ? instruction.type : typeOf(value);
+    if (value.isNone()) {
+        code.direct({ 0x31 }, Rax, Rax);
+    } else if (type == TypeId::String) {
+        loadPointer(value);
+    } else if (type == TypeId::Float && !returnsInt) {
+        loadFloat(Xmm0, value);
+    } else {
+        loadInt(Rax, value);
+    }
+    // leave; ret
+    code.emit({ 0xC9, 0xC3 });
+}
+
+void Lowering::jump(std::initializer_list<std::uint8_t> opcode, Operand target)
+{
+    code.emit(opcode);
+    jumps.push_back({ code.position(), target });
+    code.imm32(0);
+}
+
+// To a position already placed
+void Lowering::jump(std::initializer_list<std::uint8_t> opcode, size_t target)
+{
+    code.emit(opcode);
+    code.imm32(static_cast<std::int32_t>(target - (code.position() + 4)));
+}
+
+void Lowering::loadInt(std::uint8_t reg, Operand operand)
+{
+    if (operand.is(Operand::Kind::Constant)) {
+        // mov r32, imm32
+        code.emit({ static_cast<std::uint8_t>(0xB8 | reg) });
+        code.imm32(
+          static_cast<std::int32_t>(literalInteger(program.text(operand))));
+    } else if (typeOf(operand) == TypeId::Float) {
+        // movsd xmm0, [slot]; cvttsd2si r32, xmm0
+        code.memory({ 0xF2, 0x0F, 0x10 }, Xmm0, disp(operand));
+        code.direct({ 0xF2, 0x0F, 0x2C }, reg, Xmm0);
+    } else {
+        code.memory({ 0x8B }, reg, disp(operand));
+    }
+}
+
+void Lowering::loadFloat(std::uint8_t xmm, Operand operand)
+{
+    if (operand.is(Operand::Kind::Constant)) {
+        double value = literalFloat(program.text(operand));
+        std::uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        // mov rax, imm64; movq xmm, rax
+        code.emit({ 0x48, 0xB8 });
+        code.imm64(bits);
+        code.direct({ 0x66, 0x48, 0x0F, 0x6E }, xmm, Rax);
+    } else if (typeOf(operand) == TypeId::Float) {
+        code.memory({ 0xF2, 0x0F, 0x10 }, xmm, disp(operand));
+    } else {
+        // cvtsi2sd xmm, DWORD PTR [slot]
+        code.memory({ 0xF2, 0x0F, 0x2A }, xmm, disp(operand));
+    }
+}
+
+void Lowering::loadTruth(std::uint8_t reg, Operand operand)
+{
+    if (operand.is(Operand::Kind::Constant)) {
+        std::string_view text = program.text(operand);
+        code.emit({ static_cast<std::uint8_t>(0xB8 | reg) });
+        code.imm32(literalType(text) == TypeId::String ||
+                   literalFloat(text) != 0.0);
+        return;
+    }
+    if (typeOf(operand) == TypeId::Float) {
+        // NaN is true, like any other non-zero double
+        loadFloat(Xmm0, operand);
+        code.direct({ 0x66, 0x0F, 0x57 }, Xmm1, Xmm1);
+        code.direct({ 0x66, 0x0F, 0x2E }, Xmm0, Xmm1);
+        code.setcc(NotEqual, reg);
+        code.setcc(Parity, Rdx);
+        code.direct({ 0x08 }, Rdx, reg);
+    } else {
+        loadInt(reg, operand);
+        code.direct({ 0x85 }, reg, reg);
+        code.setcc(NotEqual, reg);
+    }
+    code.direct({ 0x0F, 0xB6 }, reg, reg);
+}
+
+void Lowering::loadPointer(Operand operand)
+{
+    if (operand.is(Operand::Kind::Constant)) {
+        // lea rax, [rip+disp32]
+        code.emit({ 0x48, 0x8D, 0x05 });
+        strings.push_back({ code.position(), operand.index() });
+        code.imm32(0);
+    } else {
+        code.memory({ 0x48, 0x8B }, Rax, disp(operand));
+    }
+}
+
+void Lowering::storeInt(Operand result, std::uint8_t reg, TypeId from)
+{
+    TypeId type = result.is(Operand::Kind::Variable) ? typeOf(result) : from;
+    if (type == TypeId::Float) {
+        // cvtsi2sd xmm0, r32
+        code.direct({ 0xF2, 0x0F, 0x2A }, Xmm0, reg);
+        storeFloat(result);
+        return;
+    }
+    if (type == TypeId::Char && from != TypeId::Char) {
+        // movsx r32, r8
+        code.direct({ 0x0F, 0xBE }, reg, reg);
+    } else if (type == TypeId::Bool && from != TypeId::Bool) {
+        // test r32, r32; setne r8; movzx r32, r8
+        code.direct({ 0x85 }, reg, reg);
+        code.setcc(NotEqual, reg);
+        code.direct({ 0x0F, 0xB6 }, reg, reg);
+    }
+    if (type == TypeId::String) {
+        code.memory({ 0x48, 0x89 }, reg, disp(result));
+    } else {
+        code.memory({ 0x89 }, reg, disp(result));
+    }
+}
+
+void Lowering::storeFloat(Operand result)
+{
+    if (result.is(Operand::Kind::Variable) && typeOf(result) != TypeId::Float) {
+        // cvttsd2si eax, xmm0
+        code.direct({ 0xF2, 0x0F, 0x2C }, Rax, Xmm0);
+        storeInt(result, Rax, TypeId::Int);
+        return;
+    }
+    code.memory({ 0xF2, 0x0F, 0x11 }, Xmm0, disp(result));
+}
+
+void Lowering::storeBool(Operand result)
+{
+    // movzx eax, al
+    code.direct({ 0x0F, 0xB6 }, Rax, Rax);
+    storeInt(result, Rax, TypeId::Bool);
+}
+
+} // namespace
+
+JITProgram JITProgram::compile(const TACProgram& program)
+{
+#if defined(__x86_64__)
+    size_t entry = 0;
+    std::vector<std::uint8_t> bytes = Lowering(program).run(entry);
+
+    auto page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    size_t mapped =
+      (std::max<size_t>(bytes.size(), 1) + page - 1) / page * page;
+    void* memory = ::mmap(nullptr,
+                          mapped,
+                          PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS,
+                          -1,
+                          0);
+    if (memory == MAP_FAILED) {
+        throw std::runtime_error("Could not map memory for the JIT");
+    }
+    std::memcpy(memory, bytes.data(), bytes.size());
+    if (::mprotect(memory, mapped, PROT_READ | PROT_EXEC) != 0) {
+        ::munmap(memory, mapped);
+        throw std::runtime_error("Could not make JIT code executable");
+    }
+    return JITProgram(memory, mapped, bytes.size(), entry);
+#else
+    (void)program;
+    throw std::runtime_error("The JIT needs an x86-64 host");
+#endif
+}
+
+JITProgram::JITProgram(JITProgram&& other) noexcept
+  : memory(std::exchange(other.memory, nullptr))
+  , mapped(std::exchange(other.mapped, 0))
+  , size(std::exchange(other.size, 0))
+  , entry(std::exchange(other.entry, 0))
+{
+}
+
+JITProgram& JITProgram::operator=(JITProgram&& other) noexcept
+{
+    if (this != &other) {
+        if (memory) {
+            ::munmap(memory, mapped);
+        }
+        memory = std::exchange(other.memory, nullptr);
+        mapped = std::exchange(other.mapped, 0);
+        size = std::exchange(other.size, 0);
+        entry = std::exchange(other.entry, 0);
+    }
+    return *this;
+}
+
+JITProgram::~JITProgram()
+{
+    if (memory) {
+        ::munmap(memory, mapped);
+    }
+}
+
+int JITProgram::run() const
+{
+    if (size == 0) {
+        return 0;
+    }
+    Trap trap;
+    auto* code = static_cast<char*>(memory) + entry;
+    int value = reinterpret_cast<int (*)(Trap*)>(code)(&trap);
+    switch (trap.fault) {
+        case DivisionByZero:
+            throw std::runtime_error(DivisionByZeroMessage);
+        case DivisionOverflow:
+            throw std::runtime_error(DivisionOverflowMessage);
+        default:
+            return value;
+    }
+}
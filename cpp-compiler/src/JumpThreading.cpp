@@ -0,0 +1,159 @@
+#include "ControlFlowGraph.hpp"
+#include "Optimizer.hpp"
+
+namespace {
+
+bool isJump(Opcode op) noexcept
+{
+    return op == Opcode::Goto || op == Opcode::IfFalse;
+}
+
+// 1 or 0 for a literal whose truth is known, -1 otherwise
+int constantTruth(std::string_view text) noexcept
+{
+    if (text == "true") {
+        return 1;
+    }
+    if (text == "false") {
+        return 0;
+    }
+    if (text.size() == 3 && text.front() == '\'' && text.back() == '\'') {
+        return text[1] != '\0';
+    }
+    if (text.empty()) {
+        return -1;
+    }
+
+    bool nonZero = false;
+    bool sawDigit = false;
+    for (char c : text) {
+        if (c >= '0' && c <= '9') {
+            sawDigit = true;
+            nonZero = nonZero || c != '0';
+        } else if (c != '.') {
+            return -1;
+        }
+    }
+    return sawDigit ? nonZero : -1;
+}
+
+} // namespace
+
+size_t threadJumps(TACProgram& program)
+{
+    auto& code = program.code;
+    if (code.empty()) {
+        return 0;
+    }
+    ControlFlowGraph graph(program);
+
+    // Where control ends up once it reaches `label`: through blocks that
+    // hold nothing but labels, either falling into the next label or
+    // ending in a GOTO. Every label on a walked chain remembers the result,
+    // so a ladder of nested ifs sharing one chain is walked once. Bounded,
+    // so an empty infinite loop stops the walk.
+    std::vector<Operand> resolved(program.getStrings().size());
+    std::vector<std::uint32_t> chain;
+    auto resolve = [&](Operand label) {
+        Operand current = label;
+        chain.clear();
+        for (size_t steps = 0; steps < graph.size(); ++steps) {
+            BlockId id = graph.blockOfLabel(current);
+            if (id == NoBlock) {
+                break;
+            }
+            if (!resolved[current.index()].isNone()) {
+                current = resolved[current.index()];
+                break;
+            }
+            chain.push_back(current.index());
+            const BasicBlock& b = graph.block(id);
+            std::uint32_t i = b.begin;
+            while (i < b.end && code[i].op == Opcode::Label) {
+                ++i;
+            }
+
+            Operand next;
+            if (i < b.end) {
+                if (code[i].op != Opcode::Goto) {
+                    break;
+                }
+                next = code[i].result;
+            } else if (b.end < code.size() &&
+                       code[b.end].op == Opcode::Label) {
+                next = code[b.end].result;
+            } else {
+                break;
+            }
+            if (next == label) {
+                break;
+            }
+            current = next;
+        }
+        for (std::uint32_t index : chain) {
+            resolved[index] = current;
+        }
+        return current;
+    };
+
+    size_t changes = 0;
+    std::vector<std::uint8_t> dead(code.size(), 0);
+    for (std::uint32_t i = 0; i < code.size(); ++i) {
+        TACInstruction& instruction = code[i];
+        if (instruction.op == Opcode::IfFalse &&
+            instruction.arg1.is(Operand::Kind::Constant)) {
+            int truth = constantTruth(program.text(instruction.arg1));
+            if (truth == 1) {
+                dead[i] = 1;
+                continue;
+            }
+            if (truth == 0) {
+                instruction = TACInstruction(
+                  Opcode::Goto, Operand(), Operand(), instruction.result);
+                ++changes;
+            }
+        }
+        if (!isJump(instruction.op)) {
+            continue;
+        }
+
+        Operand target = resolve(instruction.result);
+        if (target != instruction.result) {
+            instruction.result = target;
+            ++changes;
+        }
+
+        // A jump over nothing but labels is a fall-through
+        BlockId block = graph.blockOfLabel(target);
+        if (block != NoBlock) {
+            std::uint32_t position = graph.block(block).begin;
+            std::uint32_t j = i + 1;
+            while (j < position && code[j].op == Opcode::Label) {
+                ++j;
+            }
+            if (position > i && j == position) {
+                dead[i] = 1;
+            }
+        }
+    }
+
+    // Labels left without a jump can go; functions start at a FUNCTION,
+    // which stays
+    std::vector<std::uint8_t> targeted(program.getStrings().size(), 0);
+    for (std::uint32_t i = 0; i < code.size(); ++i) {
+        if (!dead[i] && isJump(code[i].op) &&
+            code[i].result.is(Operand::Kind::Label)) {
+            targeted[code[i].result.index()] = 1;
+        }
+    }
+    for (std::uint32_t i = 0; i < code.size(); ++i) {
+        const TACInstruction& instruction = code[i];
+        if (instruction.op == Opcode::Label &&
+            instruction.result.is(Operand::Kind::Label) &&
+            !targeted[instruction.result.index()]) {
+            dead[i] = 1;
+        }
+    }
+
+    return changes + eraseInstructions(code, dead);
+}
@@ -1,16 +1,379 @@
 #include "Lexer.hpp"
-#include <cctype>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
 #include <stdexcept>
-#include <unordered_map>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
-Lexer::Lexer() = default;
+namespace {
 
-void Lexer::setSource(const std::string& source)
+struct KeywordSpelling
+{
+    std::string_view spelling;
+    TokenType type;
+};
+
+// Indexed by Keyword
+constexpr KeywordSpelling keywordSpellings[] = {
+    { "true", TokenType::BooleanLiteral },
+    { "false", TokenType::BooleanLiteral },
+    { "nullptr", TokenType::NullLiteral },
+    { "int", TokenType::Keyword },
+    { "return", TokenType::Keyword },
+    { "if", TokenType::Keyword },
+    { "else", TokenType::Keyword },
+    { "for", TokenType::Keyword },
+    { "while", TokenType::Keyword },
+    { "do", TokenType::Keyword },
+    { "float", TokenType::Keyword },
+    { "char", TokenType::Keyword },
+    { "std::string", TokenType::Keyword },
+};
+
+static_assert(std::size(keywordSpellings) ==
+                static_cast<size_t>(Keyword::Count),
+              "keywordSpellings must list every Keyword");
+
+constexpr Keyword keywordIf(std::string_view text, Keyword candidate) noexcept
+{
+    return text == keywordSpellings[static_cast<size_t>(candidate)].spelling
+             ? candidate
+             : Keyword::Count;
+}
+
+// Length and at most two bytes pick the only keyword the text can be, so
+// at most one comparison decides it; Count for ordinary identifiers
+constexpr Keyword keywordFor(std::string_view text) noexcept
+{
+    switch (text.size()) {
+        case 2:
+            return keywordIf(text,
+                             text[0] == 'i' ? Keyword::If : Keyword::Do);
+        case 3:
+            return keywordIf(text,
+                             text[0] == 'i' ? Keyword::Int : Keyword::For);
+        case 4:
+            switch (text[0]) {
+                case 't':
+                    return keywordIf(text, Keyword::True);
+                case 'e':
+                    return keywordIf(text, Keyword::Else);
+                case 'c':
+                    return keywordIf(text, Keyword::Char);
+                default:
+                    return Keyword::Count;
+            }
+        case 5:
+            switch (text[0]) {
+                case 'f':
+                    return keywordIf(
+                      text, text[1] == 'a' ? Keyword::False : Keyword::Float);
+                case 'w':
+                    return keywordIf(text, Keyword::While);
+                default:
+                    return Keyword::Count;
+            }
+        case 6:
+            return keywordIf(text, Keyword::Return);
+        case 7:
+            return keywordIf(text, Keyword::Nullptr);
+        case 11:
+            return keywordIf(text, Keyword::StdString);
+        default:
+            return Keyword::Count;
+    }
+}
+
+constexpr bool keywordForCoversEveryKeyword()
+{
+    for (size_t i = 0; i < std::size(keywordSpellings); ++i) {
+        auto keyword = static_cast<Keyword>(i);
+        if (keywordFor(keywordSpellings[i].spelling) != keyword) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(keywordForCoversEveryKeyword(),
+              "keywordFor must recognise every spelling in keywordSpellings");
+
+constexpr OperatorKind operatorKindFor(std::string_view text) noexcept
+{
+    if (text.size() == 1) {
+        switch (text[0]) {
+            case '+':
+                return OperatorKind::Plus;
+            case '-':
+                return OperatorKind::Minus;
+            case '*':
+                return OperatorKind::Star;
+            case '/':
+                return OperatorKind::Slash;
+            case '%':
+                return OperatorKind::Percent;
+            case '=':
+                return OperatorKind::Assign;
+            case '<':
+                return OperatorKind::Less;
+            case '>':
+                return OperatorKind::Greater;
+            case '!':
+                return OperatorKind::Not;
+            case '&':
+                return OperatorKind::Ampersand;
+            case '|':
+                return OperatorKind::Pipe;
+            case '^':
+                return OperatorKind::Caret;
+            case '~':
+                return OperatorKind::Tilde;
+            default:
+                return OperatorKind::Other;
+        }
+    }
+
+    if (text.size() == 2) {
+        switch (text[0] << 8 | text[1]) {
+            case '<' << 8 | '=':
+                return OperatorKind::LessEqual;
+            case '>' << 8 | '=':
+                return OperatorKind::GreaterEqual;
+            case '=' << 8 | '=':
+                return OperatorKind::EqualEqual;
+            case '!' << 8 | '=':
+                return OperatorKind::NotEqual;
+            case '&' << 8 | '&':
+                return OperatorKind::AndAnd;
+            case '|' << 8 | '|':
+                return OperatorKind::OrOr;
+            default:
+                return OperatorKind::Other;
+        }
+    }
+    return OperatorKind::Other;
+}
+
+static_assert(operatorKindFor("==") == OperatorKind::EqualEqual &&
+                operatorKindFor("+") == OperatorKind::Plus &&
+                operatorKindFor("+-") == OperatorKind::Other,
+              "operatorKindFor mismatch");
+
+// Byte classes for the scanner. The table stands in for <cctype>, whose
+// answers depend on the locale and which costs a call per byte.
+enum CharClass : std::uint8_t
+{
+    Space = 1 << 0,
+    Digit = 1 << 1,
+    IdentifierStart = 1 << 2, // Letters and '_'
+    OperatorChar = 1 << 3,
+    SeparatorChar = 1 << 4,
+    IdentifierBody = Digit | IdentifierStart
+};
+
+constexpr std::array<std::uint8_t, 256> makeCharClasses()
+{
+    std::array<std::uint8_t, 256> table{};
+    for (char c : std::string_view(" \t\n\v\f\r")) {
+        table[static_cast<unsigned char>(c)] |= Space;
+    }
+    for (int c = '0'; c <= '9'; ++c) {
+        table[c] |= Digit;
+    }
+    for (int c = 'a'; c <= 'z'; ++c) {
+        table[c] |= IdentifierStart;
+        table[c - 'a' + 'A'] |= IdentifierStart;
+    }
+    table['_'] |= IdentifierStart;
+    for (char c : std::string_view("+-*/%=<>!&|^~")) {
+        table[static_cast<unsigned char>(c)] |= OperatorChar;
+    }
+    for (char c : std::string_view(";,(){}")) {
+        table[static_cast<unsigned char>(c)] |= SeparatorChar;
+    }
+    return table;
+}
+
+constexpr auto charClasses = makeCharClasses();
+
+constexpr bool hasClass(char c, std::uint8_t classes) noexcept
+{
+    return (charClasses[static_cast<unsigned char>(c)] & classes) != 0;
+}
+
+// The skip/find helpers return the first byte in [p, end) that ends the
+// run. With SSE2 they test sixteen bytes per step and leave only the last
+// partial block to the table, so no load crosses the end of the buffer.
+
+#if defined(__SSE2__)
+inline __m128i load16(const char* p) noexcept
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+inline const char* firstUnset(const char* p, int matches) noexcept
+{
+    auto misses = ~static_cast<unsigned>(matches) & 0xFFFFu;
+    return misses ? p + __builtin_ctz(misses) : nullptr;
+}
+#endif
+
+const char* skipSpaces(const char* p, const char* end) noexcept
+{
+    // Most runs are a single space; only longer ones take the vector path
+    if (p == end || !hasClass(*p, Space)) {
+        return p;
+    }
+#if defined(__SSE2__)
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i controlSpan = _mm_set1_epi8('\r' - '\t');
+    for (; end - p >= 16; p += 16) {
+        __m128i chunk = load16(p);
+        // '\t'..'\r' is one unsigned range: (c - '\t') <= 4
+        __m128i shifted = _mm_sub_epi8(chunk, tab);
+        __m128i control =
+          _mm_cmpeq_epi8(_mm_min_epu8(shifted, controlSpan), shifted);
+        __m128i blank = _mm_or_si128(_mm_cmpeq_epi8(chunk, space), control);
+        if (const char* stop = firstUnset(p, _mm_movemask_epi8(blank))) {
+            return stop;
+        }
+    }
+#endif
+    while (p < end && hasClass(*p, Space)) {
+        ++p;
+    }
+    return p;
+}
+
+const char* skipIdentifierBody(const char* p, const char* end) noexcept
+{
+#if defined(__SSE2__)
+    const __m128i caseBit = _mm_set1_epi8(0x20);
+    const __m128i beforeA = _mm_set1_epi8('a' - 1);
+    const __m128i afterZ = _mm_set1_epi8('z' + 1);
+    const __m128i before0 = _mm_set1_epi8('0' - 1);
+    const __m128i after9 = _mm_set1_epi8('9' + 1);
+    const __m128i underscore = _mm_set1_epi8('_');
+    for (; end - p >= 16; p += 16) {
+        __m128i chunk = load16(p);
+        // Folding case maps only 'A'..'Z' into 'a'..'z'. The compares are
+        // signed, so bytes >= 0x80 fall outside every range.
+        __m128i lower = _mm_or_si128(chunk, caseBit);
+        __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(lower, beforeA),
+                                       _mm_cmplt_epi8(lower, afterZ));
+        __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(chunk, before0),
+                                      _mm_cmplt_epi8(chunk, after9));
+        __m128i body = _mm_or_si128(
+          _mm_or_si128(letter, digit), _mm_cmpeq_epi8(chunk, underscore));
+        if (const char* stop = firstUnset(p, _mm_movemask_epi8(body))) {
+            return stop;
+        }
+    }
+#endif
+    while (p < end && hasClass(*p, IdentifierBody)) {
+        ++p;
+    }
+    return p;
+}
+
+// First '"', '\\' or NUL
+const char* findStringStop(const char* p, const char* end) noexcept
+{
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i nul = _mm_setzero_si128();
+    for (; end - p >= 16; p += 16) {
+        __m128i chunk = load16(p);
+        __m128i stops =
+          _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                                    _mm_cmpeq_epi8(chunk, backslash)),
+                       _mm_cmpeq_epi8(chunk, nul));
+        if (int mask = _mm_movemask_epi8(stops)) {
+            return p + __builtin_ctz(static_cast<unsigned>(mask));
+        }
+    }
+#endif
+    while (p < end && *p != '"' && *p != '\\' && *p != '\0') {
+        ++p;
+    }
+    return p;
+}
+
+constexpr SeparatorKind separatorKindFor(char c) noexcept
+{
+    switch (c) {
+        case ';':
+            return SeparatorKind::Semicolon;
+        case ',':
+            return SeparatorKind::Comma;
+        case '(':
+            return SeparatorKind::LeftParen;
+        case ')':
+            return SeparatorKind::RightParen;
+        case '{':
+            return SeparatorKind::LeftBrace;
+        case '}':
+            return SeparatorKind::RightBrace;
+        default:
+            return SeparatorKind::None;
+    }
+}
+
+} // namespace
+
+Lexer::Lexer()
+{
+    internKeywords();
+}
+
+void Lexer::internKeywords()
+{
+    // Keywords take the first symbols so their ids match the Keyword enum
+    for (const auto& keyword : keywordSpellings) {
+        interner.intern(keyword.spelling);
+    }
+}
+
+void Lexer::setSource(std::string_view source) noexcept
 {
     this->source = source;
     this->index = 0;
-    this->line = 1;
-    this->column = 1;
+    this->sourceMapped = false;
+}
+
+void Lexer::reset()
+{
+    setSource(std::string_view());
+    interner.clear();
+    internKeywords();
+}
+
+SourceLocation Lexer::locate(const Token& token) const
+{
+    std::uint32_t offset = offsetOf(token);
+    if (offset == NoOffset) {
+        return SourceLocation();
+    }
+    return getSourceMap().locate(offset);
+}
+
+const SourceMap& Lexer::getSourceMap() const
+{
+    if (!sourceMapped) {
+        sourceMap = SourceMap(source);
+        sourceMapped = true;
+    }
+    return sourceMap;
+}
+
+std::string_view Lexer::lexemeFrom(size_t start) const noexcept
+{
+    return source.substr(start, index - start);
 }
 
 char Lexer::currentChar() const noexcept
@@ -33,146 +396,123 @@ char Lexer::peekChar(int offset) const noexcept
 void Lexer::advance() noexcept
 {
     if (index < source.size()) {
-        if (source[index] == '\n') {
-            ++line;
-            column = 1;
-        } else {
-            ++column;
-        }
         ++index;
     }
 }
 
-void Lexer::skipWhitespace() noexcept
+void Lexer::skipTrivia() noexcept
 {
-    while (std::isspace(currentChar())) {
-        advance();
-    }
-}
+    const char* begin = source.data();
+    const char* end = begin + source.size();
 
-void Lexer::skipComment()
-{
-    if (currentChar() == '/' && peekChar() == '/') {
-        while (currentChar() != '\n' && currentChar() != '\0') {
-            advance();
+    while (true) {
+        index = static_cast<size_t>(skipSpaces(begin + index, end) - begin);
+
+        if (currentChar() != '/') {
+            return;
         }
-        advance(); // Skip the newline
-    } else if (currentChar() == '/' && peekChar() == '*') {
-        advance(); // Skip '/'
-        advance(); // Skip '*'
-        while (!(currentChar() == '*' && peekChar() == '/')) {
-            advance();
-            if (currentChar() == '\0') {
-                break;
-            }
+        if (peekChar() == '/') {
+            const void* newline =
+              std::memchr(begin + index, '\n', source.size() - index);
+            index = newline
+                      ? static_cast<size_t>(
+                          static_cast<const char*>(newline) - begin) + 1
+                      : source.size();
+        } else if (peekChar() == '*') {
+            size_t close = source.find("*/", index + 2);
+            index = close == std::string_view::npos ? source.size()
+                                                    : close + 2;
+        } else {
+            return;
         }
-        advance(); // Skip '*'
-        advance(); // Skip '/'
     }
 }
 
 Token Lexer::number()
 {
-    std::string value;
+    size_t start = index;
     bool isFloatingPoint = false;
 
-    int tokenColumn = column; // Capture the column where the number starts
-
-    while (std::isdigit(currentChar()) || currentChar() == '.') {
+    while (hasClass(currentChar(), Digit) || currentChar() == '.') {
         if (currentChar() == '.') {
             if (isFloatingPoint) {
                 break; // Only one '.' allowed
             }
             isFloatingPoint = true;
         }
-        value += currentChar();
         advance();
     }
 
+    std::string_view value = lexemeFrom(start);
     if (isFloatingPoint) {
-        return Token(TokenType::FloatingPointLiteral, value, line, tokenColumn);
+        return Token(TokenType::FloatingPointLiteral, value);
     } else {
-        return Token(TokenType::NumberLiteral, value, line, tokenColumn);
+        return Token(TokenType::NumberLiteral, value);
     }
 }
 
 Token Lexer::identifierOrKeyword()
 {
-    std::string value;
-    int tokenColumn = column;
-
-    while (std::isalnum(currentChar()) || currentChar() == '_') {
-        value += currentChar();
-        advance();
-
-        if (currentChar() == ':' && peekChar() == ':') {
-            value += "::";
-            advance(); // Skip the first ':'
-            advance(); // Skip the second ':'
+    size_t start = index;
+    const char* begin = source.data();
+    const char* end = begin + source.size();
+
+    // The first byte is already known to start an identifier. A "::"
+    // joins the next run, as in std::string.
+    const char* p = skipIdentifierBody(begin + index + 1, end);
+    while (end - p >= 2 && p[0] == ':' && p[1] == ':') {
+        p += 2;
+        if (p == end || !hasClass(*p, IdentifierBody)) {
+            break;
         }
+        p = skipIdentifierBody(p, end);
     }
-
-    static const std::unordered_map<std::string_view, TokenType> keywords{
-        { "true", TokenType::BooleanLiteral },
-        { "false", TokenType::BooleanLiteral },
-        { "nullptr", TokenType::NullLiteral },
-        { "int", TokenType::Keyword },
-        { "return", TokenType::Keyword },
-        { "if", TokenType::Keyword },
-        { "else", TokenType::Keyword },
-        { "for", TokenType::Keyword },
-        { "while", TokenType::Keyword },
-        { "float", TokenType::Keyword },
-        { "char", TokenType::Keyword },
-        { "std::string", TokenType::Keyword },
-    };
-
-    auto it = keywords.find(value);
-    if (it != keywords.end()) {
-        return Token(it->second, value, line, tokenColumn);
+    index = static_cast<size_t>(p - begin);
+
+    // Keywords were interned first, so their symbol is their enum value and
+    // they never need a hash probe
+    std::string_view value = lexemeFrom(start);
+    Keyword keyword = keywordFor(value);
+    if (keyword != Keyword::Count) {
+        return Token(keywordSpellings[static_cast<size_t>(keyword)].type,
+                     value,
+                     keywordSymbol(keyword));
     }
 
-    return Token(TokenType::Identifier, value, line, tokenColumn);
+    return Token(TokenType::Identifier, value, interner.intern(value));
 }
 
 Token Lexer::stringLiteral()
 {
-    std::string value;
-    int tokenColumn = column; // Capture the column where the string starts
-
-    value += currentChar(); // Add the opening quote
-    advance();              // Skip the opening quote
-
-    while (currentChar() != '"' && currentChar() != '\0') {
-        if (currentChar() == '\\' && peekChar() == '"') {
-            value += currentChar();
-            advance();
-            value += currentChar(); // Add the escaped quote
-        } else {
-            value += currentChar();
+    size_t start = index;
+    const char* begin = source.data();
+    const char* end = begin + source.size();
+
+    // Skip the opening quote, then jump between quotes and backslashes
+    const char* p = begin + index + 1;
+    while (true) {
+        p = findStringStop(p, end);
+        if (p == end || *p != '\\') {
+            break;
         }
-        advance();
+        // Keep an escaped quote inside the literal
+        p += end - p >= 2 && p[1] == '"' ? 2 : 1;
     }
+    index = static_cast<size_t>(p - begin);
 
-    value += currentChar(); // Add the closing quote
-    advance();              // Skip the closing quote
+    advance(); // Skip the closing quote
 
-    return Token(TokenType::StringLiteral, value, line, tokenColumn);
+    return Token(TokenType::StringLiteral, lexemeFrom(start));
 }
 
 Token Lexer::characterLiteral()
 {
-    std::string value;
-    int tokenColumn = column; // Capture the column where the char starts
+    size_t start = index;
 
-    value += currentChar(); // Add the opening single quote
-    advance();
+    advance(); // Skip the opening single quote
 
     if (currentChar() == '\\' && peekChar() == '\'') {
-        value += currentChar(); // Handle escape sequences like '\''
-        advance();
-    } else {
-        value += currentChar(); // Add the actual character
+        advance(); // Handle escape sequences like '\''
     }
     advance();
 
@@ -181,89 +521,86 @@ Token Lexer::characterLiteral()
           "Expected closing single quote for character literal");
     }
 
-    value += currentChar(); // Add the closing single quote
-    advance();
-
-    return Token(TokenType::CharacterLiteral, value, line, tokenColumn);
-}
+    advance(); // Skip the closing single quote
 
-constexpr bool Lexer::isOperator(char c) noexcept
-{
-    constexpr std::string_view operators = "+-*/%=<>!&|^~";
-    return operators.find(c) != std::string_view::npos;
+    return Token(TokenType::CharacterLiteral, lexemeFrom(start));
 }
 
 Token Lexer::operatorToken()
 {
-    std::string value;
-    int tokenColumn = column;
+    size_t start = index;
 
-    while (isOperator(currentChar())) {
-        value += currentChar();
+    while (hasClass(currentChar(), OperatorChar)) {
+        char first = currentChar();
         advance();
 
-        static const std::unordered_map<std::string_view, char>
-          multiCharOperators{
-              { "=", '=' }, { "!", '=' }, { "<", '=' }, { ">", '=' }
-          };
-
-        auto it = multiCharOperators.find(value);
-        if (it != multiCharOperators.end() && currentChar() == it->second) {
-            value += currentChar();
+        // "=", "!", "<" and ">" combine with a following '=' and end the
+        // operator
+        bool startsComparison = index - start == 1 &&
+                                (first == '=' || first == '!' ||
+                                 first == '<' || first == '>');
+        if (startsComparison && currentChar() == '=') {
             advance();
             break;
         }
     }
 
-    return Token(TokenType::Operator, value, line, tokenColumn);
+    std::string_view value = lexemeFrom(start);
+    return Token(operatorKindFor(value), value);
 }
 
 Token Lexer::nextToken()
 {
-    skipWhitespace();
-    skipComment();
-
-    if (std::isdigit(currentChar())) {
-        return number();
-    }
-
-    if (std::isalpha(currentChar()) || currentChar() == '_') {
-        return identifierOrKeyword();
+    skipTrivia();
+
+    char c = currentChar();
+    switch (charClasses[static_cast<unsigned char>(c)]) {
+        case Digit:
+            return number();
+        case IdentifierStart:
+            return identifierOrKeyword();
+        case OperatorChar:
+            return operatorToken();
+        case SeparatorChar: {
+            Token token(separatorKindFor(c), source.substr(index, 1));
+            advance();
+            return token;
+        }
+        default:
+            break;
     }
 
-    if (currentChar() == '"') {
+    if (c == '"') {
         return stringLiteral();
     }
 
-    if (currentChar() == '\'') {
+    if (c == '\'') {
         return characterLiteral();
     }
 
-    if (isOperator(currentChar())) {
-        return operatorToken();
-    }
-
-    if (currentChar() == ';' || currentChar() == ',' || currentChar() == '(' ||
-        currentChar() == ')' || currentChar() == '{' || currentChar() == '}') {
-        std::string value(1, currentChar());
-        Token token(TokenType::Separator, value, line, column);
-        advance();
-        return token;
-    }
-
-    if (currentChar() == '\0') {
-        return Token(TokenType::EndOfFile, "", line, column);
+    if (c == '\0') {
+        return Token(TokenType::EndOfFile, source.substr(index, 0));
     }
 
     // If we reach here, we have an unknown character
-    char unknownChar = currentChar();
+    size_t start = index;
     advance();
-    return Token(TokenType::Unknown, std::string(1, unknownChar), line, column);
+    return Token(TokenType::Unknown, lexemeFrom(start));
 }
 
 std::vector<Token> Lexer::tokenize()
 {
     std::vector<Token> tokens;
+    tokenize(tokens);
+    return tokens;
+}
+
+void Lexer::tokenize(std::vector<Token>& tokens)
+{
+    // Dense code averages four to five bytes per token; reserving for four
+    // avoids a reallocation that copies every token lexed so far
+    tokens.clear();
+    tokens.reserve(source.size() / 4 + 1);
 
     while (index < source.size()) {
         Token token = nextToken();
@@ -279,6 +616,4 @@ std::vector<Token> Lexer::tokenize()
             break;
         }
     }
-
-    return tokens;
 }
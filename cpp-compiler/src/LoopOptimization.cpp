@@ -0,0 +1,639 @@
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "ControlFlowGraph.hpp"
+#include "Optimizer.hpp"
+
+namespace {
+
+constexpr std::uint32_t NoValue = UINT32_MAX;
+
+bool isJump(Opcode op) noexcept
+{
+    return op == Opcode::Goto || op == Opcode::IfFalse;
+}
+
+// Some jump targets a label placed before it; without one there is no
+// loop, and no graph to build
+bool jumpsBack(const TACProgram& program)
+{
+    std::vector<std::uint8_t> placed(program.getStrings().size(), 0);
+    for (const TACInstruction& instruction : program.code) {
+        if (instruction.op == Opcode::Label) {
+            placed[instruction.result.index()] = 1;
+        } else if (isJump(instruction.op) &&
+                   placed[instruction.result.index()]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Everything but control flow writes its result
+bool writes(const TACInstruction& instruction) noexcept
+{
+    return !isJump(instruction.op) && instruction.op != Opcode::Label &&
+           instruction.op != Opcode::Function &&
+           instruction.op != Opcode::Ret;
+}
+
+bool isValue(Operand operand) noexcept
+{
+    return operand.is(Operand::Kind::Temp) ||
+           operand.is(Operand::Kind::Variable);
+}
+
+bool isOperand(Operand operand) noexcept
+{
+    return operand.isNone() || operand.is(Operand::Kind::Constant) ||
+           isValue(operand);
+}
+
+// Int constant spelled in decimal, as the generator and ConstantFolder
+// write them
+bool intConstant(const TACProgram& program, Operand operand,
+                 std::int32_t& value)
+{
+    if (!operand.is(Operand::Kind::Constant)) {
+        return false;
+    }
+    std::string_view text = program.text(operand);
+    const char* end = text.data() + text.size();
+    auto [stop, error] = std::from_chars(text.data(), end, value);
+    return error == std::errc() && stop == end;
+}
+
+std::int32_t wrap(std::int64_t value) noexcept
+{
+    return static_cast<std::int32_t>(static_cast<std::uint32_t>(value));
+}
+
+// An instruction another block runs before the loop: it must compute the
+// same value there and must not trap where the loop would not have run
+bool hoistable(const TACProgram& program, const TACInstruction& instruction)
+{
+    if (instruction.op < Opcode::Add || instruction.op > Opcode::Or ||
+        !isValue(instruction.result) || !isOperand(instruction.arg1) ||
+        !isOperand(instruction.arg2)) {
+        return false;
+    }
+    switch (instruction.type) {
+        case TypeId::Int:
+        case TypeId::Char:
+        case TypeId::Bool:
+        case TypeId::Float:
+            break;
+        default:
+            // Strings allocate
+            return false;
+    }
+    return !mayTrap(program, instruction);
+}
+
+// Type of the value `instruction` leaves in a temp, which the MOV standing
+// in for it has to keep; a variable keeps its declared type, which
+// foldCopies only lets the instruction produce if they agree
+TypeId valueType(const TACInstruction& instruction) noexcept
+{
+    if (instruction.result.is(Operand::Kind::Variable)) {
+        return instruction.type;
+    }
+    switch (instruction.op) {
+        case Opcode::LessThan:
+        case Opcode::GreaterThan:
+        case Opcode::Equal:
+        case Opcode::NotEqual:
+        case Opcode::And:
+        case Opcode::Or:
+            return TypeId::Bool;
+        default:
+            return instruction.type;
+    }
+}
+
+// Instructions to add to the program; those for one place keep the order
+// they were added in
+class Insertions
+{
+public:
+    void before(std::uint32_t position, const TACInstruction& instruction)
+    {
+        entries.push_back({ 2 * position, instruction });
+    }
+    void after(std::uint32_t position, const TACInstruction& instruction)
+    {
+        entries.push_back({ 2 * position + 1, instruction });
+    }
+
+    void apply(std::vector<TACInstruction>& code)
+    {
+        if (entries.empty()) {
+            return;
+        }
+        std::stable_sort(entries.begin(),
+                         entries.end(),
+                         [](const Entry& a, const Entry& b) {
+                             return a.key < b.key;
+                         });
+        std::vector<TACInstruction> merged;
+        merged.reserve(code.size() + entries.size());
+        size_t next = 0;
+        for (std::uint32_t i = 0; i < code.size(); ++i) {
+            while (next < entries.size() && entries[next].key == 2 * i) {
+                merged.push_back(entries[next++].instruction);
+            }
+            merged.push_back(code[i]);
+            while (next < entries.size() && entries[next].key == 2 * i + 1) {
+                merged.push_back(entries[next++].instruction);
+            }
+        }
+        code.swap(merged);
+    }
+
+private:
+    struct Entry
+    {
+        std::uint32_t key;
+        TACInstruction instruction;
+    };
+    std::vector<Entry> entries;
+};
+
+// What the loop passes know about one natural loop at a time: which
+// blocks are in it, and where and how often it writes each value. The
+// arrays are stamped with the loop they describe, so moving to the next
+// loop clears them without touching them and a pass costs the size of
+// the loops it looks at.
+//
+// A value is invariant at a read if the loop never writes it, or if its
+// only write in the loop stores an invariant value and runs before the
+// read on every path through the loop. Passes record such writes with
+// setInvariant as they walk the blocks in reverse postorder.
+class LoopAnalysis
+{
+public:
+    LoopAnalysis(const TACProgram& program, const ControlFlowGraph& graph)
+      : program(program)
+      , graph(graph)
+      , tempCount(program.getTempCount())
+      , blockStamp(graph.size(), 0)
+      , edited(graph.size(), 0)
+    {
+        size_t values = tempCount + program.getStrings().size();
+        valueStamp.assign(values, 0);
+        writeCount.assign(values, 0);
+        lastWrite.assign(values, 0);
+        lastWriteBlock.assign(values, NoBlock);
+        replacement.assign(values, Operand());
+    }
+
+    // Describes `loop`; false if it shares a block with a loop this pass
+    // already changed, or has no place for code to run ahead of it
+    bool enter(const LoopNest& nest, const NaturalLoop& loop);
+
+    bool contains(BlockId id) const noexcept
+    {
+        return blockStamp[id] == stamp;
+    }
+
+    // Value slot of a temp or variable the analysis knows about
+    std::uint32_t valueOf(Operand operand) const noexcept
+    {
+        if (operand.is(Operand::Kind::Temp) && operand.index() < tempCount) {
+            return operand.index();
+        }
+        if (operand.is(Operand::Kind::Variable) &&
+            tempCount + operand.index() < valueStamp.size()) {
+            return tempCount + operand.index();
+        }
+        return NoValue;
+    }
+
+    // Writes of `operand` inside the loop
+    std::uint32_t writesOf(Operand operand) const noexcept
+    {
+        std::uint32_t value = valueOf(operand);
+        return value != NoValue && valueStamp[value] == stamp
+                 ? writeCount[value]
+                 : 0;
+    }
+
+    // Replaces `operand`, read at `position` in `block`, by an operand
+    // holding the same value all through the loop; false if it varies
+    bool invariant(Operand& operand,
+                   std::uint32_t position,
+                   BlockId block) const noexcept;
+
+    // Records a MOV at `position` in `block` that copies an invariant
+    // value; false for any other instruction
+    bool copy(const TACInstruction& instruction,
+              std::uint32_t position,
+              BlockId block) noexcept
+    {
+        if (instruction.op != Opcode::Mov) {
+            return false;
+        }
+        Operand source = instruction.arg1;
+        if (invariant(source, position, block)) {
+            setInvariant(instruction.result, source);
+        }
+        return true;
+    }
+
+    void setInvariant(Operand result, Operand value) noexcept
+    {
+        std::uint32_t slot = valueOf(result);
+        if (slot != NoValue && valueStamp[slot] == stamp &&
+            writeCount[slot] == 1) {
+            replacement[slot] = value;
+        }
+    }
+
+    // Queues `code` to run once on entry to the loop last entered, ahead
+    // of its header, and marks the loop's blocks as changed
+    void insertPreheader(TACProgram& target,
+                         const std::vector<TACInstruction>& code,
+                         Insertions& insertions);
+
+private:
+    const TACProgram& program;
+    const ControlFlowGraph& graph;
+    std::uint32_t tempCount;
+    std::uint32_t stamp = 0;
+    std::vector<std::uint32_t> blockStamp;
+    std::vector<std::uint8_t> edited;
+    std::vector<std::uint32_t> valueStamp;
+    std::vector<std::uint32_t> writeCount;
+    std::vector<std::uint32_t> lastWrite;
+    std::vector<BlockId> lastWriteBlock;
+    std::vector<Operand> replacement;
+    // The loop last entered
+    BlockId header = NoBlock;
+    NodeList<const BlockId> blocks;
+    // Jumps from outside the loop to its header
+    std::vector<std::uint32_t> entryJumps;
+};
+
+bool LoopAnalysis::enter(const LoopNest& nest, const NaturalLoop& loop)
+{
+    blocks = nest.blocks(loop);
+    header = loop.header;
+    for (BlockId id : blocks) {
+        if (edited[id]) {
+            return false;
+        }
+    }
+
+    ++stamp;
+    for (BlockId id : blocks) {
+        blockStamp[id] = stamp;
+    }
+
+    // Entries have no outside predecessor to run the code; a header that
+    // the loop falls into from the block before would run it every time
+    const BasicBlock& first = graph.block(header);
+    const auto& code = program.code;
+    if (code[first.begin].op != Opcode::Label) {
+        return false;
+    }
+    if (header > 0 && contains(header - 1)) {
+        Opcode last = code[graph.block(header - 1).end - 1].op;
+        if (last != Opcode::Goto && last != Opcode::Ret) {
+            return false;
+        }
+    }
+    Operand label = code[first.begin].result;
+    bool entered = false;
+    entryJumps.clear();
+    for (BlockId from : graph.predecessors(header)) {
+        if (contains(from)) {
+            continue;
+        }
+        entered = true;
+        std::uint32_t last = graph.block(from).end - 1;
+        if (isJump(code[last].op) && code[last].result == label) {
+            entryJumps.push_back(last);
+        }
+    }
+    if (!entered) {
+        return false;
+    }
+
+    for (BlockId id : blocks) {
+        const BasicBlock& b = graph.block(id);
+        for (std::uint32_t i = b.begin; i < b.end; ++i) {
+            if (!writes(code[i])) {
+                continue;
+            }
+            std::uint32_t value = valueOf(code[i].result);
+            if (value == NoValue) {
+                continue;
+            }
+            if (valueStamp[value] != stamp) {
+                valueStamp[value] = stamp;
+                writeCount[value] = 0;
+                replacement[value] = Operand();
+            }
+            ++writeCount[value];
+            lastWrite[value] = i;
+            lastWriteBlock[value] = id;
+        }
+    }
+    return true;
+}
+
+bool LoopAnalysis::invariant(Operand& operand,
+                             std::uint32_t position,
+                             BlockId block) const noexcept
+{
+    if (operand.isNone() || operand.is(Operand::Kind::Constant)) {
+        return true;
+    }
+    std::uint32_t value = valueOf(operand);
+    if (value == NoValue) {
+        return false;
+    }
+    if (valueStamp[value] != stamp) {
+        return true;
+    }
+    if (writeCount[value] != 1 || replacement[value].isNone()) {
+        return false;
+    }
+    BlockId at = lastWriteBlock[value];
+    if (at == block ? lastWrite[value] >= position
+                    : !graph.dominates(at, block)) {
+        return false;
+    }
+    operand = replacement[value];
+    return true;
+}
+
+void LoopAnalysis::insertPreheader(TACProgram& target,
+                                   const std::vector<TACInstruction>& code,
+                                   Insertions& insertions)
+{
+    for (BlockId id : blocks) {
+        edited[id] = 1;
+    }
+    std::uint32_t begin = graph.block(header).begin;
+    // Code that jumps into the loop now jumps to the preheader instead;
+    // the block before it falls into it as it fell into the header
+    if (!entryJumps.empty()) {
+        Operand label = target.newLabel();
+        insertions.before(begin, TACInstruction(Opcode::Label,
+                                                Operand(),
+                                                Operand(),
+                                                label));
+        for (std::uint32_t jump : entryJumps) {
+            target.code[jump].result = label;
+        }
+    }
+    for (const TACInstruction& instruction : code) {
+        insertions.before(begin, instruction);
+    }
+}
+
+// A loop no other loop header sits in
+bool isInnermost(const LoopNest& nest,
+                 const NaturalLoop& loop,
+                 const std::vector<std::uint8_t>& headers)
+{
+    for (BlockId id : nest.blocks(loop)) {
+        if (id != loop.header && headers[id]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// i = i + c, i = c + i or i = i - c on an int variable
+bool isStep(const TACProgram& program, const TACInstruction& instruction)
+{
+    Operand target = instruction.result;
+    std::int32_t step;
+    if (instruction.type != TypeId::Int ||
+        !target.is(Operand::Kind::Variable)) {
+        return false;
+    }
+    if (instruction.op == Opcode::Add) {
+        return (instruction.arg1 == target &&
+                intConstant(program, instruction.arg2, step)) ||
+               (instruction.arg2 == target &&
+                intConstant(program, instruction.arg1, step));
+    }
+    return instruction.op == Opcode::Subtract &&
+           instruction.arg1 == target &&
+           intConstant(program, instruction.arg2, step);
+}
+
+// Moves the invariant expressions of the loop `analysis` last entered to
+// `preheader`, leaving a MOV of each result behind
+size_t hoistInvariants(TACProgram& program,
+                       const ControlFlowGraph& graph,
+                       LoopAnalysis& analysis,
+                       NodeList<const BlockId> blocks,
+                       std::vector<TACInstruction>& preheader)
+{
+    auto& code = program.code;
+    size_t hoisted = 0;
+    for (BlockId id : blocks) {
+        const BasicBlock& b = graph.block(id);
+        for (std::uint32_t i = b.begin; i < b.end; ++i) {
+            TACInstruction& instruction = code[i];
+            if (analysis.copy(instruction, i, id) ||
+                !hoistable(program, instruction)) {
+                continue;
+            }
+            TACInstruction moved = instruction;
+            if (!analysis.invariant(moved.arg1, i, id) ||
+                !analysis.invariant(moved.arg2, i, id)) {
+                continue;
+            }
+            // The loop keeps a copy, so the value it leaves behind does
+            // not depend on where the result is read
+            Operand temp = program.newTemp();
+            moved.result = temp;
+            preheader.push_back(moved);
+            analysis.setInvariant(instruction.result, temp);
+            instruction = TACInstruction(Opcode::Mov,
+                                         temp,
+                                         Operand(),
+                                         instruction.result,
+                                         valueType(instruction));
+            ++hoisted;
+        }
+    }
+    return hoisted;
+}
+
+// Induction variable `variable` times invariant `factor`, kept in `sum`
+struct Reduction
+{
+    Operand variable;
+    Operand factor;
+    Operand sum;
+};
+
+// Replaces the multiplies of induction variables by invariants in the
+// loop `analysis` last entered with sums that `preheader` starts and each
+// step of the variable advances
+size_t reduceMultiplies(TACProgram& program,
+                        const ControlFlowGraph& graph,
+                        LoopAnalysis& analysis,
+                        NodeList<const BlockId> blocks,
+                        std::vector<TACInstruction>& preheader,
+                        Insertions& insertions,
+                        std::vector<std::uint32_t>& steps,
+                        std::vector<Reduction>& reductions)
+{
+    auto& code = program.code;
+
+    // Induction variables: every write in the loop steps them by a
+    // constant
+    steps.clear();
+    for (BlockId id : blocks) {
+        const BasicBlock& b = graph.block(id);
+        for (std::uint32_t i = b.begin; i < b.end; ++i) {
+            if (isStep(program, code[i])) {
+                steps.push_back(i);
+            }
+        }
+    }
+    if (steps.empty()) {
+        return 0;
+    }
+    auto isInduction = [&](Operand operand) {
+        std::uint32_t count = analysis.writesOf(operand);
+        if (count == 0 || !operand.is(Operand::Kind::Variable)) {
+            return false;
+        }
+        std::uint32_t seen = 0;
+        for (std::uint32_t at : steps) {
+            seen += code[at].result == operand;
+        }
+        return seen == count;
+    };
+
+    reductions.clear();
+    size_t reduced = 0;
+    for (BlockId id : blocks) {
+        const BasicBlock& b = graph.block(id);
+        for (std::uint32_t i = b.begin; i < b.end; ++i) {
+            TACInstruction& instruction = code[i];
+            if (analysis.copy(instruction, i, id) ||
+                instruction.op != Opcode::Multiply ||
+                instruction.type != TypeId::Int ||
+                !isValue(instruction.result)) {
+                continue;
+            }
+            Operand variable = instruction.arg1;
+            Operand factor = instruction.arg2;
+            if (!isInduction(variable)) {
+                std::swap(variable, factor);
+            }
+            if (!isInduction(variable) ||
+                !analysis.invariant(factor, i, id)) {
+                continue;
+            }
+
+            auto match = std::find_if(
+              reductions.begin(), reductions.end(), [&](const Reduction& r) {
+                  return r.variable == variable && r.factor == factor;
+              });
+            if (match == reductions.end()) {
+                Operand sum = program.newTemp();
+                preheader.push_back(TACInstruction(
+                  Opcode::Multiply, variable, factor, sum, TypeId::Int));
+                reductions.push_back({ variable, factor, sum });
+                match = reductions.end() - 1;
+            }
+            instruction = TACInstruction(
+              Opcode::Mov, match->sum, Operand(), instruction.result,
+              TypeId::Int);
+            ++reduced;
+        }
+    }
+
+    // Each step of the variable steps its sums by step * factor
+    for (std::uint32_t at : steps) {
+        const TACInstruction& step = code[at];
+        Operand constant = step.arg1 == step.result ? step.arg2 : step.arg1;
+        std::int32_t by;
+        intConstant(program, constant, by);
+        for (const Reduction& r : reductions) {
+            if (r.variable != step.result) {
+                continue;
+            }
+            Operand delta;
+            std::int32_t factor;
+            if (by == 1) {
+                delta = r.factor;
+            } else if (intConstant(program, r.factor, factor)) {
+                delta = program.constant(
+                  std::to_string(wrap(std::int64_t(by) * factor)));
+            } else {
+                delta = program.newTemp();
+                preheader.push_back(TACInstruction(
+                  Opcode::Multiply, constant, r.factor, delta, TypeId::Int));
+            }
+            insertions.after(
+              at, TACInstruction(step.op, r.sum, delta, r.sum, TypeId::Int));
+        }
+    }
+    return reduced;
+}
+
+} // namespace
+
+size_t optimizeLoops(TACProgram& program)
+{
+    if (!jumpsBack(program)) {
+        return 0;
+    }
+    ControlFlowGraph graph(program);
+    LoopNest nest = graph.naturalLoops();
+    if (nest.loops.empty()) {
+        return 0;
+    }
+    std::vector<std::uint8_t> headers(graph.size(), 0);
+    for (const NaturalLoop& loop : nest.loops) {
+        headers[loop.header] = 1;
+    }
+
+    LoopAnalysis analysis(program, graph);
+    Insertions insertions;
+    std::vector<TACInstruction> preheader;
+    std::vector<std::uint32_t> steps;
+    std::vector<Reduction> reductions;
+    size_t rewritten = 0;
+    // A loop nested in one this call changed is left to the next round,
+    // when the code moved out of it sits in the outer loop's preheader
+    for (const NaturalLoop& loop : nest.loops) {
+        if (!analysis.enter(nest, loop)) {
+            continue;
+        }
+        NodeList<const BlockId> blocks = nest.blocks(loop);
+        preheader.clear();
+        size_t changed =
+          hoistInvariants(program, graph, analysis, blocks, preheader);
+        // In an outer loop the sum would only join the inner loop's own
+        if (isInnermost(nest, loop, headers)) {
+            changed += reduceMultiplies(program,
+                                        graph,
+                                        analysis,
+                                        blocks,
+                                        preheader,
+                                        insertions,
+                                        steps,
+                                        reductions);
+        }
+        if (changed > 0) {
+            analysis.insertPreheader(program, preheader, insertions);
+            rewritten += changed;
+        }
+    }
+    insertions.apply(program.code);
+    return rewritten;
+}
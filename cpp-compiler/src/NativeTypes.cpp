@@ -0,0 +1,83 @@
+#include "NativeTypes.hpp"
+#include <cstdlib>
+#include <string>
+
+TypeId literalType(std::string_view text) noexcept
+{
+    if (!text.empty() && text.front() == '"') {
+        return TypeId::String;
+    }
+    if (text.size() == 3 && text.front() == '\'') {
+        return TypeId::Char;
+    }
+    if (text == "true" || text == "false") {
+        return TypeId::Bool;
+    }
+    return text.find('.') != std::string_view::npos ? TypeId::Float
+                                                    : TypeId::Int;
+}
+
+long long literalInteger(std::string_view text)
+{
+    if (text.size() == 3 && text.front() == '\'') {
+        return static_cast<unsigned char>(text[1]);
+    }
+    if (text == "true" || text == "false") {
+        return text == "true";
+    }
+    std::string digits(text);
+    if (digits.find('.') != std::string::npos) {
+        return static_cast<long long>(std::strtod(digits.c_str(), nullptr));
+    }
+    return std::strtoll(digits.c_str(), nullptr, 10);
+}
+
+double literalFloat(std::string_view text)
+{
+    if (literalType(text) != TypeId::Float) {
+        return static_cast<double>(literalInteger(text));
+    }
+    return std::strtod(std::string(text).c_str(), nullptr);
+}
+
+void declareVariables(const TACProgram& program,
+                      std::uint32_t begin,
+                      std::uint32_t end,
+                      std::vector<TypeId>& types,
+                      size_t offset)
+{
+    const auto& code = program.code;
+    for (std::uint32_t i = begin; i < end; ++i) {
+        for (Operand operand : { code[i].arg1, code[i].arg2, code[i].result }) {
+            if (operand.is(Operand::Kind::Variable)) {
+                types[offset + operand.index()] = TypeId::Unknown;
+            }
+        }
+    }
+    for (std::uint32_t i = begin; i < end; ++i) {
+        const TACInstruction& instruction = code[i];
+        Operand result = instruction.result;
+        if (result.is(Operand::Kind::Variable) &&
+            instruction.type != TypeId::Unknown &&
+            types[offset + result.index()] == TypeId::Unknown) {
+            types[offset + result.index()] = instruction.type;
+        }
+    }
+}
+
+TypeId producedType(const TACInstruction& instruction,
+                    TypeId left,
+                    TypeId right) noexcept
+{
+    if (isComparison(instruction.op) || instruction.op == Opcode::And ||
+        instruction.op == Opcode::Or) {
+        return TypeId::Bool;
+    }
+    if (instruction.op == Opcode::Mov || instruction.op == Opcode::Call) {
+        return instruction.type != TypeId::Unknown ? instruction.type : left;
+    }
+    if (left == TypeId::Float || right == TypeId::Float) {
+        return TypeId::Float;
+    }
+    return instruction.type == TypeId::String ? TypeId::String : TypeId::Int;
+}
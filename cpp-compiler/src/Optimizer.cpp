@@ -0,0 +1,77 @@
+#include "Optimizer.hpp"
+#include <charconv>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+
+int Optimizer::parseLevel(const std::string& text)
+{
+    if (text.size() == 1 && text[0] >= '0' && text[0] <= '0' + MaxLevel) {
+        return text[0] - '0';
+    }
+    throw std::runtime_error("Unknown optimization level: " + text);
+}
+
+OptimizationSummary Optimizer::run(TACProgram& program) const
+{
+    OptimizationSummary summary;
+    if (level <= 0) {
+        return summary;
+    }
+
+    for (;;) {
+        ++summary.rounds;
+        size_t inlined = inlineCalls(program);
+        size_t threaded = threadJumps(program);
+        size_t removed = removeUnreachableBlocks(program);
+        removed += foldCopies(program);
+        size_t rewritten = eliminateCommonSubexpressions(program);
+        rewritten += propagateCopies(program);
+        if (level >= 2) {
+            rewritten += optimizeLoops(program);
+            removed += removeDeadStores(program);
+        }
+        removed += removeUnusedTemps(program);
+
+        summary.inlined += inlined;
+        summary.threaded += threaded;
+        summary.removed += removed;
+        summary.rewritten += rewritten;
+        if (inlined + threaded + removed + rewritten == 0) {
+            break;
+        }
+    }
+    return summary;
+}
+
+bool mayTrap(const TACProgram& program, const TACInstruction& instruction)
+{
+    if ((instruction.op != Opcode::Divide &&
+         instruction.op != Opcode::Modulo) ||
+        instruction.type == TypeId::Float) {
+        return false;
+    }
+    if (!instruction.arg2.is(Operand::Kind::Constant)) {
+        return true;
+    }
+    std::string_view text = program.text(instruction.arg2);
+    const char* end = text.data() + text.size();
+    std::int32_t divisor;
+    auto [stop, error] = std::from_chars(text.data(), end, divisor);
+    return error != std::errc() || stop != end || divisor == 0 ||
+           divisor == -1;
+}
+
+size_t eraseInstructions(std::vector<TACInstruction>& code,
+                         const std::vector<std::uint8_t>& dead)
+{
+    size_t kept = 0;
+    for (size_t i = 0; i < code.size(); ++i) {
+        if (!dead[i]) {
+            code[kept++] = code[i];
+        }
+    }
+    size_t removed = code.size() - kept;
+    code.erase(code.begin() + static_cast<std::ptrdiff_t>(kept), code.end());
+    return removed;
+}
@@ -1,29 +1,138 @@
 // Parser.cpp
 #include "Parser.hpp"
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include "ConstantFolder.hpp"
+#include "SemanticAnalyzer.hpp"
+#include "ThreadPool.hpp"
+
+namespace {
+
+struct BinaryOperator
+{
+    int precedence = -1; // -1: does not continue an expression
+    bool lowers = false; // Whether `op` is meaningful
+    BinaryOp op = BinaryOp::Add;
+};
+
+// Indexed by OperatorKind. "<=" and ">=" bind like the other relational
+// operators but have no BinaryOp yet.
+constexpr auto binaryOperators = [] {
+    constexpr auto size = static_cast<size_t>(OperatorKind::Count);
+    std::array<BinaryOperator, size> table{};
+    auto set = [&table](OperatorKind kind, int precedence, BinaryOp op) {
+        table[static_cast<size_t>(kind)] = { precedence, true, op };
+    };
+    set(OperatorKind::Plus, 10, BinaryOp::Add);
+    set(OperatorKind::Minus, 10, BinaryOp::Subtract);
+    set(OperatorKind::Star, 20, BinaryOp::Multiply);
+    set(OperatorKind::Slash, 20, BinaryOp::Divide);
+    set(OperatorKind::Percent, 20, BinaryOp::Modulo);
+    set(OperatorKind::EqualEqual, 5, BinaryOp::Equal);
+    set(OperatorKind::NotEqual, 5, BinaryOp::NotEqual);
+    set(OperatorKind::AndAnd, 3, BinaryOp::And);
+    set(OperatorKind::OrOr, 3, BinaryOp::Or);
+    set(OperatorKind::Less, 15, BinaryOp::LessThan);
+    set(OperatorKind::Greater, 15, BinaryOp::GreaterThan);
+    table[static_cast<size_t>(OperatorKind::LessEqual)].precedence = 15;
+    table[static_cast<size_t>(OperatorKind::GreaterEqual)].precedence = 15;
+    return table;
+}();
+
+} // namespace
 
 Parser::Parser(std::shared_ptr<Lexer> lexer)
   : lexer(std::move(lexer))
+  , tokens{ Token(TokenType::EndOfFile, "") }
   , index(0) // Initialize index here
 {
 }
 
 void Parser::setTokens(std::vector<Token> tokens)
 {
-    this->tokens = std::move(tokens);
+    swapTokens(tokens);
+}
+
+void Parser::swapTokens(std::vector<Token>& tokens)
+{
+    this->tokens.swap(tokens);
+    tokens.clear();
+    // The lexer only emits EndOfFile after trailing whitespace; a sentinel
+    // lets every lookahead read the buffer without a bounds check
+    if (this->tokens.empty() ||
+        this->tokens.back().getType() != TokenType::EndOfFile) {
+        this->tokens.emplace_back(TokenType::EndOfFile, "");
+    }
     this->index = 0;
+    arena.reset();
+    statementStack.clear();
+    argumentStack.clear();
+}
+
+void Parser::reset()
+{
+    tokens.clear();
+    tokens.emplace_back(TokenType::EndOfFile, "");
+    index = 0;
+    arena.reset();
+    statementStack.clear();
+    argumentStack.clear();
+    diagnostics.clear();
 }
 
-Token Parser::currentToken() const noexcept
+std::string_view Parser::symbolText(const Token& token) const noexcept
 {
-    if (index < tokens.size()) {
-        return tokens[index];
+    // Interned spellings outlive the source buffer the token points into
+    return lexer->getInterner().lookup(token.getSymbol());
+}
+
+std::string Parser::describe(const Token& token)
+{
+    if (token.getType() == TokenType::EndOfFile) {
+        return "end of file";
     }
-    return Token(TokenType::EndOfFile, "", 0, 0);
+    return "'" + std::string(token.getValue()) + "'";
+}
+
+TypeId Parser::typeFromKeyword(const Token& token) noexcept
+{
+    if (token.isKeyword(Keyword::Int))
+        return TypeId::Int;
+    if (token.isKeyword(Keyword::Float))
+        return TypeId::Float;
+    if (token.isKeyword(Keyword::Char))
+        return TypeId::Char;
+    if (token.isKeyword(Keyword::StdString))
+        return TypeId::String;
+    return TypeId::Unknown;
+}
+
+NodeList<StatementPtr> Parser::popStatements(size_t first)
+{
+    auto statements = arena.copyList(statementStack.data() + first,
+                                     statementStack.size() - first);
+    statementStack.resize(first);
+    return statements;
+}
+
+template <typename T, typename... Args>
+T* Parser::make(const Token& at, Args&&... args)
+{
+    T* node = arena.make<T>(std::forward<Args>(args)...);
+    node->setOffset(lexer->offsetOf(at));
+    return node;
+}
+
+const Token& Parser::currentToken() const noexcept
+{
+    return tokens[index];
 }
 
 void Parser::advance() noexcept
 {
-    if (index < tokens.size()) {
+    // Stay on the trailing EndOfFile token
+    if (index + 1 < tokens.size()) {
         index++;
     }
 }
@@ -33,220 +142,538 @@ bool Parser::match(TokenType type) const noexcept
     return currentToken().getType() == type;
 }
 
+bool Parser::matchSeparator(SeparatorKind kind) const noexcept
+{
+    return currentToken().getSeparator() == kind;
+}
+
+bool Parser::expectSeparator(SeparatorKind kind, const char* message)
+{
+    if (!matchSeparator(kind)) {
+        error(currentToken(), message);
+        return false;
+    }
+    advance();
+    return true;
+}
+
+void Parser::error(const Token& at, std::string message)
+{
+    if (!panicking) {
+        diagnostics.error(lexer->offsetOf(at), std::move(message));
+        panicking = true;
+    }
+}
+
+bool Parser::startsStatement(const Token& token) noexcept
+{
+    return typeFromKeyword(token) != TypeId::Unknown ||
+           token.isKeyword(Keyword::If) || token.isKeyword(Keyword::Return) ||
+           token.isKeyword(Keyword::While) || token.isKeyword(Keyword::For) ||
+           token.isKeyword(Keyword::Do);
+}
+
+void Parser::synchronize() noexcept
+{
+    // The statement ends at a ';' outside any block it opened, after the
+    // '}' that closes such a block (unless an 'else' follows), or just
+    // before the '}' of the enclosing block. A keyword that starts a
+    // statement ends it too, so a missing ';' costs only its own
+    // statement.
+    int depth = 0;
+    while (!match(TokenType::EndOfFile)) {
+        if (depth == 0 && startsStatement(currentToken())) {
+            break;
+        }
+        if (matchSeparator(SeparatorKind::RightBrace)) {
+            if (depth == 0) {
+                break;
+            }
+            advance();
+            if (--depth == 0 && !currentToken().isKeyword(Keyword::Else)) {
+                break;
+            }
+            continue;
+        }
+        if (matchSeparator(SeparatorKind::LeftBrace)) {
+            ++depth;
+        } else if (matchSeparator(SeparatorKind::Semicolon) && depth == 0) {
+            advance();
+            break;
+        }
+        advance();
+    }
+    panicking = false;
+}
+
+void Parser::skipHeader() noexcept
+{
+    int depth = 0;
+    while (!match(TokenType::EndOfFile) &&
+           !matchSeparator(SeparatorKind::LeftBrace) &&
+           !matchSeparator(SeparatorKind::RightBrace)) {
+        if (matchSeparator(SeparatorKind::LeftParen)) {
+            ++depth;
+        } else if (matchSeparator(SeparatorKind::RightParen) &&
+                   depth-- == 0) {
+            advance();
+            return;
+        }
+        advance();
+    }
+}
+
 StatementPtr Parser::parse()
 {
-    StatementPtr ast = parseStatement();
+    diagnostics.clear();
+    panicking = false;
+    auto* unit = static_cast<TranslationUnit*>(parseTranslationUnit());
+
+    // After parsing, perform semantic analysis, then fold the constants
+    // the annotated types allow
+    check(*unit);
+    if (diagnostics.hasErrors()) {
+        // The one exception of a failed unit
+        throw std::runtime_error(diagnostics.format(lexer->getSourceMap()));
+    }
+    ConstantFolder(arena).fold(*unit);
 
-    // After parsing, perform semantic analysis
-    SymbolTable symTable;
-    ast->checkSemantics(symTable);
+    return unit;
+}
 
-    return ast;
+StatementPtr Parser::parseTranslationUnit()
+{
+    const Token& start = currentToken();
+    size_t first = statementStack.size();
+    // An empty unit is reported as a statement missing at its end
+    do {
+        if (StatementPtr stmt = parseStatement()) {
+            statementStack.push_back(stmt);
+        }
+    } while (!match(TokenType::EndOfFile));
+
+    if (statementStack.size() - first > 1) {
+        for (size_t i = first; i < statementStack.size(); ++i) {
+            if (statementStack[i]->getKind() != NodeKind::FunctionDeclaration) {
+                diagnostics.error(
+                  statementStack[i]->getOffset(),
+                  "Only functions may appear at the top level of a unit of "
+                  "several statements");
+            }
+        }
+    }
+    return make<TranslationUnit>(start, popStatements(first));
+}
+
+void Parser::check(TranslationUnit& unit)
+{
+    symbols.reset();
+    NodeList<StatementPtr> statements = unit.getStatements();
+    // Every function is declared before any body is checked, so that the
+    // concurrent checks below share the table without writing to it
+    functions.reset();
+    for (StatementPtr stmt : statements) {
+        if (const auto* function = nodeCast<FunctionDeclaration>(stmt)) {
+            if (!functions.declare(function->getSymbol(), *function)) {
+                diagnostics.error(function->getOffset(),
+                                  "Function '" +
+                                    std::string(function->getName()) +
+                                    "' is already defined");
+            }
+        }
+    }
+
+    // A unit with syntax errors may hold statements outside functions, so
+    // it is checked in order
+    if (!pool || pool->size() < 2 || statements.size() < 2 ||
+        diagnostics.hasErrors()) {
+        SemanticAnalyzer(symbols, functions, diagnostics).check(unit);
+        return;
+    }
+
+    // Contiguous runs of functions, a few per worker so stealing can even
+    // out their sizes. Each run has its own table and errors, which are
+    // gathered in source order afterwards.
+    size_t chunks = std::min(statements.size(), size_t{ pool->size() } * 4);
+    while (checkChunks.size() < chunks) {
+        checkChunks.push_back(std::make_unique<CheckChunk>());
+    }
+    pool->forEach(chunks, [&](size_t chunk) {
+        CheckChunk& state = *checkChunks[chunk];
+        state.symbols.reset();
+        state.diagnostics.clear();
+        SemanticAnalyzer analyzer(
+          state.symbols, functions, state.diagnostics);
+        size_t end = (chunk + 1) * statements.size() / chunks;
+        for (size_t i = chunk * statements.size() / chunks; i < end; ++i) {
+            analyzer.check(*statements[i]);
+        }
+    });
+    for (size_t chunk = 0; chunk < chunks; ++chunk) {
+        diagnostics.append(checkChunks[chunk]->diagnostics);
+    }
 }
 
-// Update parseStatement() to handle block statements
 StatementPtr Parser::parseStatement()
 {
-    if (match(TokenType::Separator) && currentToken().getValue() == "{") {
+    size_t start = index;
+    StatementPtr stmt = dispatchStatement();
+    if (panicking) {
+        synchronize();
+        // Always move on, so the caller's loop cannot stall on the token
+        if (index == start) {
+            advance();
+        }
+    }
+    return stmt;
+}
+
+StatementPtr Parser::dispatchStatement()
+{
+    if (matchSeparator(SeparatorKind::LeftBrace)) {
         return parseBlockStatement();
     }
 
     if (match(TokenType::Keyword)) {
-        const auto& value = currentToken().getValue();
-        if (value == "int" || value == "float" || value == "char" ||
-            value == "std::string") {
+        const Token& token = currentToken();
+        if (typeFromKeyword(token) != TypeId::Unknown) {
             return parseVariableDeclaration();
-        } else if (value == "return") {
+        } else if (token.isKeyword(Keyword::Return)) {
             return parseReturn();
-        } else if (value == "if") {
+        } else if (token.isKeyword(Keyword::If)) {
             return parseIfStatement();
+        } else if (token.isKeyword(Keyword::While)) {
+            return parseWhileStatement();
+        } else if (token.isKeyword(Keyword::For)) {
+            return parseForStatement();
+        } else if (token.isKeyword(Keyword::Do)) {
+            return parseDoWhileStatement();
         }
     } else if (match(TokenType::Identifier)) {
         return parseAssignmentOrFunctionCall();
     }
 
-    throw std::runtime_error("Unexpected token: " + currentToken().toString());
+    error(currentToken(), "Unexpected token: " + describe(currentToken()));
+    return nullptr;
 }
 
-// New method to parse block statements
 StatementPtr Parser::parseBlockStatement()
 {
+    const Token& start = currentToken();
     advance(); // Skip '{'
 
-    std::vector<StatementPtr> statements;
-    statements.reserve(10); // Reserve space to avoid multiple reallocations
-
-    while (!match(TokenType::Separator) || currentToken().getValue() != "}") {
-        statements.push_back(parseStatement());
+    size_t first = statementStack.size();
+    while (!matchSeparator(SeparatorKind::RightBrace) &&
+           !match(TokenType::EndOfFile)) {
+        // Broken statements resynchronize inside and are left out
+        if (StatementPtr stmt = parseStatement()) {
+            statementStack.push_back(stmt);
+        }
     }
 
-    advance(); // Skip '}'
+    expectSeparator(SeparatorKind::RightBrace, "Expected '}' to close block");
 
-    return std::make_shared<BlockStatement>(std::move(statements));
+    return make<BlockStatement>(start, popStatements(first));
 }
 
 // Updated parseIfStatement() to handle block statements in 'if' branches
 StatementPtr Parser::parseIfStatement()
 {
+    const Token& start = currentToken();
     advance(); // Skip 'if'
 
-    if (!match(TokenType::Separator) || currentToken().getValue() != "(") {
-        throw std::runtime_error("Expected '(' after 'if'");
+    if (!expectSeparator(SeparatorKind::LeftParen, "Expected '(' after 'if'")) {
+        return nullptr;
     }
-    advance(); // Skip '('
 
     ExpressionPtr condition = parseExpression();
-
-    if (!match(TokenType::Separator) || currentToken().getValue() != ")") {
-        throw std::runtime_error("Expected ')' after 'if' condition");
+    if (!condition ||
+        !expectSeparator(SeparatorKind::RightParen,
+                         "Expected ')' after 'if' condition")) {
+        return nullptr;
     }
-    advance(); // Skip ')'
 
     StatementPtr thenBranch = parseStatement();
 
+    // A broken branch has already been skipped; the else still has to be
+    // parsed so it is not taken for a statement of its own
     StatementPtr elseBranch = nullptr;
-    if (match(TokenType::Keyword) && currentToken().getValue() == "else") {
+    bool brokenElse = false;
+    if (currentToken().isKeyword(Keyword::Else)) {
         advance(); // Skip 'else'
         elseBranch = parseStatement();
+        brokenElse = !elseBranch;
     }
 
-    return std::make_shared<IfStatement>(
-      std::move(condition), std::move(thenBranch), std::move(elseBranch));
+    if (!thenBranch || brokenElse) {
+        return nullptr;
+    }
+    return make<IfStatement>(start, condition, thenBranch, elseBranch);
+}
+
+StatementPtr Parser::parseWhileStatement()
+{
+    const Token& start = currentToken();
+    advance(); // Skip 'while'
+
+    if (!expectSeparator(SeparatorKind::LeftParen,
+                         "Expected '(' after 'while'")) {
+        return nullptr;
+    }
+
+    ExpressionPtr condition = parseExpression();
+    if (!condition ||
+        !expectSeparator(SeparatorKind::RightParen,
+                         "Expected ')' after 'while' condition")) {
+        return nullptr;
+    }
+
+    StatementPtr body = parseStatement();
+    if (!body) {
+        return nullptr;
+    }
+    return make<WhileStatement>(start, condition, body);
+}
+
+StatementPtr Parser::parseDoWhileStatement()
+{
+    const Token& start = currentToken();
+    advance(); // Skip 'do'
+
+    // As with a broken else branch, the tail is still parsed so it is not
+    // taken for a while loop of its own
+    StatementPtr body = parseStatement();
+
+    if (!currentToken().isKeyword(Keyword::While)) {
+        error(currentToken(), "Expected 'while' after 'do' body");
+        return nullptr;
+    }
+    advance(); // Skip 'while'
+
+    if (!expectSeparator(SeparatorKind::LeftParen,
+                         "Expected '(' after 'while'")) {
+        return nullptr;
+    }
+
+    ExpressionPtr condition = parseExpression();
+    if (!condition ||
+        !expectSeparator(SeparatorKind::RightParen,
+                         "Expected ')' after 'do' condition")) {
+        return nullptr;
+    }
+    expectSeparator(SeparatorKind::Semicolon,
+                    "Expected ';' after 'do' statement");
+
+    if (!body) {
+        return nullptr;
+    }
+    return make<DoWhileStatement>(start, body, condition);
+}
+
+StatementPtr Parser::parseForStatement()
+{
+    const Token& start = currentToken();
+    advance(); // Skip 'for'
+
+    if (!expectSeparator(SeparatorKind::LeftParen,
+                         "Expected '(' after 'for'")) {
+        return nullptr;
+    }
+
+    // Each clause is only parsed while the ones before it are intact
+    StatementPtr initializer = nullptr;
+    if (matchSeparator(SeparatorKind::Semicolon)) {
+        advance();
+    } else if (typeFromKeyword(currentToken()) != TypeId::Unknown) {
+        initializer = parseVariableDeclaration();
+    } else if (match(TokenType::Identifier)) {
+        initializer = parseAssignmentOrFunctionCall();
+    } else {
+        error(currentToken(),
+              "Expected a declaration or assignment in 'for' header");
+    }
+
+    ExpressionPtr condition = nullptr;
+    if (!panicking && !matchSeparator(SeparatorKind::Semicolon)) {
+        condition = parseExpression();
+    }
+    if (!panicking) {
+        expectSeparator(SeparatorKind::Semicolon,
+                        "Expected ';' after 'for' condition");
+    }
+
+    StatementPtr update = nullptr;
+    if (!panicking && !matchSeparator(SeparatorKind::RightParen)) {
+        if (match(TokenType::Identifier)) {
+            update = parseAssignmentOrFunctionCall(false);
+        } else {
+            error(currentToken(), "Expected an assignment in 'for' header");
+        }
+    }
+    if (!panicking) {
+        expectSeparator(SeparatorKind::RightParen,
+                        "Expected ')' after 'for' header");
+    }
+    if (panicking) {
+        skipHeader();
+        return nullptr;
+    }
+
+    StatementPtr body = parseStatement();
+    if (!body) {
+        return nullptr;
+    }
+    return make<ForStatement>(start, initializer, condition, update, body);
 }
 
-StatementPtr Parser::parseAssignmentOrFunctionCall()
+StatementPtr Parser::parseAssignmentOrFunctionCall(bool terminated)
 {
-    std::string name = currentToken().getValue();
+    const Token& start = currentToken();
+    std::string_view name = symbolText(start);
+    Symbol symbol = start.getSymbol();
     advance();
 
-    if (match(TokenType::Operator) && currentToken().getValue() == "=") {
+    if (currentToken().getOperator() == OperatorKind::Assign) {
         advance();
         ExpressionPtr value = parseExpression();
-
-        if (!match(TokenType::Separator) || currentToken().getValue() != ";") {
-            throw std::runtime_error("Expected ';' after assignment");
+        if (!value) {
+            return nullptr;
         }
 
-        advance(); // Skip ';'
-        return std::make_shared<AssignmentStatement>(std::move(name),
-                                                     std::move(value));
+        if (terminated) {
+            expectSeparator(SeparatorKind::Semicolon,
+                            "Expected ';' after assignment");
+        }
+        return make<AssignmentStatement>(start, name, symbol, value);
     }
 
-    if (match(TokenType::Separator) && currentToken().getValue() == "(") {
-        throw std::runtime_error("Function calls not yet supported.");
+    if (matchSeparator(SeparatorKind::LeftParen)) {
+        ExpressionPtr call = parseCall(start);
+        if (!call) {
+            return nullptr;
+        }
+        if (terminated) {
+            expectSeparator(SeparatorKind::Semicolon,
+                            "Expected ';' after function call");
+        }
+        return make<ExpressionStatement>(start, call);
     }
 
-    throw std::runtime_error("Unexpected token after identifier: " +
-                             currentToken().toString());
+    error(currentToken(),
+          "Unexpected token after identifier: " + describe(currentToken()));
+    return nullptr;
 }
 
 StatementPtr Parser::parseVariableDeclaration()
 {
-    std::string type = currentToken().getValue();
+    TypeId type = typeFromKeyword(currentToken());
     advance();
 
     if (!match(TokenType::Identifier)) {
-        throw std::runtime_error(
-          "Expected identifier after type in variable declaration");
+        error(currentToken(),
+              "Expected identifier after type in variable declaration");
+        return nullptr;
     }
 
-    std::string name = currentToken().getValue();
+    const Token& start = currentToken();
+    std::string_view name = symbolText(start);
+    Symbol symbol = start.getSymbol();
     advance();
 
-    if (match(TokenType::Separator) && currentToken().getValue() == "(") {
-        return parseFunctionDeclaration(std::move(type), std::move(name));
+    if (matchSeparator(SeparatorKind::LeftParen)) {
+        return parseFunctionDeclaration(type, name, symbol);
     }
 
+    // A broken initializer still declares the variable, so its uses are
+    // not reported as well
     ExpressionPtr initializer = nullptr;
-    if (match(TokenType::Operator) && currentToken().getValue() == "=") {
+    if (currentToken().getOperator() == OperatorKind::Assign) {
         advance();
         initializer = parseExpression();
     }
 
-    if (!match(TokenType::Separator) || currentToken().getValue() != ";") {
-        throw std::runtime_error("Expected ';' after variable declaration");
+    if (initializer || !panicking) {
+        expectSeparator(SeparatorKind::Semicolon,
+                        "Expected ';' after variable declaration");
     }
-
-    advance(); // Skip ';'
-    return std::make_shared<VariableDeclaration>(
-      std::move(type), std::move(name), std::move(initializer));
+    return make<VariableDeclaration>(start, type, name, symbol, initializer);
 }
 
-StatementPtr Parser::parseFunctionDeclaration(std::string returnType,
-                                              std::string name)
+StatementPtr Parser::parseFunctionDeclaration(TypeId returnType,
+                                              std::string_view name,
+                                              Symbol symbol)
 {
+    const Token& start = tokens[index - 1];
     advance(); // Skip '('
 
-    std::vector<std::string> parameters;
-    parameters.reserve(5); // Reserve space to avoid multiple reallocations
+    parameters.clear();
 
-    while (!match(TokenType::Separator) || currentToken().getValue() != ")") {
-        if (match(TokenType::Identifier)) {
-            std::string paramType = currentToken().getValue();
-            advance();
+    while (!matchSeparator(SeparatorKind::RightParen)) {
+        TypeId paramType = typeFromKeyword(currentToken());
+        if (paramType == TypeId::Unknown) {
+            error(currentToken(),
+                  "Expected parameter type in function declaration");
+            return nullptr;
+        }
+        advance();
 
-            if (!match(TokenType::Identifier)) {
-                throw std::runtime_error(
+        if (!match(TokenType::Identifier)) {
+            error(currentToken(),
                   "Expected parameter name after type in function declaration");
-            }
-
-            std::string paramName = currentToken().getValue();
-            advance();
-
-            parameters.push_back(paramType + " " + paramName);
+            return nullptr;
+        }
+        parameters.push_back(Parameter{ paramType,
+                                        symbolText(currentToken()),
+                                        currentToken().getSymbol() });
+        advance();
 
-            if (match(TokenType::Separator) &&
-                currentToken().getValue() == ",") {
-                advance(); // Skip ','
-            } else {
-                break;
-            }
+        if (matchSeparator(SeparatorKind::Comma)) {
+            advance(); // Skip ','
         } else {
-            throw std::runtime_error(
-              "Expected parameter type in function declaration");
+            break;
         }
     }
 
-    if (!match(TokenType::Separator) || currentToken().getValue() != ")") {
-        throw std::runtime_error("Expected ')' after function parameters");
+    if (!expectSeparator(SeparatorKind::RightParen,
+                         "Expected ')' after function parameters") ||
+        !expectSeparator(SeparatorKind::LeftBrace,
+                         "Expected '{' at the beginning of function body")) {
+        return nullptr;
     }
 
-    advance(); // Skip ')'
-
-    if (!match(TokenType::Separator) || currentToken().getValue() != "{") {
-        throw std::runtime_error(
-          "Expected '{' at the beginning of function body");
-    }
-
-    advance(); // Skip '{'
-
-    std::vector<StatementPtr> body;
-    body.reserve(10); // Reserve space to avoid multiple reallocations
-
-    while (!match(TokenType::Separator) || currentToken().getValue() != "}") {
-        body.push_back(parseStatement());
+    size_t first = statementStack.size();
+    while (!matchSeparator(SeparatorKind::RightBrace) &&
+           !match(TokenType::EndOfFile)) {
+        if (StatementPtr stmt = parseStatement()) {
+            statementStack.push_back(stmt);
+        }
     }
 
-    advance(); // Skip '}'
+    expectSeparator(SeparatorKind::RightBrace,
+                    "Expected '}' at the end of function body");
 
-    return std::make_shared<FunctionDeclaration>(std::move(returnType),
-                                                 std::move(name),
-                                                 std::move(parameters),
-                                                 std::move(body));
+    return make<FunctionDeclaration>(
+      start,
+      returnType,
+      name,
+      symbol,
+      arena.copyList(parameters.data(), parameters.size()),
+      popStatements(first));
 }
 
 StatementPtr Parser::parseReturn()
 {
+    const Token& start = currentToken();
     advance(); // Skip 'return'
 
     ExpressionPtr value = parseExpression();
-
-    if (!match(TokenType::Separator) || currentToken().getValue() != ";") {
-        throw std::runtime_error("Expected ';' after return statement");
+    if (!value) {
+        return nullptr;
     }
 
-    advance(); // Skip ';'
-    return std::make_shared<ReturnStatement>(std::move(value));
+    expectSeparator(SeparatorKind::Semicolon,
+                    "Expected ';' after return statement");
+    return make<ReturnStatement>(start, value);
 }
 
 ExpressionPtr Parser::parseExpression()
@@ -256,87 +683,100 @@ ExpressionPtr Parser::parseExpression()
 
 ExpressionPtr Parser::parsePrimaryExpression()
 {
+    const Token& start = currentToken();
     if (match(TokenType::NumberLiteral) ||
         match(TokenType::FloatingPointLiteral) ||
         match(TokenType::StringLiteral) || match(TokenType::CharacterLiteral)) {
-        std::string value = currentToken().getValue();
+        std::string_view value = arena.copyString(start.getValue());
         advance();
-        return std::make_shared<LiteralExpression>(std::move(value));
+        return make<LiteralExpression>(start, value);
     }
 
     if (match(TokenType::Identifier)) {
-        std::string name = currentToken().getValue();
+        std::string_view name = symbolText(start);
+        Symbol symbol = start.getSymbol();
         advance();
-        return std::make_shared<VariableExpression>(std::move(name));
+        if (matchSeparator(SeparatorKind::LeftParen)) {
+            return parseCall(start);
+        }
+        return make<VariableExpression>(start, name, symbol);
+    }
+
+    error(start, "Unexpected token in expression: " + describe(start));
+    return nullptr;
+}
+
+ExpressionPtr Parser::parseCall(const Token& start)
+{
+    advance(); // Skip '('
+
+    size_t first = argumentStack.size();
+    if (!matchSeparator(SeparatorKind::RightParen)) {
+        while (true) {
+            ExpressionPtr argument = parseExpression();
+            if (!argument) {
+                argumentStack.resize(first);
+                return nullptr;
+            }
+            argumentStack.push_back(argument);
+            if (!matchSeparator(SeparatorKind::Comma)) {
+                break;
+            }
+            advance(); // Skip ','
+        }
+    }
+    if (!expectSeparator(SeparatorKind::RightParen,
+                         "Expected ')' after call arguments")) {
+        argumentStack.resize(first);
+        return nullptr;
     }
 
-    throw std::runtime_error("Unexpected token in expression: " +
-                             currentToken().toString());
+    auto arguments = arena.copyList(argumentStack.data() + first,
+                                    argumentStack.size() - first);
+    argumentStack.resize(first);
+    return make<CallExpression>(
+      start, symbolText(start), start.getSymbol(), arguments);
 }
 
 ExpressionPtr Parser::parseBinaryExpression(int precedence)
 {
     ExpressionPtr left = parsePrimaryExpression();
+    if (!left) {
+        return nullptr;
+    }
 
     while (true) {
-        int tokenPrecedence = getPrecedence(currentToken());
+        const Token& opToken = currentToken();
+        int tokenPrecedence = getPrecedence(opToken);
 
         if (tokenPrecedence < precedence) {
             return left;
         }
 
-        BinaryOp op = tokenToBinaryOp(currentToken());
+        BinaryOp op;
+        if (!tokenToBinaryOp(opToken, op)) {
+            error(opToken, "Unknown binary operator: " + describe(opToken));
+            return nullptr;
+        }
         advance();
 
         ExpressionPtr right = parseBinaryExpression(tokenPrecedence + 1);
-        left = std::make_shared<BinaryExpression>(
-          std::move(left), op, std::move(right));
+        if (!right) {
+            return nullptr;
+        }
+        left = make<BinaryExpression>(opToken, left, op, right);
     }
 }
 
 int Parser::getPrecedence(const Token& token) noexcept
 {
-    if (token.getType() == TokenType::Operator) {
-        const std::string_view& value = token.getValue();
-        if (value == "+" || value == "-")
-            return 10;
-        if (value == "*" || value == "/" || value == "%")
-            return 20;
-        if (value == "==" || value == "!=")
-            return 5;
-        if (value == "&&" || value == "||")
-            return 3;
-        if (value == "<" || value == ">" || value == "<=" || value == ">=")
-            return 15;
-    }
-    return -1;
-}
-
-BinaryOp Parser::tokenToBinaryOp(const Token& token)
-{
-    const std::string_view& value = token.getValue();
-    if (value == "+")
-        return BinaryOp::Add;
-    if (value == "-")
-        return BinaryOp::Subtract;
-    if (value == "*")
-        return BinaryOp::Multiply;
-    if (value == "/")
-        return BinaryOp::Divide;
-    if (value == "%")
-        return BinaryOp::Modulo;
-    if (value == "<")
-        return BinaryOp::LessThan;
-    if (value == ">")
-        return BinaryOp::GreaterThan;
-    if (value == "==")
-        return BinaryOp::Equal;
-    if (value == "!=")
-        return BinaryOp::NotEqual;
-    if (value == "&&")
-        return BinaryOp::And;
-    if (value == "||")
-        return BinaryOp::Or;
-
-    throw std::runtime_error("Unknown binary operator: " + token.toString());
-}
\ No newline at end of file
+    return binaryOperators[static_cast<size_t>(token.getOperator())].precedence;
+}
+
+bool Parser::tokenToBinaryOp(const Token& token, BinaryOp& op) noexcept
+{
+    const BinaryOperator& entry =
+      binaryOperators[static_cast<size_t>(token.getOperator())];
+    op = entry.op;
+    return entry.lowers;
+}
@@ -0,0 +1,283 @@
+#include "RegisterAllocator.hpp"
+#include <algorithm>
+#include <cctype>
+#include <functional>
+#include <queue>
+#include <stdexcept>
+
+namespace {
+
+constexpr std::uint32_t Unset = UINT32_MAX;
+
+bool isJump(Opcode op) noexcept
+{
+    return op == Opcode::Goto || op == Opcode::IfFalse;
+}
+
+struct BackEdge
+{
+    std::uint32_t header;
+    std::uint32_t jump;
+};
+
+} // namespace
+
+RegisterSet::RegisterSet(std::vector<std::string> registerNames)
+  : names(std::move(registerNames))
+{
+    for (size_t i = 0; i < names.size(); ++i) {
+        const std::string& name = names[i];
+        bool wellFormed = !name.empty();
+        for (char c : name) {
+            wellFormed = wellFormed &&
+                         !std::isspace(static_cast<unsigned char>(c)) &&
+                         c != ',';
+        }
+        if (!wellFormed) {
+            throw std::runtime_error("Invalid register name: '" + name + "'");
+        }
+        if (std::find(names.begin(), names.begin() + i, name) !=
+            names.begin() + i) {
+            throw std::runtime_error("Duplicate register name: " + name);
+        }
+    }
+}
+
+RegisterSet RegisterSet::parse(const std::string& spec)
+{
+    bool numeric = !spec.empty() &&
+                   std::all_of(spec.begin(), spec.end(), [](char c) {
+                       return c >= '0' && c <= '9';
+                   });
+    std::vector<std::string> names;
+    if (numeric) {
+        unsigned long count = std::stoul(spec);
+        if (count == 0 || count > 4096) {
+            throw std::runtime_error("Register count must be 1 to 4096: " +
+                                     spec);
+        }
+        for (unsigned long i = 0; i < count; ++i) {
+            names.push_back("r" + std::to_string(i));
+        }
+    } else {
+        size_t first = 0;
+        while (first <= spec.size()) {
+            size_t comma = spec.find(',', first);
+            if (comma == std::string::npos) {
+                comma = spec.size();
+            }
+            names.push_back(spec.substr(first, comma - first));
+            first = comma + 1;
+        }
+    }
+    return RegisterSet(std::move(names));
+}
+
+std::string RegisterSet::toString() const
+{
+    std::string joined;
+    for (const auto& name : names) {
+        if (!joined.empty()) {
+            joined += ',';
+        }
+        joined += name;
+    }
+    return joined;
+}
+
+std::vector<LiveInterval> computeLiveIntervals(const TACProgram& program)
+{
+    const auto& code = program.code;
+    std::uint32_t tempCount = program.getTempCount();
+    std::vector<std::uint32_t> start(tempCount, Unset);
+    std::vector<std::uint32_t> end(tempCount, 0);
+    std::vector<std::uint32_t> labelAt(program.getStrings().size(), Unset);
+
+    for (std::uint32_t i = 0; i < code.size(); ++i) {
+        const TACInstruction& instruction = code[i];
+        if (instruction.op == Opcode::Label &&
+            instruction.result.is(Operand::Kind::Label)) {
+            labelAt[instruction.result.index()] = i;
+        }
+        for (Operand operand :
+             { instruction.arg1, instruction.arg2, instruction.result }) {
+            if (operand.is(Operand::Kind::Temp) &&
+                operand.index() < tempCount) {
+                std::uint32_t temp = operand.index();
+                start[temp] = std::min(start[temp], i);
+                end[temp] = std::max(end[temp], i);
+            }
+        }
+    }
+
+    // A jump to an earlier label closes a loop. Anything live into the
+    // header is needed again on the next iteration, so it must survive
+    // until the jump.
+    std::vector<BackEdge> backEdges;
+    for (std::uint32_t i = 0; i < code.size(); ++i) {
+        const TACInstruction& instruction = code[i];
+        if (isJump(instruction.op) &&
+            instruction.result.is(Operand::Kind::Label)) {
+            std::uint32_t target = labelAt[instruction.result.index()];
+            if (target != Unset && target < i) {
+                backEdges.push_back({ target, i });
+            }
+        }
+    }
+    std::sort(backEdges.begin(),
+              backEdges.end(),
+              [](const BackEdge& a, const BackEdge& b) {
+                  return a.header < b.header;
+              });
+
+    std::vector<LiveInterval> intervals;
+    for (std::uint32_t temp = 0; temp < tempCount; ++temp) {
+        if (start[temp] == Unset) {
+            continue;
+        }
+        LiveInterval interval{ temp, start[temp], end[temp] };
+        // Headers are visited in order and the interval only grows, so
+        // loops it is extended into are still visited
+        auto edge = std::upper_bound(
+          backEdges.begin(),
+          backEdges.end(),
+          interval.start,
+          [](std::uint32_t position, const BackEdge& candidate) {
+              return position < candidate.header;
+          });
+        for (; edge != backEdges.end() && edge->header <= interval.end;
+             ++edge) {
+            interval.end = std::max(interval.end, edge->jump);
+        }
+        intervals.push_back(interval);
+    }
+
+    std::sort(intervals.begin(),
+              intervals.end(),
+              [](const LiveInterval& a, const LiveInterval& b) {
+                  return a.start < b.start;
+              });
+    return intervals;
+}
+
+AllocationSummary RegisterAllocator::allocate(TACProgram& program) const
+{
+    AllocationSummary summary;
+    if (registers.empty()) {
+        return summary;
+    }
+
+    std::vector<LiveInterval> intervals = computeLiveIntervals(program);
+    summary.temps = intervals.size();
+
+    std::vector<Operand> physical;
+    physical.reserve(registers.size());
+    for (const auto& name : registers.getNames()) {
+        physical.push_back(program.reg(name));
+    }
+
+    std::vector<Operand> assignment(program.getTempCount());
+
+    // Registers are handed out lowest first, so small programs only touch
+    // the front of the preference list
+    std::priority_queue<std::uint32_t,
+                        std::vector<std::uint32_t>,
+                        std::greater<>>
+      freeRegisters;
+    for (std::uint32_t r = 0; r < physical.size(); ++r) {
+        freeRegisters.push(r);
+    }
+
+    struct Active
+    {
+        std::uint32_t end;
+        std::uint32_t temp;
+        std::uint32_t location;
+    };
+    // Sorted by end; never longer than the register set
+    std::vector<Active> active;
+    // Spilled intervals still live, as (end, slot), earliest end on top
+    using SlotUse = std::pair<std::uint32_t, std::uint32_t>;
+    std::priority_queue<SlotUse, std::vector<SlotUse>, std::greater<>>
+      liveSlots;
+    std::priority_queue<std::uint32_t,
+                        std::vector<std::uint32_t>,
+                        std::greater<>>
+      freeSlots;
+    std::uint32_t slotCount = program.getSlotCount();
+
+    auto spill = [&](std::uint32_t temp, std::uint32_t end) {
+        std::uint32_t slot;
+        if (!freeSlots.empty()) {
+            slot = freeSlots.top();
+            freeSlots.pop();
+        } else {
+            slot = slotCount++;
+        }
+        assignment[temp] = program.slot(slot);
+        liveSlots.push({ end, slot });
+        ++summary.spilled;
+    };
+
+    auto activate = [&](const Active& entry) {
+        auto position = std::upper_bound(
+          active.begin(),
+          active.end(),
+          entry.end,
+          [](std::uint32_t end, const Active& other) {
+              return end < other.end;
+          });
+        active.insert(position, entry);
+        summary.registersUsed = std::max(summary.registersUsed, active.size());
+    };
+
+    for (const LiveInterval& interval : intervals) {
+        // An interval that ends where this one starts is only read by the
+        // defining instruction, so its register can take the result
+        size_t expired = 0;
+        while (expired < active.size() &&
+               active[expired].end <= interval.start) {
+            freeRegisters.push(active[expired].location);
+            ++expired;
+        }
+        active.erase(active.begin(), active.begin() + expired);
+        while (!liveSlots.empty() && liveSlots.top().first <= interval.start) {
+            freeSlots.push(liveSlots.top().second);
+            liveSlots.pop();
+        }
+
+        if (!freeRegisters.empty()) {
+            std::uint32_t r = freeRegisters.top();
+            freeRegisters.pop();
+            assignment[interval.temp] = physical[r];
+            activate({ interval.end, interval.temp, r });
+            continue;
+        }
+
+        // Out of registers: whichever interval reaches furthest gives way
+        Active& last = active.back();
+        if (last.end > interval.end) {
+            std::uint32_t r = last.location;
+            spill(last.temp, last.end);
+            active.pop_back();
+            assignment[interval.temp] = physical[r];
+            activate({ interval.end, interval.temp, r });
+        } else {
+            spill(interval.temp, interval.end);
+        }
+    }
+
+    for (TACInstruction& instruction : program.code) {
+        for (Operand* operand :
+             { &instruction.arg1, &instruction.arg2, &instruction.result }) {
+            if (operand->is(Operand::Kind::Temp) &&
+                operand->index() < assignment.size()) {
+                *operand = assignment[operand->index()];
+            }
+        }
+    }
+
+    program.setSlotCount(slotCount);
+    summary.slots = slotCount;
+    return summary;
+}
@@ -0,0 +1,314 @@
+#include "SemanticAnalyzer.hpp"
+#include <string>
+#include <utility>
+
+namespace {
+
+// Whether a value may initialize a target of the given type: the same
+// type, or an int widened to float. Unknown was reported already.
+bool converts(TypeId value, TypeId target) noexcept
+{
+    return value == target || value == TypeId::Unknown ||
+           target == TypeId::Unknown ||
+           (value == TypeId::Int && target == TypeId::Float);
+}
+
+// Whether a function returning `target` may return a value: as in C++,
+// any number converts to any numeric return type, a float by truncation
+bool returnable(TypeId value, TypeId target) noexcept
+{
+    return converts(value, target) ||
+           (value != TypeId::String && target != TypeId::String);
+}
+
+} // namespace
+
+void SemanticAnalyzer::error(const ASTNode& at, std::string message)
+{
+    diagnostics.error(at.getOffset(), std::move(message));
+}
+
+TypeId SemanticAnalyzer::annotate(Expression& expr)
+{
+    TypeId type = visitExpression(expr);
+    expr.setType(type);
+    return type;
+}
+
+SymbolTable::Variable SemanticAnalyzer::lookup(const ASTNode& at,
+                                               Symbol symbol,
+                                               std::string_view name)
+{
+    SymbolTable::Variable variable = symTable.lookupVariable(symbol);
+    if (variable.type == TypeId::Unknown) {
+        error(at, "Variable '" + std::string(name) + "' is not declared");
+    }
+    return variable;
+}
+
+void SemanticAnalyzer::checkAssignable(const ASTNode& at,
+                                       TypeId target,
+                                       TypeId value,
+                                       bool initializing)
+{
+    // Already reported where the type was lost
+    if (value == TypeId::Unknown || target == TypeId::Unknown) {
+        return;
+    }
+
+    // Allow type promotion in assignments
+    if (value == TypeId::Int && target == TypeId::Float) {
+        return;
+    }
+    if (value == TypeId::Float && target == TypeId::Int) {
+        error(at, "Cannot assign float to int without explicit cast");
+        return;
+    }
+
+    if (value != target) {
+        if (initializing) {
+            error(at,
+                  std::string("Type mismatch: Cannot initialize variable of "
+                              "type '") +
+                    typeName(target) + "' with value of type '" +
+                    typeName(value) + "'");
+            return;
+        }
+        error(at,
+              std::string("Type mismatch in assignment: Cannot assign ") +
+                typeName(value) + " to " + typeName(target));
+    }
+}
+
+TypeId SemanticAnalyzer::visit(BinaryExpression& expr)
+{
+    TypeId leftType = annotate(*expr.getLeft());
+    TypeId rightType = annotate(*expr.getRight());
+    BinaryOp op = expr.getOperator();
+
+    if (op == BinaryOp::And || op == BinaryOp::Or) {
+        return TypeId::Bool;
+    }
+
+    if (leftType == TypeId::Unknown || rightType == TypeId::Unknown) {
+        return TypeId::Unknown;
+    }
+
+    if ((leftType == TypeId::Int && rightType == TypeId::Float) ||
+        (leftType == TypeId::Float && rightType == TypeId::Int)) {
+        return TypeId::Float;
+    }
+
+    if (leftType != rightType) {
+        error(expr,
+              std::string("Type mismatch in binary expression: ") +
+                typeName(leftType) + " " + BinaryExpression::opToString(op) +
+                " " + typeName(rightType));
+        return TypeId::Unknown;
+    }
+
+    return leftType;
+}
+
+TypeId SemanticAnalyzer::visit(LiteralExpression& expr)
+{
+    if (expr.isCharacterLiteral())
+        return TypeId::Char;
+    if (expr.isStringLiteral())
+        return TypeId::String;
+    if (expr.isFloatingPointLiteral())
+        return TypeId::Float;
+    return TypeId::Int;
+}
+
+TypeId SemanticAnalyzer::visit(VariableExpression& expr)
+{
+    SymbolTable::Variable variable =
+      lookup(expr, expr.getSymbol(), expr.getName());
+    expr.setOrdinal(variable.ordinal);
+    return variable.type;
+}
+
+TypeId SemanticAnalyzer::visit(CallExpression& expr)
+{
+    NodeList<ExpressionPtr> arguments = expr.getArguments();
+    for (ExpressionPtr argument : arguments) {
+        annotate(*argument);
+    }
+
+    const FunctionDeclaration* callee = functions.lookup(expr.getSymbol());
+    if (!callee || callee->getOffset() > expr.getOffset()) {
+        error(expr,
+              "Function '" + std::string(expr.getName()) +
+                "' is not declared");
+        return TypeId::Unknown;
+    }
+    expr.setFunction(callee);
+
+    NodeList<Parameter> parameters = callee->getParameters();
+    if (arguments.size() != parameters.size()) {
+        const char* noun =
+          parameters.size() == 1 ? " argument, not " : " arguments, not ";
+        error(expr,
+              "Function '" + std::string(expr.getName()) + "' takes " +
+                std::to_string(parameters.size()) + noun +
+                std::to_string(arguments.size()));
+    } else {
+        for (size_t i = 0; i < arguments.size(); ++i) {
+            TypeId type = arguments[i]->getType();
+            if (!converts(type, parameters[i].type)) {
+                error(*arguments[i],
+                      std::string("Type mismatch: Cannot pass value of "
+                                  "type '") +
+                        typeName(type) + "' as parameter '" +
+                        std::string(parameters[i].name) + "' of type '" +
+                        typeName(parameters[i].type) + "'");
+            }
+        }
+    }
+    return callee->getReturnType();
+}
+
+void SemanticAnalyzer::visit(BlockStatement& stmt)
+{
+    symTable.enterScope();
+    for (const auto& inner : stmt.getStatements()) {
+        visitStatement(*inner);
+    }
+    symTable.exitScope();
+}
+
+void SemanticAnalyzer::visit(VariableDeclaration& stmt)
+{
+    if (!symTable.declareVariable(stmt.getSymbol(), stmt.getType())) {
+        error(stmt,
+              "Variable '" + std::string(stmt.getName()) +
+                "' is already declared");
+    }
+    stmt.setOrdinal(symTable.lookupVariable(stmt.getSymbol()).ordinal);
+
+    if (Expression* initializer = stmt.getInitializer()) {
+        checkAssignable(stmt, stmt.getType(), annotate(*initializer), true);
+    }
+}
+
+void SemanticAnalyzer::visit(AssignmentStatement& stmt)
+{
+    TypeId valueType = annotate(*stmt.getValue());
+    SymbolTable::Variable variable =
+      lookup(stmt, stmt.getSymbol(), stmt.getName());
+    checkAssignable(stmt, variable.type, valueType, false);
+    stmt.setTargetType(variable.type);
+    stmt.setOrdinal(variable.ordinal);
+}
+
+void SemanticAnalyzer::visit(ExpressionStatement& stmt)
+{
+    annotate(*stmt.getExpression());
+}
+
+void SemanticAnalyzer::visit(ReturnStatement& stmt)
+{
+    if (!stmt.getReturnValue()) {
+        return;
+    }
+    TypeId type = annotate(*stmt.getReturnValue());
+    if (function && !returnable(type, function->getReturnType())) {
+        error(stmt,
+              std::string("Type mismatch: Cannot return value of type '") +
+                typeName(type) + "' from function returning '" +
+                typeName(function->getReturnType()) + "'");
+    }
+}
+
+void SemanticAnalyzer::visit(FunctionDeclaration& stmt)
+{
+    if (function) {
+        error(stmt,
+              "Function '" + std::string(stmt.getName()) +
+                "' cannot be defined inside another function");
+        return;
+    }
+    function = &stmt;
+    // Parameters share the scope of the body, which cannot redeclare them
+    symTable.enterScope();
+    for (const Parameter& parameter : stmt.getParameters()) {
+        if (!symTable.declareVariable(parameter.symbol, parameter.type)) {
+            error(stmt,
+                  "Parameter '" + std::string(parameter.name) +
+                    "' is already declared");
+        }
+    }
+    for (const auto& inner : stmt.getBody()) {
+        visitStatement(*inner);
+    }
+    symTable.exitScope();
+    function = nullptr;
+}
+
+void SemanticAnalyzer::checkCondition(Expression& condition,
+                                      const char* statement)
+{
+    TypeId type = annotate(condition);
+    if (type != TypeId::Int && type != TypeId::Bool &&
+        type != TypeId::Unknown) {
+        error(condition,
+              std::string("Condition in '") + statement +
+                "' statement must be of type int or bool");
+    }
+}
+
+void SemanticAnalyzer::visit(IfStatement& stmt)
+{
+    // Ensure the condition is a boolean expression
+    checkCondition(*stmt.getCondition(), "if");
+
+    // Check the semantics of the then branch
+    visitStatement(*stmt.getThenBranch());
+
+    // Check the semantics of the else branch (if it exists)
+    if (stmt.getElseBranch()) {
+        visitStatement(*stmt.getElseBranch());
+    }
+}
+
+void SemanticAnalyzer::visit(WhileStatement& stmt)
+{
+    checkCondition(*stmt.getCondition(), "while");
+    visitStatement(*stmt.getBody());
+}
+
+void SemanticAnalyzer::visit(DoWhileStatement& stmt)
+{
+    visitStatement(*stmt.getBody());
+    checkCondition(*stmt.getCondition(), "do");
+}
+
+void SemanticAnalyzer::visit(ForStatement& stmt)
+{
+    // A variable the initializer declares is visible to the rest of the
+    // loop only
+    symTable.enterScope();
+    if (stmt.getInitializer()) {
+        visitStatement(*stmt.getInitializer());
+    }
+    if (stmt.getCondition()) {
+        checkCondition(*stmt.getCondition(), "for");
+    }
+    if (stmt.getUpdate()) {
+        visitStatement(*stmt.getUpdate());
+    }
+    visitStatement(*stmt.getBody());
+    symTable.exitScope();
+}
+
+void SemanticAnalyzer::visit(TranslationUnit& unit)
+{
+    // Several statements are all functions, each opening a scope of its own
+    // over the empty global one, so checking them in turn is the same as
+    // checking each with a fresh table, which is what Parser does when it
+    // checks them concurrently
+    for (const auto& inner : unit.getStatements()) {
+        visitStatement(*inner);
+    }
+}
@@ -0,0 +1,140 @@
+#include "SourceBuffer.hpp"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+class FileDescriptor
+{
+public:
+    explicit FileDescriptor(int fd) noexcept
+      : fd(fd)
+    {
+    }
+    FileDescriptor(const FileDescriptor&) = delete;
+    FileDescriptor& operator=(const FileDescriptor&) = delete;
+    ~FileDescriptor()
+    {
+        if (fd > STDIN_FILENO) {
+            ::close(fd);
+        }
+    }
+
+    int get() const noexcept { return fd; }
+
+private:
+    int fd;
+};
+
+} // namespace
+
+SourceBuffer SourceBuffer::open(const std::string& filePath)
+{
+    bool fromStdin = filePath == "-";
+    FileDescriptor fd(fromStdin ? STDIN_FILENO
+                                : ::open(filePath.c_str(), O_RDONLY));
+    if (fd.get() < 0) {
+        throw std::runtime_error("Could not open input file: " + filePath);
+    }
+
+    SourceBuffer buffer;
+
+    struct stat info;
+    if (::fstat(fd.get(), &info) == 0 && S_ISREG(info.st_mode)) {
+        if (info.st_size == 0) {
+            return buffer;
+        }
+
+        auto length = static_cast<size_t>(info.st_size);
+        void* region =
+          ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd.get(), 0);
+        if (region != MAP_FAILED) {
+            ::madvise(region, length, MADV_SEQUENTIAL);
+            buffer.data = static_cast<const char*>(region);
+            buffer.size = length;
+            buffer.mapped = true;
+            return buffer;
+        }
+        // Some filesystems refuse mmap; fall through to plain reads
+    }
+
+    buffer.readChunks(fd.get(), filePath);
+    return buffer;
+}
+
+void SourceBuffer::readChunks(int fd, const std::string& filePath)
+{
+    size_t capacity = ChunkSize;
+    owned.reset(new char[capacity]);
+    size = 0;
+
+    while (true) {
+        if (capacity - size < ChunkSize) {
+            std::unique_ptr<char[]> grown(new char[capacity * 2]);
+            std::memcpy(grown.get(), owned.get(), size);
+            owned = std::move(grown);
+            capacity *= 2;
+        }
+
+        ssize_t count = ::read(fd, owned.get() + size, capacity - size);
+        if (count == 0) {
+            break;
+        }
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("Could not read input file: " + filePath);
+        }
+        size += static_cast<size_t>(count);
+    }
+
+    data = owned.get();
+}
+
+SourceBuffer::SourceBuffer(SourceBuffer&& other) noexcept
+  : data(other.data)
+  , size(other.size)
+  , mapped(other.mapped)
+  , owned(std::move(other.owned))
+{
+    other.data = nullptr;
+    other.size = 0;
+    other.mapped = false;
+}
+
+SourceBuffer& SourceBuffer::operator=(SourceBuffer&& other) noexcept
+{
+    if (this != &other) {
+        release();
+        data = other.data;
+        size = other.size;
+        mapped = other.mapped;
+        owned = std::move(other.owned);
+        other.data = nullptr;
+        other.size = 0;
+        other.mapped = false;
+    }
+    return *this;
+}
+
+SourceBuffer::~SourceBuffer()
+{
+    release();
+}
+
+void SourceBuffer::release() noexcept
+{
+    if (mapped) {
+        ::munmap(const_cast<char*>(data), size);
+    }
+    owned.reset();
+    data = nullptr;
+    size = 0;
+    mapped = false;
+}
@@ -0,0 +1,51 @@
+#include "SourceMap.hpp"
+#include <algorithm>
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+SourceMap::SourceMap(std::string_view source)
+{
+    lineStarts.reserve(source.size() / 32 + 1);
+    lineStarts.push_back(0);
+
+    const char* begin = source.data();
+    const char* end = begin + source.size();
+    const char* p = begin;
+
+#if defined(__SSE2__)
+    // Sixteen bytes per step; each set bit of the mask is a newline
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; end - p >= 16; p += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        auto mask = static_cast<unsigned>(
+          _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline)));
+        while (mask != 0) {
+            auto bit = static_cast<unsigned>(__builtin_ctz(mask));
+            lineStarts.push_back(
+              static_cast<std::uint32_t>(p - begin + bit + 1));
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    while (const void* found = std::memchr(p, '\n', end - p)) {
+        p = static_cast<const char*>(found) + 1;
+        lineStarts.push_back(static_cast<std::uint32_t>(p - begin));
+    }
+}
+
+SourceLocation SourceMap::locate(size_t offset) const noexcept
+{
+    if (lineStarts.empty()) {
+        return SourceLocation();
+    }
+
+    // Last line start at or before the offset
+    auto next = std::upper_bound(
+      lineStarts.begin(), lineStarts.end(), static_cast<std::uint32_t>(offset));
+    size_t line = static_cast<size_t>(next - lineStarts.begin());
+    return SourceLocation{ static_cast<int>(line),
+                           static_cast<int>(offset - *(next - 1) + 1) };
+}
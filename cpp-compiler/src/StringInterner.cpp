@@ -0,0 +1,108 @@
+#include "StringInterner.hpp"
+#include <algorithm>
+#include <cstring>
+
+Symbol StringInterner::intern(std::string_view text)
+{
+    std::uint32_t textHash = hash(text);
+    size_t slot = findSlot(text, textHash);
+    if (slots[slot].symbol != InvalidSymbol) {
+        return slots[slot].symbol;
+    }
+
+    auto symbol = static_cast<Symbol>(strings.size());
+    strings.push_back(store(text));
+    slots[slot] = Slot{ textHash, symbol };
+
+    // Keep the load factor at or below one half
+    if (strings.size() * 2 > slots.size()) {
+        grow();
+    }
+    return symbol;
+}
+
+Symbol StringInterner::find(std::string_view text) const noexcept
+{
+    return slots[findSlot(text, hash(text))].symbol;
+}
+
+void StringInterner::clear() noexcept
+{
+    std::fill(slots.begin(), slots.end(), Slot{});
+    strings.clear();
+    oversized.clear();
+    chunksInUse = 0;
+    current = nullptr;
+    chunkUsed = ChunkSize;
+}
+
+std::uint32_t StringInterner::hash(std::string_view text) noexcept
+{
+    // FNV-1a; identifiers are short, so a byte loop beats anything wider
+    std::uint32_t h = 2166136261u;
+    for (unsigned char c : text) {
+        h = (h ^ c) * 16777619u;
+    }
+    return h;
+}
+
+size_t StringInterner::findSlot(std::string_view text,
+                                std::uint32_t textHash) const noexcept
+{
+    size_t mask = slots.size() - 1;
+    size_t slot = textHash & mask;
+    while (slots[slot].symbol != InvalidSymbol) {
+        if (slots[slot].hash == textHash &&
+            strings[slots[slot].symbol] == text) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+void StringInterner::grow()
+{
+    std::vector<Slot> old(slots.size() * 2);
+    old.swap(slots);
+
+    size_t mask = slots.size() - 1;
+    for (const Slot& entry : old) {
+        if (entry.symbol == InvalidSymbol) {
+            continue;
+        }
+        size_t slot = entry.hash & mask;
+        while (slots[slot].symbol != InvalidSymbol) {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = entry;
+    }
+}
+
+std::string_view StringInterner::store(std::string_view text)
+{
+    if (text.empty()) {
+        return std::string_view();
+    }
+
+    if (text.size() > ChunkSize / 4) {
+        // Oversized spellings get a dedicated block so they don't waste the
+        // tail of the current chunk
+        oversized.emplace_back(new char[text.size()]);
+        std::memcpy(oversized.back().get(), text.data(), text.size());
+        return std::string_view(oversized.back().get(), text.size());
+    }
+
+    if (chunkUsed + text.size() > ChunkSize) {
+        if (chunksInUse == chunks.size()) {
+            chunks.emplace_back(new char[ChunkSize]);
+        }
+        current = chunks[chunksInUse++].get();
+        chunkUsed = 0;
+    }
+
+    char* dest = current + chunkUsed;
+    std::memcpy(dest, text.data(), text.size());
+    chunkUsed += text.size();
+    return std::string_view(dest, text.size());
+}
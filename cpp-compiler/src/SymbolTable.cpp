@@ -0,0 +1,111 @@
+#include "SymbolTable.hpp"
+#include <algorithm>
+
+SymbolTable::SymbolTable()
+  : slots(64)
+{
+    enterScope();
+}
+
+void SymbolTable::reset() noexcept
+{
+    std::fill(slots.begin(), slots.end(), Slot{});
+    bindings.clear();
+    scopeStarts.resize(1);
+    scopeStarts[0] = 0;
+    usedSlots = 0;
+    restartOrdinals();
+}
+
+void SymbolTable::enterScope()
+{
+    if (scopeStarts.size() == 1) {
+        restartOrdinals();
+    }
+    scopeStarts.push_back(static_cast<std::uint32_t>(bindings.size()));
+}
+
+void SymbolTable::exitScope() noexcept
+{
+    std::uint32_t start = scopeStarts.back();
+    scopeStarts.pop_back();
+
+    while (bindings.size() > start) {
+        const Binding& binding = bindings.back();
+        // Slots keep their symbol once claimed, so probe chains stay intact
+        slots[findSlot(binding.name)].binding = binding.shadowed;
+        bindings.pop_back();
+    }
+}
+
+bool SymbolTable::declareVariable(Symbol name, TypeId type)
+{
+    size_t slot = findSlot(name);
+    auto depth = static_cast<std::uint32_t>(scopeStarts.size());
+    std::uint32_t previous = slots[slot].binding;
+
+    if (previous != NoBinding && bindings[previous].depth == depth) {
+        return false;
+    }
+
+    if (slots[slot].name == InvalidSymbol) {
+        slots[slot].name = name;
+        ++usedSlots;
+    }
+    if (name >= ordinals.size()) {
+        ordinals.resize(name + 1, 0);
+    }
+    if (ordinals[name] == 0) {
+        counted.push_back(name);
+    }
+    slots[slot].binding = static_cast<std::uint32_t>(bindings.size());
+    bindings.push_back(
+      Binding{ name, type, depth, previous, ordinals[name]++ });
+
+    // Keep the load factor at or below one half
+    if (usedSlots * 2 > slots.size()) {
+        grow();
+    }
+    return true;
+}
+
+void SymbolTable::restartOrdinals() noexcept
+{
+    for (Symbol name : counted) {
+        ordinals[name] = 0;
+    }
+    counted.clear();
+}
+
+void SymbolTable::grow()
+{
+    std::vector<Slot> old(slots.size() * 2);
+    old.swap(slots);
+
+    for (const Slot& entry : old) {
+        if (entry.name != InvalidSymbol) {
+            slots[findSlot(entry.name)] = entry;
+        }
+    }
+}
+
+void FunctionTable::reset() noexcept
+{
+    for (Symbol name : declared) {
+        functions[name] = nullptr;
+    }
+    declared.clear();
+}
+
+bool FunctionTable::declare(Symbol name, const FunctionDeclaration& function)
+{
+    if (name >= functions.size()) {
+        functions.resize(name + 1, nullptr);
+    }
+    if (functions[name]) {
+        return false;
+    }
+    functions[name] = &function;
+    declared.push_back(name);
+    return true;
+}
@@ -0,0 +1,65 @@
+#include "TAC.hpp"
+#include <charconv>
+
+Operand TACProgram::newLabel()
+{
+    char name[16] = { 'L' };
+    for (;;) {
+        auto end =
+          std::to_chars(name + 1, name + sizeof(name), ++labelCount).ptr;
+        std::string_view spelling(name, static_cast<size_t>(end - name));
+        if (strings.find(spelling) == InvalidSymbol) {
+            return label(spelling);
+        }
+    }
+}
+
+Operand TACProgram::newVariable(std::string_view name)
+{
+    std::string spelling(name);
+    spelling += '.';
+    size_t stem = spelling.size();
+    for (;;) {
+        char digits[16];
+        auto end =
+          std::to_chars(digits, digits + sizeof(digits), ++variableCount).ptr;
+        spelling.resize(stem);
+        spelling.append(digits, end);
+        if (strings.find(spelling) == InvalidSymbol) {
+            return variable(spelling);
+        }
+    }
+}
+
+void TACProgram::appendOperand(std::string& out, Operand operand) const
+{
+    switch (operand.kind()) {
+        case Operand::Kind::None:
+            break;
+        case Operand::Kind::Temp: {
+            char digits[16];
+            auto end =
+              std::to_chars(digits, digits + sizeof(digits), operand.index()).ptr;
+            out += 't';
+            out.append(digits, end);
+            break;
+        }
+        case Operand::Kind::Slot: {
+            char digits[16];
+            auto end = std::to_chars(
+                         digits, digits + sizeof(digits), operand.index())
+                         .ptr;
+            out += "[s";
+            out.append(digits, end);
+            out += ']';
+            break;
+        }
+        case Operand::Kind::Variable:
+        case Operand::Kind::Constant:
+        case Operand::Kind::Label:
+        case Operand::Kind::Function:
+        case Operand::Kind::Register:
+            out += text(operand);
+            break;
+    }
+}
@@ -0,0 +1,215 @@
+#include "TACImage.hpp"
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+static_assert(std::is_trivially_copyable_v<TACInstruction>,
+              "TAC images store instructions as raw bytes");
+static_assert(alignof(TACInstruction) <= alignof(std::uint32_t),
+              "TAC images only guarantee 4-byte alignment");
+
+namespace {
+
+constexpr Opcode LastOpcode = Opcode::Function;
+constexpr TypeId LastType = TypeId::Bool;
+
+[[noreturn]] void corrupt(const char* reason)
+{
+    throw std::runtime_error(std::string("Corrupt TAC image: ") + reason);
+}
+
+} // namespace
+
+size_t writeTACImage(const TACProgram& program, OutputSink& sink)
+{
+    const StringInterner& table = program.getStrings();
+    auto stringCount = static_cast<std::uint32_t>(table.size());
+
+    std::vector<std::uint32_t> offsets;
+    offsets.reserve(stringCount + 1);
+    size_t stringBytes = 0;
+    for (std::uint32_t i = 0; i < stringCount; ++i) {
+        offsets.push_back(static_cast<std::uint32_t>(stringBytes));
+        stringBytes += table.lookup(i).size();
+    }
+    if (stringBytes > UINT32_MAX || program.code.size() > UINT32_MAX) {
+        throw std::runtime_error("Program is too large for a TAC image");
+    }
+    offsets.push_back(static_cast<std::uint32_t>(stringBytes));
+
+    TACImageHeader header{};
+    std::memcpy(header.magic, TACImageHeader::Magic, sizeof(header.magic));
+    header.version = TACImageHeader::CurrentVersion;
+    header.byteOrder = TACImageHeader::ByteOrderMark;
+    header.instructionCount = static_cast<std::uint32_t>(program.code.size());
+    header.tempCount = program.getTempCount();
+    header.stringCount = stringCount;
+    header.stringBytes = static_cast<std::uint32_t>(stringBytes);
+    header.slotCount = program.getSlotCount();
+
+    std::string data;
+    data.reserve(stringBytes);
+    for (std::uint32_t i = 0; i < stringCount; ++i) {
+        data += table.lookup(i);
+    }
+
+    size_t codeBytes = program.code.size() * sizeof(TACInstruction);
+    size_t offsetBytes = offsets.size() * sizeof(std::uint32_t);
+    sink.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    sink.write(reinterpret_cast<const char*>(program.code.data()), codeBytes);
+    sink.write(reinterpret_cast<const char*>(offsets.data()), offsetBytes);
+    sink.write(data.data(), data.size());
+    return sizeof(header) + codeBytes + offsetBytes + data.size();
+}
+
+bool TACImage::isImage(std::string_view bytes) noexcept
+{
+    return bytes.size() >= sizeof(TACImageHeader::Magic) &&
+           std::memcmp(bytes.data(),
+                       TACImageHeader::Magic,
+                       sizeof(TACImageHeader::Magic)) == 0;
+}
+
+TACImage TACImage::open(const std::string& filePath)
+{
+    TACImage image;
+    image.storage = SourceBuffer::open(filePath);
+    image.bind(image.storage.view());
+    return image;
+}
+
+TACImage TACImage::fromBytes(std::string_view bytes)
+{
+    TACImage image;
+    image.bind(bytes);
+    return image;
+}
+
+void TACImage::bind(std::string_view bytes)
+{
+    if (!isImage(bytes) || bytes.size() < sizeof(TACImageHeader)) {
+        corrupt("missing header");
+    }
+    if (reinterpret_cast<std::uintptr_t>(bytes.data()) %
+          alignof(std::uint32_t) !=
+        0) {
+        corrupt("misaligned buffer");
+    }
+
+    header = reinterpret_cast<const TACImageHeader*>(bytes.data());
+    if (header->byteOrder != TACImageHeader::ByteOrderMark) {
+        corrupt("written with the other byte order");
+    }
+    if (header->version < TACImageHeader::OldestReadableVersion ||
+        header->version > TACImageHeader::CurrentVersion) {
+        throw std::runtime_error("Unsupported TAC image version " +
+                                 std::to_string(header->version));
+    }
+
+    // 64-bit arithmetic, so no count in the header can wrap the total
+    std::uint64_t codeBytes =
+      std::uint64_t(header->instructionCount) * sizeof(TACInstruction);
+    std::uint64_t offsetBytes =
+      (std::uint64_t(header->stringCount) + 1) * sizeof(std::uint32_t);
+    std::uint64_t expected =
+      sizeof(TACImageHeader) + codeBytes + offsetBytes + header->stringBytes;
+    if (bytes.size() < expected) {
+        corrupt("truncated");
+    }
+
+    const char* cursor = bytes.data() + sizeof(TACImageHeader);
+    code = reinterpret_cast<const TACInstruction*>(cursor);
+    cursor += codeBytes;
+    offsets = reinterpret_cast<const std::uint32_t*>(cursor);
+    cursor += offsetBytes;
+    strings = cursor;
+}
+
+std::string_view TACImage::string(std::uint32_t index) const noexcept
+{
+    if (index >= header->stringCount) {
+        return {};
+    }
+    std::uint32_t first = offsets[index];
+    std::uint32_t last = offsets[index + 1];
+    if (first > last || last > header->stringBytes) {
+        return {};
+    }
+    return { strings + first, last - first };
+}
+
+void TACImage::verify() const
+{
+    std::uint32_t previous = 0;
+    for (std::uint32_t i = 0; i <= header->stringCount; ++i) {
+        if (offsets[i] < previous || offsets[i] > header->stringBytes) {
+            corrupt("string offsets out of order");
+        }
+        previous = offsets[i];
+    }
+    if (offsets[header->stringCount] != header->stringBytes) {
+        corrupt("string table size mismatch");
+    }
+
+    for (const TACInstruction& instruction : *this) {
+        if (instruction.op > LastOpcode || instruction.type > LastType) {
+            corrupt("unknown opcode or type");
+        }
+        if ((instruction.op == Opcode::Call &&
+             !instruction.arg1.is(Operand::Kind::Function)) ||
+            (instruction.op == Opcode::Function &&
+             !instruction.result.is(Operand::Kind::Function))) {
+            corrupt("function operand expected");
+        }
+        for (Operand operand :
+             { instruction.arg1, instruction.arg2, instruction.result }) {
+            switch (operand.kind()) {
+                case Operand::Kind::None:
+                    if (!operand.isNone()) {
+                        corrupt("malformed operand");
+                    }
+                    break;
+                case Operand::Kind::Temp:
+                    if (operand.index() >= header->tempCount) {
+                        corrupt("temp out of range");
+                    }
+                    break;
+                case Operand::Kind::Slot:
+                    if (operand.index() >= header->slotCount) {
+                        corrupt("slot out of range");
+                    }
+                    break;
+                case Operand::Kind::Variable:
+                case Operand::Kind::Constant:
+                case Operand::Kind::Label:
+                case Operand::Kind::Function:
+                case Operand::Kind::Register:
+                    if (operand.index() >= header->stringCount) {
+                        corrupt("string index out of range");
+                    }
+                    break;
+                default:
+                    corrupt("unknown operand kind");
+            }
+        }
+    }
+}
+
+TACProgram TACImage::toProgram() const
+{
+    verify();
+
+    TACProgram program;
+    for (std::uint32_t i = 0; i < header->stringCount; ++i) {
+        // Tables written by writeTACImage hold each spelling once, so
+        // interning in order reproduces the original indices
+        if (program.variable(string(i)).index() != i) {
+            corrupt("duplicate string");
+        }
+    }
+    program.code.assign(begin(), end());
+    program.setTempCount(header->tempCount);
+    program.setSlotCount(header->slotCount);
+    return program;
+}
@@ -0,0 +1,155 @@
+#include "ThreadPool.hpp"
+#include <exception>
+
+namespace {
+
+thread_local const ThreadPool* currentPool = nullptr;
+thread_local unsigned currentIndex = ThreadPool::NotAWorker;
+
+} // namespace
+
+ThreadPool::ThreadPool(unsigned threadCount)
+{
+    if (threadCount == 0) {
+        threadCount = std::thread::hardware_concurrency();
+    }
+    if (threadCount == 0) {
+        threadCount = 1;
+    }
+
+    queues.reserve(threadCount);
+    for (unsigned i = 0; i < threadCount; ++i) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+
+    workers.reserve(threadCount);
+    for (unsigned i = 0; i < threadCount; ++i) {
+        workers.emplace_back([this, i] { workerLoop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        stopping = true;
+    }
+    wakeup.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+unsigned ThreadPool::currentWorker() noexcept
+{
+    return currentIndex;
+}
+
+void ThreadPool::submit(Task task)
+{
+    unsigned target = currentPool == this
+                        ? currentIndex
+                        : nextQueue.fetch_add(1, std::memory_order_relaxed) %
+                            size();
+    // Count the task before publishing it so a fast worker can never finish
+    // it before it has been counted
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        ++queued;
+        ++pending;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queues[target]->mutex);
+        queues[target]->tasks.push_back(std::move(task));
+    }
+    wakeup.notify_one();
+}
+
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock(stateMutex);
+    idle.wait(lock, [this] { return pending == 0; });
+}
+
+void ThreadPool::forEach(size_t count,
+                         const std::function<void(size_t)>& body)
+{
+    std::mutex failureMutex;
+    std::exception_ptr failure;
+    for (size_t i = 0; i < count; ++i) {
+        submit([&, i] {
+            try {
+                body(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(failureMutex);
+                if (!failure) {
+                    failure = std::current_exception();
+                }
+            }
+        });
+    }
+    wait();
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+}
+
+bool ThreadPool::tryPop(unsigned index, Task& task)
+{
+    {
+        Queue& own = *queues[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+
+    for (unsigned offset = 1; offset < size(); ++offset) {
+        Queue& victim = *queues[(index + offset) % size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(unsigned index)
+{
+    currentPool = this;
+    currentIndex = index;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(stateMutex);
+            wakeup.wait(lock, [this] { return stopping || queued > 0; });
+            if (stopping && queued == 0) {
+                return;
+            }
+        }
+
+        Task task;
+        if (!tryPop(index, task)) {
+            // Another worker got there first, or the task is counted but
+            // not yet in its deque
+            std::this_thread::yield();
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            --queued;
+        }
+
+        task();
+
+        std::lock_guard<std::mutex> lock(stateMutex);
+        if (--pending == 0) {
+            idle.notify_all();
+        }
+    }
+}
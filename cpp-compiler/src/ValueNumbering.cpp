@@ -0,0 +1,378 @@
+#include "Optimizer.hpp"
+
+namespace {
+
+constexpr std::uint32_t NoValue = UINT32_MAX;
+
+// Temps and variables share one numbering: temp t is t, variable v is
+// tempCount + v. Everything else has no value slot.
+struct ValueIndex
+{
+    std::uint32_t tempCount;
+
+    std::uint32_t operator()(Operand operand) const noexcept
+    {
+        if (operand.is(Operand::Kind::Temp) && operand.index() < tempCount) {
+            return operand.index();
+        }
+        if (operand.is(Operand::Kind::Variable)) {
+            return tempCount + operand.index();
+        }
+        return NoValue;
+    }
+};
+
+bool endsBlock(Opcode op) noexcept
+{
+    return op == Opcode::Goto || op == Opcode::IfFalse || op == Opcode::Ret;
+}
+
+bool startsBlock(Opcode op) noexcept
+{
+    return op == Opcode::Label || op == Opcode::Function;
+}
+
+// Numbers the basic blocks on a single forward walk: `stamp` changes at
+// every LABEL or FUNCTION and after every jump or return
+class BlockStamp
+{
+public:
+    std::uint32_t next(Opcode op) noexcept
+    {
+        if (startsBlock(op) || ended) {
+            ++stamp;
+        }
+        ended = endsBlock(op);
+        return stamp;
+    }
+
+private:
+    std::uint32_t stamp = 1;
+    bool ended = false;
+};
+
+bool isExpression(Opcode op) noexcept
+{
+    return op >= Opcode::Add && op <= Opcode::Or;
+}
+
+bool commutes(Opcode op, TypeId type) noexcept
+{
+    switch (op) {
+        case Opcode::Add:
+            // Could be string concatenation
+            return type != TypeId::String && type != TypeId::Unknown;
+        case Opcode::Multiply:
+        case Opcode::Equal:
+        case Opcode::NotEqual:
+        case Opcode::And:
+        case Opcode::Or:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Fixed-size open-addressing table from (op, type, value, value) to the
+// value number of the result. Entries carry the stamp of the block that
+// made them and anything older counts as an empty slot, so moving to the
+// next block clears the table without touching it. A key whose short probe
+// run is full replaces the entry at its home slot: the table is a cache of
+// recent expressions small enough to stay in L2, and a dropped entry only
+// costs a missed match, however large the block.
+class ExpressionTable
+{
+public:
+    struct Key
+    {
+        Opcode op;
+        TypeId type;
+        std::uint32_t left;
+        std::uint32_t right;
+
+        bool operator==(const Key& other) const noexcept
+        {
+            return op == other.op && type == other.type &&
+                   left == other.left && right == other.right;
+        }
+    };
+
+    // Value number stored for `key` in block `stamp`; a key the block has
+    // not seen yet gets a slot holding NoValue for the caller to fill
+    std::uint32_t& findOrAdd(const Key& key, std::uint32_t stamp) noexcept
+    {
+        size_t home = hash(key) & (Size - 1);
+        for (size_t step = 0; step < ProbeLimit; ++step) {
+            Slot& slot = slots[(home + step) & (Size - 1)];
+            if (slot.stamp != stamp) {
+                slot = { key, NoValue, stamp };
+                return slot.value;
+            }
+            if (slot.key == key) {
+                return slot.value;
+            }
+        }
+        Slot& slot = slots[home];
+        slot = { key, NoValue, stamp };
+        return slot.value;
+    }
+
+private:
+    static constexpr size_t Size = 1 << 14;
+    static constexpr size_t ProbeLimit = 8;
+
+    struct Slot
+    {
+        Key key{};
+        std::uint32_t value = NoValue;
+        std::uint32_t stamp = 0;
+    };
+
+    std::vector<Slot> slots = std::vector<Slot>(Size);
+
+    static std::uint64_t hash(const Key& key) noexcept
+    {
+        std::uint64_t h = (std::uint64_t(key.left) << 32) | key.right;
+        h ^= (std::uint64_t(key.op) << 8 | std::uint64_t(key.type)) << 48;
+        h *= 0x9E3779B97F4A7C15ull;
+        return h >> 40;
+    }
+};
+
+} // namespace
+
+size_t foldCopies(TACProgram& program)
+{
+    auto& code = program.code;
+    std::uint32_t tempCount = program.getTempCount();
+    ValueIndex valueOf{ tempCount };
+
+    std::vector<std::uint32_t> uses(tempCount, 0);
+    for (const TACInstruction& instruction : code) {
+        for (Operand operand : { instruction.arg1, instruction.arg2 }) {
+            if (operand.is(Operand::Kind::Temp) &&
+                operand.index() < tempCount) {
+                ++uses[operand.index()];
+            }
+        }
+    }
+
+    // Position of the latest write of each temp, and of the latest read or
+    // write of each variable
+    auto valueCount =
+      static_cast<std::uint32_t>(tempCount + program.getStrings().size());
+    std::vector<std::uint32_t> lastDefinition(tempCount, NoValue);
+    std::vector<std::uint32_t> lastTouch(valueCount, NoValue);
+    std::vector<std::uint8_t> dead(code.size(), 0);
+    bool any = false;
+    std::uint32_t blockBegin = 0;
+    for (std::uint32_t i = 0; i < code.size(); ++i) {
+        const TACInstruction& instruction = code[i];
+        if (startsBlock(instruction.op) ||
+            (i > 0 && endsBlock(code[i - 1].op))) {
+            blockBegin = i;
+        }
+
+        // OP a b tN ... MOV tN v becomes OP a b v when the MOV is the only
+        // read of tN and nothing after the OP touches v before it
+        Operand source = instruction.arg1;
+        Operand target = instruction.result;
+        if (instruction.op == Opcode::Mov &&
+            source.is(Operand::Kind::Temp) && source.index() < tempCount &&
+            target.is(Operand::Kind::Variable) &&
+            uses[source.index()] == 1) {
+            std::uint32_t at = lastDefinition[source.index()];
+            std::uint32_t touched = lastTouch[valueOf(target)];
+            if (at != NoValue && at >= blockBegin &&
+                (touched == NoValue || touched <= at)) {
+                TACInstruction& definition = code[at];
+                // Different known types mean the MOV converts
+                if (definition.type == TypeId::Unknown ||
+                    instruction.type == TypeId::Unknown ||
+                    definition.type == instruction.type) {
+                    definition.result = target;
+                    lastTouch[valueOf(target)] = i;
+                    dead[i] = 1;
+                    any = true;
+                    continue;
+                }
+            }
+        }
+
+        for (Operand operand : { instruction.arg1, instruction.arg2 }) {
+            if (operand.is(Operand::Kind::Variable)) {
+                lastTouch[valueOf(operand)] = i;
+            }
+        }
+        if (target.is(Operand::Kind::Temp) && target.index() < tempCount) {
+            lastDefinition[target.index()] = i;
+        } else if (target.is(Operand::Kind::Variable)) {
+            lastTouch[valueOf(target)] = i;
+        }
+    }
+    return any ? eraseInstructions(code, dead) : 0;
+}
+
+size_t eliminateCommonSubexpressions(TACProgram& program)
+{
+    auto& code = program.code;
+    std::uint32_t tempCount = program.getTempCount();
+    ValueIndex valueOf{ tempCount };
+    auto valueCount =
+      static_cast<std::uint32_t>(tempCount + program.getStrings().size());
+
+    // Value number of each temp and variable, valid while its stamp is the
+    // current block's. Constants keep theirs for the whole program.
+    struct Numbered
+    {
+        std::uint32_t value = NoValue;
+        std::uint32_t stamp = 0;
+    };
+    std::vector<Numbered> numbers(valueCount);
+    std::vector<std::uint32_t> constants(program.getStrings().size(), NoValue);
+    // An operand that held each value number when it was made
+    std::vector<Operand> holders;
+    holders.reserve(code.size());
+    ExpressionTable expressions;
+    BlockStamp blocks;
+    std::uint32_t stamp = 0;
+
+    auto fresh = [&holders](Operand holder) {
+        holders.push_back(holder);
+        return static_cast<std::uint32_t>(holders.size() - 1);
+    };
+    // Current value number of `operand`, or NoValue if it has none yet
+    auto lookup = [&](Operand operand) -> std::uint32_t {
+        if (operand.is(Operand::Kind::Constant)) {
+            return constants[operand.index()];
+        }
+        std::uint32_t index = valueOf(operand);
+        if (index == NoValue || numbers[index].stamp != stamp) {
+            return NoValue;
+        }
+        return numbers[index].value;
+    };
+    auto number = [&](Operand operand) {
+        std::uint32_t value = lookup(operand);
+        if (value != NoValue) {
+            return value;
+        }
+        value = fresh(operand);
+        if (operand.is(Operand::Kind::Constant)) {
+            constants[operand.index()] = value;
+        } else if (std::uint32_t index = valueOf(operand); index != NoValue) {
+            numbers[index] = { value, stamp };
+        }
+        return value;
+    };
+    auto assign = [&](Operand result, std::uint32_t value) {
+        if (std::uint32_t index = valueOf(result); index != NoValue) {
+            numbers[index] = { value, stamp };
+            if (lookup(holders[value]) != value) {
+                holders[value] = result;
+            }
+        }
+    };
+
+    size_t changes = 0;
+    for (TACInstruction& instruction : code) {
+        stamp = blocks.next(instruction.op);
+        if (instruction.op == Opcode::Mov) {
+            assign(instruction.result, number(instruction.arg1));
+            continue;
+        }
+        if (!isExpression(instruction.op)) {
+            // What a call returns or a parameter receives is a new value
+            if (instruction.op == Opcode::Call ||
+                instruction.op == Opcode::Param) {
+                assign(instruction.result, fresh(instruction.result));
+            }
+            continue;
+        }
+
+        ExpressionTable::Key key{ instruction.op,
+                                  instruction.type,
+                                  number(instruction.arg1),
+                                  number(instruction.arg2) };
+        if (commutes(key.op, key.type) && key.left > key.right) {
+            std::swap(key.left, key.right);
+        }
+
+        std::uint32_t& value = expressions.findOrAdd(key, stamp);
+        if (value != NoValue && lookup(holders[value]) == value &&
+            holders[value] != instruction.result) {
+            instruction = TACInstruction(Opcode::Mov,
+                                         holders[value],
+                                         Operand(),
+                                         instruction.result,
+                                         instruction.type);
+            ++changes;
+        } else {
+            value = fresh(instruction.result);
+        }
+        assign(instruction.result, value);
+    }
+    return changes;
+}
+
+size_t propagateCopies(TACProgram& program)
+{
+    auto& code = program.code;
+    std::uint32_t tempCount = program.getTempCount();
+    ValueIndex valueOf{ tempCount };
+    auto valueCount =
+      static_cast<std::uint32_t>(tempCount + program.getStrings().size());
+
+    // Bumped on every write, so a recorded copy can tell whether its
+    // source still holds the value it copied
+    std::vector<std::uint32_t> versions(valueCount, 0);
+    struct Copy
+    {
+        Operand source;
+        std::uint32_t version = 0;
+        std::uint32_t stamp = 0;
+    };
+    std::vector<Copy> copies(tempCount);
+    BlockStamp blocks;
+
+    size_t changes = 0;
+    for (TACInstruction& instruction : code) {
+        std::uint32_t stamp = blocks.next(instruction.op);
+        for (Operand* operand : { &instruction.arg1, &instruction.arg2 }) {
+            if (!operand->is(Operand::Kind::Temp) ||
+                operand->index() >= tempCount) {
+                continue;
+            }
+            const Copy& copy = copies[operand->index()];
+            if (copy.stamp != stamp) {
+                continue;
+            }
+            std::uint32_t source = valueOf(copy.source);
+            if (source == NoValue || versions[source] == copy.version) {
+                *operand = copy.source;
+                ++changes;
+            }
+        }
+
+        std::uint32_t result = valueOf(instruction.result);
+        if (result == NoValue) {
+            continue;
+        }
+        ++versions[result];
+        if (instruction.result.is(Operand::Kind::Temp)) {
+            Copy& copy = copies[result];
+            copy.stamp = 0;
+            Operand source = instruction.arg1;
+            if (instruction.op == Opcode::Mov &&
+                source != instruction.result &&
+                (source.is(Operand::Kind::Constant) ||
+                 valueOf(source) != NoValue)) {
+                std::uint32_t index = valueOf(source);
+                copy = { source,
+                         index == NoValue ? 0 : versions[index],
+                         stamp };
+            }
+        }
+    }
+    return changes;
+}
@@ -0,0 +1,1382 @@
+#include "X86Writer.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include "ControlFlowGraph.hpp"
+#include "NativeTypes.hpp"
+
+namespace {
+
+constexpr size_t FlushThreshold = 1 << 20;
+constexpr std::uint32_t None = UINT32_MAX;
+
+struct GeneralRegister
+{
+    const char* name64;
+    const char* name32;
+    const char* name8;
+    bool calleeSaved;
+};
+
+// In the order allocatableRegisters hands them out: callee-saved first, so
+// small sets need no saves around calls
+constexpr GeneralRegister Allocatable[] = {
+    { "rbx", "ebx", "bl", true },     { "r12", "r12d", "r12b", true },
+    { "r13", "r13d", "r13b", true },  { "r14", "r14d", "r14b", true },
+    { "r15", "r15d", "r15b", true },  { "rsi", "esi", "sil", false },
+    { "rdi", "edi", "dil", false },   { "r8", "r8d", "r8b", false },
+    { "r9", "r9d", "r9b", false },    { "r10", "r10d", "r10b", false },
+    { "r11", "r11d", "r11b", false },
+};
+constexpr size_t AllocatableCount =
+  sizeof(Allocatable) / sizeof(Allocatable[0]);
+
+// Scratch registers results pass through on their way to a store
+constexpr GeneralRegister Rax{ "rax", "eax", "al", false };
+constexpr GeneralRegister Rdx{ "rdx", "edx", "dl", false };
+
+// Where the first six int, char, bool and string arguments are passed;
+// the first eight floats go in xmm0-xmm7 and the rest on the stack
+constexpr GeneralRegister ArgumentRegisters[] = {
+    { "rdi", "edi", "dil", false }, { "rsi", "esi", "sil", false },
+    { "rdx", "edx", "dl", false },  { "rcx", "ecx", "cl", false },
+    { "r8", "r8d", "r8b", false },  { "r9", "r9d", "r9b", false },
+};
+constexpr const char* FloatArgumentRegisters[] = {
+    "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7",
+};
+constexpr std::uint32_t IntArgumentCount = 6;
+constexpr std::uint32_t FloatArgumentCount = 8;
+
+bool isIntegral(TypeId type) noexcept
+{
+    return type != TypeId::Float && type != TypeId::String;
+}
+
+// What the flags say about a value after the instruction that set them
+enum class Flags : std::uint8_t
+{
+    None,
+    Less,
+    Greater,
+    Equal,
+    NotEqual,
+    // ucomisd of two doubles, ordered and greater
+    Above,
+    // Zero flag clear when the value is true
+    NonZero
+};
+
+const char* setInstruction(Flags flags) noexcept
+{
+    switch (flags) {
+        case Flags::Less:
+            return "setl";
+        case Flags::Greater:
+            return "setg";
+        case Flags::Equal:
+            return "sete";
+        case Flags::Above:
+            return "seta";
+        default:
+            return "setne";
+    }
+}
+
+const char* jumpIfFalse(Flags flags) noexcept
+{
+    switch (flags) {
+        case Flags::Less:
+            return "jge";
+        case Flags::Greater:
+            return "jle";
+        case Flags::Equal:
+            return "jne";
+        case Flags::Above:
+            return "jbe";
+        default:
+            return "je";
+    }
+}
+
+} // namespace
+
+class X86Writer::Lowering
+{
+public:
+    Lowering(X86Writer& writer, const TACProgram& program);
+
+    void run();
+
+private:
+    // Where an operand lives
+    struct Place
+    {
+        enum class Kind : std::uint8_t
+        {
+            Immediate,
+            Memory,
+            Register,
+            // A float or string literal in .rodata
+            Literal
+        };
+
+        Kind kind;
+        long long immediate = 0;
+        std::uint32_t offset = 0;
+        const GeneralRegister* reg = nullptr;
+        std::uint32_t literal = 0;
+    };
+
+    X86Writer& writer;
+    std::string& out;
+    const TACProgram& program;
+    std::uint32_t tempCount;
+    std::uint32_t stringCount;
+
+    // Declared type of each variable and the type last written to each
+    // temp, slot and register, all indexed like frameOffsets
+    std::vector<TypeId> types;
+    std::vector<std::uint32_t> uses;
+    // Frame offset of each temp, variable and slot in the current function
+    std::vector<std::uint32_t> frameOffsets;
+    std::vector<std::uint32_t> frameStamps;
+    std::uint32_t function = 0;
+    std::vector<const GeneralRegister*> pushed;
+    // Caller-saved registers the function uses, pushed around its calls
+    std::vector<const GeneralRegister*> callerSaved;
+    // ARGs of the call being lowered
+    std::vector<const TACInstruction*> arguments;
+    // Register and stack arguments the function's PARAMs have taken
+    std::uint32_t intParameters = 0;
+    std::uint32_t floatParameters = 0;
+    std::uint32_t stackParameters = 0;
+    // main returns the process exit status whatever its return expression
+    bool returnsInt = false;
+
+    std::vector<std::uint32_t> floatLiterals;
+    std::vector<std::uint32_t> stringLiterals;
+    std::vector<std::uint32_t> floatOrder;
+    std::vector<std::uint32_t> stringOrder;
+
+    Flags flags = Flags::None;
+    Operand flagsValue;
+
+    std::uint32_t slotIndex(Operand operand) const noexcept;
+    const GeneralRegister& registerOf(Operand operand) const;
+    TypeId typeOf(Operand operand) const;
+    void setType(Operand operand, TypeId type);
+    TypeId resultType(const TACInstruction& instruction) const;
+
+    void lowerFunction(std::uint32_t begin,
+                       std::uint32_t end,
+                       std::string_view name);
+    void lower(const TACInstruction& instruction, const TACInstruction* next);
+    void lowerMove(const TACInstruction& instruction);
+    void lowerIntArithmetic(const TACInstruction& instruction);
+    bool lowerWithLea(const TACInstruction& instruction);
+    void lowerDivision(const TACInstruction& instruction);
+    void lowerFloatArithmetic(const TACInstruction& instruction);
+    void lowerComparison(const TACInstruction& instruction, bool keepResult);
+    void lowerLogical(const TACInstruction& instruction, bool keepResult);
+    void lowerBranch(const TACInstruction& instruction);
+    void lowerParameter(const TACInstruction& instruction);
+    void lowerCall(const TACInstruction& instruction);
+    void pushArgument(const TACInstruction& argument);
+    void lowerReturn(const TACInstruction& instruction);
+    void epilogue();
+
+    Place place(Operand operand);
+    std::uint32_t floatLiteral(Operand constant);
+    void appendPlace(const Place& where, bool wide);
+    // `name xmm0, source`, with source read from memory where it can be
+    void floatInstruction(const char* name, Operand source);
+
+    void loadInt(const char* reg, Operand operand);
+    void loadFloat(const char* xmm, Operand operand);
+    void loadPointer(Operand operand);
+    void loadTruth(const char* reg, const char* reg8, Operand operand);
+    void storeInt(Operand result, const GeneralRegister& reg, TypeId from);
+    void storeFloat(Operand result, const char* xmm);
+    void materialize(Operand result);
+
+    void append(std::string_view text) { out += text; }
+    void append(long long value);
+    void line(std::string_view text);
+    void label(std::string_view name);
+    void appendLabel(Operand target);
+    void requireNumeric(const TACInstruction& instruction) const;
+};
+
+X86Writer::X86Writer(OutputSink& sink)
+  : sink(sink)
+{
+    buffer.reserve(FlushThreshold + 4096);
+}
+
+void X86Writer::write(const TACProgram& program)
+{
+    Lowering(*this, program).run();
+}
+
+void X86Writer::flush()
+{
+    if (!buffer.empty()) {
+        sink.write(buffer.data(), buffer.size());
+        written += buffer.size();
+        buffer.clear();
+    }
+}
+
+RegisterSet X86Writer::allocatableRegisters(size_t count)
+{
+    if (count == 0 || count > AllocatableCount) {
+        throw std::runtime_error("The x86-64 backend can allocate 1 to " +
+                                 std::to_string(AllocatableCount) +
+                                 " registers, not " + std::to_string(count));
+    }
+    std::vector<std::string> names;
+    for (size_t i = 0; i < count; ++i) {
+        names.push_back(Allocatable[i].name64);
+    }
+    return RegisterSet(std::move(names));
+}
+
+X86Writer::Lowering::Lowering(X86Writer& writer, const TACProgram& program)
+  : writer(writer)
+  , out(writer.buffer)
+  , program(program)
+  , tempCount(program.getTempCount())
+  , stringCount(static_cast<std::uint32_t>(program.getStrings().size()))
+{
+    size_t values = tempCount + stringCount + program.getSlotCount();
+    types.assign(values + stringCount, TypeId::Unknown);
+    uses.assign(tempCount, 0);
+    frameOffsets.assign(values, 0);
+    frameStamps.assign(values, 0);
+    floatLiterals.assign(stringCount, None);
+    stringLiterals.assign(stringCount, None);
+
+    for (const TACInstruction& instruction : program.code) {
+        for (Operand operand : { instruction.arg1, instruction.arg2 }) {
+            if (operand.is(Operand::Kind::Temp) &&
+                operand.index() < tempCount) {
+                ++uses[operand.index()];
+            }
+        }
+    }
+}
+
+void X86Writer::Lowering::run()
+{
+    const auto& code = program.code;
+    line(".intel_syntax noprefix");
+    line(".text");
+
+    if (!code.empty()) {
+        ControlFlowGraph graph(program);
+        std::vector<std::uint32_t> starts;
+        for (BlockId entry : graph.getEntries()) {
+            starts.push_back(graph.block(entry).begin);
+        }
+        std::sort(starts.begin(), starts.end());
+        starts.push_back(static_cast<std::uint32_t>(code.size()));
+
+        for (size_t i = 0; i + 1 < starts.size(); ++i) {
+            const TACInstruction& first = code[starts[i]];
+            // Only a program without functions starts unlabeled
+            std::string_view name = first.op == Opcode::Function
+                                      ? program.text(first.result)
+                                      : std::string_view("main");
+            lowerFunction(starts[i], starts[i + 1], name);
+        }
+    }
+
+    if (!floatOrder.empty()) {
+        line(".section .rodata");
+        line(".p2align 3");
+        for (size_t i = 0; i < floatOrder.size(); ++i) {
+            double value = literalFloat(program.text(
+              Operand::make(Operand::Kind::Constant, floatOrder[i])));
+            std::uint64_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            append(".Lfp");
+            append(static_cast<long long>(i));
+            append(":\n\t.quad ");
+            append(std::to_string(bits));
+            append("\n");
+        }
+    }
+    if (!stringOrder.empty()) {
+        line(".section .rodata.str1.1,\"aMS\",@progbits,1");
+        for (size_t i = 0; i < stringOrder.size(); ++i) {
+            append(".Lstr");
+            append(static_cast<long long>(i));
+            append(":\n\t.string ");
+            append(program.text(
+              Operand::make(Operand::Kind::Constant, stringOrder[i])));
+            append("\n");
+        }
+    }
+    line(".section .note.GNU-stack,\"\",@progbits");
+    writer.flush();
+}
+
+std::uint32_t X86Writer::Lowering::slotIndex(Operand operand) const noexcept
+{
+    switch (operand.kind()) {
+        case Operand::Kind::Temp:
+            return operand.index() < tempCount ? operand.index() : None;
+        case Operand::Kind::Variable:
+            return tempCount + operand.index();
+        case Operand::Kind::Slot:
+            return operand.index() < program.getSlotCount()
+                     ? tempCount + stringCount + operand.index()
+                     : None;
+        default:
+            return None;
+    }
+}
+
+const GeneralRegister& X86Writer::Lowering::registerOf(Operand operand) const
+{
+    std::string_view name = program.text(operand);
+    for (const GeneralRegister& reg : Allocatable) {
+        if (name == reg.name64) {
+            return reg;
+        }
+    }
+    throw std::runtime_error("Register '" + std::string(name) +
+                             "' is not available to the x86-64 backend");
+}
+
+TypeId X86Writer::Lowering::typeOf(Operand operand) const
+{
+    TypeId type = TypeId::Unknown;
+    if (operand.is(Operand::Kind::Constant)) {
+        type = literalType(program.text(operand));
+    } else if (operand.is(Operand::Kind::Register)) {
+        type = types[frameOffsets.size() + operand.index()];
+    } else if (std::uint32_t index = slotIndex(operand); index != None) {
+        type = types[index];
+    }
+    return type == TypeId::Unknown ? TypeId::Int : type;
+}
+
+void X86Writer::Lowering::setType(Operand operand, TypeId type)
+{
+    if (operand.is(Operand::Kind::Register)) {
+        types[frameOffsets.size() + operand.index()] = type;
+    } else if (!operand.is(Operand::Kind::Variable)) {
+        if (std::uint32_t index = slotIndex(operand); index != None) {
+            types[index] = type;
+        }
+    }
+}
+
+TypeId X86Writer::Lowering::resultType(const TACInstruction& instruction) const
+{
+    return producedType(
+      instruction, typeOf(instruction.arg1), typeOf(instruction.arg2));
+}
+
+void X86Writer::Lowering::lowerFunction(std::uint32_t begin,
+                                        std::uint32_t end,
+                                        std::string_view name)
+{
+    const auto& code = program.code;
+    ++function;
+    returnsInt = name == "main";
+    intParameters = 0;
+    floatParameters = 0;
+    stackParameters = 0;
+    // Reads that come before the declaration in the code still see it
+    declareVariables(program, begin, end, types, tempCount);
+
+    // One slot per temp, variable and spill slot, in order of appearance,
+    // below the callee-saved registers the function uses
+    pushed.clear();
+    callerSaved.clear();
+    std::uint32_t slots = 0;
+    for (std::uint32_t i = begin; i < end; ++i) {
+        const TACInstruction& instruction = code[i];
+        for (Operand operand :
+             { instruction.arg1, instruction.arg2, instruction.result }) {
+            if (operand.is(Operand::Kind::Register)) {
+                const GeneralRegister* reg = &registerOf(operand);
+                auto& saves = reg->calleeSaved ? pushed : callerSaved;
+                if (std::find(saves.begin(), saves.end(), reg) ==
+                    saves.end()) {
+                    saves.push_back(reg);
+                }
+                continue;
+            }
+            std::uint32_t index = slotIndex(operand);
+            if (index != None && frameStamps[index] != function) {
+                frameStamps[index] = function;
+                frameOffsets[index] = ++slots;
+            }
+        }
+    }
+    auto saved = static_cast<std::uint32_t>(pushed.size());
+    // Keeps rsp 16-byte aligned: the return address and rbp make 16
+    std::uint32_t frame = 8 * slots + ((saved + slots) % 2 ? 8 : 0);
+
+    append(".globl ");
+    append(name);
+    append("\n.type ");
+    append(name);
+    append(", @function\n");
+    append(name);
+    append(":\n");
+    line("\tpush\trbp");
+    line("\tmov\trbp, rsp");
+    for (const GeneralRegister* reg : pushed) {
+        append("\tpush\t");
+        append(reg->name64);
+        append("\n");
+    }
+    if (frame > 0) {
+        append("\tsub\trsp, ");
+        append(static_cast<long long>(frame));
+        append("\n");
+    }
+
+    flags = Flags::None;
+    for (std::uint32_t i = begin; i < end; ++i) {
+        const TACInstruction& instruction = code[i];
+        if (i == begin && instruction.op == Opcode::Function) {
+            continue;
+        }
+        lower(instruction, i + 1 < end ? &code[i + 1] : nullptr);
+        if (out.size() >= FlushThreshold) {
+            writer.flush();
+        }
+    }
+
+    append(".size ");
+    append(name);
+    append(", .-");
+    append(name);
+    append("\n");
+}
+
+void X86Writer::Lowering::lower(const TACInstruction& instruction,
+                                const TACInstruction* next)
+{
+    Flags previous = flags;
+    Operand previousValue = flagsValue;
+    flags = Flags::None;
+
+    // A comparison whose only reader is the IF_FALSE right after it needs
+    // no 0/1 value, just the flags
+    bool keepResult = true;
+    if (next && next->op == Opcode::IfFalse &&
+        next->arg1 == instruction.result &&
+        instruction.result.is(Operand::Kind::Temp) &&
+        instruction.result.index() < tempCount &&
+        uses[instruction.result.index()] == 1) {
+        keepResult = false;
+    }
+
+    switch (instruction.op) {
+        case Opcode::Mov:
+            lowerMove(instruction);
+            break;
+        case Opcode::Add:
+        case Opcode::Subtract:
+        case Opcode::Multiply:
+            requireNumeric(instruction);
+            if (resultType(instruction) == TypeId::Float) {
+                lowerFloatArithmetic(instruction);
+            } else {
+                lowerIntArithmetic(instruction);
+            }
+            break;
+        case Opcode::Divide:
+        case Opcode::Modulo:
+            requireNumeric(instruction);
+            if (resultType(instruction) == TypeId::Float) {
+                if (instruction.op == Opcode::Modulo) {
+                    throw std::runtime_error(
+                      "The x86-64 backend has no lowering for float %");
+                }
+                lowerFloatArithmetic(instruction);
+            } else {
+                lowerDivision(instruction);
+            }
+            break;
+        case Opcode::LessThan:
+        case Opcode::GreaterThan:
+        case Opcode::Equal:
+        case Opcode::NotEqual:
+            requireNumeric(instruction);
+            lowerComparison(instruction, keepResult);
+            break;
+        case Opcode::And:
+        case Opcode::Or:
+            lowerLogical(instruction, keepResult);
+            break;
+        case Opcode::IfFalse:
+            flags = previous;
+            flagsValue = previousValue;
+            lowerBranch(instruction);
+            flags = Flags::None;
+            break;
+        case Opcode::Goto:
+            append("\tjmp\t");
+            appendLabel(instruction.result);
+            append("\n");
+            break;
+        case Opcode::Label:
+            label(program.text(instruction.result));
+            break;
+        case Opcode::Function:
+            // Only ever first, where lowerFunction writes the symbol
+            break;
+        case Opcode::Ret:
+            lowerReturn(instruction);
+            break;
+        case Opcode::Param:
+            lowerParameter(instruction);
+            break;
+        case Opcode::Arg:
+            arguments.push_back(&instruction);
+            break;
+        case Opcode::Call:
+            lowerCall(instruction);
+            break;
+    }
+    if (instruction.op != Opcode::IfFalse &&
+        instruction.op != Opcode::Goto && instruction.op != Opcode::Label &&
+        instruction.op != Opcode::Ret && instruction.op != Opcode::Arg) {
+        setType(instruction.result, resultType(instruction));
+    }
+}
+
+void X86Writer::Lowering::requireNumeric(
+  const TACInstruction& instruction) const
+{
+    if (instruction.type == TypeId::String ||
+        typeOf(instruction.arg1) == TypeId::String ||
+        typeOf(instruction.arg2) == TypeId::String) {
+        throw std::runtime_error(
+          std::string("The x86-64 backend has no lowering for string ") +
+          opcodeName(instruction.op));
+    }
+}
+
+void X86Writer::Lowering::lowerMove(const TACInstruction& instruction)
+{
+    Operand source = instruction.arg1;
+    Operand result = instruction.result;
+    TypeId target = resultType(instruction);
+    if (result.is(Operand::Kind::Variable)) {
+        target = typeOf(result);
+    }
+    TypeId from = typeOf(source);
+    Place dst = place(result);
+    // Float constants copy into memory as raw bits, no pool entry needed
+    if (target == TypeId::Float && from == TypeId::Float &&
+        source.is(Operand::Kind::Constant) &&
+        dst.kind == Place::Kind::Memory) {
+        double value = literalFloat(program.text(source));
+        std::uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        append("\tmovabs\trax, ");
+        append(std::to_string(bits));
+        append("\n\tmov\t");
+        appendPlace(dst, true);
+        append(", rax\n");
+        return;
+    }
+    Place src = place(source);
+
+    if (target == TypeId::String || from == TypeId::String) {
+        loadPointer(source);
+        storeInt(result, Rax, TypeId::String);
+        return;
+    }
+
+    if (target == TypeId::Float) {
+        if (from == TypeId::Float && src.kind == Place::Kind::Memory &&
+            dst.kind == Place::Kind::Memory) {
+            // Copied as raw bits, no SSE register needed
+            append("\tmov\trax, ");
+            appendPlace(src, true);
+            append("\n\tmov\t");
+            appendPlace(dst, true);
+            append(", rax\n");
+            return;
+        }
+        loadFloat("xmm0", source);
+        storeFloat(result, "xmm0");
+        return;
+    }
+
+    if (target == TypeId::Bool && from == TypeId::Float) {
+        loadTruth("eax", "al", source);
+        storeInt(result, Rax, TypeId::Bool);
+        return;
+    }
+    // char and bool variables hold their value narrowed like C++ does
+    bool narrows = (target == TypeId::Char && from != TypeId::Char) ||
+                   (target == TypeId::Bool && from != TypeId::Bool);
+    if (narrows && src.kind == Place::Kind::Immediate) {
+        src.immediate = target == TypeId::Char
+                          ? static_cast<signed char>(src.immediate)
+                          : src.immediate != 0;
+        narrows = false;
+    }
+    // Immediates and registers move straight into memory or a register
+    if (!narrows && from != TypeId::Float &&
+        (dst.kind == Place::Kind::Register ||
+         src.kind != Place::Kind::Memory)) {
+        if (dst.kind == Place::Kind::Register &&
+            src.kind == Place::Kind::Immediate && src.immediate == 0) {
+            append("\txor\t");
+            append(dst.reg->name32);
+            append(", ");
+            append(dst.reg->name32);
+            append("\n");
+            return;
+        }
+        append("\tmov\t");
+        appendPlace(dst, false);
+        append(", ");
+        appendPlace(src, false);
+        append("\n");
+        return;
+    }
+    loadInt("eax", source);
+    storeInt(result, Rax, from == TypeId::Float ? TypeId::Int : from);
+}
+
+bool X86Writer::Lowering::lowerWithLea(const TACInstruction& instruction)
+{
+    Place a = place(instruction.arg1);
+    Place b = place(instruction.arg2);
+    Place r = place(instruction.result);
+    Opcode op = instruction.op;
+    if (op == Opcode::Add && a.kind == Place::Kind::Immediate &&
+        b.kind == Place::Kind::Register) {
+        std::swap(a, b);
+    }
+    bool sum = op == Opcode::Add && b.kind == Place::Kind::Register;
+    bool offset = (op == Opcode::Add || op == Opcode::Subtract) &&
+                  b.kind == Place::Kind::Immediate;
+    bool scaled = op == Opcode::Multiply &&
+                  b.kind == Place::Kind::Immediate &&
+                  (b.immediate == 3 || b.immediate == 5 || b.immediate == 9);
+    if (r.kind != Place::Kind::Register ||
+        a.kind != Place::Kind::Register || !(sum || offset || scaled)) {
+        return false;
+    }
+
+    append("\tlea\t");
+    append(r.reg->name32);
+    append(", [");
+    append(a.reg->name64);
+    if (sum) {
+        append("+");
+        append(b.reg->name64);
+    } else if (offset) {
+        long long value = op == Opcode::Add ? b.immediate : -b.immediate;
+        if (value >= 0) {
+            append("+");
+        }
+        append(value);
+    } else {
+        append("+");
+        append(a.reg->name64);
+        append("*");
+        append(b.immediate - 1);
+    }
+    append("]\n");
+    return true;
+}
+
+void X86Writer::Lowering::lowerIntArithmetic(const TACInstruction& instruction)
+{
+    Opcode op = instruction.op;
+    Operand left = instruction.arg1;
+    Operand right = instruction.arg2;
+    Place r = place(instruction.result);
+    if (op != Opcode::Subtract && right == instruction.result) {
+        std::swap(left, right);
+    }
+    Place a = place(left);
+    Place b = place(right);
+    const char* name = op == Opcode::Add        ? "add"
+                       : op == Opcode::Subtract ? "sub"
+                                                : "imul";
+
+    // x = x + 1 updates the slot in place
+    if (op != Opcode::Multiply && left == instruction.result &&
+        r.kind == Place::Kind::Memory && b.kind != Place::Kind::Memory &&
+        isIntegral(typeOf(instruction.result))) {
+        append("\t");
+        append(name);
+        append("\t");
+        appendPlace(r, false);
+        append(", ");
+        appendPlace(b, false);
+        append("\n");
+        return;
+    }
+    if (lowerWithLea(instruction)) {
+        return;
+    }
+
+    if (op == Opcode::Multiply && b.kind == Place::Kind::Immediate &&
+        a.kind != Place::Kind::Immediate) {
+        long long factor = b.immediate;
+        if (factor == 3 || factor == 5 || factor == 9) {
+            loadInt("eax", left);
+            append("\tlea\teax, [rax+rax*");
+            append(factor - 1);
+            append("]\n");
+        } else if (factor > 0 && (factor & (factor - 1)) == 0) {
+            loadInt("eax", left);
+            int shift = 0;
+            while ((1ll << shift) < factor) {
+                ++shift;
+            }
+            if (shift > 0) {
+                append("\tshl\teax, ");
+                append(shift);
+                append("\n");
+            }
+        } else {
+            // Three-operand imul reads memory or a register directly
+            append("\timul\teax, ");
+            appendPlace(a, false);
+            append(", ");
+            append(factor);
+            append("\n");
+        }
+        storeInt(instruction.result, Rax, TypeId::Int);
+        return;
+    }
+
+    loadInt("eax", left);
+    append("\t");
+    append(name);
+    append("\teax, ");
+    appendPlace(b, false);
+    append("\n");
+    storeInt(instruction.result, Rax, TypeId::Int);
+}
+
+void X86Writer::Lowering::lowerDivision(const TACInstruction& instruction)
+{
+    Place divisor = place(instruction.arg2);
+    loadInt("eax", instruction.arg1);
+    if (divisor.kind == Place::Kind::Immediate) {
+        append("\tmov\tecx, ");
+        append(divisor.immediate);
+        append("\n\tcdq\n\tidiv\tecx\n");
+    } else {
+        append("\tcdq\n\tidiv\t");
+        appendPlace(divisor, false);
+        append("\n");
+    }
+    if (instruction.op == Opcode::Modulo) {
+        storeInt(instruction.result, Rdx, TypeId::Int);
+    } else {
+        storeInt(instruction.result, Rax, TypeId::Int);
+    }
+}
+
+void X86Writer::Lowering::lowerFloatArithmetic(
+  const TACInstruction& instruction)
+{
+    const char* name = "addsd";
+    switch (instruction.op) {
+        case Opcode::Subtract:
+            name = "subsd";
+            break;
+        case Opcode::Multiply:
+            name = "mulsd";
+            break;
+        case Opcode::Divide:
+            name = "divsd";
+            break;
+        default:
+            break;
+    }
+    loadFloat("xmm0", instruction.arg1);
+    floatInstruction(name, instruction.arg2);
+    storeFloat(instruction.result, "xmm0");
+}
+
+void X86Writer::Lowering::lowerComparison(const TACInstruction& instruction,
+                                          bool keepResult)
+{
+    Operand left = instruction.arg1;
+    Operand right = instruction.arg2;
+    bool floating = instruction.type == TypeId::Float ||
+                    typeOf(left) == TypeId::Float ||
+                    typeOf(right) == TypeId::Float;
+
+    if (floating) {
+        // a < b is tested as b > a, so unordered operands compare false
+        // through the carry flag alone
+        if (instruction.op == Opcode::LessThan) {
+            std::swap(left, right);
+        }
+        loadFloat("xmm0", left);
+        floatInstruction("ucomisd", right);
+        if (instruction.op == Opcode::Equal ||
+            instruction.op == Opcode::NotEqual) {
+            // Unordered sets ZF too, so the parity flag has to agree
+            bool equal = instruction.op == Opcode::Equal;
+            append(equal ? "\tsete\tal\n\tsetnp\tcl\n\tand\tal, cl\n"
+                         : "\tsetne\tal\n\tsetp\tcl\n\tor\tal, cl\n");
+            flags = Flags::NonZero;
+            flagsValue = instruction.result;
+            if (keepResult) {
+                append("\tmovzx\teax, al\n");
+                storeInt(instruction.result, Rax, TypeId::Bool);
+            }
+            return;
+        }
+        flags = Flags::Above;
+    } else {
+        Place a = place(left);
+        Place b = place(right);
+        if (a.kind == Place::Kind::Immediate ||
+            (a.kind == Place::Kind::Memory && b.kind == Place::Kind::Memory)) {
+            loadInt("eax", left);
+            append("\tcmp\teax, ");
+        } else {
+            append("\tcmp\t");
+            appendPlace(a, false);
+            append(", ");
+        }
+        appendPlace(b, false);
+        append("\n");
+        switch (instruction.op) {
+            case Opcode::LessThan:
+                flags = Flags::Less;
+                break;
+            case Opcode::GreaterThan:
+                flags = Flags::Greater;
+                break;
+            case Opcode::Equal:
+                flags = Flags::Equal;
+                break;
+            default:
+                flags = Flags::NotEqual;
+                break;
+        }
+    }
+    flagsValue = instruction.result;
+    if (keepResult) {
+        materialize(instruction.result);
+    }
+}
+
+void X86Writer::Lowering::lowerLogical(const TACInstruction& instruction,
+                                       bool keepResult)
+{
+    if (typeOf(instruction.arg1) == TypeId::String ||
+        typeOf(instruction.arg2) == TypeId::String) {
+        throw std::runtime_error(
+          "The x86-64 backend has no lowering for strings in && or ||");
+    }
+    loadTruth("eax", "al", instruction.arg1);
+    loadTruth("ecx", "cl", instruction.arg2);
+    if (instruction.op == Opcode::And) {
+        // ecx = a ? b : 0
+        append("\txor\tedx, edx\n\ttest\teax, eax\n\tcmove\tecx, edx\n");
+    } else {
+        // ecx = a ? a : b
+        append("\ttest\teax, eax\n\tcmovne\tecx, eax\n");
+    }
+    append("\ttest\tecx, ecx\n");
+    flags = Flags::NonZero;
+    flagsValue = instruction.result;
+    if (keepResult) {
+        materialize(instruction.result);
+    }
+}
+
+void X86Writer::Lowering::materialize(Operand result)
+{
+    append("\t");
+    append(setInstruction(flags));
+    append("\tal\n\tmovzx\teax, al\n");
+    storeInt(result, Rax, TypeId::Bool);
+}
+
+void X86Writer::Lowering::lowerBranch(const TACInstruction& instruction)
+{
+    Operand condition = instruction.arg1;
+    if (flags != Flags::None && flagsValue == condition) {
+        append("\t");
+        append(jumpIfFalse(flags));
+        append("\t");
+        appendLabel(instruction.result);
+        append("\n");
+        return;
+    }
+
+    if (condition.is(Operand::Kind::Constant)) {
+        std::string_view text = program.text(condition);
+        bool truth = literalType(text) == TypeId::String ||
+                     literalFloat(text) != 0.0;
+        if (!truth) {
+            append("\tjmp\t");
+            appendLabel(instruction.result);
+            append("\n");
+        }
+        return;
+    }
+
+    Place where = place(condition);
+    if (typeOf(condition) == TypeId::Float) {
+        loadTruth("eax", "al", condition);
+        append("\ttest\teax, eax\n");
+    } else if (where.kind == Place::Kind::Register) {
+        append("\ttest\t");
+        append(where.reg->name32);
+        append(", ");
+        append(where.reg->name32);
+        append("\n");
+    } else {
+        append("\tcmp\t");
+        appendPlace(where, typeOf(condition) == TypeId::String);
+        append(", 0\n");
+    }
+    append("\tje\t");
+    appendLabel(instruction.result);
+    append("\n");
+}
+
+void X86Writer::Lowering::lowerParameter(const TACInstruction& instruction)
+{
+    Operand result = instruction.result;
+    TypeId type = instruction.type;
+    if (type == TypeId::Float && floatParameters < FloatArgumentCount) {
+        storeFloat(result, FloatArgumentRegisters[floatParameters++]);
+        return;
+    }
+    if (type != TypeId::Float && intParameters < IntArgumentCount) {
+        storeInt(result, ArgumentRegisters[intParameters++], type);
+        return;
+    }
+    // Above the return address and the caller's rbp
+    long long offset = 16 + 8 * static_cast<long long>(stackParameters++);
+    if (type == TypeId::Float) {
+        append("\tmovsd\txmm0, QWORD PTR [rbp+");
+        append(offset);
+        append("]\n");
+        storeFloat(result, "xmm0");
+        return;
+    }
+    append("\tmov\trax, QWORD PTR [rbp+");
+    append(offset);
+    append("]\n");
+    storeInt(result, Rax, type);
+}
+
+void X86Writer::Lowering::lowerCall(const TACInstruction& instruction)
+{
+    // Every argument is pushed before any register is loaded, since the
+    // values may live in the argument registers themselves
+    std::vector<const TACInstruction*> inRegisters;
+    std::vector<const TACInstruction*> onStack;
+    std::uint32_t ints = 0;
+    std::uint32_t floats = 0;
+    for (const TACInstruction* argument : arguments) {
+        bool floating = argument->type == TypeId::Float;
+        bool fits = floating ? floats++ < FloatArgumentCount
+                             : ints++ < IntArgumentCount;
+        (fits ? inRegisters : onStack).push_back(argument);
+    }
+    arguments.clear();
+
+    for (const GeneralRegister* reg : callerSaved) {
+        append("\tpush\t");
+        append(reg->name64);
+        append("\n");
+    }
+    // rsp is 16-byte aligned at the call
+    bool pad = (callerSaved.size() + onStack.size()) % 2 != 0;
+    if (pad) {
+        line("\tsub\trsp, 8");
+    }
+    for (size_t i = onStack.size(); i-- > 0;) {
+        pushArgument(*onStack[i]);
+    }
+    for (size_t i = inRegisters.size(); i-- > 0;) {
+        pushArgument(*inRegisters[i]);
+    }
+    ints = 0;
+    floats = 0;
+    for (const TACInstruction* argument : inRegisters) {
+        append("\tpop\t");
+        if (argument->type == TypeId::Float) {
+            append("rax\n\tmovq\t");
+            append(FloatArgumentRegisters[floats++]);
+            append(", rax\n");
+        } else {
+            append(ArgumentRegisters[ints++].name64);
+            append("\n");
+        }
+    }
+
+    append("\tcall\t");
+    append(program.text(instruction.arg1));
+    append("\n");
+    if (size_t bytes = 8 * (onStack.size() + pad); bytes > 0) {
+        append("\tadd\trsp, ");
+        append(static_cast<long long>(bytes));
+        append("\n");
+    }
+    // The value stays in rax or xmm0 while the registers come back
+    for (size_t i = callerSaved.size(); i-- > 0;) {
+        append("\tpop\t");
+        append(callerSaved[i]->name64);
+        append("\n");
+    }
+
+    Operand result = instruction.result;
+    if (result.isNone()) {
+        return;
+    }
+    TypeId type = resultType(instruction);
+    if (type == TypeId::Float) {
+        storeFloat(result, "xmm0");
+    } else {
+        storeInt(result, Rax, type);
+    }
+}
+
+void X86Writer::Lowering::pushArgument(const TACInstruction& argument)
+{
+    Operand value = argument.arg1;
+    TypeId type = argument.type;
+    if (type == TypeId::Float) {
+        loadFloat("xmm0", value);
+        line("\tmovq\trax, xmm0\n\tpush\trax");
+        return;
+    }
+    if (type == TypeId::String) {
+        loadPointer(value);
+        line("\tpush\trax");
+        return;
+    }
+    // The callee reads the low 32 bits of an int
+    Place src = place(value);
+    if (typeOf(value) != TypeId::Float &&
+        (src.kind == Place::Kind::Immediate ||
+         src.kind == Place::Kind::Register)) {
+        append("\tpush\t");
+        appendPlace(src, true);
+        append("\n");
+        return;
+    }
+    loadInt("eax", value);
+    line("\tpush\trax");
+}
+
+void X86Writer::Lowering::lowerReturn(const TACInstruction& instruction)
+{
+    Operand value = instruction.arg1;
+    TypeId type =
+      instruction.type != TypeId::Unknown ? instruction.type : typeOf(value);
+    if (value.isNone()) {
+        append("\txor\teax, eax\n");
+    } else if (type == TypeId::Float && !returnsInt) {
+        loadFloat("xmm0", value);
+    } else if (type == TypeId::String) {
+        loadPointer(value);
+    } else {
+        loadInt("eax", value);
+    }
+    epilogue();
+}
+
+void X86Writer::Lowering::epilogue()
+{
+    if (pushed.empty()) {
+        line("\tleave\n\tret");
+        return;
+    }
+    append("\tlea\trsp, [rbp-");
+    append(static_cast<long long>(8 * pushed.size()));
+    append("]\n");
+    for (size_t i = pushed.size(); i-- > 0;) {
+        append("\tpop\t");
+        append(pushed[i]->name64);
+        append("\n");
+    }
+    line("\tpop\trbp\n\tret");
+}
+
+X86Writer::Lowering::Place X86Writer::Lowering::place(Operand operand)
+{
+    Place where{ Place::Kind::Immediate };
+    if (operand.is(Operand::Kind::Constant)) {
+        std::string_view text = program.text(operand);
+        TypeId type = literalType(text);
+        if (type == TypeId::Float) {
+            where.kind = Place::Kind::Literal;
+            where.literal = floatLiteral(operand);
+        } else if (type == TypeId::String) {
+            std::uint32_t& literal = stringLiterals[operand.index()];
+            if (literal == None) {
+                literal = static_cast<std::uint32_t>(stringOrder.size());
+                stringOrder.push_back(operand.index());
+            }
+            where.kind = Place::Kind::Literal;
+            where.literal = literal;
+        } else {
+            where.immediate = literalInteger(text);
+        }
+    } else if (operand.is(Operand::Kind::Register)) {
+        where.kind = Place::Kind::Register;
+        where.reg = &registerOf(operand);
+    } else if (std::uint32_t index = slotIndex(operand); index != None) {
+        where.kind = Place::Kind::Memory;
+        where.offset = 8 * (static_cast<std::uint32_t>(pushed.size()) +
+                            frameOffsets[index]);
+    } else {
+        throw std::runtime_error("The x86-64 backend cannot place operand");
+    }
+    return where;
+}
+
+std::uint32_t X86Writer::Lowering::floatLiteral(Operand constant)
+{
+    std::uint32_t& literal = floatLiterals[constant.index()];
+    if (literal == None) {
+        literal = static_cast<std::uint32_t>(floatOrder.size());
+        floatOrder.push_back(constant.index());
+    }
+    return literal;
+}
+
+void X86Writer::Lowering::appendPlace(const Place& where, bool wide)
+{
+    switch (where.kind) {
+        case Place::Kind::Immediate:
+            append(where.immediate);
+            break;
+        case Place::Kind::Register:
+            append(wide ? where.reg->name64 : where.reg->name32);
+            break;
+        case Place::Kind::Memory:
+            append(wide ? "QWORD PTR [rbp-" : "DWORD PTR [rbp-");
+            append(static_cast<long long>(where.offset));
+            append("]");
+            break;
+        case Place::Kind::Literal:
+            append("QWORD PTR .Lfp");
+            append(static_cast<long long>(where.literal));
+            append("[rip]");
+            break;
+    }
+}
+
+void X86Writer::Lowering::floatInstruction(const char* name, Operand source)
+{
+    Place where = place(source);
+    if (source.is(Operand::Kind::Constant)) {
+        // Integer literals get a double of their own in the pool
+        where.kind = Place::Kind::Literal;
+        where.literal = floatLiteral(source);
+    } else if (typeOf(source) != TypeId::Float ||
+               where.kind != Place::Kind::Memory) {
+        loadFloat("xmm1", source);
+        append("\t");
+        append(name);
+        append("\txmm0, xmm1\n");
+        return;
+    }
+    append("\t");
+    append(name);
+    append("\txmm0, ");
+    appendPlace(where, true);
+    append("\n");
+}
+
+void X86Writer::Lowering::loadInt(const char* reg, Operand operand)
+{
+    Place where = place(operand);
+    if (typeOf(operand) == TypeId::Float) {
+        loadFloat("xmm0", operand);
+        append("\tcvttsd2si\t");
+        append(reg);
+        append(", xmm0\n");
+        return;
+    }
+    if (where.kind == Place::Kind::Immediate && where.immediate == 0) {
+        append("\txor\t");
+        append(reg);
+        append(", ");
+        append(reg);
+        append("\n");
+        return;
+    }
+    append("\tmov\t");
+    append(reg);
+    append(", ");
+    appendPlace(where, false);
+    append("\n");
+}
+
+void X86Writer::Lowering::loadFloat(const char* xmm, Operand operand)
+{
+    Place where = place(operand);
+    bool floating = typeOf(operand) == TypeId::Float;
+    append("\t");
+    if (operand.is(Operand::Kind::Constant)) {
+        where.kind = Place::Kind::Literal;
+        where.literal = floatLiteral(operand);
+        append("movsd\t");
+    } else if (where.kind == Place::Kind::Register) {
+        append(floating ? "movq\t" : "cvtsi2sd\t");
+        append(xmm);
+        append(", ");
+        appendPlace(where, floating);
+        append("\n");
+        return;
+    } else {
+        append(floating ? "movsd\t" : "cvtsi2sd\t");
+    }
+    append(xmm);
+    append(", ");
+    appendPlace(where, floating);
+    append("\n");
+}
+
+void X86Writer::Lowering::loadPointer(Operand operand)
+{
+    Place src = place(operand);
+    if (src.kind == Place::Kind::Literal) {
+        append("\tlea\trax, .Lstr");
+        append(static_cast<long long>(src.literal));
+        append("[rip]\n");
+    } else {
+        append("\tmov\trax, ");
+        appendPlace(src, true);
+        append("\n");
+    }
+}
+
+void X86Writer::Lowering::loadTruth(const char* reg,
+                                    const char* reg8,
+                                    Operand operand)
+{
+    if (typeOf(operand) != TypeId::Float) {
+        loadInt(reg, operand);
+        return;
+    }
+    // NaN is true, like any other non-zero double
+    loadFloat("xmm0", operand);
+    append("\txorpd\txmm1, xmm1\n\tucomisd\txmm0, xmm1\n\tsetne\t");
+    append(reg8);
+    append("\n\tsetp\tdl\n\tor\t");
+    append(reg8);
+    append(", dl\n\tmovzx\t");
+    append(reg);
+    append(", ");
+    append(reg8);
+    append("\n");
+}
+
+void X86Writer::Lowering::storeInt(Operand result,
+                                   const GeneralRegister& reg,
+                                   TypeId from)
+{
+    Place where = place(result);
+    TypeId type = result.is(Operand::Kind::Variable) ? typeOf(result) : from;
+    if (type == TypeId::Float) {
+        // An int or bool result stored into a float variable
+        append("\tcvtsi2sd\txmm0, ");
+        append(reg.name32);
+        append("\n");
+        storeFloat(result, "xmm0");
+        return;
+    }
+    if (type == TypeId::Char && from != TypeId::Char) {
+        append("\tmovsx\t");
+        append(reg.name32);
+        append(", ");
+        append(reg.name8);
+        append("\n");
+    } else if (type == TypeId::Bool && from != TypeId::Bool) {
+        append("\ttest\t");
+        append(reg.name32);
+        append(", ");
+        append(reg.name32);
+        append("\n\tsetne\t");
+        append(reg.name8);
+        append("\n\tmovzx\t");
+        append(reg.name32);
+        append(", ");
+        append(reg.name8);
+        append("\n");
+    }
+    bool wide = type == TypeId::String;
+    append("\tmov\t");
+    appendPlace(where, wide);
+    append(", ");
+    append(wide ? reg.name64 : reg.name32);
+    append("\n");
+}
+
+void X86Writer::Lowering::storeFloat(Operand result, const char* xmm)
+{
+    Place where = place(result);
+    if (result.is(Operand::Kind::Variable) && isIntegral(typeOf(result))) {
+        append("\tcvttsd2si\teax, ");
+        append(xmm);
+        append("\n");
+        storeInt(result, Rax, TypeId::Int);
+        return;
+    }
+    if (where.kind == Place::Kind::Register) {
+        append("\tmovq\t");
+        append(where.reg->name64);
+        append(", ");
+        append(xmm);
+        append("\n");
+        return;
+    }
+    append("\tmovsd\t");
+    appendPlace(where, true);
+    append(", ");
+    append(xmm);
+    append("\n");
+}
+
+void X86Writer::Lowering::append(long long value)
+{
+    char digits[24];
+    char* end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+    out.append(digits, end);
+}
+
+void X86Writer::Lowering::line(std::string_view text)
+{
+    out += text;
+    out += '\n';
+}
+
+void X86Writer::Lowering::label(std::string_view name)
+{
+    append(".L_");
+    append(name);
+    append(":\n");
+}
+
+void X86Writer::Lowering::appendLabel(Operand target)
+{
+    append(".L_");
+    append(program.text(target));
+}
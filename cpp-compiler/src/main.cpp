@@ -1,30 +1,474 @@
+#include <csignal>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
 #include <memory>
+#include <sstream>
+#include "ArtifactCache.hpp"
+#include "BatchDriver.hpp"
+#include "CompileReport.hpp"
+#include "CompileServer.hpp"
 #include "Compiler.hpp"
+#include "HeapStats.hpp"
+#include "X86Writer.hpp"
 
-int main(int argc, const char* argv[])
+namespace {
+
+struct CacheOptions
+{
+    std::string directory;
+    std::string maxSize;
+    bool printStats = false;
+
+    // Consumes argv[i] (and its value) when it is a cache flag
+    bool parse(int& i, int argc, const char* argv[])
+    {
+        std::string arg = argv[i];
+        if (arg == "--cache" && i + 1 < argc) {
+            directory = argv[++i];
+        } else if (arg == "--cache-size" && i + 1 < argc) {
+            maxSize = argv[++i];
+        } else if (arg == "--cache-stats") {
+            printStats = true;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    std::unique_ptr<ArtifactCache> open() const
+    {
+        if (directory.empty()) {
+            return nullptr;
+        }
+        auto maxBytes = maxSize.empty()
+                          ? ArtifactCache::DefaultMaxBytes
+                          : ArtifactCache::parseSize(maxSize);
+        return std::make_unique<ArtifactCache>(directory, maxBytes);
+    }
+};
+
+void printUsage(std::ostream& err, const char* program)
+{
+    err << "Usage: " << program
+        << " [--time-report] [--time-report-json FILE] [--emit-ir FILE]"
+           "\n       [-j N] [-O0|-O1|-O2] [--registers N|LIST] [--target T]"
+           "\n       [cache options] <input.cpp|input.tir> <output.asm>\n"
+        << "       " << program
+        << " --batch [-j N] [-o DIR] [-O0|-O1|-O2] [--target T]\n"
+           "       [cache options] <input.cpp|@list>...\n"
+        << "       " << program
+        << " --run [--interpret] [-j N] [-O0|-O1|-O2] [--time-report]\n"
+           "       [--time-report-json FILE] <input.cpp|input.tir>\n"
+        << "       " << program << " --cache DIR --cache-stats\n"
+        << "       " << program
+        << " --serve SOCKET [-j N] [cache options]\n"
+        << "Use '-' as the input to read the source from stdin.\n"
+        << "In batch mode each input is written to DIR/<name>.asm, or "
+           "next to the input\nwhen -o is omitted; @list names a file "
+           "of whitespace-separated inputs.\n"
+        << "--time-report prints per-phase time, counts and heap use "
+           "to stderr;\n--time-report-json writes the same as JSON to "
+           "FILE ('-' for stdout).\n"
+        << "--emit-ir also writes the TAC as a binary image; an image "
+           "given as the input\nis turned into assembly without "
+           "running the front end.\n"
+        << "-O1 inlines small leaf functions, threads jumps and removes "
+           "unreachable code\nand unused temps; -O2 also removes dead "
+           "stores, hoists loop invariants,\nstrength-reduces induction "
+           "variables and repeats until nothing changes. -O0\nis the "
+           "default.\n"
+        << "--registers maps temps onto N registers r0..rN-1 or a "
+           "comma-separated LIST,\nspilling to slots [sK] when they "
+           "run out.\n"
+        << "--target tac (the default) writes the TAC listing; "
+           "--target x86-64 writes\nGNU as assembly for x86-64 "
+           "Linux, where --registers N picks the first N of\nrbx, "
+           "r12-r15, rsi, rdi and r8-r11.\n"
+        << "--run compiles main into memory, runs it in-process and "
+           "exits with its value;\n--interpret (implies --run) runs it "
+           "in the bytecode interpreter instead of\nthe JIT, which is "
+           "the default on x86-64 hosts only.\n"
+        << "-j N checks and lowers the functions of one unit on N threads "
+           "(0 for one per\ncore); in batch and daemon mode it sets how "
+           "many units run at once.\n"
+        << "--serve stays resident and answers tinycpp_client on the Unix "
+           "socket SOCKET;\nthe client takes SOCKET and then the arguments "
+           "of one unit,\nand --run there always interprets.\n"
+        << "Cache options: --cache DIR reuses assembly compiled from "
+           "identical sources;\n--cache-size SIZE caps it (K, M or G "
+           "suffix, default 1G), evicting the least\nrecently used "
+           "entries; --cache-stats prints its hit and miss counts.\n";
+}
+
+int runBatch(int argc, const char* argv[])
 {
-    if (argc != 3) {
-        std::cerr << "Usage: " << argv[0] << " <input.cpp> <output.asm>\n";
+    unsigned threads = 0;
+    std::string outputDir;
+    std::vector<std::string> inputs;
+    CacheOptions cacheOptions;
+    int level = 0;
+    Compiler::Target target = Compiler::Target::Tac;
+
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (cacheOptions.parse(i, argc, argv)) {
+            continue;
+        } else if (arg.size() > 2 && arg.compare(0, 2, "-O") == 0) {
+            level = Optimizer::parseLevel(arg.substr(2));
+        } else if (arg == "--target" && i + 1 < argc) {
+            target = Compiler::parseTarget(argv[++i]);
+        } else if (arg == "-j" && i + 1 < argc) {
+            threads = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "-o" && i + 1 < argc) {
+            outputDir = argv[++i];
+        } else if (arg.size() > 1 && arg[0] == '@') {
+            auto listed = BatchDriver::readResponseFile(arg.substr(1));
+            inputs.insert(inputs.end(), listed.begin(), listed.end());
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            printUsage(std::cerr, argv[0]);
+            return 1;
+        } else {
+            inputs.push_back(std::move(arg));
+        }
+    }
+
+    if (inputs.empty()) {
+        printUsage(std::cerr, argv[0]);
         return 1;
     }
 
-    std::string inputFilePath = argv[1];
-    std::string outputFilePath = argv[2];
+    std::vector<BatchJob> jobs;
+    jobs.reserve(inputs.size());
+    for (auto& input : inputs) {
+        std::string output = BatchDriver::outputPathFor(input, outputDir);
+        jobs.push_back({ std::move(input), std::move(output) });
+    }
+
+    auto cache = cacheOptions.open();
+    BatchDriver driver(threads);
+    driver.setCache(cache.get());
+    driver.setOptimizationLevel(level);
+    driver.setTarget(target);
+    auto results = driver.run(jobs);
+
+    size_t failed = 0;
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        if (!results[i].succeeded) {
+            std::cerr << jobs[i].inputPath
+                      << ": Compilation failed: " << results[i].error << "\n";
+            ++failed;
+        }
+    }
+    std::cout << "Compiled " << jobs.size() - failed << " of " << jobs.size()
+              << " units.\n";
+    if (cache && cacheOptions.printStats) {
+        cache->writeStats(std::cout);
+    }
+    return failed == 0 ? 0 : 1;
+}
 
+// Where one single-unit invocation runs: this process, or a daemon worker
+// answering a client (see runServer)
+struct UnitContext
+{
+    UnitContext(Compiler& compiler, std::ostream& out, std::ostream& err)
+      : compiler(compiler)
+      , out(out)
+      , err(err)
+    {
+    }
+
+    Compiler& compiler;
+    std::ostream& out;
+    std::ostream& err;
+    bool daemon = false;
+    // Daemon only: the client's directory, which relative paths are taken
+    // from, its stdin as the "-" input, and the cache the daemon opened
+    std::string directory;
+    std::string_view input;
+    const ArtifactCache* cache = nullptr;
+
+    std::string resolve(const std::string& path) const
+    {
+        if (!daemon || path.empty() || path == "-" || path[0] == '/') {
+            return path;
+        }
+        return directory + "/" + path;
+    }
+};
+
+int compileUnit(int argc, const char* argv[], UnitContext& context)
+{
+    Compiler& compiler = context.compiler;
+    std::ostream& out = context.out;
+    std::ostream& err = context.err;
+
+    bool timeReport = false;
+    bool runProgram = false;
+    bool interpret = false;
+    std::string jsonReportPath;
+    std::string irOutputPath;
+    std::string registerSpec;
+    std::string levelSpec;
+    std::string targetSpec;
+    unsigned threads = 1;
+    std::vector<std::string> paths;
+    CacheOptions cacheOptions;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (cacheOptions.parse(i, argc, argv)) {
+            continue;
+        } else if (arg == "--time-report") {
+            timeReport = true;
+        } else if (arg == "--run") {
+            runProgram = true;
+        } else if (arg == "--interpret") {
+            runProgram = true;
+            interpret = true;
+        } else if (arg == "--time-report-json" && i + 1 < argc) {
+            jsonReportPath = context.resolve(argv[++i]);
+        } else if (arg == "--emit-ir" && i + 1 < argc) {
+            irOutputPath = context.resolve(argv[++i]);
+        } else if (arg.size() > 2 && arg.compare(0, 2, "-O") == 0) {
+            levelSpec = arg.substr(2);
+        } else if (arg == "--registers" && i + 1 < argc) {
+            registerSpec = argv[++i];
+        } else if (arg == "--target" && i + 1 < argc) {
+            targetSpec = argv[++i];
+        } else if (arg == "-j" && i + 1 < argc) {
+            threads = static_cast<unsigned>(
+              std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            printUsage(err, argv[0]);
+            return 1;
+        } else {
+            paths.push_back(std::move(arg));
+        }
+    }
+
+    if (context.daemon &&
+        (!cacheOptions.directory.empty() || !cacheOptions.maxSize.empty())) {
+        err << "The daemon's cache is chosen by --serve; drop --cache and "
+               "--cache-size\n";
+        return 1;
+    }
+
+    std::unique_ptr<ArtifactCache> opened;
+    const ArtifactCache* cache = context.cache;
     try {
-        auto lexer = std::make_shared<Lexer>();
-        auto parser = std::make_shared<Parser>(lexer);
-        auto irGenerator = std::make_shared<IRGenerator>(parser);
-
-        Compiler compiler(lexer, parser, irGenerator);
-        compiler.compile(inputFilePath, outputFilePath);
-        std::cout << "Compilation successful. Assembly written to "
-                  << outputFilePath << "\n";
+        if (!context.daemon) {
+            opened = cacheOptions.open();
+            cache = opened.get();
+        }
     } catch (const std::exception& e) {
-        std::cerr << "Compilation failed: " << e.what() << "\n";
+        err << "Could not read cache: " << e.what() << "\n";
         return 1;
     }
+    if (paths.empty() && cacheOptions.printStats && cache) {
+        cache->writeStats(out);
+        return 0;
+    }
+
+    if (paths.size() != (runProgram ? 1u : 2u)) {
+        printUsage(err, argv[0]);
+        return 1;
+    }
+
+    // A daemon has no stdin of its own; the client sent its stdin along
+    bool buffered = context.daemon && paths[0] == "-";
+    const std::string inputFilePath = context.resolve(paths[0]);
+    bool reporting = timeReport || !jsonReportPath.empty();
+    if (reporting) {
+        HeapStats::enable();
+    }
 
+    auto writeReports = [&](const CompileReport& report) {
+        if (timeReport) {
+            report.writeText(err);
+        }
+        if (jsonReportPath == "-") {
+            report.writeJson(out);
+        } else if (!jsonReportPath.empty()) {
+            std::ofstream json(jsonReportPath);
+            if (!json.is_open()) {
+                throw std::runtime_error("Could not open report file: " +
+                                         jsonReportPath);
+            }
+            report.writeJson(json);
+        }
+    };
+
+    CompileReport report;
+    if (reporting) {
+        compiler.setReport(&report);
+    }
+    compiler.setThreads(threads);
+
+    if (runProgram) {
+        try {
+            if (!levelSpec.empty()) {
+                compiler.setOptimizationLevel(
+                  Optimizer::parseLevel(levelSpec));
+            }
+            // JIT code runs in this process, so a program that crashes
+            // would take every other client's request down with it
+            if (interpret || context.daemon) {
+                compiler.setEngine(Compiler::Engine::Interpreter);
+            }
+            int status = buffered ? compiler.runSource(context.input)
+                                  : compiler.run(inputFilePath);
+            writeReports(report);
+            return status;
+        } catch (const std::exception& e) {
+            err << "Run failed: " << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    const std::string& outputFilePath = paths[1];
+
+    try {
+        compiler.setCache(cache);
+        compiler.setIROutput(irOutputPath);
+        if (!levelSpec.empty()) {
+            compiler.setOptimizationLevel(Optimizer::parseLevel(levelSpec));
+        }
+        auto target = targetSpec.empty() ? Compiler::Target::Tac
+                                         : Compiler::parseTarget(targetSpec);
+        compiler.setTarget(target);
+        if (!registerSpec.empty()) {
+            // A count means machine registers when there is a machine
+            bool count = registerSpec.find_first_not_of("0123456789") ==
+                         std::string::npos;
+            compiler.setRegisters(
+              target == Compiler::Target::X86_64 && count
+                ? X86Writer::allocatableRegisters(
+                    std::strtoul(registerSpec.c_str(), nullptr, 10))
+                : RegisterSet::parse(registerSpec));
+        }
+        if (buffered) {
+            FileSink sink(context.resolve(outputFilePath));
+            compiler.compileSource(context.input, sink);
+        } else {
+            compiler.compile(inputFilePath, context.resolve(outputFilePath));
+        }
+        out << "Compilation successful. Assembly written to "
+            << outputFilePath << "\n";
+        if (cache && cacheOptions.printStats) {
+            cache->writeStats(out);
+        }
+
+        writeReports(report);
+    } catch (const std::exception& e) {
+        err << "Compilation failed: " << e.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
+
+CompileServer* activeServer = nullptr;
+
+void stopServer(int)
+{
+    if (activeServer) {
+        activeServer->stop();
+    }
+}
+
+// cpp_compiler --serve SOCKET: answers tinycpp_client requests until
+// SIGINT or SIGTERM. Every worker thread keeps one Compiler for all the
+// requests it serves, so its interner, token lists, arena and writer buffer
+// stay allocated and warm, and the cache is opened once for all of them.
+int runServer(int argc, const char* argv[])
+{
+    if (argc < 3) {
+        printUsage(std::cerr, argv[0]);
+        return 1;
+    }
+    std::string socketPath = argv[2];
+    unsigned threads = 0;
+    CacheOptions cacheOptions;
+    for (int i = 3; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (cacheOptions.parse(i, argc, argv)) {
+            continue;
+        } else if (arg == "-j" && i + 1 < argc) {
+            threads = static_cast<unsigned>(
+              std::strtoul(argv[++i], nullptr, 10));
+        } else {
+            printUsage(std::cerr, argv[0]);
+            return 1;
+        }
+    }
+
+    auto cache = cacheOptions.open();
+    const char* program = argv[0];
+    auto handler = [&cache, program](const ServerRequest& request) {
+        thread_local Compiler compiler;
+        compiler.resetOptions();
+
+        std::ostringstream out;
+        std::ostringstream err;
+        UnitContext context(compiler, out, err);
+        context.daemon = true;
+        context.directory = request.directory;
+        context.input = request.input;
+        context.cache = cache.get();
+
+        std::vector<const char*> args{ program };
+        for (const auto& arg : request.args) {
+            args.push_back(arg.c_str());
+        }
+        ServerResponse response;
+        response.status =
+          compileUnit(static_cast<int>(args.size()), args.data(), context);
+        response.out = out.str();
+        response.err = err.str();
+        return response;
+    };
+
+    CompileServer server(socketPath, handler, threads);
+    activeServer = &server;
+    struct sigaction action{};
+    action.sa_handler = stopServer;
+    sigemptyset(&action.sa_mask);
+    ::sigaction(SIGINT, &action, nullptr);
+    ::sigaction(SIGTERM, &action, nullptr);
+
+    std::cout << "Serving on " << socketPath << std::endl;
+    server.serve();
+    activeServer = nullptr;
     return 0;
 }
+
+} // namespace
+
+int main(int argc, const char* argv[])
+{
+    if (argc >= 2 && std::string(argv[1]) == "--batch") {
+        try {
+            return runBatch(argc, argv);
+        } catch (const std::exception& e) {
+            std::cerr << "Batch compilation failed: " << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    if (argc >= 2 && std::string(argv[1]) == "--serve") {
+        try {
+            return runServer(argc, argv);
+        } catch (const std::exception& e) {
+            std::cerr << "Daemon failed: " << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    auto lexer = std::make_shared<Lexer>();
+    auto parser = std::make_shared<Parser>(lexer);
+    auto irGenerator = std::make_shared<IRGenerator>(parser);
+    Compiler compiler(lexer, parser, irGenerator);
+    UnitContext context(compiler, std::cout, std::cerr);
+    return compileUnit(argc, argv, context);
+}
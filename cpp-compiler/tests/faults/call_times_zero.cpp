@@ -0,0 +1,10 @@
+// Multiplying a call by zero still makes the call, which faults
+int g(int n)
+{
+    return 10 / n;
+}
+
+int main()
+{
+    return g(0) * 0;
+}
@@ -0,0 +1,16 @@
+// Divides by zero two calls below main, so the fault has frames to unwind
+int divide(int a, int b)
+{
+    return a / b;
+}
+
+int half(int a, int b)
+{
+    return divide(a, b) / 2;
+}
+
+int main()
+{
+    int zero = 0;
+    return half(5, zero);
+}
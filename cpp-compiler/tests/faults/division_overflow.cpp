@@ -0,0 +1,7 @@
+// INT_MIN % -1 overflows like INT_MIN / -1, though its result would fit
+int main()
+{
+    int smallest = 0 - 2147483647 - 1;
+    int minusOne = 0 - 1;
+    return smallest % minusOne;
+}
@@ -0,0 +1,7 @@
+// Multiplying by zero must not drop a division that faults
+int main()
+{
+    int z = 0;
+    int r = 10 / z * 0;
+    return r;
+}
@@ -0,0 +1,9 @@
+// The quotient is never read, so at -O2 the division is a dead store, but
+// it still has to fault
+int main()
+{
+    int z = 0;
+    int r = 10 / z;
+    int q = 10 % z + 1;
+    return 0;
+}
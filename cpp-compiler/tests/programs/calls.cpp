@@ -0,0 +1,33 @@
+// Calls to functions spelled like generated labels, from inside branches
+// and loops that take labels of their own, and recursively
+int L2(int n)
+{
+    if (n > 1) {
+        return n * L2(n - 1);
+    }
+    return 1;
+}
+
+int L4(float x, int k)
+{
+    return x * k;
+}
+
+int L1()
+{
+    return 3;
+}
+
+int main()
+{
+    int sum = 0;
+    for (int i = 0; i < 4; i = i + 1) {
+        if (i > 1) {
+            sum = sum + L1();
+        } else {
+            sum = sum + L2(i + 3);
+        }
+    }
+    int scaled = L4(2.5, 4);
+    return sum + scaled - 46;
+}
@@ -0,0 +1,12 @@
+// At -O2 the first store to h is dead, and deleting it leaves only the
+// division that writes h to give it its type
+int main()
+{
+    float h = 0.0;
+    float x = 7.0;
+    h = x / 2;
+    if (h < 3.4 || h > 3.6) {
+        return 1;
+    }
+    return 0;
+}
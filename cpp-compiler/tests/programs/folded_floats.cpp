@@ -0,0 +1,28 @@
+// Floats written only by arithmetic that the optimizer folds into its
+// variable, so no MOV is left to give the variable its type
+float half(float x)
+{
+    return x / 2;
+}
+
+int main()
+{
+    int a = 7;
+    float h = a / 2;
+    float g = h / 2;
+    if (g < 1.4 || g > 1.6) {
+        return 1;
+    }
+
+    float x = 7;
+    float q = x / 2;
+    if (q < 3.4 || q > 3.6) {
+        return 2;
+    }
+
+    float inlined = half(7);
+    if (inlined < 3.4 || inlined > 3.6) {
+        return 3;
+    }
+    return 0;
+}
@@ -0,0 +1,28 @@
+// A function spelled like the labels the generator makes, declared after
+// a function whose branches already took some of those labels
+int f(int a)
+{
+    int r = 0;
+    if (a > 0) {
+        r = 40;
+    }
+    return r;
+}
+
+int L1()
+{
+    return 2;
+}
+
+int L3(int a)
+{
+    while (a > 0) {
+        a = a - 1;
+    }
+    return a;
+}
+
+int main()
+{
+    return f(1) + L1() + L3(5) - 42;
+}
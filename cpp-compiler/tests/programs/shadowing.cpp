@@ -0,0 +1,27 @@
+// An inner declaration shadows the outer variable of the same name until
+// its block ends; each binding is a separate variable.
+int keep(int a)
+{
+    {
+        int a = 10;
+        a = a + 1;
+    }
+    return a;
+}
+
+int main()
+{
+    int x = 1;
+    if (x > 0) {
+        int x = 5;
+        x = x + 1;
+    }
+    {
+        float x = 2.5;
+        x = x * 2.0;
+    }
+    for (int x = 0; x < 3; x = x + 1) {
+        int y = x;
+    }
+    return x - 1 + keep(3) - 3;
+}